@@ -0,0 +1,122 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+#include "geometry_batch.hpp"
+
+/**
+ * Retained-mode renderer for GeometryBatch geometry
+ *
+ * Static meshes (grid, obstacles) are uploaded once into their own vertex
+ * buffers. Per-frame geometry (torch, particle) is streamed through one
+ * ring buffer: each batch is written into the next free range with an
+ * unsynchronised map, and the buffer is orphaned when it wraps, so the CPU
+ * never waits for the GPU to finish reading earlier frames. Each run of
+ * same-type primitives in a batch is one draw call.
+ *
+ * Vertices go through the fixed-function client arrays, so the current
+ * projection and modelview matrices apply as they did for glBegin/glEnd.
+ * Vertex array objects and glMapBufferRange are used when the context
+ * provides them (GL 3.0 compatibility contexts, including Mesa llvmpipe),
+ * with GL 1.5 fallbacks otherwise.
+ */
+class BatchRenderer {
+public:
+    BatchRenderer();
+
+    /**
+     * Destructor - releases the GL objects (the context must still be current)
+     */
+    ~BatchRenderer();
+
+    BatchRenderer(const BatchRenderer&) = delete;
+    BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+    /**
+     * Create the GL objects (requires a current context)
+     * @param ringBytes Size of the streaming ring buffer
+     */
+    void initialize(std::size_t ringBytes = std::size_t(4) << 20);
+
+    /**
+     * Release all GL objects
+     */
+    void release();
+
+    bool isInitialized() const { return ringBuffer_ != 0; }
+
+    /**
+     * Upload a static mesh
+     * @param batch The geometry
+     * @return Handle for drawStatic() and updateStatic()
+     */
+    std::size_t uploadStatic(const GeometryBatch& batch);
+
+    /**
+     * Replace the contents of a static mesh
+     * @param mesh Handle returned by uploadStatic()
+     * @param batch The new geometry
+     */
+    void updateStatic(std::size_t mesh, const GeometryBatch& batch);
+
+    /**
+     * Draw a static mesh
+     * @param mesh Handle returned by uploadStatic()
+     */
+    void drawStatic(std::size_t mesh);
+
+    /**
+     * Stream a batch through the ring buffer and draw it
+     * @param batch The geometry
+     */
+    void drawDynamic(const GeometryBatch& batch);
+
+    /**
+     * Reset the per-frame statistics
+     */
+    void beginFrame();
+
+    // Per-frame statistics
+    std::size_t getDrawCallCount() const { return drawCalls_; }
+    std::size_t getStreamedBytes() const { return streamedBytes_; }
+
+private:
+    struct Mesh {
+        GLuint buffer;
+        GLuint vertexArray;
+        std::vector<BatchCommand> commands;
+    };
+
+    /**
+     * Create a vertex array object recording the vertex layout of a buffer
+     */
+    GLuint createVertexArray(GLuint buffer);
+
+    /**
+     * Bind a buffer's vertex layout for drawing
+     */
+    void bind(GLuint buffer, GLuint vertexArray);
+    void unbind(GLuint vertexArray);
+
+    /**
+     * Issue the draw calls of a batch
+     * @param commands The batch's commands
+     * @param baseVertex Position of the batch's first vertex in the bound buffer
+     */
+    void drawCommands(const std::vector<BatchCommand>& commands, GLint baseVertex);
+
+    bool useVertexArrays_;
+    bool useMapBufferRange_;
+
+    std::vector<Mesh> meshes_;
+
+    // Streaming ring buffer
+    GLuint ringBuffer_;
+    GLuint ringVertexArray_;
+    std::size_t ringBytes_;
+    std::size_t ringOffset_;
+
+    std::size_t drawCalls_;
+    std::size_t streamedBytes_;
+};
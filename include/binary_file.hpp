@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+// Helpers shared by the binary file formats: snapshots, trajectories,
+// compiled maps and input recordings
+
+// Arrays inside the formats start at multiples of this many bytes
+constexpr std::uint64_t kFileArrayAlignment = 64;
+
+/**
+ * FILE handle that is closed on scope exit
+ */
+struct FileCloser {
+    void operator()(std::FILE* file) const { if (file) std::fclose(file); }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+/**
+ * Check whether the host stores integers little-endian, as every format does
+ */
+bool hostIsLittleEndian();
+
+/**
+ * Round a file offset up to the next multiple of kFileArrayAlignment
+ */
+std::uint64_t alignUp(std::uint64_t value);
+
+/**
+ * Write bytes to a file
+ * @param kind What is being written, for the error message ("snapshot", "map", ...)
+ * @param path Destination path, for the error message
+ * @throws std::runtime_error if the write fails
+ */
+void writeBytes(std::FILE* file, const void* data, std::size_t bytes, const char* kind, const std::string& path);
+
+/**
+ * Write zeros from position up to target (less than kFileArrayAlignment bytes on)
+ * @param position Current offset in the file; set to target
+ * @throws std::runtime_error if the write fails
+ */
+void padTo(std::FILE* file, std::uint64_t& position, std::uint64_t target, const char* kind, const std::string& path);
+
+/**
+ * Move a finished file over its destination in one step
+ *
+ * Readers see either the old file or the new one, never neither: POSIX
+ * rename() replaces the destination atomically, and Windows uses
+ * MoveFileEx with MOVEFILE_REPLACE_EXISTING.
+ * @param from Path of the finished file (usually written beside the destination)
+ * @param to Destination path
+ * @return Whether the file was moved
+ */
+bool replaceFile(const std::string& from, const std::string& to);
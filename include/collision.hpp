@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "obstacle.hpp"
+#include "obstacle_grid.hpp"
+
+/**
+ * First contact of a moving circle with an obstacle
+ */
+struct SweepHit {
+    double time;     // Fraction of the displacement covered before contact, in [0, 1]
+    double normalX;  // Unit contact normal, pointing away from the obstacle
+    double normalY;
+};
+
+/**
+ * Sweep a circle along a straight displacement against one obstacle
+ *
+ * The circle-vs-rectangle test is done as a ray cast against the rectangle
+ * grown by the radius (with rounded corners), so it is exact and cannot
+ * tunnel through thin walls. A circle that already overlaps the obstacle
+ * hits at time 0 unless it is moving away from it.
+ * @param obstacle The obstacle to test
+ * @param x Start centre x
+ * @param y Start centre y
+ * @param dx Displacement along x
+ * @param dy Displacement along y
+ * @param radius Circle radius
+ * @param hit Receives the contact when there is one
+ * @return true if the circle touches the obstacle during the displacement
+ */
+bool sweepCircle(const Obstacle& obstacle, double x, double y, double dx, double dy,
+                 double radius, SweepHit& hit);
+
+/**
+ * Outcome of moving a circle through the obstacles with sliding
+ */
+struct SlideResult {
+    static constexpr int kMaxContacts = 4;
+
+    double x, y;                     // Resolved centre
+    int contactCount;                // Number of contacts along the way
+    double normalX[kMaxContacts];    // Contact normals, in the order they were hit
+    double normalY[kMaxContacts];
+};
+
+/**
+ * Static set of obstacles with swept-circle queries
+ *
+ * Obstacles are indexed in an ObstacleGrid, so each query only tests the
+ * obstacles near the swept path. Queries are const and safe to run from
+ * several threads at once.
+ */
+class ObstacleCollider {
+public:
+    /**
+     * Replace the obstacle set and rebuild the index
+     * @param obstacles The new obstacles
+     */
+    void setObstacles(std::vector<Obstacle> obstacles);
+
+    /**
+     * Use an obstacle array and its prebuilt grid from external memory
+     * (such as a mapped map file) without copying either
+     * @param owner Keeps the obstacles and grid arrays alive
+     * @param obstacles Obstacle array
+     * @param count Number of obstacles
+     * @param grid Grid built over exactly these obstacles
+     */
+    void adoptObstacles(std::shared_ptr<const void> owner, const Obstacle* obstacles, std::size_t count,
+                        const ObstacleGrid::Baked& grid);
+
+    /**
+     * Remove all obstacles
+     */
+    void clear();
+
+    const Obstacle* getObstacles() const { return adoptedOwner_ ? adoptedObstacles_ : obstacles_.data(); }
+    std::size_t getObstacleCount() const { return adoptedOwner_ ? adoptedCount_ : obstacles_.size(); }
+    const ObstacleGrid& getGrid() const { return grid_; }
+    bool empty() const { return getObstacleCount() == 0; }
+
+    /**
+     * Check whether a circle overlaps any obstacle
+     * @param x Centre x
+     * @param y Centre y
+     * @param radius Circle radius
+     */
+    bool overlaps(double x, double y, double radius) const;
+
+    /**
+     * Find the earliest contact of a moving circle with any obstacle
+     * @param x Start centre x
+     * @param y Start centre y
+     * @param dx Displacement along x
+     * @param dy Displacement along y
+     * @param radius Circle radius
+     * @param hit Receives the earliest contact when there is one
+     * @return true if the circle touches an obstacle during the displacement
+     */
+    bool sweep(double x, double y, double dx, double dy, double radius, SweepHit& hit) const;
+
+    /**
+     * Move a circle, sliding along the obstacles it runs into
+     *
+     * At each contact the circle stops at the exact time of impact and the
+     * rest of the displacement is projected onto the contact plane. After
+     * SlideResult::kMaxContacts contacts the remaining motion is dropped.
+     * @param x Start centre x
+     * @param y Start centre y
+     * @param dx Displacement along x
+     * @param dy Displacement along y
+     * @param radius Circle radius
+     * @return The resolved position and the contacts made
+     */
+    SlideResult slide(double x, double y, double dx, double dy, double radius) const;
+
+private:
+    std::vector<Obstacle> obstacles_;
+    ObstacleGrid grid_;
+
+    // Obstacles adopted by adoptObstacles(), used instead of obstacles_
+    std::shared_ptr<const void> adoptedOwner_;
+    const Obstacle* adoptedObstacles_ = nullptr;
+    std::size_t adoptedCount_ = 0;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+/**
+ * Instruction sets usable on the running machine
+ *
+ * A feature is only reported when both the CPU and the operating system
+ * support it (the OS must save the wider registers on context switches).
+ */
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2 = false;
+    bool avx512f = false;
+};
+
+/**
+ * Get the features of the CPU this process runs on (detected once)
+ */
+const CpuFeatures& cpuFeatures();
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * Fixed-timestep accumulator that decouples simulation rate from frame rate
+ *
+ * Each frame reports its elapsed wall time; advance() returns how many
+ * fixed steps to run so that simulated time keeps pace with real time.
+ * The remainder is exposed as an interpolation factor for rendering. At
+ * most maxSubsteps steps run per frame: if a frame falls further behind,
+ * the excess time is dropped instead of being carried into ever longer
+ * catch-up frames (the "spiral of death").
+ */
+class FixedTimestep {
+public:
+    /**
+     * Constructor
+     * @param stepSeconds Length of one simulation step in seconds
+     * @param maxSubsteps Maximum number of steps run for a single frame
+     */
+    FixedTimestep(double stepSeconds, int maxSubsteps)
+        : stepSeconds_(stepSeconds), maxSubsteps_(maxSubsteps), accumulator_(0.0), droppedSeconds_(0.0) {
+        if (stepSeconds <= 0.0) {
+            throw std::invalid_argument("Fixed step must be positive");
+        }
+        if (maxSubsteps < 1) {
+            throw std::invalid_argument("Max substeps must be at least 1");
+        }
+    }
+
+    /**
+     * Add a frame's elapsed time and get the number of steps to run
+     * @param frameSeconds Wall time since the previous frame
+     * @return Number of fixed steps to run this frame (0..maxSubsteps)
+     */
+    int advance(double frameSeconds) {
+        accumulator_ += std::max(0.0, frameSeconds);
+
+        int steps = static_cast<int>(accumulator_ / stepSeconds_);
+        if (steps > maxSubsteps_) {
+            // Too far behind: run what we can and forget the rest
+            double excess = accumulator_ - maxSubsteps_ * stepSeconds_;
+            double keep = excess - static_cast<int>(excess / stepSeconds_) * stepSeconds_;
+            droppedSeconds_ += excess - keep;
+            accumulator_ = maxSubsteps_ * stepSeconds_ + keep;
+            steps = maxSubsteps_;
+        }
+
+        accumulator_ -= steps * stepSeconds_;
+        return steps;
+    }
+
+    /**
+     * Interpolation factor between the last two simulation states
+     * @return Fraction of a step left in the accumulator, in [0, 1)
+     */
+    double getAlpha() const { return accumulator_ / stepSeconds_; }
+
+    // Length of one step in seconds
+    double getStep() const { return stepSeconds_; }
+
+    // Maximum number of steps per frame
+    int getMaxSubsteps() const { return maxSubsteps_; }
+
+    // Total wall time discarded because frames were too slow
+    double getDroppedSeconds() const { return droppedSeconds_; }
+
+private:
+    double stepSeconds_;
+    int maxSubsteps_;
+    double accumulator_;
+    double droppedSeconds_;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "particle_store.hpp"
+#include "vector3d.hpp"
+
+/**
+ * Base class for forces applied by the simulation
+ *
+ * A generator processes a whole range of particles per call, so the cost of
+ * the virtual dispatch is paid once per batch rather than once per particle.
+ */
+class ForceGenerator {
+public:
+    virtual ~ForceGenerator() = default;
+
+    /**
+     * Add this generator's forces to the particles' force accumulators
+     * @param particles The particle store
+     * @param begin First particle to process
+     * @param end One past the last particle to process
+     */
+    virtual void apply(ParticleStore& particles, std::size_t begin, std::size_t end) const = 0;
+
+    /**
+     * Whether apply() only writes the forces of particles inside [begin, end)
+     *
+     * Per-particle generators are fused and run in parallel chunks. Others
+     * (such as springs, which write to both ends of a pair) are called once
+     * with the full range on a single thread.
+     */
+    virtual bool isPerParticle() const { return true; }
+};
+
+/**
+ * Constant acceleration field: F = m * g
+ */
+class UniformGravity : public ForceGenerator {
+public:
+    explicit UniformGravity(const Vector3D& acceleration) : acceleration_(acceleration) {}
+
+    void apply(ParticleStore& particles, std::size_t begin, std::size_t end) const override;
+
+    void setAcceleration(const Vector3D& acceleration) { acceleration_ = acceleration; }
+    const Vector3D& getAcceleration() const { return acceleration_; }
+
+private:
+    Vector3D acceleration_;
+};
+
+/**
+ * Velocity-proportional drag: F = -k * v
+ */
+class LinearDrag : public ForceGenerator {
+public:
+    explicit LinearDrag(double coefficient) : coefficient_(coefficient) {}
+
+    void apply(ParticleStore& particles, std::size_t begin, std::size_t end) const override;
+
+    void setCoefficient(double coefficient) { coefficient_ = coefficient; }
+    double getCoefficient() const { return coefficient_; }
+
+private:
+    double coefficient_;
+};
+
+/**
+ * Softened inverse-square pull towards a fixed point:
+ * F = strength * m * r / (|r|^2 + softening^2)^(3/2)
+ */
+class PointAttractor : public ForceGenerator {
+public:
+    PointAttractor(const Vector3D& center, double strength, double softening = 0.01)
+        : center_(center), strength_(strength), softening_(softening) {}
+
+    void apply(ParticleStore& particles, std::size_t begin, std::size_t end) const override;
+
+    void setCenter(const Vector3D& center) { center_ = center; }
+    const Vector3D& getCenter() const { return center_; }
+    double getStrength() const { return strength_; }
+    double getSoftening() const { return softening_; }
+
+private:
+    Vector3D center_;
+    double strength_;
+    double softening_;
+};
+
+/**
+ * Damped Hooke springs between pairs of particles
+ */
+class SpringForce : public ForceGenerator {
+public:
+    struct Spring {
+        std::uint32_t a, b;
+        double restLength;
+        double stiffness;
+        double damping;
+    };
+
+    /**
+     * Add a spring between two particles
+     * @param a Index of the first particle
+     * @param b Index of the second particle
+     * @param restLength Length at which the spring exerts no force
+     * @param stiffness Spring constant
+     * @param damping Damping along the spring axis
+     */
+    void addSpring(std::size_t a, std::size_t b, double restLength, double stiffness, double damping = 0.0);
+
+    void apply(ParticleStore& particles, std::size_t begin, std::size_t end) const override;
+    bool isPerParticle() const override { return false; }
+
+    std::size_t getSpringCount() const { return springs_.size(); }
+    const std::vector<Spring>& getSprings() const { return springs_; }
+
+private:
+    std::vector<Spring> springs_;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "obstacle.hpp"
+#include "obstacle_grid.hpp"
+
+/**
+ * Area the player is kept inside
+ */
+struct MapBounds {
+    float minX, minY;
+    float maxX, maxY;
+};
+
+/**
+ * Point where the player can start a session
+ */
+struct MapSpawn {
+    float x, y;
+    std::string name;
+};
+
+/**
+ * Objective marker, drawn as a circle with its name inside
+ */
+struct MapSite {
+    float x, y;
+    float radius;
+    std::string name;
+};
+
+/**
+ * Text drawn on the map
+ */
+struct MapLabel {
+    float x, y;
+    std::string text;
+};
+
+/**
+ * A playable map: walls, bounds, spawn points, site markers and labels
+ *
+ * Maps come from three places: defaultMap() builds the original layout,
+ * readMapText() parses the authoring format, and loadCompiledMap() maps a
+ * file written by writeCompiledMap(). A compiled map's wall array and
+ * obstacle grid are used straight from the mapping, so opening a map with
+ * tens of thousands of walls costs little more than reading its header.
+ *
+ * Text format, one item per line (# starts a comment):
+ *   bounds MINX MINY MAXX MAXY
+ *   wall X Y WIDTH HEIGHT        (centre and size)
+ *   spawn X Y NAME
+ *   site X Y RADIUS NAME
+ *   label X Y TEXT...            (the rest of the line)
+ */
+class GameMap {
+public:
+    GameMap();
+
+    /**
+     * Set the area the player is kept inside
+     * @param bounds The bounds (min must be below max)
+     */
+    void setBounds(const MapBounds& bounds);
+    const MapBounds& getBounds() const { return bounds_; }
+
+    /**
+     * Add a wall; copies mapped walls first if the map was compiled
+     * @param obstacle The wall
+     */
+    void addObstacle(const Obstacle& obstacle);
+    void addSpawn(const MapSpawn& spawn) { spawns_.push_back(spawn); }
+    void addSite(const MapSite& site) { sites_.push_back(site); }
+    void addLabel(const MapLabel& label) { labels_.push_back(label); }
+
+    const Obstacle* getObstacles() const { return mapping_ ? mappedObstacles_ : obstacles_.data(); }
+    std::size_t getObstacleCount() const { return mapping_ ? mappedCount_ : obstacles_.size(); }
+    const std::vector<MapSpawn>& getSpawns() const { return spawns_; }
+    const std::vector<MapSite>& getSites() const { return sites_; }
+    const std::vector<MapLabel>& getLabels() const { return labels_; }
+
+    /**
+     * Build the obstacle grid over the current walls
+     * @param cellSize Cell edge length, or 0 to pick one from the wall density
+     */
+    void buildGrid(float cellSize = 0.0f);
+
+    /**
+     * Grid over the walls (built by buildGrid() or read from a compiled map)
+     */
+    const ObstacleGrid& getGrid() const { return grid_; }
+
+    /**
+     * Check whether the walls and grid are read from a mapped file
+     */
+    bool isMapped() const { return mapping_ != nullptr; }
+
+    /**
+     * Hash of the map's contents (bounds, walls, spawns, sites and labels)
+     *
+     * Identifies a map independently of where it was loaded from: the text
+     * and compiled forms of the same map hash the same.
+     */
+    std::uint64_t fingerprint() const;
+
+private:
+    friend GameMap loadCompiledMap(const std::string& path);
+
+    MapBounds bounds_;
+    std::vector<Obstacle> obstacles_;
+    std::vector<MapSpawn> spawns_;
+    std::vector<MapSite> sites_;
+    std::vector<MapLabel> labels_;
+    ObstacleGrid grid_;
+
+    // Walls inside a mapped compiled file, used instead of obstacles_
+    std::shared_ptr<const void> mapping_;
+    const Obstacle* mappedObstacles_;
+    std::size_t mappedCount_;
+};
+
+/**
+ * Build the original hand-made layout, scaled to an aspect ratio
+ *
+ * The map spans [-5 * aspectRatio, 5 * aspectRatio] x [-5, 5], as the
+ * game's view does.
+ * @param aspectRatio Width over height of the layout
+ * @return The map, with its grid built
+ */
+GameMap defaultMap(float aspectRatio);
+
+/**
+ * Parse a map in the text format
+ * @param path Map file
+ * @return The map, with its grid built
+ */
+GameMap readMapText(const std::string& path);
+
+/**
+ * Write a map in the text format
+ * @param path Destination file
+ * @param map Map to write
+ */
+void writeMapText(const std::string& path, const GameMap& map);
+
+/**
+ * Write a map in the compiled binary format, with its grid baked in
+ * @param path Destination file
+ * @param map Map to write (its grid must be built)
+ */
+void writeCompiledMap(const std::string& path, const GameMap& map);
+
+/**
+ * Map a compiled map file
+ *
+ * The header and the grid arrays are validated; the walls and grid are
+ * then used in place.
+ * @param path Compiled map file
+ * @return The map
+ */
+GameMap loadCompiledMap(const std::string& path);
+
+/**
+ * Load a map in either format, telling them apart by the file's magic
+ * @param path Map file
+ * @return The map, with its grid built
+ */
+GameMap loadMap(const std::string& path);
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vector3d.hpp"
+
+/**
+ * RGBA colour of a batched vertex
+ */
+struct BatchColor {
+    float r, g, b, a;
+};
+
+/**
+ * Vertex layout shared by the CPU batches and the GPU buffers
+ */
+struct BatchVertex {
+    float x, y, z;
+    BatchColor color;
+};
+
+/**
+ * Per-instance data of an instanced particle (32 bytes)
+ */
+struct ParticleInstance {
+    float x, y, z;
+    float radius;
+    BatchColor color;
+};
+
+/**
+ * Convert particle positions into instance records
+ * @param positions Particle positions
+ * @param count Number of particles
+ * @param radius Drawn radius of every particle
+ * @param color Colour of every particle
+ * @param out Receives count instances (may be mapped GPU memory)
+ */
+void packParticleInstances(const Vector3D* positions, std::size_t count, float radius,
+                           const BatchColor& color, ParticleInstance* out);
+
+/**
+ * Primitive type of a run of batched vertices
+ */
+enum class BatchPrimitive : std::uint8_t {
+    Triangles,
+    Lines
+};
+
+/**
+ * One draw call: a run of vertices with the same primitive and line width
+ */
+struct BatchCommand {
+    BatchPrimitive primitive;
+    float lineWidth;        // Only used for lines
+    std::uint32_t first;    // Index of the first vertex
+    std::uint32_t count;    // Number of vertices
+};
+
+/**
+ * CPU-side list of coloured geometry, ready to be uploaded in one buffer
+ *
+ * Fans, strips and quads are tessellated into plain triangles, and lines
+ * into segment pairs, so a batch draws with one call per run of the same
+ * primitive type instead of one call per shape. Submission order is kept,
+ * which matters for blended geometry. The batch has no GL dependency;
+ * BatchRenderer draws it.
+ */
+class GeometryBatch {
+public:
+    /**
+     * Remove all geometry, keeping the storage for the next frame
+     */
+    void clear();
+
+    /**
+     * Reserve storage
+     * @param vertexCount Number of vertices to make room for
+     */
+    void reserve(std::size_t vertexCount) { vertices_.reserve(vertexCount); }
+
+    /**
+     * Add a triangle
+     */
+    void addTriangle(const BatchVertex& a, const BatchVertex& b, const BatchVertex& c);
+
+    /**
+     * Add a quad given by its corners in order (split into two triangles)
+     */
+    void addQuad(const BatchVertex& a, const BatchVertex& b, const BatchVertex& c, const BatchVertex& d);
+
+    /**
+     * Add a quad strip, as GL_QUAD_STRIP would draw it
+     * @param vertices Vertex pairs, one pair per row of the strip
+     * @param count Number of vertices (pairs * 2)
+     */
+    void addQuadStrip(const BatchVertex* vertices, std::size_t count);
+
+    /**
+     * Add an axis-aligned rectangle
+     * @param x Centre x
+     * @param y Centre y
+     * @param width Rectangle width
+     * @param height Rectangle height
+     * @param z Depth of the rectangle
+     * @param color Fill colour
+     */
+    void addRectangle(float x, float y, float width, float height, float z, const BatchColor& color);
+
+    /**
+     * Add a filled circle as a fan of triangles
+     * @param x Centre x
+     * @param y Centre y
+     * @param z Depth of the circle
+     * @param radius Circle radius
+     * @param segments Number of rim segments
+     * @param centerColor Colour at the centre
+     * @param rimColor Colour at the rim (blended towards the centre)
+     */
+    void addCircle(float x, float y, float z, float radius, int segments,
+                   const BatchColor& centerColor, const BatchColor& rimColor);
+
+    /**
+     * Add a line segment
+     * @param lineWidth Line width in pixels
+     */
+    void addLine(const BatchVertex& a, const BatchVertex& b, float lineWidth = 1.0f);
+
+    /**
+     * Add a connected line strip
+     * @param vertices Points of the strip
+     * @param count Number of points
+     * @param lineWidth Line width in pixels
+     */
+    void addLineStrip(const BatchVertex* vertices, std::size_t count, float lineWidth = 1.0f);
+
+    // Tessellated geometry and the draw calls covering it
+    const std::vector<BatchVertex>& getVertices() const { return vertices_; }
+    const std::vector<BatchCommand>& getCommands() const { return commands_; }
+    bool empty() const { return vertices_.empty(); }
+
+private:
+    /**
+     * Extend the last command, or start a new one, for count more vertices
+     */
+    void beginRun(BatchPrimitive primitive, float lineWidth, std::size_t count);
+
+    std::vector<BatchVertex> vertices_;
+    std::vector<BatchCommand> commands_;
+};
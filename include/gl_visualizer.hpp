@@ -2,33 +2,35 @@
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
 #include <vector>
 #ifdef __APPLE__
 #include <GLUT/glut.h> // macOS path
 #else
 #include <GL/freeglut.h> // Linux/Windows path
 #endif
+#include "batch_renderer.hpp"
+#include "fixed_timestep.hpp"
+#include "game_map.hpp"
+#include "geometry_batch.hpp"
+#include "input.hpp"
+#include "obstacle.hpp"
+#include "particle_renderer.hpp"
+#include "player_controller.hpp"
 #include "simulation.hpp"
+#include "spsc_queue.hpp"
+#include "torch_rays.hpp"
+#include "triple_buffer.hpp"
 #include "vector3d.hpp" // Implied import for Vector3D
 
 
-/**
- * Simple struct to represent a rectangular obstacle
- */
-struct Obstacle {
-    float x, y;        // Center position
-    float width, height; // Dimensions
-    
-    Obstacle(float x, float y, float width, float height)
-        : x(x), y(y), width(width), height(height) {}
-        
-    // Check if a point is inside the obstacle
-    bool contains(float px, float py) const {
-        return (px >= x - width/2 && px <= x + width/2 &&
-                py >= y - height/2 && py <= y + height/2);
-    }
-};
-
 /**
  * Class to visualize the physics simulation using OpenGL
  */
@@ -40,9 +42,11 @@ public:
      * @param width Window width
      * @param height Window height
      * @param title Window title
+     * @param seed Seed for the spawn choice and the torch effect, so a
+     *             recorded session can be replayed
      */
     GLVisualizer(Simulation& simulation, unsigned int width = 800, unsigned int height = 600, 
-               const std::string& title = "Physics Simulation");
+               const std::string& title = "Physics Simulation", std::uint32_t seed = 1);
     
     /**
      * Destructor
@@ -59,26 +63,166 @@ public:
      */
     void toggleCameraMode();
     
-    // Key state variables (public for callback access)
-    bool keyW_, keyA_, keyS_, keyD_;
-    bool keyK_, keyL_; // K and L keys for rotation
+    /**
+     * Replace the built-in map
+     *
+     * Rebuilds the static geometry and respawns the player. Must be called
+     * before run().
+     * @param map The map, e.g. from loadMap()
+     */
+    void setMap(std::shared_ptr<const GameMap> map);
+    
+    /**
+     * Configure the fixed simulation rate
+     * @param stepsPerSecond Simulation steps per second of real time
+     * @param maxSubsteps Maximum steps run for one rendered frame
+     */
+    void setPhysicsRate(double stepsPerSecond, int maxSubsteps);
+    
+    /**
+     * Run the simulation on its own thread during run()
+     *
+     * The simulation thread publishes particle snapshots that the render
+     * loop picks up without blocking and blends like the single-threaded
+     * loop does, and key presses reach it through a lock-free command queue.
+     * @param enabled Whether to use a dedicated simulation thread
+     */
+    void setThreadedSimulation(bool enabled) { threadedSimulation_ = enabled; }
+    
+    /**
+     * Log the keys held during every simulation tick of run()
+     *
+     * The recording, with the seed and step, is written to the file when
+     * run() returns; phy_headless --replay plays it back without a window.
+     * @param path Destination file
+     */
+    void recordInput(const std::string& path);
+    
+    /**
+     * Write the profiler's buffered zone timings when run() returns
+     *
+     * The file is in the Chrome trace event format (chrome://tracing or
+     * ui.perfetto.dev) and covers the last few thousand frames.
+     * @param path Destination file
+     */
+    void exportProfileTrace(const std::string& path);
+    
+    /**
+     * Show or hide the per-phase frame timings (rolling min/avg/p99)
+     */
+    void toggleProfilerOverlay();
+    
+    /**
+     * Measure frame time against particle count instead of running the game
+     *
+     * Renders synthetic particles scattered over the map for each count and
+     * prints the average and best frame time with the draw-call count, for
+     * the instanced path and, up to 100k particles, the batched fallback.
+     * @param counts Particle counts to measure
+     * @param frames Frames rendered per count
+     */
+    void runRenderBenchmark(const std::vector<std::size_t>& counts, int frames);
+    
+    /**
+     * Record a key press or release from the window
+     * @param key The key that changed
+     * @param pressed Whether the key is now held down
+     */
+    void setKeyState(InputKey key, bool pressed);
     
 private:
+    /**
+     * State needed to draw a frame, captured after each simulation step
+     */
+    struct RenderState {
+        Vector3D position;   // Central particle position
+        float rotationAngle; // Torch angle in radians
+        bool hasParticle;    // Whether the simulation has a central particle
+    };
+    
+    /**
+     * Immutable view of the simulation published by the simulation thread
+     */
+    struct SimulationSnapshot {
+        std::vector<Vector3D> positions; // Positions of all particles after the latest step
+        RenderState previous{};          // State before the latest step
+        RenderState current{};           // State after the latest step
+        double alpha = 0.0;              // Fraction of a step accumulated when published
+        double step = 0.0;               // Step length in seconds
+        std::chrono::steady_clock::time_point publishedAt;
+    };
+    
     /**
      * Initialize OpenGL
      */
     bool initGL();
     
     /**
-     * Process a single frame of the visualization
+     * Advance input handling and the simulation by one fixed step
+     * @param dt Step length in seconds
+     */
+    void tick(double dt);
+    
+    /**
+     * Render loop with the simulation stepped on the same thread
+     */
+    void runSingleThreaded();
+    
+    /**
+     * Render loop with the simulation stepped on its own thread
+     */
+    void runThreaded();
+    
+    /**
+     * Body of the simulation thread
+     */
+    void simulationThreadLoop();
+    
+    /**
+     * Ask the simulation thread to finish and wait for it (no-op when not running)
+     */
+    void stopSimulationThread();
+    
+    /**
+     * Update the key state read by the simulation step
+     * @param key The key that changed
+     * @param pressed Whether the key is now held down
+     */
+    void applyKeyState(InputKey key, bool pressed);
+    
+    /**
+     * Apply key transitions queued by the window thread
+     */
+    void drainInputCommands();
+    
+    /**
+     * Copy the current simulation state into the triple buffer
+     */
+    void publishSnapshot();
+    
+    /**
+     * Capture the current simulation state for rendering
      */
-    void update();
+    RenderState captureRenderState();
+    
+    /**
+     * Blend two captured states into the state drawn this frame
+     * @param previous State before the latest step
+     * @param current State after the latest step
+     * @param alpha Interpolation factor (0 = previous step, 1 = latest step)
+     */
+    void interpolateRenderState(const RenderState& previous, const RenderState& current, float alpha);
     
     /**
      * Render the current state of the simulation
      */
     void render();
     
+    /**
+     * Draw the profiler's rolling per-zone timings in the top left corner
+     */
+    void drawProfilerOverlay();
+    
     /**
      * Update the camera position to follow the particle
      */
@@ -90,23 +234,31 @@ private:
     void setupPerspective();
     
     /**
-     * Draw a circle at the given position with the given radius
-     * @param x X coordinate
-     * @param y Y coordinate
-     * @param radius Radius of the circle
-     * @param segments Number of segments to use for the circle
+     * Draw the simulation's particles, except the central one
+     *
+     * Uses the instanced renderer when available; otherwise the particles
+     * are added to the batch as circles.
+     * @param batch Batch receiving the particles on the fallback path
+     * @param first Index of the first particle to draw
      */
-    void drawCircle(float x, float y, float radius, int segments);
+    void drawParticles(GeometryBatch& batch, std::size_t first);
     
     /**
-     * Draw a torch light effect in the direction of the mouse
+     * Build the static meshes (grid, obstacles, site markers) for the
+     * current window aspect ratio and upload them
+     */
+    void buildStaticGeometry();
+    
+    /**
+     * Add the torch light effect to a batch
+     * @param batch Batch receiving the geometry
      * @param x X coordinate of the base
      * @param y Y coordinate of the base
      * @param dirX X component of the direction
      * @param dirY Y component of the direction
      * @param length Base length of the torch light
      */
-    void drawTorch(float x, float y, float dirX, float dirY, float length);
+    void drawTorch(GeometryBatch& batch, float x, float y, float dirX, float dirY, float length);
     
     /**
      * Draw text at the specified position
@@ -127,28 +279,10 @@ private:
     void drawSiteMarkers();
     
     /**
-     * Draw a grid overlay on the map for tactical look
+     * Add a grid overlay for a tactical look to a batch
+     * @param batch Batch receiving the grid lines
      */
-    void drawGrid();
-    
-    /**
-     * Draw a rectangle (used for obstacles)
-     * @param x Center X coordinate
-     * @param y Center Y coordinate
-     * @param width Width of the rectangle
-     * @param height Height of the rectangle
-     */
-    void drawRectangle(float x, float y, float width, float height);
-    
-    /**
-     * Initialize obstacles in the map
-     */
-    void initializeObstacles();
-    
-    /**
-     * Place the particle in a valid position that doesn't collide with obstacles
-     */
-    void placeParticleInValidPosition();
+    void drawGrid(GeometryBatch& batch);
     
     /**
      * Check if a position collides with any obstacle
@@ -159,16 +293,6 @@ private:
      */
     bool checkObstacleCollision(float x, float y, float radius);
     
-    /**
-     * Handle keyboard input
-     */
-    void handleKeyboardInput();
-    
-    /**
-     * Update the direction based on keyboard input (K and L keys)
-     */
-    void updateDirection();
-    
     // GLFW window
     GLFWwindow* window_;
     
@@ -180,28 +304,67 @@ private:
     unsigned int height_;
     
     // Visualization parameters
-    const float particleRadius_ = 0.15f; // Reduced particle size (was 0.2f)
+    const float particleRadius_ = PlayerController::kParticleRadius;
     int particleSegments_;
     
-    // Direction vector (normalized)
-    float directionX_;
-    float directionY_;
-    float rotationAngle_; // Current rotation angle in radians
-    float rotationSpeed_; // Rotation speed in radians per frame
+    // Map layout, held keys and torch angle, applied to the simulation each tick
+    PlayerController controller_;
+    std::string inputRecordingPath_; // Where run() saves the key log (empty when not recording)
+    
+    // Seeded generator for the torch's volumetric specks
+    std::mt19937 effectRng_;
+    
+    // Fixed-step clock driving the simulation
+    FixedTimestep timestep_;
+    
+    // Simulation state before and after the latest step (owned by the
+    // simulation thread while it runs), and the blend drawn this frame
+    RenderState previousState_;
+    RenderState currentState_;
+    RenderState renderState_;
     
-    // Movement speed
-    float moveSpeed_;
+    // Dedicated simulation thread and its lock-free links to the render loop
+    bool threadedSimulation_;
+    std::thread simulationThread_;
+    std::atomic<bool> simulationRunning_;
+    std::exception_ptr simulationError_;
+    TripleBuffer<SimulationSnapshot> snapshots_;
+    SpscQueue<InputCommand, 256> inputCommands_;
     
     // Mouse position
     double mouseX_, mouseY_;
     
-    // Obstacles in the map
-    std::vector<Obstacle> obstacles_;
-    
     // Camera parameters
     float cameraHeight_; // Height of camera above the map
     float cameraFollowSpeed_; // How quickly the camera follows the particle
     Vector3D cameraPosition_; // Current camera position
     Vector3D cameraTarget_; // Current camera target (usually the particle)
     bool useFollowCamera_; // Whether to use the follow camera or fixed orthographic view
+    
+    // Profiler overlay text, rebuilt every few frames, and the trace written by run()
+    bool showProfilerOverlay_;
+    int profilerOverlayAge_; // Frames since the text was rebuilt
+    std::vector<std::string> profilerOverlayLines_;
+    std::string profileTracePath_;
+    
+    // Torch ray marching, the cache of the latest traced paths, and the
+    // render-side workers it runs on (null on single-core machines)
+    TorchRayTracer torchRays_;
+    TorchRayCache torchCache_;
+    std::unique_ptr<ThreadPool> torchPool_;
+    
+    // Retained-mode drawing: static meshes uploaded once, per-frame
+    // geometry streamed through the renderer's ring buffer
+    BatchRenderer renderer_;
+    GeometryBatch frameBatch_;
+    std::vector<BatchVertex> torchScratch_; // Rows of the torch strips and outlines
+    std::size_t mapMesh_;
+    std::size_t siteMarkerMesh_;
+    
+    // Instanced drawing of the simulation's particles, and the positions drawn this frame
+    ParticleRenderer particleRenderer_;
+    bool instancedParticles_;
+    const Vector3D* particlePositions_;
+    std::size_t particleCount_;
+    float staticGeometryAspect_; // Window aspect ratio the static meshes were built for
 }; 
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vector3d.hpp"
+
+/**
+ * Pairwise Newtonian gravity between particles
+ *
+ * Two backends are available: a Barnes-Hut octree that approximates
+ * distant groups of particles by their centre of mass (O(N log N)), and a
+ * direct pairwise sum (O(N^2)) used as the accuracy reference. The octree
+ * is rebuilt from the current positions every step; its nodes come from a
+ * pool that keeps its capacity between builds, so steady-state steps do
+ * not allocate.
+ */
+class GravitySolver {
+public:
+    /**
+     * Force backend selection
+     */
+    enum class Mode {
+        Off,        // No pairwise gravity
+        DirectSum,  // Exact O(N^2) reference
+        BarnesHut   // Octree approximation controlled by the opening angle
+    };
+
+    GravitySolver();
+
+    // Backend selection
+    void setMode(Mode mode) { mode_ = mode; }
+    Mode getMode() const { return mode_; }
+
+    /**
+     * Set the Barnes-Hut opening angle
+     *
+     * A node of size s at distance d is treated as a point mass when
+     * s / d < theta. Zero opens every node; larger values are faster and
+     * less accurate. Nodes containing the particle being evaluated are
+     * always opened, so it never feels its own mass.
+     * @param theta Opening angle in [0, 1]
+     */
+    void setOpeningAngle(double theta);
+    double getOpeningAngle() const { return theta_; }
+
+    // Gravitational constant used for the force (default 1)
+    void setGravitationalConstant(double g) { gravitationalConstant_ = g; }
+    double getGravitationalConstant() const { return gravitationalConstant_; }
+
+    /**
+     * Set the Plummer softening length
+     * @param softening Softening length (added in quadrature to separations)
+     */
+    void setSoftening(double softening);
+    double getSoftening() const { return softening_; }
+
+    /**
+     * Prepare for force evaluation; rebuilds the octree in Barnes-Hut mode
+     * @param positions Particle positions
+     * @param masses Particle masses
+     * @param count Number of particles
+     */
+    void build(const Vector3D* positions, const double* masses, std::size_t count);
+
+    /**
+     * Add gravitational forces to particles [begin, end)
+     *
+     * Must follow build() with the same arrays. Each particle is processed
+     * independently, so disjoint ranges may run concurrently.
+     * @param positions Particle positions
+     * @param masses Particle masses
+     * @param forces Force accumulators to add to
+     * @param count Total number of particles
+     * @param begin First particle to process
+     * @param end One past the last particle to process
+     */
+    void accumulateForces(const Vector3D* positions, const double* masses, Vector3D* forces,
+                          std::size_t count, std::size_t begin, std::size_t end) const;
+
+    // Number of octree nodes in use after the last build
+    std::size_t getNodeCount() const { return nodes_.size(); }
+
+private:
+    /**
+     * Octree node; the eight children of a node are stored contiguously
+     */
+    struct Node {
+        Vector3D center;          // Geometric centre of the cell
+        double halfSize;          // Half the edge length of the cell
+        Vector3D centerOfMass;    // Mass-weighted centre of the contents
+        double mass;              // Total mass of the contents
+        std::int32_t firstChild;  // Index of child 0, or -1 for a leaf
+        std::int32_t firstParticle; // Head of the leaf's particle list, or -1
+    };
+
+    // Deepest subdivision; coincident particles share a leaf past this depth
+    static constexpr int kMaxDepth = 48;
+
+    /**
+     * Insert one particle into the tree
+     */
+    void insert(std::int32_t particle, const Vector3D* positions);
+
+    /**
+     * Split a leaf into eight children taken from the node pool
+     */
+    void subdivide(std::int32_t node);
+
+    /**
+     * Compute masses and centres of mass bottom-up
+     */
+    void computeMassDistribution(const Vector3D* positions, const double* masses);
+
+    /**
+     * Acceleration-like sum G * m_j * r / |r|^3 over the tree for one particle
+     */
+    Vector3D treeField(std::size_t particle, const Vector3D* positions, const double* masses) const;
+
+    /**
+     * Exact field for one particle by summing over every other particle
+     */
+    Vector3D directField(std::size_t particle, const Vector3D* positions, const double* masses,
+                         std::size_t count) const;
+
+    Mode mode_;
+    double theta_;
+    double gravitationalConstant_;
+    double softening_;
+
+    std::vector<Node> nodes_;               // Node pool, cleared but not freed between builds
+    std::vector<std::int32_t> nextInLeaf_;  // Per-particle link for leaf particle lists
+};
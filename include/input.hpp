@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Keys that drive the player and torch
+ */
+enum class InputKey : std::uint8_t {
+    W, A, S, D,  // Movement
+    K, L,        // Torch rotation
+    Count
+};
+
+/**
+ * A key transition sent from the window thread to the simulation thread
+ */
+struct InputCommand {
+    InputKey key;
+    bool pressed;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "input.hpp"
+
+/**
+ * Bit for a key in a per-tick key mask
+ * @param key The key
+ * @return Mask with only that key's bit set
+ */
+inline std::uint8_t inputKeyBit(InputKey key) {
+    return static_cast<std::uint8_t>(1u << static_cast<unsigned>(key));
+}
+
+/**
+ * Everything needed to replay a session: the seed, the fixed step, the map
+ * and the keys held during every simulation tick
+ *
+ * File layout (little-endian): a 48-byte header ("PHYINPT" magic, version,
+ * seed, step, map aspect ratio, tick count, map fingerprint) followed by
+ * one key mask byte per tick. Version 1 files have a 40-byte header
+ * without the fingerprint; they read back with a fingerprint of 0.
+ */
+struct InputRecording {
+    std::uint32_t seed = 0;          // Seed the session's generators were created with
+    double step = 1.0 / 240.0;       // Fixed simulation step in seconds
+    float mapAspectRatio = 1.0f;     // Aspect ratio the map was laid out for
+    std::uint64_t mapFingerprint = 0; // GameMap::fingerprint() of the map played on (0 if unknown)
+    std::vector<std::uint8_t> keyMasks; // Keys held during each tick (inputKeyBit flags)
+};
+
+/**
+ * Write an input recording
+ * @param path Destination file
+ * @param recording Recording to write
+ */
+void writeInputRecording(const std::string& path, const InputRecording& recording);
+
+/**
+ * Read an input recording
+ * @param path Recording file
+ * @return The recording
+ */
+InputRecording readInputRecording(const std::string& path);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Time integration schemes available to Simulation::step
+ */
+enum class Integrator {
+    SemiImplicitEuler, // v += a dt, then x += v dt (first order, one force evaluation)
+    VelocityVerlet,    // Kick-drift-kick, symplectic, reuses forces from the previous step
+    Leapfrog,          // Drift-kick-drift, symplectic, one force evaluation
+    RK4                // Classical fourth-order Runge-Kutta, four force evaluations
+};
+
+/**
+ * Get the command-line name of an integrator
+ * @param integrator The integrator
+ * @return Short lowercase name ("euler", "verlet", "leapfrog" or "rk4")
+ */
+inline const char* integratorName(Integrator integrator) {
+    switch (integrator) {
+        case Integrator::SemiImplicitEuler: return "euler";
+        case Integrator::VelocityVerlet: return "verlet";
+        case Integrator::Leapfrog: return "leapfrog";
+        case Integrator::RK4: return "rk4";
+    }
+    return "unknown";
+}
+
+/**
+ * Parse an integrator from its command-line name
+ * @param name Name as returned by integratorName()
+ * @param integrator Receives the parsed integrator on success
+ * @return true if the name was recognised
+ */
+inline bool parseIntegrator(const std::string& name, Integrator& integrator) {
+    for (Integrator candidate : {Integrator::SemiImplicitEuler, Integrator::VelocityVerlet,
+                                 Integrator::Leapfrog, Integrator::RK4}) {
+        if (name == integratorName(candidate)) {
+            integrator = candidate;
+            return true;
+        }
+    }
+    return false;
+}
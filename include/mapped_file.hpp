@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/**
+ * Map a whole file into memory
+ *
+ * The mapping is private: with writable set, pages can be modified in
+ * memory but changes never reach the file. Platforms without mmap read
+ * the file into an aligned buffer instead.
+ * @param path File to map
+ * @param size Receives the file size in bytes
+ * @param writable Whether the mapped pages may be written
+ * @return The mapping; it is released when the last owner lets go
+ */
+std::shared_ptr<void> mapFile(const std::string& path, std::size_t& size, bool writable);
@@ -0,0 +1,42 @@
+#pragma once
+
+/**
+ * Simple struct to represent a rectangular obstacle
+ */
+struct Obstacle {
+    float x, y;        // Center position
+    float width, height; // Dimensions
+
+    Obstacle(float x, float y, float width, float height)
+        : x(x), y(y), width(width), height(height) {}
+
+    // Check if a point is inside the obstacle
+    bool contains(float px, float py) const {
+        return (px >= x - width/2 && px <= x + width/2 &&
+                py >= y - height/2 && py <= y + height/2);
+    }
+
+    // Check if a circle overlaps the obstacle or has its centre strictly inside it
+    bool intersectsCircle(float px, float py, float radius) const {
+        // Calculate the closest point on the rectangle to the circle
+        float closestX = px < x - width/2 ? x - width/2 : (px > x + width/2 ? x + width/2 : px);
+        float closestY = py < y - height/2 ? y - height/2 : (py > y + height/2 ? y + height/2 : py);
+
+        // If the distance is less than the circle's radius, collision detected
+        float distanceX = px - closestX;
+        float distanceY = py - closestY;
+        if (distanceX * distanceX + distanceY * distanceY < radius * radius) {
+            return true;
+        }
+
+        // Special case: the circle's centre is fully inside the obstacle
+        return px > x - width/2 && px < x + width/2 &&
+               py > y - height/2 && py < y + height/2;
+    }
+
+    // Edges of the rectangle
+    float left() const { return x - width/2; }
+    float right() const { return x + width/2; }
+    float bottom() const { return y - height/2; }
+    float top() const { return y + height/2; }
+};
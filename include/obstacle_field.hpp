@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "obstacle.hpp"
+
+/**
+ * How far a baked ObstacleField is from the analytic obstacle forces
+ */
+struct ObstacleFieldError {
+    std::size_t samples = 0;             // Points compared
+    double maxForceError = 0.0;          // Largest |sampled - analytic| force
+    double rmsForceError = 0.0;          // Root mean square of the same
+    double maxForce = 0.0;               // Largest analytic force seen, for scale
+    std::size_t insideMismatches = 0;    // Points the field puts on the wrong side of a wall
+};
+
+/**
+ * Obstacle distance and repulsion baked into a regular grid
+ *
+ * Each grid node stores the signed distance to the nearest wall (negative
+ * inside an obstacle) and the repulsion the torch rays feel there, summed
+ * over all obstacles at full strength. Bilinear lookups between the nodes
+ * then replace the per-obstacle edge and corner tests, so a lookup costs
+ * the same however many obstacles the map has.
+ *
+ * The grid covers the obstacles plus the 1 unit the repulsion reaches.
+ * Points outside it read the nearest border value, where the force is zero
+ * and the distance positive. Distances are clamped to that same 1 unit.
+ */
+class ObstacleField {
+public:
+    // Floats stored per node: distance, force x, force y and padding
+    static constexpr int kNodeFloats = 4;
+
+    /**
+     * Bilinearly interpolated field values at a point
+     */
+    struct Sample {
+        float distance;
+        float forceX;
+        float forceY;
+    };
+
+    ObstacleField();
+
+    /**
+     * Bake the field for a set of obstacles
+     * @param obstacles Obstacle array (not copied; only used during the build)
+     * @param count Number of obstacles
+     * @param cellSize Node spacing in world units (> 0)
+     * @throws std::length_error if the field would exceed the node limit (see fitCellSize())
+     */
+    void build(const Obstacle* obstacles, std::size_t count, float cellSize);
+
+    /**
+     * Get the finest cell size, no finer than cellSize, whose field for
+     * these obstacles fits the node limit build() enforces
+     *
+     * Returns cellSize itself unless the map is too large for it.
+     * @param obstacles Obstacle array
+     * @param count Number of obstacles
+     * @param cellSize Requested node spacing in world units (> 0)
+     */
+    static float fitCellSize(const Obstacle* obstacles, std::size_t count, float cellSize);
+
+    /**
+     * Drop the field
+     */
+    void clear();
+
+    /**
+     * Look up the field at a point
+     */
+    Sample sample(float x, float y) const;
+
+    /**
+     * Compare the field against the analytic forces it was baked from
+     *
+     * Samples a lattice samplesPerCell times finer than the field's nodes,
+     * so most points fall between nodes where interpolation error shows.
+     * @param obstacles The obstacles the field was built from
+     * @param count Number of obstacles
+     * @param samplesPerCell Sample points per cell along each axis (>= 1)
+     */
+    ObstacleFieldError measureError(const Obstacle* obstacles, std::size_t count, int samplesPerCell = 4) const;
+
+    /**
+     * Exact torch repulsion at a point, at full strength
+     *
+     * Sums the same edge and corner terms as the torch ray kernels with
+     * their per-step distance factor left out.
+     */
+    static void analyticForce(const Obstacle* obstacles, std::size_t count, float x, float y,
+                              float& forceX, float& forceY);
+
+    // Grid layout; node (column, row) starts at nodes()[(row * getColumns() + column) * kNodeFloats]
+    bool empty() const { return nodes_.empty(); }
+    float getCellSize() const { return cellSize_; }
+    float getInverseCellSize() const { return inverseCellSize_; }
+    float getOriginX() const { return originX_; }
+    float getOriginY() const { return originY_; }
+    int getColumns() const { return columns_; }
+    int getRows() const { return rows_; }
+    const float* nodes() const { return nodes_.data(); }
+
+private:
+    float originX_, originY_;   // Position of node (0, 0)
+    float cellSize_;
+    float inverseCellSize_;
+    int columns_, rows_;        // Nodes along each axis (at least 2 each once built)
+
+    std::vector<float> nodes_;  // kNodeFloats per node, row by row
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "obstacle.hpp"
+
+/**
+ * Static uniform grid over a set of rectangular obstacles
+ *
+ * Built once for a map, the grid maps each cell to the obstacles whose
+ * bounds overlap it (stored contiguously, one slice per cell). A query
+ * visits only the cells under the query rectangle, so its cost depends on
+ * how many obstacles are nearby rather than on the size of the map.
+ *
+ * The grid arrays can also be adopted from external memory, such as a
+ * compiled map file, so a baked grid is used without rebuilding it.
+ */
+class ObstacleGrid {
+public:
+    /**
+     * First cell covered by one obstacle's bounds
+     */
+    struct CellRange {
+        std::int32_t firstColumn;
+        std::int32_t firstRow;
+    };
+
+    /**
+     * Grid layout and arrays, as written to and read from a compiled map
+     */
+    struct Baked {
+        float originX, originY;
+        float cellSize;
+        std::int32_t columns, rows;
+        const std::uint32_t* cellStarts;  // columns * rows + 1 entries
+        const std::uint32_t* cellItems;   // cellStarts[columns * rows] entries
+        const CellRange* obstacleCells;   // One entry per obstacle
+        std::size_t obstacleCount;
+    };
+
+    ObstacleGrid();
+
+    /**
+     * Build the grid for a set of obstacles
+     * @param obstacles Obstacle array (not copied; only used during the build)
+     * @param count Number of obstacles
+     * @param cellSize Cell edge length, or 0 to pick one from the obstacle density
+     */
+    void build(const Obstacle* obstacles, std::size_t count, float cellSize = 0.0f);
+
+    /**
+     * Use grid arrays from external memory without copying
+     *
+     * The arrays are checked for consistency first, so a corrupt file
+     * cannot make queries read out of bounds.
+     * @param owner Keeps the arrays alive while the grid uses them
+     * @param baked Layout and arrays, as returned by getBaked()
+     */
+    void adopt(std::shared_ptr<const void> owner, const Baked& baked);
+
+    /**
+     * Get the layout and arrays, for writing them out
+     */
+    Baked getBaked() const;
+
+    /**
+     * Visit each obstacle whose bounds may overlap a rectangle, exactly once
+     *
+     * Obstacles spanning several cells are reported only from the first
+     * cell they share with the query, so no per-query scratch state is
+     * needed and concurrent queries are safe.
+     * @param minX Left edge of the query rectangle
+     * @param minY Bottom edge of the query rectangle
+     * @param maxX Right edge of the query rectangle
+     * @param maxY Top edge of the query rectangle
+     * @param visit Callable taking an obstacle index; return true to stop early
+     * @return true if the visitor stopped the query early
+     */
+    template <typename Visitor>
+    bool visitCandidates(float minX, float minY, float maxX, float maxY, Visitor&& visit) const {
+        if (empty()) return false;
+        const std::uint32_t* cellStarts = this->cellStarts();
+        const std::uint32_t* cellItems = this->cellItems();
+        const CellRange* obstacleCells = this->obstacleCells();
+
+        int firstColumn = columnOf(minX);
+        int lastColumn = columnOf(maxX);
+        int firstRow = rowOf(minY);
+        int lastRow = rowOf(maxY);
+
+        for (int row = firstRow; row <= lastRow; ++row) {
+            for (int column = firstColumn; column <= lastColumn; ++column) {
+                std::size_t cell = static_cast<std::size_t>(row) * columns_ + column;
+                for (std::uint32_t k = cellStarts[cell]; k < cellStarts[cell + 1]; ++k) {
+                    std::uint32_t index = cellItems[k];
+                    // Report the obstacle only from its first cell inside the query
+                    const CellRange& range = obstacleCells[index];
+                    if (column != std::max<int>(range.firstColumn, firstColumn) ||
+                        row != std::max<int>(range.firstRow, firstRow)) {
+                        continue;
+                    }
+                    if (visit(index)) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Grid layout
+    float getCellSize() const { return cellSize_; }
+    int getColumns() const { return columns_; }
+    int getRows() const { return rows_; }
+    float getOriginX() const { return originX_; }
+    float getOriginY() const { return originY_; }
+    bool empty() const { return columns_ == 0; }
+    bool isAdopted() const { return adopted_.owner != nullptr; }
+
+private:
+    /**
+     * External arrays adopted by adopt()
+     */
+    struct AdoptedArrays {
+        std::shared_ptr<const void> owner;
+        const std::uint32_t* cellStarts = nullptr;
+        const std::uint32_t* cellItems = nullptr;
+        const CellRange* obstacleCells = nullptr;
+        std::size_t obstacleCount = 0;
+    };
+
+    const std::uint32_t* cellStarts() const { return isAdopted() ? adopted_.cellStarts : cellStarts_.data(); }
+    const std::uint32_t* cellItems() const { return isAdopted() ? adopted_.cellItems : cellItems_.data(); }
+    const CellRange* obstacleCells() const { return isAdopted() ? adopted_.obstacleCells : obstacleCells_.data(); }
+
+    // Cell coordinates of a point, clamped to the grid
+    int columnOf(float x) const { return clampCell((x - originX_) * inverseCellSize_, columns_); }
+    int rowOf(float y) const { return clampCell((y - originY_) * inverseCellSize_, rows_); }
+
+    static int clampCell(float cell, int cells) {
+        // Clamp in floating point first so far-away (or NaN) queries cannot overflow
+        if (!(cell >= 0.0f)) return 0;
+        if (cell >= static_cast<float>(cells)) return cells - 1;
+        return std::min(static_cast<int>(cell), cells - 1);
+    }
+
+    float originX_, originY_;   // Lower-left corner of the grid
+    float cellSize_;
+    float inverseCellSize_;
+    int columns_, rows_;
+
+    std::vector<std::uint32_t> cellStarts_;  // Offset of each cell's slice in cellItems_ (cells + 1 entries)
+    std::vector<std::uint32_t> cellItems_;   // Obstacle indices, grouped by cell
+    std::vector<CellRange> obstacleCells_;   // First cell of each obstacle
+    AdoptedArrays adopted_;
+};
@@ -1,65 +1,79 @@
 #pragma once
 
 #include "vector3d.hpp"
+#include "particle_store.hpp"
+#include <cstddef>
+#include <memory>
 #include <string>
 
 /**
- * Represents a particle in the physics simulation
+ * Lightweight handle to a particle in the physics simulation
+ *
+ * A Particle refers to one slot of a ParticleStore. Handles created by
+ * Simulation view the simulation's store; a Particle constructed from a
+ * mass, position and velocity owns a private single-particle store.
  */
 class Particle {
 public:
     /**
-     * Constructor
+     * Constructor for a standalone particle
      * @param mass The mass of the particle
      * @param position Initial position
      * @param velocity Initial velocity
      * @param name Optional name for the particle
      */
     Particle(double mass, const Vector3D& position, const Vector3D& velocity, const std::string& name = "");
-    
+
     /**
-     * Destructor
+     * Constructor for a view into an existing store
+     * @param store The store holding the particle data
+     * @param index Index of the particle in the store
      */
-    virtual ~Particle() = default;
-    
+    Particle(ParticleStore& store, std::size_t index) noexcept : store_(&store), index_(index) {}
+
     /**
      * Apply a force to the particle
      * @param force The force vector to apply
      */
     void applyForce(const Vector3D& force);
-    
+
     /**
      * Update the particle's position based on its velocity
      * @param dt Time step in seconds
      */
     void updatePosition(double dt);
-    
+
     /**
      * Update the particle's velocity based on accumulated forces
      * @param dt Time step in seconds
      */
     void updateVelocity(double dt);
-    
+
     /**
      * Reset accumulated forces to zero
      */
     void resetForces();
-    
+
     // Getters
-    double getMass() const { return mass_; }
-    const Vector3D& getPosition() const { return position_; }
-    const Vector3D& getVelocity() const { return velocity_; }
-    const Vector3D& getForce() const { return force_; }
-    const std::string& getName() const { return name_; }
-    
+    double getMass() const { return store_->masses()[index_]; }
+    const Vector3D& getPosition() const { return store_->positions()[index_]; }
+    const Vector3D& getVelocity() const { return store_->velocities()[index_]; }
+    const Vector3D& getForce() const { return store_->forces()[index_]; }
+    const std::string& getName() const { return store_->name(index_); }
+    std::size_t getIndex() const { return index_; }
+
     // Setters
-    void setPosition(const Vector3D& position) { position_ = position; }
-    void setVelocity(const Vector3D& velocity) { velocity_ = velocity; }
-    
+    void setPosition(const Vector3D& position) {
+        store_->positions()[index_] = position;
+        store_->markModified();
+    }
+    void setVelocity(const Vector3D& velocity) {
+        store_->velocities()[index_] = velocity;
+        store_->markModified();
+    }
+
 private:
-    double mass_;           // Mass of the particle
-    Vector3D position_;     // Current position
-    Vector3D velocity_;     // Current velocity
-    Vector3D force_;        // Accumulated force
-    std::string name_;      // Optional name for identification
-}; 
\ No newline at end of file
+    std::unique_ptr<ParticleStore> owned_; // Backing store for standalone particles
+    ParticleStore* store_;                 // Store holding the particle data
+    std::size_t index_;                    // Slot in the store
+};
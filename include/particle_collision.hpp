@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "vector3d.hpp"
+
+/**
+ * Work done by one ParticleCollider::resolve() call
+ */
+struct ParticleCollisionStats {
+    std::size_t sweepOverlaps = 0; // Pairs whose x extents overlapped (visited by the sweep)
+    std::size_t pairsTested = 0;   // Of those, pairs whose bounding boxes overlapped (narrow-phase tests)
+    std::size_t contacts = 0;      // Pairs found touching and resolved
+    std::size_t sortMoves = 0;     // Insertion-sort moves needed to restore the sweep order
+    bool fullSort = false;         // The order was rebuilt from scratch instead
+};
+
+/**
+ * Collisions between particles treated as spheres (discs when z is flat)
+ *
+ * Broad phase: sort and sweep along x. Particles are kept ordered by the
+ * low end of their x extent, and the order is carried over from the
+ * previous call. Particles move little between steps, so an insertion
+ * sort restores the order in close to linear time. When the order has
+ * drifted too far, or the particle count changed, it is rebuilt with a
+ * full sort. The sweep then walks each particle's x overlaps and keeps the
+ * pairs whose bounding boxes overlap on the other axes too. The sweep
+ * works best when particles are spread along x; in a dense cloud every
+ * particle overlaps many others along x alone (see sweepOverlaps).
+ *
+ * Narrow phase: the candidate pairs are tested in one batch for sphere
+ * overlap. The touching pairs are then resolved in order. Overlapping
+ * particles are pushed apart along the line between their centres,
+ * weighted by inverse mass. Approaching particles exchange an impulse set
+ * by the restitution coefficient (1 is perfectly elastic, 0 perfectly
+ * inelastic).
+ */
+class ParticleCollider {
+public:
+    ParticleCollider();
+
+    // Collision is off until enabled
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    bool isEnabled() const { return enabled_; }
+
+    /**
+     * Set the radius shared by every particle without its own radius
+     * @param radius Radius (must be positive)
+     */
+    void setRadius(double radius);
+    double getRadius() const { return radius_; }
+
+    /**
+     * Give each particle its own radius
+     * @param radii One positive radius per particle (empty to use the shared radius)
+     */
+    void setRadii(std::vector<double> radii);
+    const std::vector<double>& getRadii() const { return radii_; }
+
+    /**
+     * Set the coefficient of restitution
+     * @param restitution Coefficient in [0, 1]
+     */
+    void setRestitution(double restitution);
+    double getRestitution() const { return restitution_; }
+
+    /**
+     * Find and resolve all touching pairs
+     * @param positions Particle positions (overlaps are pushed apart)
+     * @param velocities Particle velocities (receive the collision impulses)
+     * @param inverseMasses Particle inverse masses
+     * @param count Number of particles (must match the radii, if set)
+     */
+    void resolve(Vector3D* positions, Vector3D* velocities, const double* inverseMasses, std::size_t count);
+
+    /**
+     * Statistics of the last resolve() call
+     */
+    const ParticleCollisionStats& getStats() const { return stats_; }
+
+private:
+    double radiusOf(std::uint32_t index) const { return radii_.empty() ? radius_ : radii_[index]; }
+
+    /**
+     * Bring order_ and starts_ up to date with the current positions
+     */
+    void updateOrder(const Vector3D* positions, std::size_t count);
+
+    /**
+     * Rebuild order_ and starts_ with a full sort
+     */
+    void sortOrder(const Vector3D* positions, std::size_t count);
+
+    bool enabled_;
+    double radius_;
+    std::vector<double> radii_;
+    double restitution_;
+
+    // Particle indices ordered by the low end of their x extent, and those ends
+    std::vector<std::uint32_t> order_;
+    std::vector<double> starts_;
+
+    // y, z and radius of each particle in sweep order, refreshed every call
+    std::vector<double> sortedY_;
+    std::vector<double> sortedZ_;
+    std::vector<double> sortedRadii_;
+
+    // Candidate pairs from the sweep (as two index arrays for the batch distance
+    // kernel), their squared distances and the touching subset, reused between calls
+    std::vector<std::uint32_t> pairFirst_;
+    std::vector<std::uint32_t> pairSecond_;
+    std::vector<double> pairDistancesSquared_;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> contacts_;
+
+    ParticleCollisionStats stats_;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "vector3d.hpp"
+
+/**
+ * Contiguous structure-of-arrays storage for simulation particles
+ *
+ * Each particle attribute lives in its own array so that the integration
+ * loops in Simulation are plain linear sweeps. Names are kept in a side
+ * table that the hot loops never touch.
+ *
+ * The state arrays (positions, velocities, masses, inverse masses) can
+ * also be adopted from external memory such as a mapped snapshot file; the
+ * store then works on that memory in place and copies it into its own
+ * arrays only when particles are added.
+ */
+class ParticleStore {
+public:
+    ParticleStore() = default;
+
+    /**
+     * Append a particle to the store
+     * @param mass The mass of the particle (must be positive)
+     * @param position Initial position
+     * @param velocity Initial velocity
+     * @param name Optional name for the particle
+     * @return Index of the new particle
+     */
+    std::size_t add(double mass, const Vector3D& position, const Vector3D& velocity, const std::string& name = "");
+
+    /**
+     * Remove all particles
+     */
+    void clear();
+
+    /**
+     * Reserve capacity for the given number of particles
+     * @param count Number of particles to reserve space for
+     */
+    void reserve(std::size_t count);
+
+    /**
+     * Use externally owned arrays as the particle state, without copying
+     *
+     * Replaces the current contents. Forces start at zero and names empty.
+     * The arrays must stay valid and writable while owner is alive; the
+     * store keeps a reference to it.
+     * @param owner Keeps the memory alive (e.g. a file mapping)
+     * @param count Number of particles
+     * @param positions Position array
+     * @param velocities Velocity array
+     * @param masses Mass array (all positive)
+     * @param inverseMasses Inverse mass array matching masses
+     */
+    void adopt(std::shared_ptr<void> owner, std::size_t count, Vector3D* positions,
+               Vector3D* velocities, double* masses, double* inverseMasses);
+
+    /**
+     * Check whether the state arrays are adopted external memory
+     */
+    bool isAdopted() const { return adopted_.owner != nullptr; }
+
+    /**
+     * Set every accumulated force to zero
+     */
+    void resetForces();
+
+    /**
+     * Change the mass of a particle, keeping the inverse mass in sync
+     * @param index Particle index
+     * @param mass New mass (must be positive)
+     */
+    void setMass(std::size_t index, double mass);
+
+    /**
+     * Record a write to particle state made outside the batch kernels
+     *
+     * Particle handles and setMass() call this, so owners caching derived
+     * state (such as Simulation's forces) can tell it went stale.
+     */
+    void markModified() { ++version_; }
+    std::uint64_t getVersion() const { return version_; }
+
+    // Number of particles in the store
+    std::size_t size() const { return forces_.size(); }
+    bool empty() const { return forces_.empty(); }
+
+    // Raw array access for batch kernels
+    Vector3D* positions() { return isAdopted() ? adopted_.positions : positions_.data(); }
+    Vector3D* velocities() { return isAdopted() ? adopted_.velocities : velocities_.data(); }
+    Vector3D* forces() { return forces_.data(); }
+    const Vector3D* positions() const { return isAdopted() ? adopted_.positions : positions_.data(); }
+    const Vector3D* velocities() const { return isAdopted() ? adopted_.velocities : velocities_.data(); }
+    const Vector3D* forces() const { return forces_.data(); }
+    const double* masses() const { return isAdopted() ? adopted_.masses : masses_.data(); }
+    const double* inverseMasses() const { return isAdopted() ? adopted_.inverseMasses : inverseMasses_.data(); }
+
+    // Side table of particle names (not used by the integration loops)
+    const std::string& name(std::size_t index) const;
+    void setName(std::size_t index, const std::string& name);
+
+private:
+    /**
+     * External arrays adopted by adopt()
+     */
+    struct AdoptedArrays {
+        std::shared_ptr<void> owner;
+        Vector3D* positions = nullptr;
+        Vector3D* velocities = nullptr;
+        double* masses = nullptr;
+        double* inverseMasses = nullptr;
+    };
+
+    /**
+     * Copy adopted arrays into the store's own arrays and release them
+     */
+    void copyAdoptedArrays();
+
+    AdoptedArrays adopted_;
+
+    std::vector<Vector3D> positions_;     // Current positions
+    std::vector<Vector3D> velocities_;    // Current velocities
+    std::vector<Vector3D> forces_;        // Accumulated forces
+    std::vector<double> masses_;          // Masses
+    std::vector<double> inverseMasses_;   // Cached 1/mass for the velocity update
+    std::vector<std::string> names_;      // Optional names; empty while no particle has one
+    std::uint64_t version_ = 0;           // Bumped by markModified()
+};
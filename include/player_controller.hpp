@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include "game_map.hpp"
+#include "input.hpp"
+#include "input_recording.hpp"
+#include "simulation.hpp"
+
+/**
+ * Drives the player particle from the held keys, without a window
+ *
+ * Holds the map, the key state and the torch angle, and applies
+ * them to the simulation once per fixed step. The spawn point is drawn
+ * from a generator seeded by the caller. A seed plus the keys held during
+ * every tick therefore reproduce a session exactly. GLVisualizer feeds it
+ * live keys; a headless run can feed it an InputRecording instead.
+ */
+class PlayerController {
+public:
+    static constexpr float kParticleRadius = 0.15f;
+
+    /**
+     * Constructor
+     * @param simulation Simulation whose central particle is the player
+     * @param mapAspectRatio Width over height of the built-in map layout
+     * @param seed Seed for the spawn choice
+     */
+    PlayerController(Simulation& simulation, float mapAspectRatio, std::uint32_t seed);
+
+    /**
+     * Use the built-in map, laid out for the aspect ratio
+     */
+    void buildMap();
+
+    /**
+     * Use a loaded map; its walls are shared with the simulation, not copied
+     * @param map The map (its grid must be built)
+     */
+    void setMap(std::shared_ptr<const GameMap> map);
+
+    /**
+     * Put the player at one of the spawn points, chosen from the seeded generator
+     */
+    void spawn();
+
+    /**
+     * Record a key press or release
+     * @param key The key that changed
+     * @param pressed Whether the key is now held down
+     */
+    void setKeyState(InputKey key, bool pressed);
+
+    /**
+     * Set all keys at once
+     * @param mask Held keys as inputKeyBit flags
+     */
+    void setKeyMask(std::uint8_t mask) { keyMask_ = mask; }
+    std::uint8_t getKeyMask() const { return keyMask_; }
+
+    /**
+     * Apply the held keys and advance the simulation by one fixed step
+     * @param dt Step length in seconds
+     */
+    void tick(double dt);
+
+    /**
+     * Start logging the key mask of every tick
+     *
+     * The recording identifies the current map by its fingerprint, so set
+     * the map before starting.
+     * @param step Fixed step the ticks will run at
+     */
+    void startRecording(double step);
+
+    /**
+     * Keys logged since startRecording(), with the seed and map settings
+     */
+    const InputRecording& getRecording() const { return recording_; }
+    bool isRecording() const { return recordingEnabled_; }
+
+    float getRotationAngle() const { return rotationAngle_; }
+    float getMapAspectRatio() const { return mapAspectRatio_; }
+    std::uint32_t getSeed() const { return seed_; }
+    const GameMap& getMap() const { return *map_; }
+
+private:
+    bool isHeld(InputKey key) const { return (keyMask_ & inputKeyBit(key)) != 0; }
+
+    /**
+     * Turn the torch with the K and L keys
+     * @param dt Step length in seconds
+     */
+    void updateDirection(double dt);
+
+    /**
+     * Set the player's velocity from the WASD keys
+     * @param dt Step length in seconds
+     */
+    void handleKeyboardInput(double dt);
+
+    Simulation& simulation_;
+    float mapAspectRatio_;
+    std::uint32_t seed_;
+    std::mt19937 rng_;
+
+    std::uint8_t keyMask_;
+    float rotationAngle_; // Torch angle in radians
+    float rotationSpeed_; // Radians per second
+    float moveSpeed_;     // Units per second
+
+    std::shared_ptr<const GameMap> map_;
+
+    bool recordingEnabled_;
+    InputRecording recording_;
+};
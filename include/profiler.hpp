@@ -0,0 +1,199 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * One timed execution of a zone
+ */
+struct ProfileEvent {
+    std::uint32_t zone;     // Zone id from registerZone()
+    std::uint32_t thread;   // Index of the recording thread, in order of first use
+    std::uint64_t startNs;  // Nanoseconds since the profiler was created
+    std::uint64_t endNs;
+};
+
+/**
+ * Rolling statistics for one zone over the recent frames
+ */
+struct ProfileZoneStats {
+    std::string name;
+    double minMs;           // Time spent in the zone per frame
+    double avgMs;
+    double p99Ms;
+    double callsPerFrame;
+    std::size_t frames;     // Frames the statistics cover
+};
+
+/**
+ * Collects timings of named code zones
+ *
+ * Zones are usually opened with PHY_PROFILE_ZONE, which times the rest of
+ * the enclosing scope. Every finished zone is kept twice:
+ *
+ * - as an event in a ring buffer owned by the recording thread, holding
+ *   the latest eventCapacity events, for writeChromeTrace();
+ * - added to the zone's total for the current frame. endFrame() moves the
+ *   totals into a history of the last kHistoryFrames frames, which
+ *   getStats() summarizes as min/avg/p99 per frame.
+ *
+ * Recording is off until setEnabled(true); a disabled zone costs one
+ * relaxed atomic load. Building without PHY_ENABLE_PROFILER removes the
+ * zones entirely.
+ */
+class Profiler {
+public:
+    static constexpr std::size_t kMaxZones = 64;
+    static constexpr std::size_t kHistoryFrames = 240;
+
+    /**
+     * The profiler used by PHY_PROFILE_ZONE and PHY_PROFILE_FRAME
+     */
+    static Profiler& instance();
+
+    /**
+     * Constructor
+     * @param eventCapacity Events kept per recording thread for traces
+     */
+    explicit Profiler(std::size_t eventCapacity = 1 << 16);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    /**
+     * Get the id of a zone, registering it on first use
+     * @param name Zone name (a string literal; the pointer is kept)
+     * @return Zone id
+     */
+    std::uint32_t registerZone(const char* name);
+
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * Record a finished zone
+     * @param zone Zone id returned by this profiler's registerZone()
+     * @param startNs Start time from now()
+     * @param endNs End time from now()
+     */
+    void record(std::uint32_t zone, std::uint64_t startNs, std::uint64_t endNs);
+
+    /**
+     * Close the current frame: push each zone's total into its history
+     */
+    void endFrame();
+
+    /**
+     * Summarize the frame history of every zone seen so far
+     * @return Statistics in registration order
+     */
+    std::vector<ProfileZoneStats> getStats() const;
+
+    /**
+     * Frames closed by endFrame() since the last reset
+     */
+    std::uint64_t getFrameCount() const;
+
+    /**
+     * Collect the buffered events of all threads, oldest first
+     */
+    std::vector<ProfileEvent> getEvents() const;
+
+    /**
+     * Write the buffered events in the Chrome trace event format
+     *
+     * The file opens in chrome://tracing or ui.perfetto.dev.
+     * @param path Destination file
+     */
+    void writeChromeTrace(const std::string& path) const;
+
+    /**
+     * Drop all events and frame history (zone ids stay valid)
+     */
+    void reset();
+
+    /**
+     * Nanoseconds since the profiler was created
+     */
+    std::uint64_t now() const;
+
+private:
+    struct ThreadBuffer;
+
+    ThreadBuffer& threadBuffer();
+
+    const std::uint64_t serial_;   // Tells instances apart in the per-thread buffer cache
+    const std::size_t eventCapacity_;
+    const std::uint64_t epochNs_;
+    std::atomic<bool> enabled_;
+
+    mutable std::mutex mutex_;
+    std::vector<const char*> zoneNames_;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads_;
+
+    // Current frame's totals, and the history of closed frames (ring of kHistoryFrames)
+    std::array<std::atomic<std::uint64_t>, kMaxZones> frameNs_;
+    std::array<std::atomic<std::uint32_t>, kMaxZones> frameCalls_;
+    std::vector<float> historyMs_;          // kMaxZones x kHistoryFrames
+    std::vector<std::uint32_t> historyCalls_;
+    std::uint64_t frames_;
+};
+
+// Inline so a disabled zone stays a guard check and a load
+inline Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+/**
+ * Times its own lifetime as one execution of a zone
+ */
+class ProfileZone {
+public:
+    ProfileZone(Profiler& profiler, std::uint32_t zone)
+        : profiler_(profiler.isEnabled() ? &profiler : nullptr), zone_(zone),
+          startNs_(profiler_ ? profiler.now() : 0) {}
+
+    ~ProfileZone() {
+        if (profiler_) {
+            profiler_->record(zone_, startNs_, profiler_->now());
+        }
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    Profiler* profiler_;
+    std::uint32_t zone_;
+    std::uint64_t startNs_;
+};
+
+#define PHY_PROFILE_CONCAT_INNER(a, b) a##b
+#define PHY_PROFILE_CONCAT(a, b) PHY_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PHY_ENABLE_PROFILER
+constexpr bool kProfilerCompiledIn = true;
+
+// Time the rest of the enclosing scope as the zone `name` (a string literal)
+#define PHY_PROFILE_ZONE(name)                                                                       \
+    static const std::uint32_t PHY_PROFILE_CONCAT(phyProfileZoneId, __LINE__) =                      \
+        Profiler::instance().registerZone(name);                                                     \
+    ProfileZone PHY_PROFILE_CONCAT(phyProfileZone, __LINE__)(Profiler::instance(),                   \
+                                                            PHY_PROFILE_CONCAT(phyProfileZoneId, __LINE__))
+
+// Close the current frame of the global profiler
+#define PHY_PROFILE_FRAME() Profiler::instance().endFrame()
+#else
+constexpr bool kProfilerCompiledIn = false;
+
+#define PHY_PROFILE_ZONE(name) static_cast<void>(0)
+#define PHY_PROFILE_FRAME() static_cast<void>(0)
+#endif
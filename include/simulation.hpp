@@ -1,9 +1,21 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 #include "vector3d.hpp"
+#include "collision.hpp"
+#include "force_generators.hpp"
 #include "particle.hpp"
+#include "gravity_solver.hpp"
+#include "integrator.hpp"
+#include "particle_collision.hpp"
+#include "particle_store.hpp"
+#include "snapshot.hpp"
+#include "thread_pool.hpp"
 
 /**
  * Main simulation class that handles the physics simulation
@@ -12,59 +24,317 @@ class Simulation {
 public:
     Simulation();
     ~Simulation();
-    
+
+    // Particle handles point into this simulation's store
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
     /**
      * Initialize the simulation with default parameters
      */
     void initialize();
-    
+
     /**
      * Advance the simulation by the specified time step
      * @param dt Time step in seconds
      */
     void step(double dt);
-    
+
     /**
      * Print the current state of the simulation
      */
     void printState() const;
-    
+
+    /**
+     * Save the particles and settings to a snapshot file
+     *
+     * Blocks until the file is written; use a SnapshotWriter with
+     * getSnapshotSettings() to save without pausing the step loop.
+     * Throws std::invalid_argument if a registered force generator is not
+     * one of the built-in types, which have no stored form.
+     * @param path Destination file
+     */
+    void saveSnapshot(const std::string& path) const;
+
+    /**
+     * Restart from a snapshot file
+     *
+     * The file is memory-mapped and its arrays become the particle state
+     * directly, so loading costs no parsing; pages are read on first use.
+     * Replaces all particles and force generators and restores gravity,
+     * damping, collision radius, integrator, the gravity solver and the
+     * particle collider settings. Obstacles are kept.
+     * @param path Snapshot file
+     */
+    void loadSnapshot(const std::string& path);
+
+    /**
+     * Get the settings a snapshot of this simulation would store
+     *
+     * Throws std::invalid_argument for force generators that cannot be saved.
+     */
+    SnapshotSettings getSnapshotSettings() const;
+
+    /**
+     * Add a particle to the simulation
+     * @param mass The mass of the particle
+     * @param position Initial position
+     * @param velocity Initial velocity
+     * @param name Optional name for the particle
+     * @return Index of the new particle
+     */
+    std::size_t addParticle(double mass, const Vector3D& position, const Vector3D& velocity,
+                            const std::string& name = "");
+
+    /**
+     * Remove all particles from the simulation
+     */
+    void clearParticles();
+
     /**
      * Get access to the particles in the simulation
-     * @return Reference to the vector of particles
+     * @return Reference to the structure-of-arrays particle store
      */
-    const std::vector<std::unique_ptr<Particle>>& getParticles() const {
+    const ParticleStore& getParticles() const {
         return particles_;
     }
-    
+
+    /**
+     * Get a handle to a particle
+     * @param index Index of the particle
+     * @return Handle viewing the particle in the simulation's store
+     */
+    Particle getParticle(std::size_t index) {
+        return Particle(particles_, index);
+    }
+
     /**
      * Get the central particle for direct manipulation
      * @return Pointer to the central particle, or nullptr if no particles exist
      */
     Particle* getCentralParticle();
-    
+
+    /**
+     * Set the number of threads used by step()
+     *
+     * Each phase of a step is split into per-particle chunks that run on a
+     * persistent worker pool. Results are bit-identical for any thread count.
+     * @param threadCount Number of threads (0 selects the hardware concurrency)
+     */
+    void setThreadCount(std::size_t threadCount);
+
+    /**
+     * Get the number of threads used by step()
+     */
+    std::size_t getThreadCount() const { return threadCount_; }
+
+    /**
+     * Get the pairwise gravity solver
+     *
+     * Gravity between particles is off by default; select a backend with
+     * getGravitySolver().setMode().
+     */
+    GravitySolver& getGravitySolver() { return gravitySolver_; }
+    const GravitySolver& getGravitySolver() const { return gravitySolver_; }
+
+    /**
+     * Get the particle-particle collision stage
+     *
+     * Collisions between particles are off by default; turn them on with
+     * getParticleCollider().setEnabled(). They are resolved after
+     * integration and before obstacle collision, and getStats() reports
+     * the last step's broad-phase pairs and contacts.
+     */
+    ParticleCollider& getParticleCollider() { return particleCollider_; }
+    const ParticleCollider& getParticleCollider() const { return particleCollider_; }
+
+    /**
+     * Register a force generator, applied every step in registration order
+     * @param args Constructor arguments for the generator
+     * @return Reference to the registered generator
+     */
+    template <typename T, typename... Args>
+    T& addForceGenerator(Args&&... args) {
+        auto generator = std::make_unique<T>(std::forward<Args>(args)...);
+        T& reference = *generator;
+        forceGenerators_.push_back(std::move(generator));
+        forcesValid_ = false;
+        return reference;
+    }
+
+    /**
+     * Remove all registered force generators
+     */
+    void clearForceGenerators() {
+        forceGenerators_.clear();
+        forcesValid_ = false;
+    }
+
+    /**
+     * Discard the forces cached by velocity Verlet
+     *
+     * Velocity Verlet reuses the forces computed at the end of the previous
+     * step. Call this after changing force parameters through generator
+     * references. The Simulation setters, and positions, velocities and
+     * masses written through Particle handles, already invalidate them.
+     */
+    void invalidateForces() { forcesValid_ = false; }
+
+    /**
+     * Select the time integration scheme used by step()
+     * @param integrator The integrator (semi-implicit Euler by default)
+     */
+    void setIntegrator(Integrator integrator);
+    Integrator getIntegrator() const { return integrator_; }
+
+    /**
+     * Set the magnitude of uniform gravity, which acts along -y
+     * @param gravity Gravitational acceleration (0 disables it)
+     */
+    void setGravity(double gravity);
+    double getGravity() const { return gravity_; }
+
+    /**
+     * Set the linear drag coefficient
+     * @param damping Drag coefficient (0 disables it)
+     */
+    void setDamping(double damping);
+    double getDamping() const { return damping_; }
+
+    /**
+     * Set the static obstacles particles collide with
+     *
+     * Obstacles are rectangles in the x-y plane. After each step every
+     * particle's motion is swept from its start-of-step position against
+     * them: particles stop at the exact contact, slide along the surface,
+     * and lose the velocity component pointing into it. Motion along z is
+     * not affected.
+     * @param obstacles The obstacles (an empty set disables collision)
+     */
+    void setObstacles(std::vector<Obstacle> obstacles);
+
+    /**
+     * Collide against obstacles held elsewhere, such as a loaded map,
+     * without copying them or rebuilding their grid
+     * @param owner Keeps the obstacles and grid arrays alive
+     * @param obstacles Obstacle array
+     * @param count Number of obstacles
+     * @param grid Grid built over exactly these obstacles
+     */
+    void adoptObstacles(std::shared_ptr<const void> owner, const Obstacle* obstacles, std::size_t count,
+                        const ObstacleGrid::Baked& grid);
+
+    /**
+     * Remove all obstacles
+     */
+    void clearObstacles();
+
+    /**
+     * Get the obstacles and their collision queries
+     */
+    const ObstacleCollider& getObstacleCollider() const { return obstacleCollider_; }
+
+    /**
+     * Set the radius of every particle for obstacle collision
+     * @param radius Particle radius (0 treats particles as points)
+     */
+    void setCollisionRadius(double radius);
+    double getCollisionRadius() const { return collisionRadius_; }
+
 private:
+    /**
+     * Run fn(begin, end) over all particles, in parallel when a pool is active
+     * @param fn Callable invoked for each chunk of particles
+     * @param minChunk Smallest chunk worth running on its own thread
+     */
+    template <typename Fn>
+    void forEachParticleChunk(Fn&& fn, std::size_t minChunk = 1024) {
+        if (threadPool_) {
+            threadPool_->parallelFor(particles_.size(), fn, minChunk);
+        } else {
+            fn(std::size_t(0), particles_.size());
+        }
+    }
+
     /**
      * Apply forces between particles
      */
     void applyForces();
-    
+
     /**
-     * Update particle positions based on velocities
+     * Semi-implicit Euler: v += a dt, x += v dt, fused into one
+     * VectorBatch::kickDrift() sweep
      * @param dt Time step in seconds
      */
-    void updatePositions(double dt);
-    
+    void integrateSemiImplicitEuler(double dt);
+
+    /**
+     * Velocity Verlet (kick-drift-kick)
+     * @param dt Time step in seconds
+     */
+    void integrateVelocityVerlet(double dt);
+
     /**
-     * Update particle velocities based on forces
+     * Leapfrog (drift-kick-drift)
      * @param dt Time step in seconds
      */
-    void updateVelocities(double dt);
-    
+    void integrateLeapfrog(double dt);
+
+    /**
+     * Classical fourth-order Runge-Kutta
+     * @param dt Time step in seconds
+     */
+    void integrateRK4(double dt);
+
+    /**
+     * Sweep each particle from its start-of-step position against the obstacles
+     */
+    void resolveObstacleCollisions();
+
     // Simulation parameters
     double gravity_;
     double damping_;
-    
-    // Collection of particles in the simulation
-    std::vector<std::unique_ptr<Particle>> particles_;
-}; 
\ No newline at end of file
+
+    // Built-in generators driven by gravity_ and damping_
+    UniformGravity gravityForce_;
+    LinearDrag dragForce_;
+
+    // User-registered force generators
+    std::vector<std::unique_ptr<ForceGenerator>> forceGenerators_;
+
+    // Particle data in structure-of-arrays layout
+    ParticleStore particles_;
+
+    // Handle to particle 0, returned by getCentralParticle()
+    Particle centralParticle_;
+
+    // Time integration scheme
+    Integrator integrator_;
+
+    // Whether the force arrays match the current state (used by velocity Verlet),
+    // and the store version they were computed for
+    bool forcesValid_;
+    std::uint64_t forcesVersion_;
+
+    // Scratch arrays for multi-stage integrators, kept between steps
+    std::vector<Vector3D> stagePositions_;
+    std::vector<Vector3D> stageVelocities_;
+    std::vector<Vector3D> positionSums_;
+    std::vector<Vector3D> velocitySums_;
+
+    // Static obstacles, the particle radius used against them, and the
+    // positions at the start of the current step
+    ObstacleCollider obstacleCollider_;
+    double collisionRadius_;
+    std::vector<Vector3D> stepStartPositions_;
+
+    // Pairwise gravity backend (Barnes-Hut or direct sum)
+    GravitySolver gravitySolver_;
+
+    // Sort-and-sweep collisions between particles
+    ParticleCollider particleCollider_;
+
+    // Worker threads for parallel stepping (null when single-threaded)
+    std::size_t threadCount_;
+    std::unique_ptr<ThreadPool> threadPool_;
+};
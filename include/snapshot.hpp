@@ -0,0 +1,243 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "force_generators.hpp"
+#include "gravity_solver.hpp"
+#include "integrator.hpp"
+#include "particle_store.hpp"
+#include "vector3d.hpp"
+
+/**
+ * Fixed-size header at the start of a snapshot file
+ *
+ * Layout (all values little-endian):
+ *   header (192 bytes)
+ *   positions        count x 3 doubles   at positionsOffset
+ *   velocities       count x 3 doubles   at velocitiesOffset
+ *   masses           count doubles       at massesOffset
+ *   inverse masses   count doubles       at inverseMassesOffset
+ *   collision radii  radiiCount doubles  at radiiOffset (0 when absent)
+ *   name table       optional            at namesOffset (0 when absent)
+ *   force table      optional            at forcesOffset (0 when absent)
+ *
+ * Array offsets are multiples of 64, so a mapped file can be used as the
+ * particle arrays directly. The name table is a sequence of entries
+ * (uint64 particle index, uint32 byte length, name bytes) covering only
+ * the named particles. The force table holds the registered force
+ * generators in order, each as (uint32 kind, uint32 zero, uint64 spring
+ * count, 5 doubles of parameters) followed by its springs as (uint32 a,
+ * uint32 b, rest length, stiffness, damping).
+ */
+struct SnapshotHeader {
+    char magic[8];                 // "PHYSNAP" followed by a zero byte
+    std::uint32_t version;         // kSnapshotVersion
+    std::uint32_t headerSize;      // sizeof(SnapshotHeader)
+    std::uint64_t particleCount;
+    std::uint64_t positionsOffset;
+    std::uint64_t velocitiesOffset;
+    std::uint64_t massesOffset;
+    std::uint64_t inverseMassesOffset;
+    std::uint64_t namesOffset;
+    std::uint64_t namesSize;       // Bytes in the name table
+    double gravity;                // Simulation settings at save time
+    double damping;
+    double collisionRadius;
+    std::uint32_t integrator;      // Integrator enum value
+    std::uint32_t gravityMode;     // GravitySolver::Mode enum value
+    double gravitationalConstant;  // GravitySolver settings
+    double openingAngle;
+    double gravitySoftening;
+    std::uint32_t particleCollisions;  // ParticleCollider settings; non-zero when enabled
+    std::uint32_t reserved0;
+    double particleRadius;
+    double restitution;
+    std::uint64_t radiiOffset;
+    std::uint64_t radiiCount;      // Per-particle collision radii (0 for a uniform radius)
+    std::uint64_t forcesOffset;
+    std::uint64_t forcesSize;      // Bytes in the force table
+    std::uint64_t reserved[1];
+};
+static_assert(sizeof(SnapshotHeader) == 192, "Snapshot header layout changed");
+
+constexpr std::uint32_t kSnapshotVersion = 2;
+
+/**
+ * A registered force generator as stored in a snapshot
+ *
+ * Only the built-in generator types can be saved. Which fields apply
+ * depends on the kind.
+ */
+struct SnapshotForce {
+    enum class Kind : std::uint32_t {
+        UniformGravity = 1,   // vector is the acceleration
+        LinearDrag = 2,       // strength is the drag coefficient
+        PointAttractor = 3,   // vector, strength and softening
+        Springs = 4           // springs
+    };
+
+    Kind kind = Kind::UniformGravity;
+    Vector3D vector;
+    double strength = 0.0;
+    double softening = 0.0;
+    std::vector<SpringForce::Spring> springs;
+};
+
+/**
+ * Simulation settings stored alongside the particle state
+ *
+ * Everything step() depends on besides the particles and the obstacles:
+ * a restart from these settings continues bit for bit.
+ */
+struct SnapshotSettings {
+    double gravity = 0.0;
+    double damping = 0.0;
+    double collisionRadius = 0.0;
+    Integrator integrator = Integrator::SemiImplicitEuler;
+
+    // Pairwise gravity
+    GravitySolver::Mode gravityMode = GravitySolver::Mode::Off;
+    double gravitationalConstant = 1.0;
+    double openingAngle = 0.5;
+    double gravitySoftening = 0.01;
+
+    // Particle-particle collisions
+    bool particleCollisions = false;
+    double particleRadius = 0.05;
+    std::vector<double> particleRadii;
+    double restitution = 1.0;
+
+    // Registered force generators, in registration order
+    std::vector<SnapshotForce> forces;
+};
+
+/**
+ * Write a snapshot file
+ *
+ * The arrays are written as they are in memory, with no per-particle
+ * formatting. The file is written under a temporary name and renamed into
+ * place, so readers never see a partial snapshot.
+ * @param path Destination file
+ * @param particles Particle state to save
+ * @param settings Simulation settings to save
+ */
+void writeSnapshot(const std::string& path, const ParticleStore& particles, const SnapshotSettings& settings);
+
+/**
+ * Read-only view of a snapshot file mapped into memory
+ *
+ * Opening validates the header and the array bounds but does not touch
+ * the particle data; pages are read in as they are used. The mapping is
+ * private, so writes through adopted arrays stay in memory and never
+ * reach the file.
+ */
+class SnapshotFile {
+public:
+    /**
+     * Map and validate a snapshot
+     * @param path Snapshot file
+     */
+    explicit SnapshotFile(const std::string& path);
+
+    std::size_t getParticleCount() const { return static_cast<std::size_t>(header_->particleCount); }
+
+    /**
+     * Read the settings, including the force generators
+     *
+     * Throws std::runtime_error when the force table is corrupt.
+     */
+    SnapshotSettings getSettings() const;
+
+    /**
+     * Hand the particle arrays to a store without copying
+     *
+     * The store keeps the mapping alive, so the SnapshotFile may be
+     * destroyed afterwards. Names from the name table are applied.
+     * @param store Store to receive the particles
+     */
+    void adoptInto(ParticleStore& store) const;
+
+    /**
+     * Read the name table
+     * @return (particle index, name) pairs for the named particles
+     */
+    std::vector<std::pair<std::size_t, std::string>> readNames() const;
+
+private:
+    template <typename T>
+    T* array(std::uint64_t offset) const {
+        return reinterpret_cast<T*>(static_cast<char*>(mapping_.get()) + offset);
+    }
+
+    std::shared_ptr<void> mapping_;   // Unmapped when the last owner lets go
+    std::size_t size_;
+    const SnapshotHeader* header_;
+};
+
+/**
+ * Saves snapshots on a background thread
+ *
+ * save() copies the particle state into a staging buffer and returns;
+ * the file is written while the caller keeps stepping. Only one save is
+ * in flight at a time: a save requested while the previous one is still
+ * writing waits for it first.
+ */
+class SnapshotWriter {
+public:
+    SnapshotWriter();
+
+    /**
+     * Destructor - finishes the pending save
+     */
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    /**
+     * Start saving a snapshot
+     * @param path Destination file
+     * @param particles Particle state (copied before returning)
+     * @param settings Simulation settings
+     */
+    void save(const std::string& path, const ParticleStore& particles, const SnapshotSettings& settings);
+
+    /**
+     * Wait for the pending save to finish
+     *
+     * Rethrows any error raised while writing it.
+     */
+    void wait();
+
+    /**
+     * Check whether a save is still being written
+     */
+    bool isBusy() const;
+
+private:
+    void threadLoop();
+
+    // Copy of the state being written, reused between saves
+    std::vector<Vector3D> positions_;
+    std::vector<Vector3D> velocities_;
+    std::vector<double> masses_;
+    std::vector<double> inverseMasses_;
+    std::vector<std::pair<std::size_t, std::string>> names_;
+    SnapshotSettings settings_;
+    std::string path_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    bool pending_;
+    bool stopping_;
+    std::exception_ptr error_;
+    std::thread thread_;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Bounded lock-free queue for exactly one producer and one consumer thread
+ *
+ * Capacity must be a power of two. push() fails instead of blocking when
+ * the queue is full; pop() fails when it is empty.
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() : head_(0), tail_(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * Append an item (producer thread only)
+     * @param item The item to append
+     * @return false if the queue was full
+     */
+    bool push(const T& item) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Remove the oldest item (consumer thread only)
+     * @param item Receives the removed item
+     * @return false if the queue was empty
+     */
+    bool pop(T& item) {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items_[Capacity];
+    alignas(64) std::atomic<std::size_t> head_; // Next slot to read (consumer)
+    alignas(64) std::atomic<std::size_t> tail_; // Next slot to write (producer)
+};
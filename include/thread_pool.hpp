@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Persistent pool of worker threads for data-parallel loops
+ *
+ * Workers are created once and sleep between jobs. parallelFor() splits an
+ * index range into contiguous chunks, runs them on the workers and the
+ * calling thread, and returns only when every chunk has finished, so
+ * consecutive calls act as phases separated by a barrier.
+ */
+class ThreadPool {
+public:
+    /**
+     * Constructor
+     * @param threadCount Total number of threads taking part in a job,
+     *                    including the calling thread (minimum 1)
+     */
+    explicit ThreadPool(std::size_t threadCount);
+
+    /**
+     * Destructor - stops and joins all workers
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Run a function over [0, count) in parallel
+     * @param count Number of items to process
+     * @param fn Callable invoked as fn(begin, end) for each chunk
+     * @param minChunk Smallest number of items worth handing to a thread
+     */
+    template <typename Fn>
+    void parallelFor(std::size_t count, Fn&& fn, std::size_t minChunk = 1024) {
+        auto invoke = [](void* context, std::size_t begin, std::size_t end) {
+            (*static_cast<std::remove_reference_t<Fn>*>(context))(begin, end);
+        };
+        run(count, minChunk, invoke, const_cast<void*>(static_cast<const void*>(&fn)));
+    }
+
+    /**
+     * Number of threads taking part in a job, including the caller
+     */
+    std::size_t threadCount() const { return workers_.size() + 1; }
+
+private:
+    using ChunkFunction = void (*)(void*, std::size_t, std::size_t);
+
+    /**
+     * Dispatch a job to the workers and wait for it to complete
+     */
+    void run(std::size_t count, std::size_t minChunk, ChunkFunction function, void* context);
+
+    /**
+     * Claim and execute chunks of the current job until none are left
+     */
+    void processChunks();
+
+    /**
+     * Main loop of a worker thread
+     */
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+
+    // Job state, published under mutex_ and read by workers after wakeup
+    std::mutex mutex_;
+    std::condition_variable wakeCondition_;
+    std::condition_variable doneCondition_;
+    std::size_t generation_ = 0;    // Incremented for every job
+    std::size_t activeWorkers_ = 0; // Workers still inside the current job
+    bool stopping_ = false;
+
+    ChunkFunction function_ = nullptr;
+    void* context_ = nullptr;
+    std::size_t count_ = 0;
+    std::size_t chunkSize_ = 0;
+    std::atomic<std::size_t> nextChunk_{0};
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Ray-marching kernels behind TorchRayTracer
+ *
+ * Each kernel advances rays [begin, end) through every step of the march
+ * and writes their points. The SIMD kernels replay the scalar kernel's
+ * arithmetic operation for operation, so with floating-point contraction
+ * disabled they produce bit-identical paths.
+ */
+
+// Widest SIMD kernel; per-ray inputs are padded to a multiple of this
+constexpr int kTorchMaxLanes = 8;
+
+/**
+ * Inputs and outputs shared by all torch ray kernels
+ */
+struct TorchKernelArgs {
+    // Obstacles that can influence the rays, structure-of-arrays
+    const float* left;
+    const float* right;
+    const float* bottom;
+    const float* top;
+    std::size_t obstacleCount;
+
+    // Initial direction and step length of each ray
+    const float* dirX;
+    const float* dirY;
+    const float* stepSize;
+
+    float originX;
+    float originY;
+    int bendSteps;
+
+    // Baked obstacle field, read by the field kernels instead of the
+    // obstacles above; layout as in ObstacleField (4 floats per node)
+    const float* fieldNodes;
+    float fieldOriginX;
+    float fieldOriginY;
+    float fieldInverseCellSize;
+    int fieldColumns;
+    int fieldRows;
+
+    // Output: see TorchRayPaths
+    float* vertices;
+    int* pointCounts;
+    int stride;
+};
+
+void traceTorchRaysScalar(const TorchKernelArgs& args, int begin, int end);
+void traceTorchRaysSse(const TorchKernelArgs& args, int begin, int end);
+void traceTorchRaysAvx2(const TorchKernelArgs& args, int begin, int end);
+
+// Same march with one bilinear field lookup per step in place of the obstacle loops
+void traceTorchRaysFieldScalar(const TorchKernelArgs& args, int begin, int end);
+void traceTorchRaysFieldSse(const TorchKernelArgs& args, int begin, int end);
+void traceTorchRaysFieldAvx2(const TorchKernelArgs& args, int begin, int end);
+
+// Whether each SIMD kernel was compiled in for this target
+bool torchRaysSseCompiled();
+bool torchRaysAvx2Compiled();
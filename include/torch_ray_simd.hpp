@@ -0,0 +1,325 @@
+#pragma once
+
+#include "torch_ray_kernel.hpp"
+
+/**
+ * Lane-parallel torch ray march shared by the SSE and AVX2 kernels
+ *
+ * L wraps one instruction set: a vector type Vec holding kWidth floats and
+ * static operations on it. Comparisons return all-ones/all-zeros lane
+ * masks in a Vec. The wrappers live in anonymous namespaces of the kernel
+ * translation units, so each instantiation stays local to the unit that
+ * was compiled for its instruction set. For the same reason this code
+ * must not call inline library functions, which the linker could share
+ * with units compiled without those instructions.
+ *
+ * Every operation mirrors traceTorchRaysScalar(); lanes of rays that have
+ * stopped keep computing but are no longer written.
+ */
+template <typename L>
+void marchTorchRays(const TorchKernelArgs& args, int begin, int end) {
+    using Vec = typename L::Vec;
+    constexpr int kWidth = L::kWidth;
+
+    const Vec zero = L::set1(0.0f);
+    const Vec one = L::set1(1.0f);
+    const Vec minusOne = L::set1(-1.0f);
+    const Vec minForceDistance = L::set1(0.01f);
+    const Vec maxForceDistance = L::set1(2.0f);
+    const Vec cornerThreshold = L::set1(0.5f);
+    const Vec bendFactor = L::set1(0.25f);
+    const Vec smoothFactor = L::set1(0.7f);
+    const Vec inverseSmoothFactor = L::set1(1.0f - 0.7f);
+    const Vec minDirectionLength = L::set1(0.001f);
+    const Vec originX = L::set1(args.originX);
+    const Vec originY = L::set1(args.originY);
+
+    alignas(64) float laneIndices[kWidth];
+    for (int lane = 0; lane < kWidth; ++lane) laneIndices[lane] = static_cast<float>(lane);
+    alignas(64) float storedX[kWidth];
+    alignas(64) float storedY[kWidth];
+
+    for (int first = begin; first < end; first += kWidth) {
+        const int lanes = end - first < kWidth ? end - first : kWidth;
+
+        // Per-ray inputs are padded, so full-width loads are safe
+        Vec rayDirX = L::load(args.dirX + first);
+        Vec rayDirY = L::load(args.dirY + first);
+        Vec stepSize = L::load(args.stepSize + first);
+        Vec prevDirX = rayDirX;
+        Vec prevDirY = rayDirY;
+        Vec currentX = originX;
+        Vec currentY = originY;
+        Vec active = L::cmplt(L::load(laneIndices), L::set1(static_cast<float>(lanes)));
+
+        for (int lane = 0; lane < lanes; ++lane) {
+            float* point = args.vertices + static_cast<std::size_t>(first + lane) * args.stride * 2;
+            point[0] = args.originX;
+            point[1] = args.originY;
+            args.pointCounts[first + lane] = 1;
+        }
+
+        for (int step = 0; step < args.bendSteps && L::any(active); ++step) {
+            Vec forceX = zero;
+            Vec forceY = zero;
+            const Vec distanceFactor = L::set1(1.0f - static_cast<float>(step) / args.bendSteps * 0.5f);
+
+            for (std::size_t o = 0; o < args.obstacleCount; ++o) {
+                const float left = args.left[o];
+                const float right = args.right[o];
+                const float top = args.top[o];
+                const float bottom = args.bottom[o];
+
+                Vec nearObstacle = L::bitAnd(
+                    L::bitAnd(L::cmpge(currentX, L::set1(left - 1.0f)), L::cmple(currentX, L::set1(right + 1.0f))),
+                    L::bitAnd(L::cmpge(currentY, L::set1(bottom - 1.0f)), L::cmple(currentY, L::set1(top + 1.0f))));
+                if (!L::any(nearObstacle)) continue;
+
+                Vec distToLeft = L::sub(currentX, L::set1(left));
+                Vec distToRight = L::sub(L::set1(right), currentX);
+                Vec distToTop = L::sub(L::set1(top), currentY);
+                Vec distToBottom = L::sub(currentY, L::set1(bottom));
+                Vec minDist = L::min(L::min(distToLeft, distToRight), L::min(distToTop, distToBottom));
+
+                Vec applies = L::bitAnd(nearObstacle,
+                    L::bitAnd(L::cmpgt(minDist, minForceDistance), L::cmplt(minDist, maxForceDistance)));
+                if (!L::any(applies)) continue;
+
+                Vec minDistSquared = L::mul(minDist, minDist);
+                Vec repulsiveForce = L::mul(L::div(L::set1(0.08f), L::add(minDistSquared, L::set1(0.1f))),
+                                            distanceFactor);
+
+                // Closest edge, with the scalar code's left/right/top/bottom priority
+                Vec isLeft = L::cmpeq(minDist, distToLeft);
+                Vec isRight = L::bitAndNot(isLeft, L::cmpeq(minDist, distToRight));
+                Vec horizontal = L::bitOr(isLeft, isRight);
+                Vec isTop = L::bitAndNot(horizontal, L::cmpeq(minDist, distToTop));
+                Vec isBottom = L::bitAndNot(L::bitOr(horizontal, isTop), L::cmpeq(minDist, distToBottom));
+                Vec normalX = L::select(isLeft, minusOne, L::select(isRight, one, zero));
+                Vec normalY = L::select(isTop, one, L::select(isBottom, minusOne, zero));
+
+                forceX = L::add(forceX, L::bitAnd(applies, L::mul(normalX, repulsiveForce)));
+                forceY = L::add(forceY, L::bitAnd(applies, L::mul(normalY, repulsiveForce)));
+
+                // Corner push, first matching corner in top-left, top-right,
+                // bottom-left, bottom-right order
+                Vec nearLeft = L::cmplt(distToLeft, cornerThreshold);
+                Vec nearRight = L::cmplt(distToRight, cornerThreshold);
+                Vec nearTop = L::cmplt(distToTop, cornerThreshold);
+                Vec nearBottom = L::cmplt(distToBottom, cornerThreshold);
+                Vec nearTopLeft = L::bitAnd(nearLeft, nearTop);
+                Vec nearTopRight = L::bitAnd(nearRight, nearTop);
+                Vec nearBottomLeft = L::bitAnd(nearLeft, nearBottom);
+                Vec nearBottomRight = L::bitAnd(nearRight, nearBottom);
+                Vec nearCorner = L::bitAnd(applies,
+                    L::bitOr(L::bitOr(nearTopLeft, nearTopRight), L::bitOr(nearBottomLeft, nearBottomRight)));
+                if (!L::any(nearCorner)) continue;
+
+                Vec cornerForce = L::mul(L::div(L::set1(0.15f), L::add(minDistSquared, L::set1(0.05f))),
+                                         distanceFactor);
+                Vec cornerPush = L::mul(cornerForce, L::set1(0.7071f));
+                Vec cornerSignX = L::select(nearTopLeft, minusOne,
+                                  L::select(nearTopRight, one,
+                                  L::select(nearBottomLeft, minusOne, one)));
+                Vec cornerSignY = L::select(L::bitOr(nearTopLeft, nearTopRight), one, minusOne);
+
+                forceX = L::add(forceX, L::bitAnd(nearCorner, L::mul(cornerSignX, cornerPush)));
+                forceY = L::add(forceY, L::bitAnd(nearCorner, L::mul(cornerSignY, cornerPush)));
+            }
+
+            // Bend, smooth and renormalise the direction
+            rayDirX = L::add(rayDirX, L::mul(forceX, bendFactor));
+            rayDirY = L::add(rayDirY, L::mul(forceY, bendFactor));
+            rayDirX = L::add(L::mul(prevDirX, smoothFactor), L::mul(rayDirX, inverseSmoothFactor));
+            rayDirY = L::add(L::mul(prevDirY, smoothFactor), L::mul(rayDirY, inverseSmoothFactor));
+            prevDirX = rayDirX;
+            prevDirY = rayDirY;
+
+            Vec dirLength = L::sqrt(L::add(L::mul(rayDirX, rayDirX), L::mul(rayDirY, rayDirY)));
+            Vec normalise = L::cmpgt(dirLength, minDirectionLength);
+            rayDirX = L::select(normalise, L::div(rayDirX, dirLength), rayDirX);
+            rayDirY = L::select(normalise, L::div(rayDirY, dirLength), rayDirY);
+
+            Vec nextX = L::add(currentX, L::mul(rayDirX, stepSize));
+            Vec nextY = L::add(currentY, L::mul(rayDirY, stepSize));
+
+            // Rays stop before entering an obstacle
+            Vec hit = zero;
+            for (std::size_t o = 0; o < args.obstacleCount; ++o) {
+                hit = L::bitOr(hit, L::bitAnd(
+                    L::bitAnd(L::cmpge(nextX, L::set1(args.left[o])), L::cmple(nextX, L::set1(args.right[o]))),
+                    L::bitAnd(L::cmpge(nextY, L::set1(args.bottom[o])), L::cmple(nextY, L::set1(args.top[o])))));
+            }
+            active = L::bitAndNot(hit, active);
+            currentX = L::select(active, nextX, currentX);
+            currentY = L::select(active, nextY, currentY);
+
+            int advanced = L::movemask(active);
+            if (advanced == 0) break;
+            L::store(storedX, nextX);
+            L::store(storedY, nextY);
+            for (int lane = 0; lane < lanes; ++lane) {
+                if (!(advanced & (1 << lane))) continue;
+                int ray = first + lane;
+                float* point = args.vertices + (static_cast<std::size_t>(ray) * args.stride +
+                                                args.pointCounts[ray]) * 2;
+                point[0] = storedX[lane];
+                point[1] = storedY[lane];
+                args.pointCounts[ray]++;
+            }
+        }
+    }
+}
+
+/**
+ * Field lookups for marchTorchRaysField(), mirroring sampleTorchField()
+ *
+ * Node offsets are computed in float; they stay exact because fields are
+ * capped at 2^22 nodes.
+ */
+template <typename L>
+struct TorchFieldLanes {
+    using Vec = typename L::Vec;
+
+    const float* nodes;
+    Vec originX, originY;
+    Vec inverseCellSize;
+    Vec maxGridX, maxGridY;   // Last node column and row
+    Vec maxCellX, maxCellY;   // Last cell column and row
+    Vec columns;
+    Vec nodeFloats, rowFloats;
+
+    explicit TorchFieldLanes(const TorchKernelArgs& args)
+        : nodes(args.fieldNodes),
+          originX(L::set1(args.fieldOriginX)), originY(L::set1(args.fieldOriginY)),
+          inverseCellSize(L::set1(args.fieldInverseCellSize)),
+          maxGridX(L::set1(static_cast<float>(args.fieldColumns - 1))),
+          maxGridY(L::set1(static_cast<float>(args.fieldRows - 1))),
+          maxCellX(L::set1(static_cast<float>(args.fieldColumns - 2))),
+          maxCellY(L::set1(static_cast<float>(args.fieldRows - 2))),
+          columns(L::set1(static_cast<float>(args.fieldColumns))),
+          nodeFloats(L::set1(4.0f)),
+          rowFloats(L::set1(static_cast<float>(args.fieldColumns * 4))) {}
+
+    void sample(Vec x, Vec y, Vec& distance, Vec& forceX, Vec& forceY) const {
+        const Vec zero = L::set1(0.0f);
+        Vec gridX = L::min(L::max(L::mul(L::sub(x, originX), inverseCellSize), zero), maxGridX);
+        Vec gridY = L::min(L::max(L::mul(L::sub(y, originY), inverseCellSize), zero), maxGridY);
+        Vec cellX = L::min(L::truncate(gridX), maxCellX);
+        Vec cellY = L::min(L::truncate(gridY), maxCellY);
+        Vec tx = L::sub(gridX, cellX);
+        Vec ty = L::sub(gridY, cellY);
+
+        Vec index00 = L::mul(L::add(L::mul(cellY, columns), cellX), nodeFloats);
+        Vec index10 = L::add(index00, nodeFloats);
+        Vec index01 = L::add(index00, rowFloats);
+        Vec index11 = L::add(index01, nodeFloats);
+
+        distance = bilinear(nodes, index00, index10, index01, index11, tx, ty);
+        forceX = bilinear(nodes + 1, index00, index10, index01, index11, tx, ty);
+        forceY = bilinear(nodes + 2, index00, index10, index01, index11, tx, ty);
+    }
+
+    static Vec bilinear(const float* channel, Vec index00, Vec index10, Vec index01, Vec index11, Vec tx, Vec ty) {
+        Vec v00 = L::gather(channel, index00);
+        Vec v10 = L::gather(channel, index10);
+        Vec v01 = L::gather(channel, index01);
+        Vec v11 = L::gather(channel, index11);
+        Vec bottom = L::add(v00, L::mul(L::sub(v10, v00), tx));
+        Vec top = L::add(v01, L::mul(L::sub(v11, v01), tx));
+        return L::add(bottom, L::mul(L::sub(top, bottom), ty));
+    }
+};
+
+/**
+ * Lane-parallel torch ray march against a baked obstacle field
+ *
+ * Every operation mirrors traceTorchRaysFieldScalar(). The lookup at a
+ * ray's next point both decides whether it enters a wall and, once the
+ * ray moves there, gives the force for the following step.
+ */
+template <typename L>
+void marchTorchRaysField(const TorchKernelArgs& args, int begin, int end) {
+    using Vec = typename L::Vec;
+    constexpr int kWidth = L::kWidth;
+
+    const Vec zero = L::set1(0.0f);
+    const Vec bendFactor = L::set1(0.25f);
+    const Vec smoothFactor = L::set1(0.7f);
+    const Vec inverseSmoothFactor = L::set1(1.0f - 0.7f);
+    const Vec minDirectionLength = L::set1(0.001f);
+    const Vec originX = L::set1(args.originX);
+    const Vec originY = L::set1(args.originY);
+    const TorchFieldLanes<L> field(args);
+
+    alignas(64) float laneIndices[kWidth];
+    for (int lane = 0; lane < kWidth; ++lane) laneIndices[lane] = static_cast<float>(lane);
+    alignas(64) float storedX[kWidth];
+    alignas(64) float storedY[kWidth];
+
+    for (int first = begin; first < end; first += kWidth) {
+        const int lanes = end - first < kWidth ? end - first : kWidth;
+
+        Vec rayDirX = L::load(args.dirX + first);
+        Vec rayDirY = L::load(args.dirY + first);
+        Vec stepSize = L::load(args.stepSize + first);
+        Vec prevDirX = rayDirX;
+        Vec prevDirY = rayDirY;
+        Vec currentX = originX;
+        Vec currentY = originY;
+        Vec active = L::cmplt(L::load(laneIndices), L::set1(static_cast<float>(lanes)));
+
+        Vec distance, fieldForceX, fieldForceY;
+        field.sample(currentX, currentY, distance, fieldForceX, fieldForceY);
+
+        for (int lane = 0; lane < lanes; ++lane) {
+            float* point = args.vertices + static_cast<std::size_t>(first + lane) * args.stride * 2;
+            point[0] = args.originX;
+            point[1] = args.originY;
+            args.pointCounts[first + lane] = 1;
+        }
+
+        for (int step = 0; step < args.bendSteps && L::any(active); ++step) {
+            const Vec distanceFactor = L::set1(1.0f - static_cast<float>(step) / args.bendSteps * 0.5f);
+            Vec forceX = L::mul(fieldForceX, distanceFactor);
+            Vec forceY = L::mul(fieldForceY, distanceFactor);
+
+            rayDirX = L::add(rayDirX, L::mul(forceX, bendFactor));
+            rayDirY = L::add(rayDirY, L::mul(forceY, bendFactor));
+            rayDirX = L::add(L::mul(prevDirX, smoothFactor), L::mul(rayDirX, inverseSmoothFactor));
+            rayDirY = L::add(L::mul(prevDirY, smoothFactor), L::mul(rayDirY, inverseSmoothFactor));
+            prevDirX = rayDirX;
+            prevDirY = rayDirY;
+
+            Vec dirLength = L::sqrt(L::add(L::mul(rayDirX, rayDirX), L::mul(rayDirY, rayDirY)));
+            Vec normalise = L::cmpgt(dirLength, minDirectionLength);
+            rayDirX = L::select(normalise, L::div(rayDirX, dirLength), rayDirX);
+            rayDirY = L::select(normalise, L::div(rayDirY, dirLength), rayDirY);
+
+            Vec nextX = L::add(currentX, L::mul(rayDirX, stepSize));
+            Vec nextY = L::add(currentY, L::mul(rayDirY, stepSize));
+
+            Vec nextForceX, nextForceY;
+            field.sample(nextX, nextY, distance, nextForceX, nextForceY);
+            active = L::bitAndNot(L::cmple(distance, zero), active);
+            currentX = L::select(active, nextX, currentX);
+            currentY = L::select(active, nextY, currentY);
+            fieldForceX = L::select(active, nextForceX, fieldForceX);
+            fieldForceY = L::select(active, nextForceY, fieldForceY);
+
+            int advanced = L::movemask(active);
+            if (advanced == 0) break;
+            L::store(storedX, nextX);
+            L::store(storedY, nextY);
+            for (int lane = 0; lane < lanes; ++lane) {
+                if (!(advanced & (1 << lane))) continue;
+                int ray = first + lane;
+                float* point = args.vertices + (static_cast<std::size_t>(ray) * args.stride +
+                                                args.pointCounts[ray]) * 2;
+                point[0] = storedX[lane];
+                point[1] = storedY[lane];
+                args.pointCounts[ray]++;
+            }
+        }
+    }
+}
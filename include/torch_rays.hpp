@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "obstacle.hpp"
+#include "obstacle_field.hpp"
+#include "obstacle_grid.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * Shape of the torch's ray fan
+ */
+struct TorchRayConfig {
+    int rayCount = 81;                      // Rays across the cone, edges included
+    int bendSteps = 30;                     // March steps per ray
+    float coneAngle = 0.826735f;            // Full cone angle in radians (pi / 3.8)
+    float length = 0.7875f;                 // Nominal ray length
+};
+
+/**
+ * Traced ray paths in a flat vertex buffer
+ *
+ * Ray r owns points [r * stride, r * stride + pointCounts[r]) of
+ * vertices, stored as interleaved x, y pairs. The first point of every ray
+ * is the torch origin. The buffers only ever grow, so an instance kept
+ * across frames stops allocating once it has held the largest fan.
+ */
+struct TorchRayPaths {
+    int rayCount = 0;
+    int stride = 0;                  // Point capacity per ray (bendSteps + 1)
+    std::vector<float> vertices;     // x, y pairs
+    std::vector<int> pointCounts;    // Points traced for each ray
+
+    /**
+     * Lay the buffers out for a ray fan, reusing their storage
+     * @param rays Number of rays
+     * @param bendSteps March steps per ray
+     */
+    void resize(int rays, int bendSteps) {
+        rayCount = rays;
+        stride = bendSteps + 1;
+        vertices.resize(static_cast<std::size_t>(rays) * stride * 2);
+        pointCounts.resize(rays);
+    }
+
+    // Pointer to the first x of a ray
+    const float* ray(int index) const { return vertices.data() + static_cast<std::size_t>(index) * stride * 2; }
+};
+
+/**
+ * Marches the torch's light rays through the obstacle field
+ *
+ * Each ray is bent away from nearby obstacle edges and stops when it
+ * enters an obstacle. Only obstacles within reach of the torch are
+ * considered, found through an ObstacleGrid, and rays are processed in
+ * SIMD lanes (SSE or AVX2, picked at runtime) and spread over a thread
+ * pool. All backends produce the same paths as the scalar reference.
+ *
+ * Alternatively the obstacles can be baked into an ObstacleField when
+ * they are set, so each ray step is one bilinear lookup whatever the
+ * obstacle count, at the cost of approximating the exact forces.
+ */
+class TorchRayTracer {
+public:
+    /**
+     * Ray-marching implementation
+     */
+    enum class Backend {
+        Scalar,  // One ray at a time (reference)
+        SSE,     // 4 rays per instruction
+        AVX2     // 8 rays per instruction
+    };
+
+    /**
+     * Constructor - selects the fastest backend the CPU supports
+     */
+    TorchRayTracer();
+
+    /**
+     * Replace the obstacle set
+     *
+     * Per-frame scratch is sized here for the worst case, so trace() does
+     * not allocate once the ray fan's size has been seen.
+     * @param obstacles Obstacle array (copied)
+     * @param count Number of obstacles
+     */
+    void setObstacles(const Obstacle* obstacles, std::size_t count);
+
+    /**
+     * Select the ray-marching backend
+     * @param backend The backend (must be supported on this CPU)
+     */
+    void setBackend(Backend backend);
+    Backend getBackend() const { return backend_; }
+
+    /**
+     * Trace against a baked obstacle field instead of the obstacles
+     *
+     * With a cell size above zero the obstacles are baked into an
+     * ObstacleField of that resolution, now and on every setObstacles(),
+     * and rays read their repulsion and wall hits from it. Maps too large
+     * for that resolution are baked at the finest one that fits (see
+     * ObstacleField::fitCellSize()); getField().getCellSize() gives the
+     * spacing in use. Use ObstacleField::measureError() on getField() to
+     * pick a resolution.
+     * @param cellSize Requested node spacing in world units, or 0 (the default) for exact tracing
+     */
+    void setFieldCellSize(float cellSize);
+    float getFieldCellSize() const { return fieldCellSize_; }
+    const ObstacleField& getField() const { return field_; }
+
+    /**
+     * Check whether a backend was compiled in and runs on this CPU
+     */
+    static bool isSupported(Backend backend);
+
+    /**
+     * Get a short name for a backend ("scalar", "sse", "avx2")
+     */
+    static const char* backendName(Backend backend);
+
+    /**
+     * Trace the ray fan for one frame
+     * @param x Torch origin x
+     * @param y Torch origin y
+     * @param baseAngle Direction of the cone's centre line in radians
+     * @param config Shape of the ray fan
+     * @param paths Receives the traced paths (keep it across frames to reuse its storage)
+     * @param pool Optional worker pool to spread the rays over
+     */
+    void trace(float x, float y, float baseAngle, const TorchRayConfig& config,
+               TorchRayPaths& paths, ThreadPool* pool = nullptr);
+
+    /**
+     * Get a counter that changes whenever the obstacle set or field resolution changes
+     */
+    std::uint64_t getObstacleVersion() const { return obstacleVersion_; }
+
+private:
+    static void checkConfig(const TorchRayConfig& config);
+
+    /**
+     * Trace the rayCount rays of a fan along angles into paths
+     */
+    void traceFan(float x, float y, const float* angles, const TorchRayConfig& config,
+                  TorchRayPaths& paths, ThreadPool* pool);
+
+    Backend backend_;
+    std::uint64_t obstacleVersion_;
+
+    std::vector<Obstacle> obstacles_;
+    ObstacleGrid grid_;
+    float fieldCellSize_;
+    ObstacleField field_;     // Empty unless fieldCellSize_ > 0
+
+    // Per-trace scratch, kept between frames so steady-state traces do not allocate
+    std::vector<std::uint32_t> candidates_;
+    std::vector<float> left_, right_, bottom_, top_;
+    std::vector<float> dirX_, dirY_, stepSize_;
+    std::vector<float> angles_;
+};
+
+/**
+ * Lookups answered by a TorchRayCache
+ */
+struct TorchRayCacheStats {
+    std::uint64_t hits = 0;    // Cached fan returned
+    std::uint64_t misses = 0;  // Whole fan traced
+    std::uint64_t raysTraced = 0;
+    std::uint64_t raysReused = 0;
+
+    std::uint64_t lookups() const { return hits + misses; }
+
+    // Fraction of lookups that traced nothing
+    double hitRate() const { return lookups() ? static_cast<double>(hits) / lookups() : 0.0; }
+};
+
+/**
+ * Keeps the last traced torch fan and returns it while the pose holds still
+ *
+ * The origin is snapped to a grid of positionQuantum and the cone's centre
+ * line to multiples of angleQuantum, and the fan is traced from the snapped
+ * pose. When the snapped pose, fan shape and obstacle version all match the
+ * cached fan it is returned as it is; otherwise the whole fan is traced.
+ * Rays are not reused across a rotation: a ray's length depends on its place
+ * in the fan, so turning the torch changes every path. A quantum of zero
+ * turns snapping off for that input; the cache then only hits on
+ * bit-identical values.
+ */
+class TorchRayCache {
+public:
+    /**
+     * Constructor
+     * @param positionQuantum Origin grid spacing in world units (>= 0)
+     * @param angleQuantum Cone direction step in radians (>= 0)
+     */
+    explicit TorchRayCache(float positionQuantum = 1e-3f, float angleQuantum = 1e-3f);
+
+    /**
+     * Change the snapping; the cached fan is dropped
+     */
+    void setQuantization(float positionQuantum, float angleQuantum);
+    float getPositionQuantum() const { return positionQuantum_; }
+    float getAngleQuantum() const { return angleQuantum_; }
+
+    /**
+     * Get the fan for a torch pose, tracing it unless the cached one matches
+     * @param tracer Tracer holding the current obstacles (its version keys the cache)
+     * @param x Torch origin x
+     * @param y Torch origin y
+     * @param baseAngle Direction of the cone's centre line in radians
+     * @param config Shape of the ray fan
+     * @param pool Optional worker pool to spread the rays over
+     * @return The traced paths, valid until the next call
+     */
+    const TorchRayPaths& trace(TorchRayTracer& tracer, float x, float y, float baseAngle,
+                               const TorchRayConfig& config, ThreadPool* pool = nullptr);
+
+    /**
+     * Drop the cached fan so the next trace() traces everything
+     */
+    void invalidate() { valid_ = false; }
+
+    const TorchRayPaths& getPaths() const { return paths_; }
+    const TorchRayCacheStats& getStats() const { return stats_; }
+    void resetStats() { stats_ = TorchRayCacheStats(); }
+
+private:
+    float snap(float value, float quantum) const;
+
+    float positionQuantum_;
+    float angleQuantum_;
+
+    // Key of the cached fan
+    bool valid_;
+    const TorchRayTracer* tracer_;
+    std::uint64_t obstacleVersion_;
+    float originX_, originY_;
+    float baseAngle_;
+    TorchRayConfig config_;
+
+    TorchRayPaths paths_;
+    TorchRayCacheStats stats_;
+};
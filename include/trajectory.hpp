@@ -0,0 +1,199 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "particle_store.hpp"
+#include "vector3d.hpp"
+
+/**
+ * Encoding settings for a trajectory file
+ */
+struct TrajectoryOptions {
+    double quantum = 0.0;              // Position precision; 0 stores exact doubles
+    std::uint32_t framesPerChunk = 64; // Frames between keyframes (seek granularity)
+    std::size_t queueDepth = 8;        // Frames buffered ahead of the writer thread
+};
+
+/**
+ * Records particle positions every step into a compressed, seekable file
+ *
+ * Frames are grouped into chunks. The first frame of a chunk is a
+ * keyframe; every later frame stores each coordinate as a delta against
+ * the previous frame, as a variable-length integer. In exact mode the
+ * delta is the XOR of the IEEE bit patterns, which is small when a value
+ * changes little. With a quantum, coordinates are rounded to multiples
+ * of it and the integer difference is stored. Slow-moving particles then
+ * cost one or two bytes per coordinate.
+ *
+ * record() only copies the positions into a free frame buffer; encoding
+ * and file I/O happen on a writer thread fed through a bounded queue. If
+ * the writer falls queueDepth frames behind, record() waits for it.
+ *
+ * close() appends a chunk index so TrajectoryReader can seek to any frame
+ * without decoding the frames before its chunk.
+ */
+class TrajectoryWriter {
+public:
+    /**
+     * Create the file and start the writer thread
+     * @param path Destination file
+     * @param particleCount Particles in every frame
+     * @param options Encoding settings
+     */
+    TrajectoryWriter(const std::string& path, std::size_t particleCount,
+                     const TrajectoryOptions& options = TrajectoryOptions());
+
+    /**
+     * Destructor - closes the file, ignoring errors (call close() to see them)
+     */
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    /**
+     * Append a frame
+     * @param positions particleCount positions (copied before returning)
+     * @param step Step number stored with the frame
+     */
+    void record(const Vector3D* positions, std::uint64_t step);
+
+    /**
+     * Append a frame from a store
+     * @param particles Store holding particleCount particles
+     * @param step Step number stored with the frame
+     */
+    void record(const ParticleStore& particles, std::uint64_t step);
+
+    /**
+     * Write the remaining frames and the chunk index, and close the file
+     *
+     * Rethrows any error raised on the writer thread.
+     */
+    void close();
+
+    std::uint64_t getFrameCount() const { return framesRecorded_; }
+
+    /**
+     * Encoded bytes written so far (excluding headers and the index)
+     */
+    std::uint64_t getEncodedBytes() const;
+
+private:
+    struct ChunkEntry {
+        std::uint64_t offset;
+        std::uint64_t firstFrame;
+        std::uint32_t frameCount;
+        std::uint32_t reserved;
+    };
+
+    struct Frame {
+        std::vector<Vector3D> positions;
+        std::uint64_t step;
+    };
+
+    void threadLoop();
+    void encodeFrame(const Frame& frame);
+    void flushChunk();
+    void throwIfFailed();
+
+    std::FILE* file_;
+    std::string path_;
+    std::size_t particleCount_;
+    TrajectoryOptions options_;
+    std::uint64_t framesRecorded_;
+
+    // Frame buffers cycle between the free list and the queue
+    std::vector<Frame> frames_;
+    std::deque<std::size_t> freeFrames_;
+    std::deque<std::size_t> queuedFrames_;
+
+    // Writer thread state
+    std::vector<std::int64_t> previous_;    // Previous frame's coordinates (bits or quanta)
+    std::uint64_t previousStep_;
+    std::vector<std::uint8_t> chunk_;       // Encoded frames of the open chunk (grows, never shrinks)
+    std::size_t chunkBytes_;                // Bytes of chunk_ in use
+    std::uint32_t chunkFrames_;
+    std::uint64_t chunkFirstFrame_;
+    std::uint64_t framesWritten_;
+    std::uint64_t filePosition_;
+    std::uint64_t encodedBytes_;
+    std::vector<ChunkEntry> index_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_;
+    bool closed_;
+    std::exception_ptr error_;
+    std::thread thread_;
+};
+
+/**
+ * Random-access reader for files written by TrajectoryWriter
+ *
+ * Uses the chunk index to jump to the chunk holding a frame, then decodes
+ * forward from its keyframe. Reading frames in order decodes each frame
+ * once. A file whose writer never closed it (no index) is still readable:
+ * the index is rebuilt by walking the chunk headers.
+ */
+class TrajectoryReader {
+public:
+    /**
+     * Open a trajectory
+     * @param path Trajectory file
+     */
+    explicit TrajectoryReader(const std::string& path);
+
+    /**
+     * Destructor - closes the file
+     */
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    std::size_t getParticleCount() const { return particleCount_; }
+    std::uint64_t getFrameCount() const { return frameCount_; }
+    double getQuantum() const { return quantum_; }
+
+    /**
+     * Decode one frame
+     * @param frame Frame index (0-based, in recording order)
+     * @param positions Receives the particle positions
+     * @return Step number stored with the frame
+     */
+    std::uint64_t readFrame(std::uint64_t frame, std::vector<Vector3D>& positions);
+
+private:
+    struct Chunk {
+        std::uint64_t offset;
+        std::uint64_t firstFrame;
+        std::uint32_t frameCount;
+    };
+
+    void loadChunk(std::size_t chunk);
+    std::uint64_t decodeNextFrame();
+
+    std::FILE* file_;
+    std::string path_;
+    std::size_t particleCount_;
+    double quantum_;
+    std::uint64_t frameCount_;
+    std::vector<Chunk> chunks_;
+
+    // Decoder position: chunk loaded in payload_, next frame to decode in it
+    std::size_t loadedChunk_;
+    std::uint64_t nextFrame_;
+    std::vector<std::uint8_t> payload_;
+    std::size_t cursor_;
+    std::vector<std::int64_t> previous_;
+    std::uint64_t lastStep_;
+};
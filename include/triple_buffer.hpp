@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Lock-free triple buffer for handing the latest state from one producer
+ * thread to one consumer thread
+ *
+ * The producer fills writeBuffer() and calls publish(); the consumer calls
+ * update() and reads readBuffer(). Neither side ever waits: the producer
+ * always has a free slot to write into, and the consumer keeps reading its
+ * current slot until a newer one has been published. Intermediate states
+ * the consumer did not pick up in time are overwritten.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle_(1), writeIndex_(0), readIndex_(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /**
+     * Slot owned by the producer (producer thread only)
+     */
+    T& writeBuffer() { return slots_[writeIndex_].value; }
+
+    /**
+     * Make the contents of writeBuffer() visible to the consumer
+     * (producer thread only)
+     */
+    void publish() {
+        std::uint8_t previous = middle_.exchange(writeIndex_ | kFreshBit, std::memory_order_acq_rel);
+        writeIndex_ = previous & kIndexMask;
+    }
+
+    /**
+     * Switch to the most recently published slot, if there is one
+     * (consumer thread only)
+     * @return true if readBuffer() now holds newer data
+     */
+    bool update() {
+        if (!(middle_.load(std::memory_order_relaxed) & kFreshBit)) {
+            return false;
+        }
+        std::uint8_t previous = middle_.exchange(readIndex_, std::memory_order_acq_rel);
+        readIndex_ = previous & kIndexMask;
+        return true;
+    }
+
+    /**
+     * Slot owned by the consumer (consumer thread only)
+     */
+    const T& readBuffer() const { return slots_[readIndex_].value; }
+
+private:
+    static constexpr std::uint8_t kIndexMask = 0x3;
+    static constexpr std::uint8_t kFreshBit = 0x4;
+
+    // Each slot on its own cache line so the two threads never share one
+    struct alignas(64) Slot {
+        T value{};
+    };
+
+    Slot slots_[3];
+    alignas(64) std::atomic<std::uint8_t> middle_; // Index of the shared slot plus the fresh bit
+    alignas(64) std::uint8_t writeIndex_;          // Producer-owned slot
+    alignas(64) std::uint8_t readIndex_;           // Consumer-owned slot
+};
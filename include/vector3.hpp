@@ -0,0 +1,421 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHY_VECTOR3_SSE 1
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PHY_VECTOR3_AVX 1
+#endif
+
+/**
+ * Lane-wise operations on the four components of a padded vector
+ *
+ * The generic version is plain scalar code. The float and double
+ * specializations below use SSE (and AVX for double, when the build
+ * enables it). Every pointer is aligned to 4 * sizeof(T).
+ */
+template <typename T>
+struct Vector3Lanes {
+    static constexpr const char* kName = "scalar";
+
+    static void add(const T* a, const T* b, T* out) noexcept {
+        for (int i = 0; i < 4; ++i) out[i] = a[i] + b[i];
+    }
+    static void sub(const T* a, const T* b, T* out) noexcept {
+        for (int i = 0; i < 4; ++i) out[i] = a[i] - b[i];
+    }
+    static void scale(const T* a, T scalar, T* out) noexcept {
+        for (int i = 0; i < 4; ++i) out[i] = a[i] * scalar;
+    }
+    // out = a + b * scalar
+    static void scaledAdd(const T* a, const T* b, T scalar, T* out) noexcept {
+        for (int i = 0; i < 4; ++i) out[i] = a[i] + b[i] * scalar;
+    }
+};
+
+#ifdef PHY_VECTOR3_SSE
+template <>
+struct Vector3Lanes<float> {
+    static constexpr const char* kName = "sse";
+
+    static void add(const float* a, const float* b, float* out) noexcept {
+        _mm_store_ps(out, _mm_add_ps(_mm_load_ps(a), _mm_load_ps(b)));
+    }
+    static void sub(const float* a, const float* b, float* out) noexcept {
+        _mm_store_ps(out, _mm_sub_ps(_mm_load_ps(a), _mm_load_ps(b)));
+    }
+    static void scale(const float* a, float scalar, float* out) noexcept {
+        _mm_store_ps(out, _mm_mul_ps(_mm_load_ps(a), _mm_set1_ps(scalar)));
+    }
+    static void scaledAdd(const float* a, const float* b, float scalar, float* out) noexcept {
+        // Multiply then add, never fused, to match the scalar result
+        _mm_store_ps(out, _mm_add_ps(_mm_load_ps(a), _mm_mul_ps(_mm_load_ps(b), _mm_set1_ps(scalar))));
+    }
+};
+
+#ifdef PHY_VECTOR3_AVX
+template <>
+struct Vector3Lanes<double> {
+    static constexpr const char* kName = "avx";
+
+    static void add(const double* a, const double* b, double* out) noexcept {
+        _mm256_store_pd(out, _mm256_add_pd(_mm256_load_pd(a), _mm256_load_pd(b)));
+    }
+    static void sub(const double* a, const double* b, double* out) noexcept {
+        _mm256_store_pd(out, _mm256_sub_pd(_mm256_load_pd(a), _mm256_load_pd(b)));
+    }
+    static void scale(const double* a, double scalar, double* out) noexcept {
+        _mm256_store_pd(out, _mm256_mul_pd(_mm256_load_pd(a), _mm256_set1_pd(scalar)));
+    }
+    static void scaledAdd(const double* a, const double* b, double scalar, double* out) noexcept {
+        _mm256_store_pd(out, _mm256_add_pd(_mm256_load_pd(a), _mm256_mul_pd(_mm256_load_pd(b), _mm256_set1_pd(scalar))));
+    }
+};
+#else
+// Two SSE2 registers per vector: (x, y) and (z, w)
+template <>
+struct Vector3Lanes<double> {
+    static constexpr const char* kName = "sse2";
+
+    static void add(const double* a, const double* b, double* out) noexcept {
+        _mm_store_pd(out, _mm_add_pd(_mm_load_pd(a), _mm_load_pd(b)));
+        _mm_store_pd(out + 2, _mm_add_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2)));
+    }
+    static void sub(const double* a, const double* b, double* out) noexcept {
+        _mm_store_pd(out, _mm_sub_pd(_mm_load_pd(a), _mm_load_pd(b)));
+        _mm_store_pd(out + 2, _mm_sub_pd(_mm_load_pd(a + 2), _mm_load_pd(b + 2)));
+    }
+    static void scale(const double* a, double scalar, double* out) noexcept {
+        const __m128d s = _mm_set1_pd(scalar);
+        _mm_store_pd(out, _mm_mul_pd(_mm_load_pd(a), s));
+        _mm_store_pd(out + 2, _mm_mul_pd(_mm_load_pd(a + 2), s));
+    }
+    static void scaledAdd(const double* a, const double* b, double scalar, double* out) noexcept {
+        const __m128d s = _mm_set1_pd(scalar);
+        _mm_store_pd(out, _mm_add_pd(_mm_load_pd(a), _mm_mul_pd(_mm_load_pd(b), s)));
+        _mm_store_pd(out + 2, _mm_add_pd(_mm_load_pd(a + 2), _mm_mul_pd(_mm_load_pd(b + 2), s)));
+    }
+};
+#endif
+#endif
+
+/**
+ * A 3D vector of T (float or double)
+ *
+ * The default layout is three packed components, 3 * sizeof(T) bytes with
+ * no padding. Vector3D keeps this layout: snapshots, trajectories and
+ * compiled maps store particle arrays byte for byte.
+ *
+ * Padded = true selects the SIMD specialization below: a fourth, unused
+ * lane and 4 * sizeof(T) alignment, so a vector is one SSE register (float)
+ * or one AVX / two SSE2 registers (double). Both layouts have the same
+ * interface and give bit-identical results.
+ */
+template <typename T, bool Padded = false>
+class Vector3 {
+public:
+    using value_type = T;
+
+    // Components
+    T x, y, z;
+
+    // Constructors
+    constexpr Vector3() noexcept : x(0), y(0), z(0) {}
+    constexpr Vector3(T x, T y, T z) noexcept : x(x), y(y), z(z) {}
+
+    // Conversion from another precision or layout
+    template <typename U, bool P>
+    constexpr explicit Vector3(const Vector3<U, P>& other) noexcept
+        : x(static_cast<T>(other.x)), y(static_cast<T>(other.y)), z(static_cast<T>(other.z)) {}
+
+    constexpr Vector3(const Vector3& other) noexcept = default;
+    constexpr Vector3(Vector3&& other) noexcept = default;
+    constexpr Vector3& operator=(const Vector3& other) noexcept = default;
+    constexpr Vector3& operator=(Vector3&& other) noexcept = default;
+
+    // Vector addition
+    constexpr inline Vector3 operator+(const Vector3& rhs) const noexcept {
+        return Vector3(x + rhs.x, y + rhs.y, z + rhs.z);
+    }
+
+    // Vector subtraction
+    constexpr inline Vector3 operator-(const Vector3& rhs) const noexcept {
+        return Vector3(x - rhs.x, y - rhs.y, z - rhs.z);
+    }
+
+    // Scalar multiplication
+    constexpr inline Vector3 operator*(T scalar) const noexcept {
+        return Vector3(x * scalar, y * scalar, z * scalar);
+    }
+
+    // Scalar division
+    inline Vector3 operator/(T scalar) const {
+        T invScalar = T(1) / scalar; // Compute once instead of three divisions
+        return Vector3(x * invScalar, y * invScalar, z * invScalar);
+    }
+
+    // Compound assignment operators
+    constexpr inline Vector3& operator+=(const Vector3& rhs) noexcept {
+        x += rhs.x;
+        y += rhs.y;
+        z += rhs.z;
+        return *this;
+    }
+
+    constexpr inline Vector3& operator-=(const Vector3& rhs) noexcept {
+        x -= rhs.x;
+        y -= rhs.y;
+        z -= rhs.z;
+        return *this;
+    }
+
+    constexpr inline Vector3& operator*=(T scalar) noexcept {
+        x *= scalar;
+        y *= scalar;
+        z *= scalar;
+        return *this;
+    }
+
+    inline Vector3& operator/=(T scalar) {
+        T invScalar = T(1) / scalar; // Compute once instead of three divisions
+        x *= invScalar;
+        y *= invScalar;
+        z *= invScalar;
+        return *this;
+    }
+
+    // this += v * scalar without a temporary
+    constexpr inline Vector3& addScaled(const Vector3& v, T scalar) noexcept {
+        x += v.x * scalar;
+        y += v.y * scalar;
+        z += v.z * scalar;
+        return *this;
+    }
+
+    // Dot product
+    constexpr inline T dot(const Vector3& rhs) const noexcept {
+        return x * rhs.x + y * rhs.y + z * rhs.z;
+    }
+
+    // Cross product
+    constexpr inline Vector3 cross(const Vector3& rhs) const noexcept {
+        return Vector3(
+            y * rhs.z - z * rhs.y,
+            z * rhs.x - x * rhs.z,
+            x * rhs.y - y * rhs.x
+        );
+    }
+
+    // Magnitude (length) of the vector
+    inline T magnitude() const noexcept {
+        return std::sqrt(magnitudeSquared());
+    }
+
+    // Squared magnitude (faster when only comparing lengths)
+    constexpr inline T magnitudeSquared() const noexcept {
+        return x * x + y * y + z * z;
+    }
+
+    // Normalize the vector (make it unit length)
+    inline Vector3 normalize() const {
+        T mag = magnitude();
+        if (mag > 0) {
+            T invMag = T(1) / mag;
+            return Vector3(x * invMag, y * invMag, z * invMag);
+        }
+        return Vector3();
+    }
+
+    // Check if vector is zero (within epsilon)
+    constexpr inline bool isZero(T epsilon = T(1e-10)) const noexcept {
+        return magnitudeSquared() < epsilon * epsilon;
+    }
+
+    // Distance between two points
+    static inline T distance(const Vector3& a, const Vector3& b) noexcept {
+        return (b - a).magnitude();
+    }
+
+    // Squared distance between two points (faster)
+    static constexpr inline T distanceSquared(const Vector3& a, const Vector3& b) noexcept {
+        return (b - a).magnitudeSquared();
+    }
+
+    // Linear interpolation between two vectors
+    static inline Vector3 lerp(const Vector3& a, const Vector3& b, T t) noexcept {
+        return a + (b - a) * t;
+    }
+};
+
+/**
+ * Padded SIMD layout: x, y, z and an unused lane w, aligned to 4 * sizeof(T)
+ *
+ * Component-wise operators run on all four lanes through Vector3Lanes.
+ * w starts at zero and never feeds a result; dot products and lengths
+ * stay scalar so they round exactly like the packed layout.
+ */
+template <typename T>
+class alignas(4 * sizeof(T)) Vector3<T, true> {
+public:
+    using value_type = T;
+    using Lanes = Vector3Lanes<T>;
+
+    // Components, and the padding lane
+    T x, y, z;
+    T w;
+
+    // Constructors
+    constexpr Vector3() noexcept : x(0), y(0), z(0), w(0) {}
+    constexpr Vector3(T x, T y, T z) noexcept : x(x), y(y), z(z), w(0) {}
+
+    // Conversion from another precision or layout
+    template <typename U, bool P>
+    constexpr explicit Vector3(const Vector3<U, P>& other) noexcept
+        : x(static_cast<T>(other.x)), y(static_cast<T>(other.y)), z(static_cast<T>(other.z)), w(0) {}
+
+    constexpr Vector3(const Vector3& other) noexcept = default;
+    constexpr Vector3(Vector3&& other) noexcept = default;
+    constexpr Vector3& operator=(const Vector3& other) noexcept = default;
+    constexpr Vector3& operator=(Vector3&& other) noexcept = default;
+
+    // Vector addition
+    inline Vector3 operator+(const Vector3& rhs) const noexcept {
+        Vector3 result;
+        Lanes::add(lanes(), rhs.lanes(), result.lanes());
+        return result;
+    }
+
+    // Vector subtraction
+    inline Vector3 operator-(const Vector3& rhs) const noexcept {
+        Vector3 result;
+        Lanes::sub(lanes(), rhs.lanes(), result.lanes());
+        return result;
+    }
+
+    // Scalar multiplication
+    inline Vector3 operator*(T scalar) const noexcept {
+        Vector3 result;
+        Lanes::scale(lanes(), scalar, result.lanes());
+        return result;
+    }
+
+    // Scalar division
+    inline Vector3 operator/(T scalar) const {
+        return *this * (T(1) / scalar); // Compute once instead of three divisions
+    }
+
+    // Compound assignment operators
+    inline Vector3& operator+=(const Vector3& rhs) noexcept {
+        Lanes::add(lanes(), rhs.lanes(), lanes());
+        return *this;
+    }
+
+    inline Vector3& operator-=(const Vector3& rhs) noexcept {
+        Lanes::sub(lanes(), rhs.lanes(), lanes());
+        return *this;
+    }
+
+    inline Vector3& operator*=(T scalar) noexcept {
+        Lanes::scale(lanes(), scalar, lanes());
+        return *this;
+    }
+
+    inline Vector3& operator/=(T scalar) {
+        return *this *= T(1) / scalar;
+    }
+
+    // this += v * scalar without a temporary
+    inline Vector3& addScaled(const Vector3& v, T scalar) noexcept {
+        Lanes::scaledAdd(lanes(), v.lanes(), scalar, lanes());
+        return *this;
+    }
+
+    // Dot product
+    constexpr inline T dot(const Vector3& rhs) const noexcept {
+        return x * rhs.x + y * rhs.y + z * rhs.z;
+    }
+
+    // Cross product
+    constexpr inline Vector3 cross(const Vector3& rhs) const noexcept {
+        return Vector3(
+            y * rhs.z - z * rhs.y,
+            z * rhs.x - x * rhs.z,
+            x * rhs.y - y * rhs.x
+        );
+    }
+
+    // Magnitude (length) of the vector
+    inline T magnitude() const noexcept {
+        return std::sqrt(magnitudeSquared());
+    }
+
+    // Squared magnitude (faster when only comparing lengths)
+    constexpr inline T magnitudeSquared() const noexcept {
+        return x * x + y * y + z * z;
+    }
+
+    // Normalize the vector (make it unit length)
+    inline Vector3 normalize() const {
+        T mag = magnitude();
+        if (mag > 0) {
+            return *this * (T(1) / mag);
+        }
+        return Vector3();
+    }
+
+    // Check if vector is zero (within epsilon)
+    constexpr inline bool isZero(T epsilon = T(1e-10)) const noexcept {
+        return magnitudeSquared() < epsilon * epsilon;
+    }
+
+    // Distance between two points
+    static inline T distance(const Vector3& a, const Vector3& b) noexcept {
+        return (b - a).magnitude();
+    }
+
+    // Squared distance between two points (faster)
+    static inline T distanceSquared(const Vector3& a, const Vector3& b) noexcept {
+        return (b - a).magnitudeSquared();
+    }
+
+    // Linear interpolation between two vectors
+    static inline Vector3 lerp(const Vector3& a, const Vector3& b, T t) noexcept {
+        return a + (b - a) * t;
+    }
+
+private:
+    // The four lanes start at x; the layout is checked below
+    T* lanes() noexcept { return &x; }
+    const T* lanes() const noexcept { return &x; }
+};
+
+// Stream output operator
+template <typename T, bool Padded>
+inline std::ostream& operator<<(std::ostream& os, const Vector3<T, Padded>& v) {
+    os << "(" << v.x << ", " << v.y << ", " << v.z << ")";
+    return os;
+}
+
+// Scalar multiplication (scalar * vector); the scalar converts like the member operator's
+template <typename T, bool Padded>
+constexpr inline Vector3<T, Padded> operator*(typename Vector3<T, Padded>::value_type scalar,
+                                              const Vector3<T, Padded>& v) noexcept {
+    return v * scalar;
+}
+
+using Vector3F = Vector3<float>;
+using Vector3PaddedF = Vector3<float, true>;
+using Vector3PaddedD = Vector3<double, true>;
+
+static_assert(sizeof(Vector3<float>) == 3 * sizeof(float), "Packed vectors have no padding");
+static_assert(sizeof(Vector3<double>) == 3 * sizeof(double), "Packed vectors have no padding");
+static_assert(sizeof(Vector3PaddedF) == 16 && alignof(Vector3PaddedF) == 16, "Padded float vector is one SSE register");
+static_assert(sizeof(Vector3PaddedD) == 32 && alignof(Vector3PaddedD) == 32, "Padded double vector is one AVX register");
+static_assert(offsetof(Vector3PaddedD, w) == 3 * sizeof(double), "Lanes are contiguous from x");
+static_assert(offsetof(Vector3PaddedF, w) == 3 * sizeof(float), "Lanes are contiguous from x");
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "vector3d.hpp"
+
+/**
+ * Vector math over whole arrays of Vector3D
+ *
+ * Each operation processes a span of packed vectors in one call, so the
+ * loop runs in SIMD registers instead of one Vector3D at a time. The
+ * implementation is picked once at startup from the CPU's features
+ * (AVX-512, AVX2, SSE2 or portable scalar code), so a single binary uses
+ * the widest instructions of whatever machine it runs on.
+ *
+ * All backends perform the same IEEE operations in the same order as the
+ * equivalent Vector3D expressions noted below, so results are
+ * bit-identical across backends and to the open-coded loops they replace.
+ * Output arrays may alias the matching input arrays exactly, but must not
+ * otherwise overlap them.
+ */
+class VectorBatch {
+public:
+    /**
+     * Instruction set of the batch kernels
+     */
+    enum class Backend {
+        Scalar,  // Portable one-vector-at-a-time code
+        SSE2,    // 2 doubles per instruction
+        AVX2,    // 4 doubles per instruction
+        AVX512   // 8 doubles per instruction
+    };
+
+    /**
+     * Select the backend for every subsequent call (process-wide)
+     * @param backend The backend (must be supported on this CPU)
+     */
+    static void setBackend(Backend backend);
+    static Backend getBackend();
+
+    /**
+     * Get the widest backend this machine supports (the startup default)
+     */
+    static Backend bestBackend();
+
+    /**
+     * Check whether a backend was compiled in and runs on this CPU
+     */
+    static bool isSupported(Backend backend);
+
+    /**
+     * Get a short name for a backend ("scalar", "sse2", "avx2", "avx512")
+     */
+    static const char* backendName(Backend backend);
+
+    /**
+     * Parse a backend from its name
+     * @param name Name as returned by backendName()
+     * @param backend Receives the parsed backend on success
+     * @return true if the name was recognised
+     */
+    static bool parseBackend(const std::string& name, Backend& backend);
+
+    /**
+     * y[i] += x[i] * a
+     */
+    static void axpy(Vector3D* y, const Vector3D* x, double a, std::size_t count);
+
+    /**
+     * y[i] += x[i] * scales[i] * a (e.g. v += F * (1/m) * dt)
+     */
+    static void scaledAdd(Vector3D* y, const Vector3D* x, const double* scales, double a, std::size_t count);
+
+    /**
+     * v[i] += f[i] * scales[i] * kick, then x[i] += v[i] * drift
+     *
+     * The integrators' kick and drift in one pass over the particles: each
+     * block of velocities is still in registers when it moves the
+     * positions. Rounds exactly like scaledAdd() followed by axpy().
+     */
+    static void kickDrift(Vector3D* x, Vector3D* v, const Vector3D* f, const double* scales, double kick,
+                          double drift, std::size_t count);
+
+    /**
+     * out[i] = v[i].magnitude()
+     */
+    static void lengths(double* out, const Vector3D* v, std::size_t count);
+
+    /**
+     * v[i] = v[i].normalize() (zero-length vectors become zero)
+     */
+    static void normalize(Vector3D* v, std::size_t count);
+
+    /**
+     * Clamp each component of v[i] to [low, high] (NaN components stay NaN)
+     */
+    static void clampToBox(Vector3D* v, const Vector3D& low, const Vector3D& high, std::size_t count);
+
+    /**
+     * out[i] = Vector3D::distance(a[i], b[i])
+     */
+    static void distances(double* out, const Vector3D* a, const Vector3D* b, std::size_t count);
+
+    /**
+     * out[k] = Vector3D::distanceSquared(points[first[k]], points[second[k]])
+     *
+     * For candidate pair lists such as the narrow phase of ParticleCollider.
+     */
+    static void pairDistancesSquared(double* out, const Vector3D* points, const std::uint32_t* first,
+                                     const std::uint32_t* second, std::size_t count);
+};
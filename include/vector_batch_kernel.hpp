@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Kernels behind VectorBatch, one table per instruction set
+ *
+ * Vectors are passed as packed x, y, z doubles (three per vector, the
+ * layout of Vector3D). Counts are in vectors.
+ */
+struct VectorBatchKernels {
+    void (*axpy)(double* y, const double* x, double a, std::size_t count);
+    void (*scaledAdd)(double* y, const double* x, const double* scales, double a, std::size_t count);
+    void (*kickDrift)(double* x, double* v, const double* f, const double* scales, double kick, double drift,
+                      std::size_t count);
+    void (*lengths)(double* out, const double* v, std::size_t count);
+    void (*normalize)(double* v, std::size_t count);
+    void (*clampToBox)(double* v, const double* low, const double* high, std::size_t count);
+    void (*distances)(double* out, const double* a, const double* b, std::size_t count);
+    void (*pairDistancesSquared)(double* out, const double* points, const std::uint32_t* first,
+                                 const std::uint32_t* second, std::size_t count);
+};
+
+// Kernel tables; the SIMD ones are null when not compiled in for this target
+const VectorBatchKernels* vectorBatchKernelsScalar();
+const VectorBatchKernels* vectorBatchKernelsSse2();
+const VectorBatchKernels* vectorBatchKernelsAvx2();
+const VectorBatchKernels* vectorBatchKernelsAvx512();
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "vector_batch_kernel.hpp"
+
+/**
+ * Lane-generic VectorBatch kernels shared by every instruction set
+ *
+ * L wraps one instruction set: a register type Vec holding kWidth doubles
+ * and static operations on it. Besides plain arithmetic it provides:
+ *   spread(s, out)       - out[0..2] hold lane i of s at components
+ *                          3i, 3i+1, 3i+2 (one scalar per packed vector)
+ *   loadComponents(p)    - x, y and z of kWidth packed vectors at p
+ *   gatherComponents(p, indices) - the same for vectors p + 3 * indices[i]
+ *   positiveOr0(t, a)    - a where t > 0, else 0 (NaN counts as not positive)
+ *
+ * As with the torch kernels, the wrappers live in anonymous namespaces of
+ * translation units built for their instruction set, and this code calls
+ * no inline library functions: tails are padded into a local block and
+ * copied with plain loops, so no shared instantiation can leak wider
+ * instructions into other units.
+ *
+ * Every kernel performs the Vector3D operations it replaces, in the same
+ * order, so all instantiations round identically.
+ */
+template <typename L>
+struct VectorBatchSimd {
+    using Vec = typename L::Vec;
+    static constexpr int kWidth = L::kWidth;
+    static constexpr int kBlock = 3 * kWidth;  // Doubles in kWidth packed vectors
+
+    static void copy(double* destination, const double* source, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) destination[i] = source[i];
+    }
+
+    // y += x * a over one block of kWidth vectors
+    static void axpyBlock(double* y, const double* x, Vec a) {
+        for (int r = 0; r < 3; ++r) {
+            L::store(y + r * kWidth, L::add(L::load(y + r * kWidth), L::mul(L::load(x + r * kWidth), a)));
+        }
+    }
+
+    static void axpy(double* y, const double* x, double a, std::size_t count) {
+        const Vec va = L::set1(a);
+        const std::size_t full = count / kWidth * kWidth;
+        for (std::size_t i = 0; i < full; i += kWidth) {
+            axpyBlock(y + 3 * i, x + 3 * i, va);
+        }
+        if (full < count) {
+            const std::size_t rest = 3 * (count - full);
+            double ty[kBlock] = {};
+            double tx[kBlock] = {};
+            copy(ty, y + 3 * full, rest);
+            copy(tx, x + 3 * full, rest);
+            axpyBlock(ty, tx, va);
+            copy(y + 3 * full, ty, rest);
+        }
+    }
+
+    // y += (x * s) * a over one block
+    static void scaledAddBlock(double* y, const double* x, const double* scales, Vec a) {
+        Vec s[3];
+        L::spread(L::load(scales), s);
+        for (int r = 0; r < 3; ++r) {
+            Vec term = L::mul(L::mul(L::load(x + r * kWidth), s[r]), a);
+            L::store(y + r * kWidth, L::add(L::load(y + r * kWidth), term));
+        }
+    }
+
+    static void scaledAdd(double* y, const double* x, const double* scales, double a, std::size_t count) {
+        const Vec va = L::set1(a);
+        const std::size_t full = count / kWidth * kWidth;
+        for (std::size_t i = 0; i < full; i += kWidth) {
+            scaledAddBlock(y + 3 * i, x + 3 * i, scales + i, va);
+        }
+        if (full < count) {
+            const std::size_t rest = count - full;
+            double ty[kBlock] = {};
+            double tx[kBlock] = {};
+            double ts[kWidth] = {};
+            copy(ty, y + 3 * full, 3 * rest);
+            copy(tx, x + 3 * full, 3 * rest);
+            copy(ts, scales + full, rest);
+            scaledAddBlock(ty, tx, ts, va);
+            copy(y + 3 * full, ty, 3 * rest);
+        }
+    }
+
+    // v += (f * s) * kick, then x += v * drift, over one block
+    static void kickDriftBlock(double* x, double* v, const double* f, const double* scales, Vec kick, Vec drift) {
+        Vec s[3];
+        L::spread(L::load(scales), s);
+        for (int r = 0; r < 3; ++r) {
+            Vec velocity = L::add(L::load(v + r * kWidth), L::mul(L::mul(L::load(f + r * kWidth), s[r]), kick));
+            L::store(v + r * kWidth, velocity);
+            L::store(x + r * kWidth, L::add(L::load(x + r * kWidth), L::mul(velocity, drift)));
+        }
+    }
+
+    static void kickDrift(double* x, double* v, const double* f, const double* scales, double kick, double drift,
+                          std::size_t count) {
+        const Vec vkick = L::set1(kick);
+        const Vec vdrift = L::set1(drift);
+        const std::size_t full = count / kWidth * kWidth;
+        for (std::size_t i = 0; i < full; i += kWidth) {
+            kickDriftBlock(x + 3 * i, v + 3 * i, f + 3 * i, scales + i, vkick, vdrift);
+        }
+        if (full < count) {
+            const std::size_t rest = count - full;
+            double tx[kBlock] = {};
+            double tv[kBlock] = {};
+            double tf[kBlock] = {};
+            double ts[kWidth] = {};
+            copy(tx, x + 3 * full, 3 * rest);
+            copy(tv, v + 3 * full, 3 * rest);
+            copy(tf, f + 3 * full, 3 * rest);
+            copy(ts, scales + full, rest);
+            kickDriftBlock(tx, tv, tf, ts, vkick, vdrift);
+            copy(x + 3 * full, tx, 3 * rest);
+            copy(v + 3 * full, tv, 3 * rest);
+        }
+    }
+
+    // (x * x + y * y) + z * z, the order of Vector3D::magnitudeSquared()
+    static Vec lengthSquared(Vec x, Vec y, Vec z) {
+        return L::add(L::add(L::mul(x, x), L::mul(y, y)), L::mul(z, z));
+    }
+
+    static void lengths(double* out, const double* v, std::size_t count) {
+        const std::size_t full = count / kWidth * kWidth;
+        Vec x, y, z;
+        for (std::size_t i = 0; i < full; i += kWidth) {
+            L::loadComponents(v + 3 * i, x, y, z);
+            L::store(out + i, L::sqrt(lengthSquared(x, y, z)));
+        }
+        if (full < count) {
+            const std::size_t rest = count - full;
+            double tv[kBlock] = {};
+            double to[kWidth];
+            copy(tv, v + 3 * full, 3 * rest);
+            L::loadComponents(tv, x, y, z);
+            L::store(to, L::sqrt(lengthSquared(x, y, z)));
+            copy(out + full, to, rest);
+        }
+    }
+
+    // v * (1 / |v|), or zero when |v| is not positive
+    static void normalizeBlock(double* v) {
+        Vec x, y, z;
+        L::loadComponents(v, x, y, z);
+        const Vec magnitude = L::sqrt(lengthSquared(x, y, z));
+        const Vec inverse = L::div(L::set1(1.0), magnitude);
+        Vec magnitudes[3];
+        Vec inverses[3];
+        L::spread(magnitude, magnitudes);
+        L::spread(inverse, inverses);
+        for (int r = 0; r < 3; ++r) {
+            L::store(v + r * kWidth, L::positiveOr0(magnitudes[r], L::mul(L::load(v + r * kWidth), inverses[r])));
+        }
+    }
+
+    static void normalize(double* v, std::size_t count) {
+        const std::size_t full = count / kWidth * kWidth;
+        for (std::size_t i = 0; i < full; i += kWidth) {
+            normalizeBlock(v + 3 * i);
+        }
+        if (full < count) {
+            const std::size_t rest = 3 * (count - full);
+            double tv[kBlock] = {};
+            copy(tv, v + 3 * full, rest);
+            normalizeBlock(tv);
+            copy(v + 3 * full, tv, rest);
+        }
+    }
+
+    // max then min with the bound first, so NaN components pass through
+    static void clampBlock(double* v, const Vec* low, const Vec* high) {
+        for (int r = 0; r < 3; ++r) {
+            L::store(v + r * kWidth, L::min(high[r], L::max(low[r], L::load(v + r * kWidth))));
+        }
+    }
+
+    static void clampToBox(double* v, const double* low, const double* high, std::size_t count) {
+        // The x, y, z pattern of the bounds repeated across one block
+        double lowPattern[kBlock];
+        double highPattern[kBlock];
+        for (int k = 0; k < kBlock; ++k) {
+            lowPattern[k] = low[k % 3];
+            highPattern[k] = high[k % 3];
+        }
+        Vec lows[3];
+        Vec highs[3];
+        for (int r = 0; r < 3; ++r) {
+            lows[r] = L::load(lowPattern + r * kWidth);
+            highs[r] = L::load(highPattern + r * kWidth);
+        }
+
+        const std::size_t full = count / kWidth * kWidth;
+        for (std::size_t i = 0; i < full; i += kWidth) {
+            clampBlock(v + 3 * i, lows, highs);
+        }
+        if (full < count) {
+            const std::size_t rest = 3 * (count - full);
+            double tv[kBlock] = {};
+            copy(tv, v + 3 * full, rest);
+            clampBlock(tv, lows, highs);
+            copy(v + 3 * full, tv, rest);
+        }
+    }
+
+    // |b - a|, the order of Vector3D::distance()
+    static Vec distanceBlock(const double* a, const double* b) {
+        Vec ax, ay, az, bx, by, bz;
+        L::loadComponents(a, ax, ay, az);
+        L::loadComponents(b, bx, by, bz);
+        return L::sqrt(lengthSquared(L::sub(bx, ax), L::sub(by, ay), L::sub(bz, az)));
+    }
+
+    static void distances(double* out, const double* a, const double* b, std::size_t count) {
+        const std::size_t full = count / kWidth * kWidth;
+        for (std::size_t i = 0; i < full; i += kWidth) {
+            L::store(out + i, distanceBlock(a + 3 * i, b + 3 * i));
+        }
+        if (full < count) {
+            const std::size_t rest = count - full;
+            double ta[kBlock] = {};
+            double tb[kBlock] = {};
+            double to[kWidth];
+            copy(ta, a + 3 * full, 3 * rest);
+            copy(tb, b + 3 * full, 3 * rest);
+            L::store(to, distanceBlock(ta, tb));
+            copy(out + full, to, rest);
+        }
+    }
+
+    static Vec pairBlock(const double* points, const std::uint32_t* first, const std::uint32_t* second) {
+        Vec ax, ay, az, bx, by, bz;
+        L::gatherComponents(points, first, ax, ay, az);
+        L::gatherComponents(points, second, bx, by, bz);
+        return lengthSquared(L::sub(bx, ax), L::sub(by, ay), L::sub(bz, az));
+    }
+
+    static void pairDistancesSquared(double* out, const double* points, const std::uint32_t* first,
+                                     const std::uint32_t* second, std::size_t count) {
+        const std::size_t full = count / kWidth * kWidth;
+        for (std::size_t k = 0; k < full; k += kWidth) {
+            L::store(out + k, pairBlock(points, first + k, second + k));
+        }
+        if (full < count) {
+            // Padding lanes read point 0, which exists whenever there is a pair
+            const std::size_t rest = count - full;
+            std::uint32_t tf[kWidth] = {};
+            std::uint32_t ts[kWidth] = {};
+            double to[kWidth];
+            for (std::size_t k = 0; k < rest; ++k) {
+                tf[k] = first[full + k];
+                ts[k] = second[full + k];
+            }
+            L::store(to, pairBlock(points, tf, ts));
+            copy(out + full, to, rest);
+        }
+    }
+
+    static VectorBatchKernels table() {
+        VectorBatchKernels kernels;
+        kernels.axpy = axpy;
+        kernels.scaledAdd = scaledAdd;
+        kernels.kickDrift = kickDrift;
+        kernels.lengths = lengths;
+        kernels.normalize = normalize;
+        kernels.clampToBox = clampToBox;
+        kernels.distances = distances;
+        kernels.pairDistancesSquared = pairDistancesSquared;
+        return kernels;
+    }
+};
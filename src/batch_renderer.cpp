@@ -0,0 +1,195 @@
+#include "batch_renderer.hpp"
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    constexpr GLsizei kStride = sizeof(BatchVertex);
+
+    const void* offsetPointer(std::size_t offset) {
+        return reinterpret_cast<const void*>(offset);
+    }
+
+    // Point the fixed-function vertex and colour arrays at the bound buffer
+    void setVertexPointers() {
+        glVertexPointer(3, GL_FLOAT, kStride, offsetPointer(offsetof(BatchVertex, x)));
+        glColorPointer(4, GL_FLOAT, kStride, offsetPointer(offsetof(BatchVertex, color)));
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+    }
+}
+
+BatchRenderer::BatchRenderer()
+    : useVertexArrays_(false),
+      useMapBufferRange_(false),
+      ringBuffer_(0),
+      ringVertexArray_(0),
+      ringBytes_(0),
+      ringOffset_(0),
+      drawCalls_(0),
+      streamedBytes_(0) {
+}
+
+BatchRenderer::~BatchRenderer() {
+    release();
+}
+
+void BatchRenderer::initialize(std::size_t ringBytes) {
+    release();
+
+    if (ringBytes < sizeof(BatchVertex)) {
+        throw std::invalid_argument("Ring buffer must hold at least one vertex");
+    }
+
+    useVertexArrays_ = GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object;
+    useMapBufferRange_ = GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range;
+
+    // Round down to whole vertices so every batch starts on a vertex boundary
+    ringBytes_ = ringBytes / sizeof(BatchVertex) * sizeof(BatchVertex);
+    ringOffset_ = 0;
+    glGenBuffers(1, &ringBuffer_);
+    glBindBuffer(GL_ARRAY_BUFFER, ringBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(ringBytes_), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    ringVertexArray_ = createVertexArray(ringBuffer_);
+}
+
+void BatchRenderer::release() {
+    for (Mesh& mesh : meshes_) {
+        if (mesh.vertexArray) glDeleteVertexArrays(1, &mesh.vertexArray);
+        glDeleteBuffers(1, &mesh.buffer);
+    }
+    meshes_.clear();
+
+    if (ringVertexArray_) {
+        glDeleteVertexArrays(1, &ringVertexArray_);
+        ringVertexArray_ = 0;
+    }
+    if (ringBuffer_) {
+        glDeleteBuffers(1, &ringBuffer_);
+        ringBuffer_ = 0;
+    }
+}
+
+GLuint BatchRenderer::createVertexArray(GLuint buffer) {
+    if (!useVertexArrays_) return 0;
+
+    GLuint vertexArray = 0;
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    setVertexPointers();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vertexArray;
+}
+
+void BatchRenderer::bind(GLuint buffer, GLuint vertexArray) {
+    if (vertexArray) {
+        glBindVertexArray(vertexArray);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        setVertexPointers();
+    }
+}
+
+void BatchRenderer::unbind(GLuint vertexArray) {
+    if (vertexArray) {
+        glBindVertexArray(0);
+    } else {
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glDisableClientState(GL_COLOR_ARRAY);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+std::size_t BatchRenderer::uploadStatic(const GeometryBatch& batch) {
+    Mesh mesh{0, 0, {}};
+    glGenBuffers(1, &mesh.buffer);
+    mesh.vertexArray = createVertexArray(mesh.buffer);
+    meshes_.push_back(mesh);
+
+    std::size_t handle = meshes_.size() - 1;
+    updateStatic(handle, batch);
+    return handle;
+}
+
+void BatchRenderer::updateStatic(std::size_t mesh, const GeometryBatch& batch) {
+    Mesh& target = meshes_.at(mesh);
+    const std::vector<BatchVertex>& vertices = batch.getVertices();
+    glBindBuffer(GL_ARRAY_BUFFER, target.buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(BatchVertex)),
+                 vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    target.commands = batch.getCommands();
+}
+
+void BatchRenderer::drawStatic(std::size_t mesh) {
+    const Mesh& source = meshes_.at(mesh);
+    if (source.commands.empty()) return;
+
+    bind(source.buffer, source.vertexArray);
+    drawCommands(source.commands, 0);
+    unbind(source.vertexArray);
+}
+
+void BatchRenderer::drawDynamic(const GeometryBatch& batch) {
+    if (batch.empty()) return;
+
+    const std::vector<BatchVertex>& vertices = batch.getVertices();
+    const std::size_t bytes = vertices.size() * sizeof(BatchVertex);
+    glBindBuffer(GL_ARRAY_BUFFER, ringBuffer_);
+
+    if (bytes > ringBytes_) {
+        // Grow to fit; the old storage is orphaned
+        ringBytes_ = bytes * 2;
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(ringBytes_), nullptr, GL_STREAM_DRAW);
+        ringOffset_ = 0;
+    } else if (ringOffset_ + bytes > ringBytes_) {
+        // Wrapped: orphan the buffer instead of waiting for the GPU to release it
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(ringBytes_), nullptr, GL_STREAM_DRAW);
+        ringOffset_ = 0;
+    }
+
+    bool written = false;
+    if (useMapBufferRange_) {
+        // Nothing in use can overlap this range, so skip the implicit sync
+        void* target = glMapBufferRange(GL_ARRAY_BUFFER, static_cast<GLintptr>(ringOffset_),
+                                        static_cast<GLsizeiptr>(bytes),
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (target) {
+            std::memcpy(target, vertices.data(), bytes);
+            written = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+        }
+    }
+    if (!written) {
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(ringOffset_),
+                        static_cast<GLsizeiptr>(bytes), vertices.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    bind(ringBuffer_, ringVertexArray_);
+    drawCommands(batch.getCommands(), static_cast<GLint>(ringOffset_ / sizeof(BatchVertex)));
+    unbind(ringVertexArray_);
+
+    ringOffset_ += bytes;
+    streamedBytes_ += bytes;
+}
+
+void BatchRenderer::drawCommands(const std::vector<BatchCommand>& commands, GLint baseVertex) {
+    for (const BatchCommand& command : commands) {
+        GLenum mode = GL_TRIANGLES;
+        if (command.primitive == BatchPrimitive::Lines) {
+            glLineWidth(command.lineWidth);
+            mode = GL_LINES;
+        }
+        glDrawArrays(mode, baseVertex + static_cast<GLint>(command.first), static_cast<GLsizei>(command.count));
+        ++drawCalls_;
+    }
+    glLineWidth(1.0f);
+}
+
+void BatchRenderer::beginFrame() {
+    drawCalls_ = 0;
+    streamedBytes_ = 0;
+}
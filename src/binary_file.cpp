@@ -0,0 +1,38 @@
+#include "binary_file.hpp"
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+bool hostIsLittleEndian() {
+    const std::uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+std::uint64_t alignUp(std::uint64_t value) {
+    return (value + kFileArrayAlignment - 1) / kFileArrayAlignment * kFileArrayAlignment;
+}
+
+void writeBytes(std::FILE* file, const void* data, std::size_t bytes, const char* kind, const std::string& path) {
+    if (bytes && std::fwrite(data, 1, bytes, file) != bytes) {
+        throw std::runtime_error(std::string("Failed to write ") + kind + ": " + path);
+    }
+}
+
+void padTo(std::FILE* file, std::uint64_t& position, std::uint64_t target, const char* kind, const std::string& path) {
+    static const char zeros[kFileArrayAlignment] = {};
+    writeBytes(file, zeros, static_cast<std::size_t>(target - position), kind, path);
+    position = target;
+}
+
+bool replaceFile(const std::string& from, const std::string& to) {
+#if defined(_WIN32)
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
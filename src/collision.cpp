@@ -0,0 +1,216 @@
+#include "collision.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    // Gap left between a circle and the obstacle it stopped against, so the
+    // next query does not start in contact
+    constexpr double kContactSkin = 1e-6;
+
+    // Padding for grid queries, which are done in single precision
+    constexpr double kQueryPadding = 1e-4;
+
+    // Whether a circle overlaps the rectangle, with the same rules as Obstacle::intersectsCircle
+    bool overlapsRectangle(double left, double right, double bottom, double top,
+                           double x, double y, double radius) {
+        double distanceX = x - std::clamp(x, left, right);
+        double distanceY = y - std::clamp(y, bottom, top);
+        if (distanceX * distanceX + distanceY * distanceY < radius * radius) {
+            return true;
+        }
+        return x > left && x < right && y > bottom && y < top;
+    }
+}
+
+bool sweepCircle(const Obstacle& obstacle, double x, double y, double dx, double dy,
+                 double radius, SweepHit& hit) {
+    const double left = obstacle.left();
+    const double right = obstacle.right();
+    const double bottom = obstacle.bottom();
+    const double top = obstacle.top();
+
+    // Already overlapping: block only motion that goes further in
+    if (overlapsRectangle(left, right, bottom, top, x, y, radius)) {
+        double normalX = x - std::clamp(x, left, right);
+        double normalY = y - std::clamp(y, bottom, top);
+        double distance = std::sqrt(normalX * normalX + normalY * normalY);
+        if (distance > 0.0) {
+            normalX /= distance;
+            normalY /= distance;
+        } else {
+            // Centre inside the rectangle: push out through the nearest face
+            const double depths[4] = {x - left, right - x, y - bottom, top - y};
+            const double normals[4][2] = {{-1.0, 0.0}, {1.0, 0.0}, {0.0, -1.0}, {0.0, 1.0}};
+            int face = static_cast<int>(std::min_element(depths, depths + 4) - depths);
+            normalX = normals[face][0];
+            normalY = normals[face][1];
+        }
+
+        if (dx * normalX + dy * normalY >= 0.0) {
+            return false;
+        }
+        hit = SweepHit{0.0, normalX, normalY};
+        return true;
+    }
+
+    // Ray against the rectangle grown by the radius (slab test)
+    const double minimum[2] = {left - radius, bottom - radius};
+    const double maximum[2] = {right + radius, top + radius};
+    const double origin[2] = {x, y};
+    const double direction[2] = {dx, dy};
+    double enterTime = 0.0;
+    double exitTime = 1.0;
+    int enterAxis = -1;
+
+    for (int axis = 0; axis < 2; ++axis) {
+        if (direction[axis] == 0.0) {
+            if (origin[axis] < minimum[axis] || origin[axis] > maximum[axis]) return false;
+            continue;
+        }
+        double inverse = 1.0 / direction[axis];
+        double nearTime = (minimum[axis] - origin[axis]) * inverse;
+        double farTime = (maximum[axis] - origin[axis]) * inverse;
+        if (nearTime > farTime) std::swap(nearTime, farTime);
+        // >= so a circle starting in exact contact with a face enters through it
+        if (nearTime >= enterTime) {
+            enterTime = nearTime;
+            enterAxis = axis;
+        }
+        exitTime = std::min(exitTime, farTime);
+        if (enterTime > exitTime) return false;
+    }
+
+    // Entry point on a flat face of the grown rectangle
+    double entryX = x + dx * enterTime;
+    double entryY = y + dy * enterTime;
+    bool alongX = entryX >= left && entryX <= right;
+    bool alongY = entryY >= bottom && entryY <= top;
+    if ((enterAxis == 0 && alongY) || (enterAxis == 1 && alongX)) {
+        hit.time = enterTime;
+        hit.normalX = enterAxis == 0 ? (dx > 0.0 ? -1.0 : 1.0) : 0.0;
+        hit.normalY = enterAxis == 1 ? (dy > 0.0 ? -1.0 : 1.0) : 0.0;
+        return true;
+    }
+
+    // Entry point in a corner region: the grown rectangle is rounded there,
+    // so intersect the ray with a circle around the rectangle's corner
+    if (radius <= 0.0) return false;
+    double cornerX = entryX < left ? left : right;
+    double cornerY = entryY < bottom ? bottom : top;
+    double offsetX = x - cornerX;
+    double offsetY = y - cornerY;
+    double a = dx * dx + dy * dy;
+    double b = offsetX * dx + offsetY * dy;
+    double c = offsetX * offsetX + offsetY * offsetY - radius * radius;
+    double discriminant = b * b - a * c;
+    if (discriminant < 0.0) return false;
+
+    double time = (-b - std::sqrt(discriminant)) / a;
+    if (time < 0.0 || time > 1.0) return false;
+
+    hit.time = time;
+    hit.normalX = (offsetX + dx * time) / radius;
+    hit.normalY = (offsetY + dy * time) / radius;
+    return true;
+}
+
+void ObstacleCollider::setObstacles(std::vector<Obstacle> obstacles) {
+    adoptedOwner_.reset();
+    adoptedObstacles_ = nullptr;
+    adoptedCount_ = 0;
+    obstacles_ = std::move(obstacles);
+    grid_.build(obstacles_.data(), obstacles_.size());
+}
+
+void ObstacleCollider::adoptObstacles(std::shared_ptr<const void> owner, const Obstacle* obstacles,
+                                      std::size_t count, const ObstacleGrid::Baked& grid) {
+    if (!owner || (count > 0 && !obstacles)) {
+        throw std::invalid_argument("Adopted obstacles need an owner and an array");
+    }
+    if (grid.obstacleCount != count) {
+        throw std::invalid_argument("Grid was built for a different obstacle count");
+    }
+    grid_.adopt(owner, grid);
+    obstacles_.clear();
+    adoptedOwner_ = std::move(owner);
+    adoptedObstacles_ = obstacles;
+    adoptedCount_ = count;
+}
+
+void ObstacleCollider::clear() {
+    obstacles_.clear();
+    adoptedOwner_.reset();
+    adoptedObstacles_ = nullptr;
+    adoptedCount_ = 0;
+    grid_.build(nullptr, 0);
+}
+
+bool ObstacleCollider::overlaps(double x, double y, double radius) const {
+    const Obstacle* obstacles = getObstacles();
+    const double reach = radius + kQueryPadding;
+    return grid_.visitCandidates(static_cast<float>(x - reach), static_cast<float>(y - reach),
+                                 static_cast<float>(x + reach), static_cast<float>(y + reach),
+        [&](std::uint32_t index) {
+            const Obstacle& obstacle = obstacles[index];
+            return overlapsRectangle(obstacle.left(), obstacle.right(), obstacle.bottom(), obstacle.top(),
+                                     x, y, radius);
+        });
+}
+
+bool ObstacleCollider::sweep(double x, double y, double dx, double dy, double radius, SweepHit& hit) const {
+    // Only obstacles under the bounds of the whole swept path can be hit
+    const Obstacle* obstacles = getObstacles();
+    const double reach = radius + kQueryPadding;
+    bool found = false;
+    grid_.visitCandidates(static_cast<float>(std::min(x, x + dx) - reach),
+                          static_cast<float>(std::min(y, y + dy) - reach),
+                          static_cast<float>(std::max(x, x + dx) + reach),
+                          static_cast<float>(std::max(y, y + dy) + reach),
+        [&](std::uint32_t index) {
+            SweepHit candidate;
+            if (sweepCircle(obstacles[index], x, y, dx, dy, radius, candidate) &&
+                (!found || candidate.time < hit.time)) {
+                hit = candidate;
+                found = true;
+            }
+            return false;
+        });
+    return found;
+}
+
+SlideResult ObstacleCollider::slide(double x, double y, double dx, double dy, double radius) const {
+    SlideResult result;
+    result.x = x;
+    result.y = y;
+    result.contactCount = 0;
+
+    while (dx != 0.0 || dy != 0.0) {
+        SweepHit hit;
+        if (!sweep(result.x, result.y, dx, dy, radius, hit)) {
+            result.x += dx;
+            result.y += dy;
+            break;
+        }
+
+        // Stop at the contact, just clear of the surface
+        result.x += dx * hit.time + hit.normalX * kContactSkin;
+        result.y += dy * hit.time + hit.normalY * kContactSkin;
+        result.normalX[result.contactCount] = hit.normalX;
+        result.normalY[result.contactCount] = hit.normalY;
+        if (++result.contactCount == SlideResult::kMaxContacts) break;
+
+        // Slide: keep only the part of the remaining motion along the surface
+        dx *= 1.0 - hit.time;
+        dy *= 1.0 - hit.time;
+        double into = dx * hit.normalX + dy * hit.normalY;
+        if (into < 0.0) {
+            dx -= hit.normalX * into;
+            dy -= hit.normalY * into;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,20 @@
+#include "cpu_features.hpp"
+
+namespace {
+    CpuFeatures detectCpuFeatures() {
+        CpuFeatures features;
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        // CPUID, plus XGETBV for the OS-enabled register state
+        __builtin_cpu_init();
+        features.sse2 = __builtin_cpu_supports("sse2");
+        features.avx2 = __builtin_cpu_supports("avx2");
+        features.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+        return features;
+    }
+}
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
@@ -0,0 +1,68 @@
+#include "force_generators.hpp"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+void UniformGravity::apply(ParticleStore& particles, std::size_t begin, std::size_t end) const {
+    Vector3D* forces = particles.forces();
+    const double* masses = particles.masses();
+    for (std::size_t i = begin; i < end; ++i) {
+        forces[i] += acceleration_ * masses[i];
+    }
+}
+
+void LinearDrag::apply(ParticleStore& particles, std::size_t begin, std::size_t end) const {
+    Vector3D* forces = particles.forces();
+    const Vector3D* velocities = particles.velocities();
+    for (std::size_t i = begin; i < end; ++i) {
+        forces[i] -= velocities[i] * coefficient_;
+    }
+}
+
+void PointAttractor::apply(ParticleStore& particles, std::size_t begin, std::size_t end) const {
+    Vector3D* forces = particles.forces();
+    const Vector3D* positions = particles.positions();
+    const double* masses = particles.masses();
+    const double softening2 = softening_ * softening_;
+    for (std::size_t i = begin; i < end; ++i) {
+        Vector3D r = center_ - positions[i];
+        double r2 = r.magnitudeSquared() + softening2;
+        if (r2 <= 0.0) continue;
+        forces[i] += r * (strength_ * masses[i] / (r2 * std::sqrt(r2)));
+    }
+}
+
+void SpringForce::addSpring(std::size_t a, std::size_t b, double restLength, double stiffness, double damping) {
+    if (a == b) {
+        throw std::invalid_argument("Spring endpoints must be different particles");
+    }
+    if (a > std::numeric_limits<std::uint32_t>::max() || b > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::out_of_range("Spring endpoint index too large");
+    }
+    springs_.push_back(Spring{static_cast<std::uint32_t>(a), static_cast<std::uint32_t>(b),
+                              restLength, stiffness, damping});
+}
+
+void SpringForce::apply(ParticleStore& particles, std::size_t begin [[maybe_unused]],
+                        std::size_t end [[maybe_unused]]) const {
+    Vector3D* forces = particles.forces();
+    const Vector3D* positions = particles.positions();
+    const Vector3D* velocities = particles.velocities();
+    const std::size_t count = particles.size();
+
+    for (const Spring& spring : springs_) {
+        if (spring.a >= count || spring.b >= count) continue;
+
+        Vector3D delta = positions[spring.b] - positions[spring.a];
+        double length = delta.magnitude();
+        if (length <= 0.0) continue;
+
+        Vector3D direction = delta * (1.0 / length);
+        double stretch = length - spring.restLength;
+        double closingSpeed = (velocities[spring.b] - velocities[spring.a]).dot(direction);
+        Vector3D force = direction * (spring.stiffness * stretch + spring.damping * closingSpeed);
+
+        forces[spring.a] += force;
+        forces[spring.b] -= force;
+    }
+}
@@ -0,0 +1,552 @@
+#include "game_map.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include "binary_file.hpp"
+#include "mapped_file.hpp"
+
+namespace {
+    const char kMagic[8] = {'P', 'H', 'Y', 'M', 'A', 'P', '\0', '\0'};
+    constexpr std::uint32_t kCompiledMapVersion = 1;
+
+    /**
+     * Fixed-size header at the start of a compiled map
+     *
+     * Layout (all values little-endian, arrays at multiples of 64):
+     *   header (128 bytes)
+     *   walls            wallCount Obstacles (4 floats each)
+     *   cell offsets     columns x rows + 1 uint32
+     *   cell items       cellItemCount uint32
+     *   wall cells       wallCount (int32 column, int32 row) pairs
+     *   extras           spawn, site and label records
+     *
+     * Each extra record is (uint32 kind, float x, float y, float radius,
+     * uint32 byte length, name bytes).
+     */
+    struct CompiledMapHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::uint64_t wallCount;
+        std::uint64_t wallsOffset;
+        float minX, minY, maxX, maxY;
+        float originX, originY;
+        float cellSize;
+        std::int32_t columns;
+        std::int32_t rows;
+        std::uint32_t reserved0;
+        std::uint64_t cellStartsOffset;
+        std::uint64_t cellItemCount;
+        std::uint64_t cellItemsOffset;
+        std::uint64_t wallCellsOffset;
+        std::uint64_t extrasOffset;
+        std::uint64_t extrasSize;
+        std::uint64_t reserved;
+    };
+    static_assert(sizeof(CompiledMapHeader) == 128, "Compiled map header layout changed");
+    static_assert(sizeof(Obstacle) == 4 * sizeof(float), "Obstacle layout changed");
+
+    enum ExtraKind : std::uint32_t { kSpawn = 0, kSite = 1, kLabel = 2 };
+
+    template <typename T>
+    void appendValue(std::vector<char>& out, T value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+    }
+
+    void appendExtra(std::vector<char>& out, std::uint32_t kind, float x, float y, float radius,
+                     const std::string& text) {
+        appendValue(out, kind);
+        appendValue(out, x);
+        appendValue(out, y);
+        appendValue(out, radius);
+        appendValue(out, static_cast<std::uint32_t>(text.size()));
+        out.insert(out.end(), text.begin(), text.end());
+    }
+
+    bool arrayFits(std::uint64_t offset, std::uint64_t bytes, std::size_t fileSize) {
+        return offset % alignof(std::uint32_t) == 0 && offset <= fileSize && bytes <= fileSize - offset;
+    }
+
+    // 64-bit FNV-1a, fed field by field so struct padding never enters the hash
+    class Fnv1a {
+    public:
+        void add(const void* data, std::size_t bytes) {
+            const unsigned char* cursor = static_cast<const unsigned char*>(data);
+            for (std::size_t i = 0; i < bytes; ++i) {
+                hash_ = (hash_ ^ cursor[i]) * 1099511628211ull;
+            }
+        }
+
+        template <typename T>
+        void addValue(T value) { add(&value, sizeof(value)); }
+
+        void addText(const std::string& text) {
+            addValue(static_cast<std::uint64_t>(text.size()));
+            add(text.data(), text.size());
+        }
+
+        std::uint64_t value() const { return hash_; }
+
+    private:
+        std::uint64_t hash_ = 14695981039346656037ull;
+    };
+
+    bool validBounds(const MapBounds& bounds) {
+        return std::isfinite(bounds.minX) && std::isfinite(bounds.minY) && std::isfinite(bounds.maxX) &&
+               std::isfinite(bounds.maxY) && bounds.minX < bounds.maxX && bounds.minY < bounds.maxY;
+    }
+
+    // Finite centre and a finite, positive size
+    bool validWall(const Obstacle& wall) {
+        return std::isfinite(wall.x) && std::isfinite(wall.y) && std::isfinite(wall.width) &&
+               std::isfinite(wall.height) && wall.width > 0.0f && wall.height > 0.0f;
+    }
+}
+
+GameMap::GameMap()
+    : bounds_{-5.0f, -5.0f, 5.0f, 5.0f},
+      mappedObstacles_(nullptr),
+      mappedCount_(0) {
+}
+
+void GameMap::setBounds(const MapBounds& bounds) {
+    if (!validBounds(bounds)) {
+        throw std::invalid_argument("Map bounds must be finite and non-empty");
+    }
+    bounds_ = bounds;
+}
+
+void GameMap::addObstacle(const Obstacle& obstacle) {
+    if (mapping_) {
+        // Walls are read-only in the mapping; take a copy before growing
+        obstacles_.assign(mappedObstacles_, mappedObstacles_ + mappedCount_);
+        mapping_.reset();
+        mappedObstacles_ = nullptr;
+        mappedCount_ = 0;
+        grid_.build(nullptr, 0);
+    }
+    obstacles_.push_back(obstacle);
+}
+
+void GameMap::buildGrid(float cellSize) {
+    grid_.build(getObstacles(), getObstacleCount(), cellSize);
+}
+
+std::uint64_t GameMap::fingerprint() const {
+    Fnv1a hash;
+    hash.addValue(bounds_.minX);
+    hash.addValue(bounds_.minY);
+    hash.addValue(bounds_.maxX);
+    hash.addValue(bounds_.maxY);
+    hash.addValue(static_cast<std::uint64_t>(getObstacleCount()));
+    hash.add(getObstacles(), getObstacleCount() * sizeof(Obstacle));
+    hash.addValue(static_cast<std::uint64_t>(spawns_.size()));
+    for (const MapSpawn& spawn : spawns_) {
+        hash.addValue(spawn.x);
+        hash.addValue(spawn.y);
+        hash.addText(spawn.name);
+    }
+    hash.addValue(static_cast<std::uint64_t>(sites_.size()));
+    for (const MapSite& site : sites_) {
+        hash.addValue(site.x);
+        hash.addValue(site.y);
+        hash.addValue(site.radius);
+        hash.addText(site.name);
+    }
+    hash.addValue(static_cast<std::uint64_t>(labels_.size()));
+    for (const MapLabel& label : labels_) {
+        hash.addValue(label.x);
+        hash.addValue(label.y);
+        hash.addText(label.text);
+    }
+    return hash.value();
+}
+
+GameMap defaultMap(float aspectRatio) {
+    if (!(aspectRatio > 0.0f)) {
+        throw std::invalid_argument("Map aspect ratio must be positive");
+    }
+    GameMap map;
+
+    // Use the full aspect ratio for scaling to fill the window width
+    float scaleX = aspectRatio;
+    map.setBounds(MapBounds{-5.0f * scaleX, -5.0f, 5.0f * scaleX, 5.0f});
+
+    // Defender side (top of map)
+    // Defender spawn area
+    map.addObstacle(Obstacle(-2.0f * scaleX, 3.0f, 4.0f * scaleX, 0.2f));  // Horizontal wall below spawn
+    map.addObstacle(Obstacle(-4.0f * scaleX, 2.5f, 0.2f, 1.0f));  // Left vertical wall
+    map.addObstacle(Obstacle(0.0f, 2.5f, 0.2f, 1.0f));   // Right vertical wall
+
+    // A Site (top right)
+    map.addObstacle(Obstacle(3.0f * scaleX, 3.0f, 4.0f * scaleX, 0.2f));   // Horizontal wall below A site
+    map.addObstacle(Obstacle(1.0f * scaleX, 2.0f, 0.2f, 2.0f));   // Left vertical wall
+    map.addObstacle(Obstacle(3.0f * scaleX, 1.5f, 4.0f * scaleX, 0.2f));   // Bottom wall of A site
+
+    // A Main
+    map.addObstacle(Obstacle(3.0f * scaleX, 0.5f, 0.2f, 2.0f));   // Vertical wall for A Main
+
+    // A Link
+    map.addObstacle(Obstacle(1.5f * scaleX, 1.0f, 3.0f * scaleX, 0.2f));   // Horizontal wall for A Link
+
+    // A Lobby
+    map.addObstacle(Obstacle(3.0f * scaleX, -1.5f, 0.2f, 2.0f));  // Vertical wall for A Lobby
+
+    // Mid Courtyard
+    map.addObstacle(Obstacle(0.0f, 0.0f, 2.0f * scaleX, 2.0f));   // Center obstacle
+
+    // Mid Top
+    map.addObstacle(Obstacle(-1.5f * scaleX, 1.5f, 3.0f * scaleX, 0.2f));  // Horizontal wall for Mid Top
+
+    // B Site (top left)
+    map.addObstacle(Obstacle(-3.0f * scaleX, 1.5f, 2.0f * scaleX, 0.2f));  // Bottom wall of B site
+    map.addObstacle(Obstacle(-2.0f * scaleX, 2.0f, 0.2f, 1.0f));  // Right vertical wall of B site
+
+    // B Main
+    map.addObstacle(Obstacle(-3.0f * scaleX, 0.0f, 0.2f, 3.0f));  // Vertical wall for B Main
+
+    // B Market
+    map.addObstacle(Obstacle(-1.5f * scaleX, -0.5f, 3.0f * scaleX, 0.2f)); // Horizontal wall for B Market
+
+    // Mid Tiles
+    map.addObstacle(Obstacle(0.0f, -1.5f, 2.0f * scaleX, 0.2f));  // Horizontal wall for Mid Tiles
+
+    // Mid Bottom
+    map.addObstacle(Obstacle(-1.5f * scaleX, -2.0f, 3.0f * scaleX, 0.2f)); // Horizontal wall for Mid Bottom
+
+    // B Lobby
+    map.addObstacle(Obstacle(-2.0f * scaleX, -2.5f, 0.2f, 1.0f)); // Vertical wall for B Lobby
+
+    // Attacker side (bottom of map)
+    // Attacker spawn area
+    map.addObstacle(Obstacle(0.0f, -3.0f, 4.0f * scaleX, 0.2f));  // Horizontal wall above spawn
+
+    // Spawn points for defender and attacker sides
+    map.addSpawn(MapSpawn{-2.0f * scaleX, 3.5f, "Defender"});  // Defender spawn (top)
+    map.addSpawn(MapSpawn{0.0f, -3.5f, "Attacker"});           // Attacker spawn (bottom)
+
+    // A and B site markers
+    map.addSite(MapSite{3.5f * scaleX, 2.0f, 0.3f, "A"});
+    map.addSite(MapSite{-3.0f * scaleX, 2.0f, 0.3f, "B"});
+
+    // Location names
+    map.addLabel(MapLabel{-2.0f * scaleX, 3.5f, "DEFENDER SIDE SPAWN"});
+    map.addLabel(MapLabel{3.0f * scaleX, 2.5f, "A SITE"});
+    map.addLabel(MapLabel{4.0f * scaleX, 1.0f, "A ELBOW"});
+    map.addLabel(MapLabel{1.5f * scaleX, 1.3f, "A LINK"});
+    map.addLabel(MapLabel{3.5f * scaleX, 0.0f, "A MAIN"});
+    map.addLabel(MapLabel{3.5f * scaleX, -2.0f, "A LOBBY"});
+    map.addLabel(MapLabel{0.0f, 0.3f, "MID COURTYARD"});
+    map.addLabel(MapLabel{-1.5f * scaleX, 1.8f, "MID TOP"});
+    map.addLabel(MapLabel{0.0f, -1.8f, "MID TILES"});
+    map.addLabel(MapLabel{-1.5f * scaleX, -2.3f, "MID BOTTOM"});
+    map.addLabel(MapLabel{-3.0f * scaleX, 2.5f, "B SITE"});
+    map.addLabel(MapLabel{-3.5f * scaleX, 1.0f, "B BOBA"});
+    map.addLabel(MapLabel{-3.5f * scaleX, -1.0f, "B MAIN"});
+    map.addLabel(MapLabel{-1.5f * scaleX, -0.8f, "B MARKET"});
+    map.addLabel(MapLabel{-2.5f * scaleX, -2.8f, "B LOBBY"});
+    map.addLabel(MapLabel{0.0f, -3.5f, "ATTACKER SIDE SPAWN"});
+
+    map.buildGrid();
+    return map;
+}
+
+GameMap readMapText(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open map: " + path);
+    }
+
+    GameMap map;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::string::size_type comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream in(line);
+        std::string keyword;
+        if (!(in >> keyword)) continue;  // Blank line
+
+        auto fail = [&](const std::string& message) {
+            return std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + message);
+        };
+        // Remaining text after the numbers, without leading blanks
+        auto rest = [&]() {
+            std::string text;
+            std::getline(in >> std::ws, text);
+            while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+                text.pop_back();
+            }
+            return text;
+        };
+
+        float x, y;
+        if (keyword == "bounds") {
+            MapBounds bounds;
+            if (!(in >> bounds.minX >> bounds.minY >> bounds.maxX >> bounds.maxY) || !validBounds(bounds)) {
+                throw fail("bounds needs MINX MINY MAXX MAXY with min below max");
+            }
+            map.setBounds(bounds);
+        } else if (keyword == "wall") {
+            float width, height;
+            if (!(in >> x >> y >> width >> height) || !validWall(Obstacle(x, y, width, height))) {
+                throw fail("wall needs X Y WIDTH HEIGHT with a positive size");
+            }
+            map.addObstacle(Obstacle(x, y, width, height));
+        } else if (keyword == "spawn") {
+            std::string name;
+            if (!(in >> x >> y) || (name = rest()).empty()) {
+                throw fail("spawn needs X Y NAME");
+            }
+            map.addSpawn(MapSpawn{x, y, name});
+        } else if (keyword == "site") {
+            float radius;
+            std::string name;
+            if (!(in >> x >> y >> radius) || !(radius > 0.0f) || (name = rest()).empty()) {
+                throw fail("site needs X Y RADIUS NAME");
+            }
+            map.addSite(MapSite{x, y, radius, name});
+        } else if (keyword == "label") {
+            std::string text;
+            if (!(in >> x >> y) || (text = rest()).empty()) {
+                throw fail("label needs X Y TEXT");
+            }
+            map.addLabel(MapLabel{x, y, text});
+        } else {
+            throw fail("unknown item '" + keyword + "'");
+        }
+    }
+
+    map.buildGrid();
+    return map;
+}
+
+void writeMapText(const std::string& path, const GameMap& map) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to create map: " + path);
+    }
+    file << std::setprecision(std::numeric_limits<float>::max_digits10);
+
+    const MapBounds& bounds = map.getBounds();
+    file << "bounds " << bounds.minX << ' ' << bounds.minY << ' ' << bounds.maxX << ' ' << bounds.maxY << '\n';
+    for (const MapSpawn& spawn : map.getSpawns()) {
+        file << "spawn " << spawn.x << ' ' << spawn.y << ' ' << spawn.name << '\n';
+    }
+    for (const MapSite& site : map.getSites()) {
+        file << "site " << site.x << ' ' << site.y << ' ' << site.radius << ' ' << site.name << '\n';
+    }
+    for (const MapLabel& label : map.getLabels()) {
+        file << "label " << label.x << ' ' << label.y << ' ' << label.text << '\n';
+    }
+    const Obstacle* walls = map.getObstacles();
+    for (std::size_t i = 0; i < map.getObstacleCount(); ++i) {
+        file << "wall " << walls[i].x << ' ' << walls[i].y << ' ' << walls[i].width << ' ' << walls[i].height << '\n';
+    }
+
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write map: " + path);
+    }
+}
+
+void writeCompiledMap(const std::string& path, const GameMap& map) {
+    if (!hostIsLittleEndian()) {
+        throw std::runtime_error("Compiled maps are little-endian and this host is not");
+    }
+    const ObstacleGrid::Baked grid = map.getGrid().getBaked();
+    const std::size_t wallCount = map.getObstacleCount();
+    if (grid.obstacleCount != wallCount) {
+        throw std::invalid_argument("Map grid is out of date; call buildGrid() first");
+    }
+
+    std::vector<char> extras;
+    for (const MapSpawn& spawn : map.getSpawns()) appendExtra(extras, kSpawn, spawn.x, spawn.y, 0.0f, spawn.name);
+    for (const MapSite& site : map.getSites()) appendExtra(extras, kSite, site.x, site.y, site.radius, site.name);
+    for (const MapLabel& label : map.getLabels()) appendExtra(extras, kLabel, label.x, label.y, 0.0f, label.text);
+
+    const std::uint64_t cellCount = wallCount ? static_cast<std::uint64_t>(grid.columns) * grid.rows : 0;
+    const std::uint64_t cellStartCount = wallCount ? cellCount + 1 : 0;
+
+    CompiledMapHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kCompiledMapVersion;
+    header.headerSize = sizeof(CompiledMapHeader);
+    header.wallCount = wallCount;
+    header.minX = map.getBounds().minX;
+    header.minY = map.getBounds().minY;
+    header.maxX = map.getBounds().maxX;
+    header.maxY = map.getBounds().maxY;
+    header.originX = grid.originX;
+    header.originY = grid.originY;
+    header.cellSize = grid.cellSize;
+    header.columns = wallCount ? grid.columns : 0;
+    header.rows = wallCount ? grid.rows : 0;
+    header.cellItemCount = wallCount ? grid.cellStarts[cellCount] : 0;
+    header.wallsOffset = alignUp(sizeof(CompiledMapHeader));
+    header.cellStartsOffset = alignUp(header.wallsOffset + wallCount * sizeof(Obstacle));
+    header.cellItemsOffset = alignUp(header.cellStartsOffset + cellStartCount * sizeof(std::uint32_t));
+    header.wallCellsOffset = alignUp(header.cellItemsOffset + header.cellItemCount * sizeof(std::uint32_t));
+    header.extrasOffset = alignUp(header.wallCellsOffset + wallCount * sizeof(ObstacleGrid::CellRange));
+    header.extrasSize = extras.size();
+
+    // Write beside the destination and rename over it, so a crash never
+    // leaves a torn map and readers see either the old file or the new one
+    const std::string temporaryPath = path + ".tmp";
+    {
+        FilePtr file(std::fopen(temporaryPath.c_str(), "wb"));
+        if (!file) {
+            throw std::runtime_error("Failed to create map: " + temporaryPath);
+        }
+        std::uint64_t position = 0;
+        writeBytes(file.get(), &header, sizeof(header), "map", path);
+        position += sizeof(header);
+        padTo(file.get(), position, header.wallsOffset, "map", path);
+        writeBytes(file.get(), map.getObstacles(), wallCount * sizeof(Obstacle), "map", path);
+        position += wallCount * sizeof(Obstacle);
+        padTo(file.get(), position, header.cellStartsOffset, "map", path);
+        writeBytes(file.get(), grid.cellStarts, cellStartCount * sizeof(std::uint32_t), "map", path);
+        position += cellStartCount * sizeof(std::uint32_t);
+        padTo(file.get(), position, header.cellItemsOffset, "map", path);
+        writeBytes(file.get(), grid.cellItems, header.cellItemCount * sizeof(std::uint32_t), "map", path);
+        position += header.cellItemCount * sizeof(std::uint32_t);
+        padTo(file.get(), position, header.wallCellsOffset, "map", path);
+        writeBytes(file.get(), grid.obstacleCells, wallCount * sizeof(ObstacleGrid::CellRange), "map", path);
+        position += wallCount * sizeof(ObstacleGrid::CellRange);
+        padTo(file.get(), position, header.extrasOffset, "map", path);
+        writeBytes(file.get(), extras.data(), extras.size(), "map", path);
+        if (std::fflush(file.get()) != 0) {
+            throw std::runtime_error("Failed to write map: " + path);
+        }
+    }
+    if (!replaceFile(temporaryPath, path)) {
+        throw std::runtime_error("Failed to move map into place: " + path);
+    }
+}
+
+GameMap loadCompiledMap(const std::string& path) {
+    if (!hostIsLittleEndian()) {
+        throw std::runtime_error("Compiled maps are little-endian and this host is not");
+    }
+
+    std::size_t size = 0;
+    std::shared_ptr<const void> mapping = mapFile(path, size, false);
+    if (size < sizeof(CompiledMapHeader)) {
+        throw std::runtime_error("Map is truncated: " + path);
+    }
+    const char* base = static_cast<const char*>(mapping.get());
+    const CompiledMapHeader& header = *reinterpret_cast<const CompiledMapHeader*>(base);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a compiled map: " + path);
+    }
+    if (header.version != kCompiledMapVersion || header.headerSize != sizeof(CompiledMapHeader)) {
+        throw std::runtime_error("Unsupported compiled map version: " + path);
+    }
+
+    // Every array must lie inside the file before anything is read from it
+    const std::uint64_t wallCount = header.wallCount;
+    const std::uint64_t cellStartCount =
+        wallCount ? static_cast<std::uint64_t>(header.columns) * static_cast<std::uint64_t>(header.rows) + 1 : 0;
+    const std::uint64_t limit = size;
+    if (wallCount > limit / sizeof(Obstacle) || header.cellItemCount > limit / sizeof(std::uint32_t) ||
+        header.columns < 0 || header.rows < 0 || cellStartCount > limit / sizeof(std::uint32_t) ||
+        !arrayFits(header.wallsOffset, wallCount * sizeof(Obstacle), size) ||
+        !arrayFits(header.cellStartsOffset, cellStartCount * sizeof(std::uint32_t), size) ||
+        !arrayFits(header.cellItemsOffset, header.cellItemCount * sizeof(std::uint32_t), size) ||
+        !arrayFits(header.wallCellsOffset, wallCount * sizeof(ObstacleGrid::CellRange), size) ||
+        !arrayFits(header.extrasOffset, header.extrasSize, size)) {
+        throw std::runtime_error("Map arrays do not fit in the file: " + path);
+    }
+
+    GameMap map;
+    MapBounds bounds{header.minX, header.minY, header.maxX, header.maxY};
+    if (!validBounds(bounds)) {
+        throw std::runtime_error("Map bounds are invalid: " + path);
+    }
+    map.setBounds(bounds);
+
+    const std::uint32_t* cellStarts = reinterpret_cast<const std::uint32_t*>(base + header.cellStartsOffset);
+    if (wallCount > 0 && cellStarts[cellStartCount - 1] != header.cellItemCount) {
+        throw std::runtime_error("Map grid is corrupt: " + path);
+    }
+    ObstacleGrid::Baked grid{};
+    grid.originX = header.originX;
+    grid.originY = header.originY;
+    grid.cellSize = header.cellSize;
+    grid.columns = header.columns;
+    grid.rows = header.rows;
+    grid.cellStarts = cellStarts;
+    grid.cellItems = reinterpret_cast<const std::uint32_t*>(base + header.cellItemsOffset);
+    grid.obstacleCells = reinterpret_cast<const ObstacleGrid::CellRange*>(base + header.wallCellsOffset);
+    grid.obstacleCount = static_cast<std::size_t>(wallCount);
+    try {
+        map.grid_.adopt(mapping, grid);
+    } catch (const std::invalid_argument& e) {
+        throw std::runtime_error("Map grid is corrupt (" + std::string(e.what()) + "): " + path);
+    }
+    // Mapped walls go straight to collision and torch tracing, so they get
+    // the checks the text parser applies
+    const Obstacle* walls = reinterpret_cast<const Obstacle*>(base + header.wallsOffset);
+    for (std::uint64_t i = 0; i < wallCount; ++i) {
+        if (!validWall(walls[i])) {
+            throw std::runtime_error("Map wall " + std::to_string(i) + " has an invalid position or size: " + path);
+        }
+    }
+    map.mapping_ = mapping;
+    map.mappedObstacles_ = walls;
+    map.mappedCount_ = static_cast<std::size_t>(wallCount);
+
+    // Spawns, sites and labels are few; copy them out
+    const char* extra = base + header.extrasOffset;
+    const char* extrasEnd = extra + header.extrasSize;
+    const std::size_t recordHeader = 5 * sizeof(std::uint32_t);  // Kind, x, y, radius, length
+    while (extra < extrasEnd) {
+        std::uint32_t kind, length;
+        float x, y, radius;
+        if (static_cast<std::size_t>(extrasEnd - extra) < recordHeader) {
+            throw std::runtime_error("Map extras are truncated: " + path);
+        }
+        std::memcpy(&kind, extra, sizeof(kind));
+        std::memcpy(&x, extra + 4, sizeof(x));
+        std::memcpy(&y, extra + 8, sizeof(y));
+        std::memcpy(&radius, extra + 12, sizeof(radius));
+        std::memcpy(&length, extra + 16, sizeof(length));
+        extra += recordHeader;
+        if (static_cast<std::size_t>(extrasEnd - extra) < length) {
+            throw std::runtime_error("Map extras are truncated: " + path);
+        }
+        std::string text(extra, length);
+        extra += length;
+        switch (kind) {
+            case kSpawn: map.addSpawn(MapSpawn{x, y, text}); break;
+            case kSite: map.addSite(MapSite{x, y, radius, text}); break;
+            case kLabel: map.addLabel(MapLabel{x, y, text}); break;
+            default: throw std::runtime_error("Map extras are corrupt: " + path);
+        }
+    }
+    return map;
+}
+
+GameMap loadMap(const std::string& path) {
+    char magic[sizeof(kMagic)] = {};
+    {
+        FilePtr file(std::fopen(path.c_str(), "rb"));
+        if (!file) {
+            throw std::runtime_error("Failed to open map: " + path);
+        }
+        if (std::fread(magic, 1, sizeof(magic), file.get()) != sizeof(magic)) {
+            std::memset(magic, 0, sizeof(magic));  // Too short to be compiled; parse it as text
+        }
+    }
+    if (std::memcmp(magic, kMagic, sizeof(kMagic)) == 0) {
+        return loadCompiledMap(path);
+    }
+    return readMapText(path);
+}
@@ -0,0 +1,88 @@
+#include "geometry_batch.hpp"
+#include <cmath>
+
+void GeometryBatch::clear() {
+    vertices_.clear();
+    commands_.clear();
+}
+
+void GeometryBatch::beginRun(BatchPrimitive primitive, float lineWidth, std::size_t count) {
+    if (primitive == BatchPrimitive::Triangles) {
+        lineWidth = 0.0f;
+    }
+    if (commands_.empty() || commands_.back().primitive != primitive ||
+        commands_.back().lineWidth != lineWidth) {
+        commands_.push_back(BatchCommand{primitive, lineWidth,
+                                         static_cast<std::uint32_t>(vertices_.size()), 0});
+    }
+    commands_.back().count += static_cast<std::uint32_t>(count);
+}
+
+void GeometryBatch::addTriangle(const BatchVertex& a, const BatchVertex& b, const BatchVertex& c) {
+    beginRun(BatchPrimitive::Triangles, 0.0f, 3);
+    vertices_.push_back(a);
+    vertices_.push_back(b);
+    vertices_.push_back(c);
+}
+
+void GeometryBatch::addQuad(const BatchVertex& a, const BatchVertex& b, const BatchVertex& c, const BatchVertex& d) {
+    beginRun(BatchPrimitive::Triangles, 0.0f, 6);
+    vertices_.push_back(a);
+    vertices_.push_back(b);
+    vertices_.push_back(c);
+    vertices_.push_back(a);
+    vertices_.push_back(c);
+    vertices_.push_back(d);
+}
+
+void GeometryBatch::addQuadStrip(const BatchVertex* vertices, std::size_t count) {
+    // Rows (v0, v1), (v2, v3), ... form quads v0 v1 v3 v2, v2 v3 v5 v4, ...
+    for (std::size_t i = 0; i + 3 < count; i += 2) {
+        addQuad(vertices[i], vertices[i + 1], vertices[i + 3], vertices[i + 2]);
+    }
+}
+
+void GeometryBatch::addRectangle(float x, float y, float width, float height, float z, const BatchColor& color) {
+    addQuad(BatchVertex{x - width/2, y - height/2, z, color},
+            BatchVertex{x + width/2, y - height/2, z, color},
+            BatchVertex{x + width/2, y + height/2, z, color},
+            BatchVertex{x - width/2, y + height/2, z, color});
+}
+
+void GeometryBatch::addCircle(float x, float y, float z, float radius, int segments,
+                              const BatchColor& centerColor, const BatchColor& rimColor) {
+    if (segments < 3) return;
+
+    beginRun(BatchPrimitive::Triangles, 0.0f, static_cast<std::size_t>(segments) * 3);
+    const BatchVertex center{x, y, z, centerColor};
+    BatchVertex previous{x + radius, y, z, rimColor};
+    for (int i = 1; i <= segments; ++i) {
+        // Same rim points as the GL_TRIANGLE_FAN this replaces
+        float angle = 2.0f * M_PI * static_cast<float>(i) / static_cast<float>(segments);
+        BatchVertex next{x + radius * std::cos(angle), y + radius * std::sin(angle), z, rimColor};
+        vertices_.push_back(center);
+        vertices_.push_back(previous);
+        vertices_.push_back(next);
+        previous = next;
+    }
+}
+
+void GeometryBatch::addLine(const BatchVertex& a, const BatchVertex& b, float lineWidth) {
+    beginRun(BatchPrimitive::Lines, lineWidth, 2);
+    vertices_.push_back(a);
+    vertices_.push_back(b);
+}
+
+void GeometryBatch::addLineStrip(const BatchVertex* vertices, std::size_t count, float lineWidth) {
+    for (std::size_t i = 0; i + 1 < count; ++i) {
+        addLine(vertices[i], vertices[i + 1], lineWidth);
+    }
+}
+
+void packParticleInstances(const Vector3D* positions, std::size_t count, float radius,
+                           const BatchColor& color, ParticleInstance* out) {
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = ParticleInstance{static_cast<float>(positions[i].x), static_cast<float>(positions[i].y),
+                                  static_cast<float>(positions[i].z), radius, color};
+    }
+}
@@ -1,13 +1,21 @@
 #define GL_SILENCE_DEPRECATION // Silence OpenGL deprecation warnings on macOS
 
 #include "gl_visualizer.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <cmath>
-#include <cstdlib> // Added for rand()
-#include <ctime> // Added for time()
 #include <vector> // Added for std::vector
 #include <random> // Added for random number generation
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
 
+// Node spacing of the torch's baked obstacle field; about 2% rms force
+// error on the built-in map (see phy_mapc --field-report). Maps too large
+// for it are baked at the finest spacing that fits.
+static constexpr float kTorchFieldCellSize = 0.025f;
 
 // Error callback for GLFW
 static void errorCallback(int error, const char* description) {
@@ -24,63 +32,79 @@ static void keyCallback(GLFWwindow* window, int key, int scancode [[maybe_unused
     
     // Track key states for WASD movement
     if (key == GLFW_KEY_W) {
-        if (action == GLFW_PRESS) visualizer->keyW_ = true;
-        else if (action == GLFW_RELEASE) visualizer->keyW_ = false;
+        if (action == GLFW_PRESS) visualizer->setKeyState(InputKey::W, true);
+        else if (action == GLFW_RELEASE) visualizer->setKeyState(InputKey::W, false);
     }
     else if (key == GLFW_KEY_A) {
-        if (action == GLFW_PRESS) visualizer->keyA_ = true;
-        else if (action == GLFW_RELEASE) visualizer->keyA_ = false;
+        if (action == GLFW_PRESS) visualizer->setKeyState(InputKey::A, true);
+        else if (action == GLFW_RELEASE) visualizer->setKeyState(InputKey::A, false);
     }
     else if (key == GLFW_KEY_S) {
-        if (action == GLFW_PRESS) visualizer->keyS_ = true;
-        else if (action == GLFW_RELEASE) visualizer->keyS_ = false;
+        if (action == GLFW_PRESS) visualizer->setKeyState(InputKey::S, true);
+        else if (action == GLFW_RELEASE) visualizer->setKeyState(InputKey::S, false);
     }
     else if (key == GLFW_KEY_D) {
-        if (action == GLFW_PRESS) visualizer->keyD_ = true;
-        else if (action == GLFW_RELEASE) visualizer->keyD_ = false;
+        if (action == GLFW_PRESS) visualizer->setKeyState(InputKey::D, true);
+        else if (action == GLFW_RELEASE) visualizer->setKeyState(InputKey::D, false);
     }
     // Track key states for rotation
     else if (key == GLFW_KEY_K) {
-        if (action == GLFW_PRESS) visualizer->keyK_ = true;
-        else if (action == GLFW_RELEASE) visualizer->keyK_ = false;
+        if (action == GLFW_PRESS) visualizer->setKeyState(InputKey::K, true);
+        else if (action == GLFW_RELEASE) visualizer->setKeyState(InputKey::K, false);
     }
     else if (key == GLFW_KEY_L) {
-        if (action == GLFW_PRESS) visualizer->keyL_ = true;
-        else if (action == GLFW_RELEASE) visualizer->keyL_ = false;
+        if (action == GLFW_PRESS) visualizer->setKeyState(InputKey::L, true);
+        else if (action == GLFW_RELEASE) visualizer->setKeyState(InputKey::L, false);
     }
     // Toggle camera mode with 'C' key
     else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
         visualizer->toggleCameraMode();
     }
+    // Toggle the profiler overlay with 'P' key
+    else if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        visualizer->toggleProfilerOverlay();
+    }
 }
 
-GLVisualizer::GLVisualizer(Simulation& simulation, unsigned int width, unsigned int height, const std::string& title)
-    : keyW_(false),
-      keyA_(false),
-      keyS_(false),
-      keyD_(false),
-      keyK_(false),
-      keyL_(false),
-      window_(nullptr),
+GLVisualizer::GLVisualizer(Simulation& simulation, unsigned int width, unsigned int height, const std::string& title,
+                           std::uint32_t seed)
+    : window_(nullptr),
       simulation_(simulation),
       width_(width),
       height_(height),
       particleSegments_(30),
-      directionX_(1.0f),
-      directionY_(0.0f),
-      rotationAngle_(0.0f),
-      rotationSpeed_(0.1f),  // Rotation speed in radians per frame (about 3 degrees)
-      moveSpeed_(0.15f),      // Movement speed
+      controller_(simulation, static_cast<float>(width) / static_cast<float>(height), seed),
+      effectRng_(seed),
+      timestep_(1.0 / 240.0, 8), // Simulate at 240 Hz, at most 8 steps per frame
+      previousState_{Vector3D(), 0.0f, false},
+      currentState_{Vector3D(), 0.0f, false},
+      renderState_{Vector3D(), 0.0f, false},
+      threadedSimulation_(false),
+      simulationRunning_(false),
       mouseX_(0.0),
       mouseY_(0.0),
       cameraHeight_(5.0f),   // Height of camera above the map
       cameraFollowSpeed_(0.1f), // Camera follows at 10% of the distance per frame
       cameraPosition_(0.0, 0.0, cameraHeight_),
       cameraTarget_(0.0, 0.0, 0.0),
-      useFollowCamera_(true) { // Enable follow camera by default
-    
-    // Initialize random seed
-    srand(static_cast<unsigned int>(time(nullptr)));
+      useFollowCamera_(true), // Enable follow camera by default
+      showProfilerOverlay_(false),
+      profilerOverlayAge_(0),
+      mapMesh_(0),
+      siteMarkerMesh_(0),
+      instancedParticles_(false),
+      particlePositions_(nullptr),
+      particleCount_(0),
+      staticGeometryAspect_(0.0f) {
+    
+    // Time the frame phases from the start, so the overlay has history when it is first shown
+    Profiler::instance().setEnabled(kProfilerCompiledIn);
+    
+    // A few render-side workers for the torch rays and particle packing; the simulation has its own pool
+    unsigned int torchThreads = std::min(4u, std::thread::hardware_concurrency());
+    if (torchThreads > 1) {
+        torchPool_ = std::make_unique<ThreadPool>(torchThreads);
+    }
     
     // Initialize GLFW
     if (!glfwInit()) {
@@ -161,11 +185,29 @@ GLVisualizer::GLVisualizer(Simulation& simulation, unsigned int width, unsigned
         }
     });
     
-    // Initialize obstacles
-    initializeObstacles();
+    // Lay out the built-in map; the torch bends its rays around the same
+    // obstacles, baked into a field whenever they are set
+    controller_.buildMap();
+    torchRays_.setFieldCellSize(kTorchFieldCellSize);
+    torchRays_.setObstacles(controller_.getMap().getObstacles(), controller_.getMap().getObstacleCount());
+    
+    // Upload the static map geometry
+    renderer_.initialize();
+    buildStaticGeometry();
+    
+    // Simulation particles are drawn instanced when the context supports it
+    instancedParticles_ = particleRenderer_.initialize();
+    if (!instancedParticles_) {
+        std::cerr << "Instanced rendering unavailable, drawing particles as batched circles" << std::endl;
+    }
+    
+    // Place the particle at a spawn point
+    controller_.spawn();
     
-    // Place the particle in a valid starting position
-    placeParticleInValidPosition();
+    // Start interpolation from the spawn state
+    currentState_ = captureRenderState();
+    previousState_ = currentState_;
+    renderState_ = currentState_;
     
     std::cout << "OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
     std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
@@ -175,40 +217,16 @@ GLVisualizer::GLVisualizer(Simulation& simulation, unsigned int width, unsigned
     std::cout << "  - K, L: Rotate torch left/right" << std::endl;
     std::cout << "  - C: Toggle between follow camera and top-down view" << std::endl;
     std::cout << "  - ESC: Exit" << std::endl;
-}
-
-void GLVisualizer::placeParticleInValidPosition() {
-    Particle* centralParticle = simulation_.getCentralParticle();
-    if (!centralParticle) return;
-    
-    // Define spawn positions for defender and attacker sides
-    struct SpawnPosition {
-        float x, y;
-        std::string name;
-    };
-    
-    // Calculate scaling factor for wider screens
-    float aspectRatio = static_cast<float>(width_) / static_cast<float>(height_);
-    float scaleX = aspectRatio; // Use normal aspect ratio scaling
-    
-    // Define the two main spawn positions
-    const SpawnPosition spawnPositions[] = {
-        {-2.0f * scaleX, 3.5f, "Defender"},  // Defender spawn (top)
-        {0.0f, -3.5f, "Attacker"}   // Attacker spawn (bottom)
-    };
-    
-    // Randomly select one of the spawn positions
-    int spawnIndex = rand() % 2;
-    const auto& selectedSpawn = spawnPositions[spawnIndex];
-    
-    // Place the particle at the selected spawn point
-    centralParticle->setPosition(Vector3D(selectedSpawn.x, selectedSpawn.y, 0));
-    centralParticle->setVelocity(Vector3D(0, 0, 0));
-    
-    std::cout << "Particle spawned at " << selectedSpawn.name << " position." << std::endl;
+    std::cout << "Seed: " << seed << std::endl;
 }
 
 GLVisualizer::~GLVisualizer() {
+    // GL objects go first, while the context still exists
+    if (window_) {
+        particleRenderer_.release();
+        renderer_.release();
+    }
+    
     // Clean up GLFW
     if (window_) {
         glfwDestroyWindow(window_);
@@ -260,6 +278,30 @@ bool GLVisualizer::initGL() {
     return true;
 }
 
+void GLVisualizer::setMap(std::shared_ptr<const GameMap> map) {
+    if (simulationRunning_.load(std::memory_order_acquire)) {
+        throw std::logic_error("Cannot change the map while the simulation thread runs");
+    }
+    controller_.setMap(std::move(map));
+    torchRays_.setObstacles(controller_.getMap().getObstacles(), controller_.getMap().getObstacleCount());
+    if (window_) {
+        buildStaticGeometry();
+    }
+    
+    // Start again from one of the new map's spawn points
+    controller_.spawn();
+    currentState_ = captureRenderState();
+    previousState_ = currentState_;
+    renderState_ = currentState_;
+}
+
+void GLVisualizer::setPhysicsRate(double stepsPerSecond, int maxSubsteps) {
+    if (stepsPerSecond <= 0.0) {
+        throw std::invalid_argument("Physics rate must be positive");
+    }
+    timestep_ = FixedTimestep(1.0 / stepsPerSecond, maxSubsteps);
+}
+
 void GLVisualizer::setupPerspective() {
     // Set up perspective projection for the follow camera
     glMatrixMode(GL_PROJECTION);
@@ -277,12 +319,11 @@ void GLVisualizer::setupPerspective() {
 }
 
 void GLVisualizer::updateCamera() {
-    // Get the central particle
-    Particle* centralParticle = simulation_.getCentralParticle();
-    if (!centralParticle) return;
+    // Nothing to follow without a central particle
+    if (!renderState_.hasParticle) return;
     
-    // Get the current particle position
-    Vector3D particlePos = centralParticle->getPosition();
+    // Follow the particle position being drawn this frame
+    const Vector3D& particlePos = renderState_.position;
     
     // Set the camera target directly to the particle's position (no interpolation)
     // This ensures the camera is always looking at the particle
@@ -297,111 +338,96 @@ void GLVisualizer::updateCamera() {
     cameraPosition_.z = cameraHeight_;
 }
 
-void GLVisualizer::initializeObstacles() {
-    // Clear any existing obstacles
-    obstacles_.clear();
-    
-    // Create a map layout similar to the provided image
-    // The map has two spawn areas (Defender and Attacker) and various named locations
-    
-    // Calculate aspect ratio for scaling
-    float aspectRatio = static_cast<float>(width_) / static_cast<float>(height_);
-    
-    // Use the full aspect ratio for scaling to fill the window width
-    float scaleX = aspectRatio;
-    
-    // Defender side (top of map)
-    // Defender spawn area
-    obstacles_.emplace_back(-2.0f * scaleX, 3.0f, 4.0f * scaleX, 0.2f);  // Horizontal wall below spawn
-    obstacles_.emplace_back(-4.0f * scaleX, 2.5f, 0.2f, 1.0f);  // Left vertical wall
-    obstacles_.emplace_back(0.0f, 2.5f, 0.2f, 1.0f);   // Right vertical wall
-    
-    // A Site (top right)
-    obstacles_.emplace_back(3.0f * scaleX, 3.0f, 4.0f * scaleX, 0.2f);   // Horizontal wall below A site
-    obstacles_.emplace_back(1.0f * scaleX, 2.0f, 0.2f, 2.0f);   // Left vertical wall
-    obstacles_.emplace_back(3.0f * scaleX, 1.5f, 4.0f * scaleX, 0.2f);   // Bottom wall of A site
-    
-    // A Main
-    obstacles_.emplace_back(3.0f * scaleX, 0.5f, 0.2f, 2.0f);   // Vertical wall for A Main
-    
-    // A Link
-    obstacles_.emplace_back(1.5f * scaleX, 1.0f, 3.0f * scaleX, 0.2f);   // Horizontal wall for A Link
-    
-    // A Lobby
-    obstacles_.emplace_back(3.0f * scaleX, -1.5f, 0.2f, 2.0f);  // Vertical wall for A Lobby
-    
-    // Mid Courtyard
-    obstacles_.emplace_back(0.0f, 0.0f, 2.0f * scaleX, 2.0f);   // Center obstacle
-    
-    // Mid Top
-    obstacles_.emplace_back(-1.5f * scaleX, 1.5f, 3.0f * scaleX, 0.2f);  // Horizontal wall for Mid Top
-    
-    // B Site (top left)
-    obstacles_.emplace_back(-3.0f * scaleX, 1.5f, 2.0f * scaleX, 0.2f);  // Bottom wall of B site
-    obstacles_.emplace_back(-2.0f * scaleX, 2.0f, 0.2f, 1.0f);  // Right vertical wall of B site
-    
-    // B Main
-    obstacles_.emplace_back(-3.0f * scaleX, 0.0f, 0.2f, 3.0f);  // Vertical wall for B Main
-    
-    // B Market
-    obstacles_.emplace_back(-1.5f * scaleX, -0.5f, 3.0f * scaleX, 0.2f); // Horizontal wall for B Market
-    
-    // Mid Tiles
-    obstacles_.emplace_back(0.0f, -1.5f, 2.0f * scaleX, 0.2f);  // Horizontal wall for Mid Tiles
-    
-    // Mid Bottom
-    obstacles_.emplace_back(-1.5f * scaleX, -2.0f, 3.0f * scaleX, 0.2f); // Horizontal wall for Mid Bottom
-    
-    // B Lobby
-    obstacles_.emplace_back(-2.0f * scaleX, -2.5f, 0.2f, 1.0f); // Vertical wall for B Lobby
-    
-    // Attacker side (bottom of map)
-    // Attacker spawn area
-    obstacles_.emplace_back(0.0f, -3.0f, 4.0f * scaleX, 0.2f);  // Horizontal wall above spawn
+bool GLVisualizer::checkObstacleCollision(float x, float y, float radius) {
+    return simulation_.getObstacleCollider().overlaps(x, y, radius);
 }
 
-bool GLVisualizer::checkObstacleCollision(float x, float y, float radius) {
-    // Check if the particle collides with any obstacle
-    for (const auto& obstacle : obstacles_) {
-        // Calculate the closest point on the rectangle to the circle
-        float closestX = std::max(obstacle.x - obstacle.width/2, std::min(x, obstacle.x + obstacle.width/2));
-        float closestY = std::max(obstacle.y - obstacle.height/2, std::min(y, obstacle.y + obstacle.height/2));
-        
-        // Calculate the distance between the circle's center and the closest point
-        float distanceX = x - closestX;
-        float distanceY = y - closestY;
-        float distanceSquared = distanceX * distanceX + distanceY * distanceY;
-        
-        // Use the exact radius for collision detection to avoid false positives
-        float radiusSquared = radius * radius;
-        
-        // If the distance is less than the circle's radius, collision detected
-        if (distanceSquared < radiusSquared) {
-            return true;
-        }
-        
-        // Special case: check if the particle is fully inside the obstacle
-        // This prevents the particle from getting stuck inside obstacles
-        if (x > obstacle.x - obstacle.width/2 && x < obstacle.x + obstacle.width/2 &&
-            y > obstacle.y - obstacle.height/2 && y < obstacle.y + obstacle.height/2) {
-            return true;
+void GLVisualizer::setKeyState(InputKey key, bool pressed) {
+    if (simulationRunning_.load(std::memory_order_acquire)) {
+        // The simulation thread owns the key state while it runs. It drains
+        // the queue every tick, so a full queue frees up within one step;
+        // dropping the event instead could leave a key stuck down and make
+        // a recording diverge from what was played.
+        while (!inputCommands_.push(InputCommand{key, pressed})) {
+            if (!simulationRunning_.load(std::memory_order_acquire)) return;
+            std::this_thread::yield();
         }
+        return;
     }
     
-    return false;
+    applyKeyState(key, pressed);
+}
+
+void GLVisualizer::applyKeyState(InputKey key, bool pressed) {
+    controller_.setKeyState(key, pressed);
+}
+
+void GLVisualizer::recordInput(const std::string& path) {
+    inputRecordingPath_ = path;
+    controller_.startRecording(timestep_.getStep());
 }
 
 void GLVisualizer::run() {
+    if (threadedSimulation_) {
+        runThreaded();
+    } else {
+        runSingleThreaded();
+    }
+    
+    if (!inputRecordingPath_.empty()) {
+        writeInputRecording(inputRecordingPath_, controller_.getRecording());
+        std::cout << "Recorded " << controller_.getRecording().keyMasks.size() << " ticks of input to "
+                  << inputRecordingPath_ << std::endl;
+    }
+    
+    if (!profileTracePath_.empty()) {
+        Profiler::instance().writeChromeTrace(profileTracePath_);
+        std::cout << "Wrote profile trace to " << profileTracePath_ << std::endl;
+    }
+}
+
+void GLVisualizer::exportProfileTrace(const std::string& path) {
+    profileTracePath_ = path;
+}
+
+void GLVisualizer::toggleProfilerOverlay() {
+    if (!kProfilerCompiledIn) {
+        std::cout << "Profiler overlay unavailable: built without PHY_ENABLE_PROFILER" << std::endl;
+        return;
+    }
+    showProfilerOverlay_ = !showProfilerOverlay_;
+    profilerOverlayLines_.clear();
+}
+
+void GLVisualizer::runSingleThreaded() {
+    double previousTime = glfwGetTime();
+    
     // Main loop
     while (!glfwWindowShouldClose(window_)) {
-        // Update direction based on keyboard input
-        updateDirection();
+        // Close the previous frame's timings before timing this one
+        PHY_PROFILE_FRAME();
+        PHY_PROFILE_ZONE("frame");
+        
+        // Measure the wall time since the last frame
+        double currentTime = glfwGetTime();
+        double frameTime = currentTime - previousTime;
+        previousTime = currentTime;
         
-        // Handle keyboard input
-        handleKeyboardInput();
+        // Run as many fixed simulation steps as the elapsed time calls for
+        int steps = timestep_.advance(frameTime);
+        for (int i = 0; i < steps; ++i) {
+            previousState_ = currentState_;
+            tick(timestep_.getStep());
+            currentState_ = captureRenderState();
+        }
         
-        // Update simulation
-        update();
+        // Draw a blend of the last two steps so motion stays smooth
+        interpolateRenderState(previousState_, currentState_, static_cast<float>(timestep_.getAlpha()));
+        
+        // The other particles are drawn straight from the simulation
+        const ParticleStore& particles = simulation_.getParticles();
+        particlePositions_ = particles.positions();
+        particleCount_ = particles.size();
         
         // Update camera position if using follow camera
         if (useFollowCamera_) {
@@ -412,198 +438,165 @@ void GLVisualizer::run() {
         render();
         
         // Swap buffers
-        glfwSwapBuffers(window_);
+        {
+            PHY_PROFILE_ZONE("swap buffers");
+            glfwSwapBuffers(window_);
+        }
         
         // Poll for events
-        glfwPollEvents();
-    }
-}
-
-void GLVisualizer::updateDirection() {
-    // Update direction based on keyboard input instead of mouse
-    
-    // Get the central particle
-    Particle* centralParticle = simulation_.getCentralParticle();
-    if (!centralParticle) return;
-    
-    // Update rotation angle based on key states
-    if (keyK_) {
-        // Rotate counter-clockwise (left)
-        rotationAngle_ += rotationSpeed_;
-    }
-    if (keyL_) {
-        // Rotate clockwise (right)
-        rotationAngle_ -= rotationSpeed_;
-    }
-    
-    // Keep angle in [0, 2π) range
-    while (rotationAngle_ >= 2.0f * M_PI) {
-        rotationAngle_ -= 2.0f * M_PI;
-    }
-    while (rotationAngle_ < 0.0f) {
-        rotationAngle_ += 2.0f * M_PI;
+        {
+            PHY_PROFILE_ZONE("poll events");
+            glfwPollEvents();
+        }
     }
-    
-    // Calculate direction vector from rotation angle
-    directionX_ = std::cos(rotationAngle_);
-    directionY_ = std::sin(rotationAngle_);
 }
 
-void GLVisualizer::handleKeyboardInput() {
-    Particle* centralParticle = simulation_.getCentralParticle();
-    if (!centralParticle) return;
-    
-    Vector3D position = centralParticle->getPosition();
-    Vector3D velocity(0, 0, 0);
-    
-    // Apply movement based on key states - always use full speed
-    if (keyW_) velocity.y += moveSpeed_;
-    if (keyS_) velocity.y -= moveSpeed_;
-    if (keyA_) velocity.x -= moveSpeed_;
-    if (keyD_) velocity.x += moveSpeed_;
-    
-    // If no movement, explicitly set velocity to zero and return early
-    if (velocity.x == 0 && velocity.y == 0) {
-        centralParticle->setVelocity(Vector3D(0, 0, 0));
-        return;
-    }
-    
-    // Try moving in both directions separately to allow sliding along obstacles
-    Vector3D newPosition = position;
-    bool canMoveX = true;
-    bool canMoveY = true;
-    
-    // Check X movement
-    Vector3D xMovement = position;
-    xMovement.x += velocity.x;
-    if (checkObstacleCollision(xMovement.x, position.y, particleRadius_)) {
-        canMoveX = false;
+void GLVisualizer::runThreaded() {
+    // Hand the initial state to the render side before the thread starts
+    previousState_ = currentState_ = captureRenderState();
+    publishSnapshot();
+    simulationRunning_.store(true, std::memory_order_release);
+    simulationThread_ = std::thread(&GLVisualizer::simulationThreadLoop, this);
+    
+    // Stop and join the thread however this function is left, so a throwing
+    // frame cannot destroy a joinable std::thread
+    struct SimulationThreadGuard {
+        GLVisualizer& visualizer;
+        ~SimulationThreadGuard() { visualizer.stopSimulationThread(); }
+    } guard{*this};
+    
+    // Main loop: render the latest snapshot, never waiting on the simulation
+    while (!glfwWindowShouldClose(window_) && simulationRunning_.load(std::memory_order_acquire)) {
+        // Close the previous frame's timings before timing this one
+        PHY_PROFILE_FRAME();
+        PHY_PROFILE_ZONE("frame");
         
-        // Find the maximum distance we can move without colliding
-        float maxMove = 0;
-        float step = velocity.x / 10.0f; // Divide the movement into 10 steps
-        float testX = position.x;
+        // Blend the snapshot's two states like the single-threaded loop.
+        // Time has passed since it was published, which the accumulator
+        // would have added to alpha, but never blend past the latest step.
+        snapshots_.update();
+        const SimulationSnapshot& snapshot = snapshots_.readBuffer();
+        double sincePublished = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - snapshot.publishedAt).count();
+        double alpha = snapshot.step > 0.0 ? std::min(1.0, snapshot.alpha + sincePublished / snapshot.step) : 1.0;
+        interpolateRenderState(snapshot.previous, snapshot.current, static_cast<float>(alpha));
+        particlePositions_ = snapshot.positions.data();
+        particleCount_ = snapshot.positions.size();
         
-        for (int i = 0; i < 10; i++) {
-            testX += step;
-            if (checkObstacleCollision(testX, position.y, particleRadius_)) {
-                break;
-            }
-            maxMove += step;
+        // Update camera position if using follow camera
+        if (useFollowCamera_) {
+            updateCamera();
         }
         
-        // Apply the maximum allowed movement
-        newPosition.x = position.x + maxMove * 0.9f; // 90% of max to be safe
-    }
-    
-    // Check Y movement
-    Vector3D yMovement = position;
-    yMovement.y += velocity.y;
-    if (checkObstacleCollision(position.x, yMovement.y, particleRadius_)) {
-        canMoveY = false;
-        
-        // Find the maximum distance we can move without colliding
-        float maxMove = 0;
-        float step = velocity.y / 10.0f; // Divide the movement into 10 steps
-        float testY = position.y;
+        // Render
+        render();
         
-        for (int i = 0; i < 10; i++) {
-            testY += step;
-            if (checkObstacleCollision(position.x, testY, particleRadius_)) {
-                break;
-            }
-            maxMove += step;
+        // Swap buffers
+        {
+            PHY_PROFILE_ZONE("swap buffers");
+            glfwSwapBuffers(window_);
         }
         
-        // Apply the maximum allowed movement
-        newPosition.y = position.y + maxMove * 0.9f; // 90% of max to be safe
+        // Poll for events (key callbacks queue commands for the simulation thread)
+        {
+            PHY_PROFILE_ZONE("poll events");
+            glfwPollEvents();
+        }
     }
     
-    // Apply valid movements
-    if (canMoveX) {
-        newPosition.x = xMovement.x;
+    // Stop the simulation thread and report anything it threw
+    stopSimulationThread();
+    if (simulationError_) {
+        std::rethrow_exception(simulationError_);
     }
-    
-    if (canMoveY) {
-        newPosition.y = yMovement.y;
+}
+
+void GLVisualizer::stopSimulationThread() {
+    simulationRunning_.store(false, std::memory_order_release);
+    if (simulationThread_.joinable()) {
+        simulationThread_.join();
     }
-    
-    // Double-check combined movement (diagonal cases)
-    if (canMoveX && canMoveY) {
-        // Check diagonal movement
-        if (checkObstacleCollision(newPosition.x, newPosition.y, particleRadius_)) {
-            // Try to maintain at least one direction of movement
-            if (!checkObstacleCollision(newPosition.x, position.y, particleRadius_)) {
-                // Can move in X direction
-                newPosition.y = position.y;
-            } else if (!checkObstacleCollision(position.x, newPosition.y, particleRadius_)) {
-                // Can move in Y direction
-                newPosition.x = position.x;
-            } else {
-                // Can't move in either direction
-                newPosition = position;
+}
+
+void GLVisualizer::simulationThreadLoop() {
+    using Clock = std::chrono::steady_clock;
+    
+    try {
+        Clock::time_point previousTime = Clock::now();
+        while (simulationRunning_.load(std::memory_order_acquire)) {
+            Clock::time_point currentTime = Clock::now();
+            double elapsed = std::chrono::duration<double>(currentTime - previousTime).count();
+            previousTime = currentTime;
+            
+            // Same fixed-step schedule as the single-threaded loop
+            int steps = timestep_.advance(elapsed);
+            for (int i = 0; i < steps; ++i) {
+                drainInputCommands();
+                previousState_ = currentState_;
+                tick(timestep_.getStep());
+                currentState_ = captureRenderState();
+            }
+            if (steps > 0) {
+                publishSnapshot();
             }
+            
+            // Sleep until the next step is due
+            double untilNextStep = (1.0 - timestep_.getAlpha()) * timestep_.getStep();
+            std::this_thread::sleep_for(std::chrono::duration<double>(untilNextStep));
         }
+    } catch (...) {
+        simulationError_ = std::current_exception();
+        simulationRunning_.store(false, std::memory_order_release);
     }
-    
-    // Apply boundary constraints using the full view width
-    float aspectRatio = static_cast<float>(width_) / static_cast<float>(height_);
-    float viewHeight = 10.0f;
-    float viewWidth = viewHeight * aspectRatio; // Use normal aspect ratio scaling
-    
-    newPosition.x = std::max(static_cast<double>(-viewWidth/2 + particleRadius_), 
-                  std::min(static_cast<double>(viewWidth/2 - particleRadius_), newPosition.x));
-    newPosition.y = std::max(static_cast<double>(-viewHeight/2 + particleRadius_), 
-                  std::min(static_cast<double>(viewHeight/2 - particleRadius_), newPosition.y));
-    
-    // Update particle
-    centralParticle->setPosition(newPosition);
-    centralParticle->setVelocity(velocity);
 }
 
-void GLVisualizer::update() {
-    // Get the central particle
-    Particle* centralParticle = simulation_.getCentralParticle();
-    if (!centralParticle) return;
-    
-    // Store current position before updating
-    Vector3D oldPosition = centralParticle->getPosition();
-    
-    // Update the simulation
-    simulation_.step(0.01); // 0.01 seconds per step
-    
-    // Get new position after update
-    Vector3D newPosition = centralParticle->getPosition();
-    
-    // If the particle has moved through an obstacle, prevent that movement
-    if (checkObstacleCollision(newPosition.x, newPosition.y, particleRadius_)) {
-        // First try to maintain one axis of movement
-        bool canMoveX = !checkObstacleCollision(newPosition.x, oldPosition.y, particleRadius_);
-        bool canMoveY = !checkObstacleCollision(oldPosition.x, newPosition.y, particleRadius_);
-        
-        if (canMoveX) {
-            // Can move along X axis
-            newPosition.y = oldPosition.y;
-        } else if (canMoveY) {
-            // Can move along Y axis
-            newPosition.x = oldPosition.x;
-        } else {
-            // Can't move in either direction, stay at old position
-            newPosition = oldPosition;
-        }
-        
-        // Update the position to prevent moving through obstacles
-        centralParticle->setPosition(newPosition);
-    }
-    
-    // If no keys are pressed, ensure the particle doesn't move at all
-    if (!keyW_ && !keyA_ && !keyS_ && !keyD_) {
-        // Reset velocity to zero but keep the current position
-        centralParticle->setVelocity(Vector3D(0, 0, 0));
+void GLVisualizer::drainInputCommands() {
+    InputCommand command;
+    while (inputCommands_.pop(command)) {
+        applyKeyState(command.key, command.pressed);
     }
 }
 
+void GLVisualizer::publishSnapshot() {
+    PHY_PROFILE_ZONE("publishSnapshot");
+    // Reuses the slot's capacity, so steady-state publishing does not allocate
+    SimulationSnapshot& snapshot = snapshots_.writeBuffer();
+    const ParticleStore& particles = simulation_.getParticles();
+    snapshot.positions.assign(particles.positions(), particles.positions() + particles.size());
+    snapshot.previous = previousState_;
+    snapshot.current = currentState_;
+    snapshot.alpha = timestep_.getAlpha();
+    snapshot.step = timestep_.getStep();
+    snapshot.publishedAt = std::chrono::steady_clock::now();
+    snapshots_.publish();
+}
+
+void GLVisualizer::tick(double dt) {
+    PHY_PROFILE_ZONE("tick");
+    // Apply the held keys and step the simulation
+    controller_.tick(dt);
+}
+
+GLVisualizer::RenderState GLVisualizer::captureRenderState() {
+    Particle* centralParticle = simulation_.getCentralParticle();
+    Vector3D position = centralParticle ? centralParticle->getPosition() : Vector3D();
+    return RenderState{position, controller_.getRotationAngle(), centralParticle != nullptr};
+}
+
+void GLVisualizer::interpolateRenderState(const RenderState& previous, const RenderState& current, float alpha) {
+    renderState_.hasParticle = current.hasParticle;
+    renderState_.position = Vector3D::lerp(previous.position, current.position, alpha);
+    
+    // Blend the torch angle along the shortest arc
+    float delta = current.rotationAngle - previous.rotationAngle;
+    if (delta > M_PI) delta -= 2.0f * M_PI;
+    if (delta < -M_PI) delta += 2.0f * M_PI;
+    renderState_.rotationAngle = previous.rotationAngle + delta * alpha;
+}
+
 void GLVisualizer::render() {
+    PHY_PROFILE_ZONE("render");
+    
     // Clear the color and depth buffer
     if (useFollowCamera_) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -632,39 +625,48 @@ void GLVisualizer::render() {
         glDisable(GL_DEPTH_TEST);
     }
     
-    // Get the central particle
-    Particle* centralParticle = simulation_.getCentralParticle();
-    if (centralParticle) {
-        // Get particle properties
-        const Vector3D& position = centralParticle->getPosition();
-        
-        // Draw the grid overlay
-        drawGrid();
+    // The grid and site markers follow the window's aspect ratio
+    renderer_.beginFrame();
+    particleRenderer_.beginFrame();
+    float aspectRatio = static_cast<float>(width_) / static_cast<float>(height_);
+    if (aspectRatio != staticGeometryAspect_) {
+        buildStaticGeometry();
+    }
+    
+    // Draw the state captured for this frame (the simulation may be
+    // running on another thread, so it is not read directly)
+    if (renderState_.hasParticle) {
+        const Vector3D& position = renderState_.position;
+        float directionX = std::cos(renderState_.rotationAngle);
+        float directionY = std::sin(renderState_.rotationAngle);
         
-        // Draw the obstacles
-        glColor3f(0.5f, 0.5f, 0.5f); // Gray color for obstacles
-        for (const auto& obstacle : obstacles_) {
-            drawRectangle(obstacle.x, obstacle.y, obstacle.width, obstacle.height);
-        }
+        // Draw the grid overlay and the obstacles
+        renderer_.drawStatic(mapMesh_);
         
         // Draw location labels
         drawLocationLabels();
         
+        // Collect the particles, the torch and the central particle, then stream them in one batch
+        frameBatch_.clear();
+        drawParticles(frameBatch_, 1);
+        
         // Draw the direction torch (behind the particle)
-        drawTorch(position.x, position.y, directionX_, directionY_, particleRadius_ * 1.5f);
+        drawTorch(frameBatch_, position.x, position.y, directionX, directionY, particleRadius_ * 1.5f);
         
-        // Draw the particle as a solid ball
-        glColor3f(1.0f, 0.2f, 0.2f); // Bright red color
-        drawCircle(position.x, position.y, particleRadius_, particleSegments_);
-    } else {
-        // Draw the grid overlay
-        drawGrid();
+        // Draw the particle as a solid ball, slightly above the ground to avoid z-fighting
+        const BatchColor particleColor{1.0f, 0.2f, 0.2f, 1.0f}; // Bright red color
+        frameBatch_.addCircle(position.x, position.y, 0.01f, particleRadius_, particleSegments_,
+                              particleColor, particleColor);
         
-        // Draw the obstacles
-        glColor3f(0.5f, 0.5f, 0.5f); // Gray color for obstacles
-        for (const auto& obstacle : obstacles_) {
-            drawRectangle(obstacle.x, obstacle.y, obstacle.width, obstacle.height);
-        }
+        // Enable blending for the light effect
+        PHY_PROFILE_ZONE("render: draw batch");
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        renderer_.drawDynamic(frameBatch_);
+        glDisable(GL_BLEND);
+    } else {
+        // Draw the grid overlay and the obstacles
+        renderer_.drawStatic(mapMesh_);
         
         // Draw site markers
         drawSiteMarkers();
@@ -672,57 +674,182 @@ void GLVisualizer::render() {
         // Draw location labels
         drawLocationLabels();
     }
+    
+    if (showProfilerOverlay_) {
+        drawProfilerOverlay();
+    }
 }
 
-void GLVisualizer::drawCircle(float x, float y, float radius, int segments) {
-    // In 3D mode, we need to draw at z=0 to be visible on the ground plane
-    float z = 0.01f; // Slightly above the ground to avoid z-fighting
+void GLVisualizer::drawProfilerOverlay() {
+    // Rebuild the text a few times a second; every line is a rolling figure anyway
+    if (profilerOverlayLines_.empty() || ++profilerOverlayAge_ >= 15) {
+        profilerOverlayAge_ = 0;
+        profilerOverlayLines_.clear();
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-28s %7s %7s %7s %6s", "zone (ms per frame)", "min", "avg", "p99", "calls");
+        profilerOverlayLines_.push_back(line);
+        for (const ProfileZoneStats& zone : Profiler::instance().getStats()) {
+            std::snprintf(line, sizeof(line), "%-28.28s %7.3f %7.3f %7.3f %6.1f", zone.name.c_str(),
+                          zone.minMs, zone.avgMs, zone.p99Ms, zone.callsPerFrame);
+            profilerOverlayLines_.push_back(line);
+        }
+        
+        // Torch cache over the frames since the last rebuild
+        const TorchRayCacheStats& torchStats = torchCache_.getStats();
+        if (torchStats.lookups() > 0) {
+            std::snprintf(line, sizeof(line), "torch ray cache: %5.1f%% hits, %6.1f rays traced/frame",
+                          100.0 * torchStats.hitRate(),
+                          static_cast<double>(torchStats.raysTraced) / torchStats.lookups());
+            profilerOverlayLines_.push_back(line);
+        }
+        torchCache_.resetStats();
+    }
     
-    glBegin(GL_TRIANGLE_FAN);
+    // Draw in window pixels, top left, over everything else
+    glDisable(GL_DEPTH_TEST);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0, width_, 0.0, height_, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
     
-    // Center vertex
+    glColor3f(0.7f, 1.0f, 0.6f);
+    float y = static_cast<float>(height_) - 20.0f;
+    for (const std::string& line : profilerOverlayLines_) {
+        drawText(line, 10.0f, y);
+        y -= 15.0f;
+    }
+    
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
     if (useFollowCamera_) {
-        glVertex3f(x, y, z);
-    } else {
-        glVertex2f(x, y);
+        glEnable(GL_DEPTH_TEST);
     }
+}
+
+void GLVisualizer::drawParticles(GeometryBatch& batch, std::size_t first) {
+    if (particleCount_ <= first) return;
+    PHY_PROFILE_ZONE("drawParticles");
     
-    // Circle vertices
-    for (int i = 0; i <= segments; i++) {
-        float angle = 2.0f * M_PI * static_cast<float>(i) / static_cast<float>(segments);
-        float vx = x + radius * std::cos(angle);
-        float vy = y + radius * std::sin(angle);
-        
-        if (useFollowCamera_) {
-            glVertex3f(vx, vy, z);
-        } else {
-            glVertex2f(vx, vy);
-        }
+    const Vector3D* positions = particlePositions_ + first;
+    std::size_t count = particleCount_ - first;
+    const float radius = particleRadius_ * 0.4f;
+    const BatchColor color{0.3f, 0.7f, 1.0f, 1.0f}; // Light blue, apart from the red player
+    
+    if (instancedParticles_) {
+        particleRenderer_.draw(positions, count, radius, color, torchPool_.get());
+        return;
     }
     
-    glEnd();
+    for (std::size_t i = 0; i < count; ++i) {
+        batch.addCircle(positions[i].x, positions[i].y, 0.005f, radius, 12, color, color);
+    }
 }
 
-void GLVisualizer::drawRectangle(float x, float y, float width, float height) {
-    // In 3D mode, we need to draw at z=0 to be visible on the ground plane
-    float z = 0.0f;
+void GLVisualizer::runRenderBenchmark(const std::vector<std::size_t>& counts, int frames) {
+    if (!window_) {
+        throw std::runtime_error("Render benchmark needs a window");
+    }
+    if (frames <= 0) {
+        throw std::invalid_argument("Benchmark frame count must be positive");
+    }
     
-    glBegin(GL_QUADS);
+    // Scatter synthetic particles over the map; index 0 stands in for the player
+    std::size_t maxCount = 0;
+    for (std::size_t count : counts) maxCount = std::max(maxCount, count);
+    float viewHeight = 10.0f;
+    float viewWidth = viewHeight * controller_.getMapAspectRatio();
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> xDist(-viewWidth / 2, viewWidth / 2);
+    std::uniform_real_distribution<double> yDist(-viewHeight / 2, viewHeight / 2);
+    std::vector<Vector3D> positions(maxCount + 1);
+    positions[0] = renderState_.position;
+    for (std::size_t i = 1; i < positions.size(); ++i) {
+        positions[i] = Vector3D(xDist(rng), yDist(rng), 0.0);
+    }
+    
+    // Measure rendering, not the display's refresh rate
+    glfwSwapInterval(0);
     if (useFollowCamera_) {
-        glVertex3f(x - width/2, y - height/2, z);
-        glVertex3f(x + width/2, y - height/2, z);
-        glVertex3f(x + width/2, y + height/2, z);
-        glVertex3f(x - width/2, y + height/2, z);
-    } else {
-        glVertex2f(x - width/2, y - height/2);
-        glVertex2f(x + width/2, y - height/2);
-        glVertex2f(x + width/2, y + height/2);
-        glVertex2f(x - width/2, y + height/2);
+        updateCamera();
     }
-    glEnd();
+    
+    const bool instancedSupported = instancedParticles_;
+    const std::size_t maxBatchedCount = 100000;
+    std::cout << "particles  path       avg ms    min ms  draw calls" << std::endl;
+    for (std::size_t count : counts) {
+        for (int path = 0; path < 2; ++path) {
+            bool instanced = (path == 0);
+            if (instanced && !instancedSupported) continue;
+            if (!instanced && count > maxBatchedCount) continue;
+            instancedParticles_ = instanced;
+            particlePositions_ = positions.data();
+            particleCount_ = count + 1;
+            
+            double total = 0.0;
+            double best = 0.0;
+            for (int frame = 0; frame < frames && !glfwWindowShouldClose(window_); ++frame) {
+                double start = glfwGetTime();
+                render();
+                glFinish(); // Include the GPU's share of the frame
+                double elapsed = glfwGetTime() - start;
+                total += elapsed;
+                best = (frame == 0) ? elapsed : std::min(best, elapsed);
+                glfwSwapBuffers(window_);
+                glfwPollEvents();
+            }
+            
+            std::size_t drawCalls = renderer_.getDrawCallCount() + particleRenderer_.getDrawCallCount();
+            std::cout << std::setw(9) << count << "  " << std::left << std::setw(9)
+                      << (instanced ? "instanced" : "batched") << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(8) << total / frames * 1000.0
+                      << std::setw(10) << best * 1000.0 << std::setw(12) << drawCalls << std::endl;
+        }
+    }
+    
+    instancedParticles_ = instancedSupported;
+    particlePositions_ = nullptr;
+    particleCount_ = 0;
+    glfwSwapInterval(1);
 }
 
- 
+void GLVisualizer::buildStaticGeometry() {
+    float aspectRatio = static_cast<float>(width_) / static_cast<float>(height_);
+    bool firstBuild = (staticGeometryAspect_ == 0.0f);
+    GeometryBatch batch;
+    
+    // Grid overlay, then the obstacles on top of it
+    drawGrid(batch);
+    const BatchColor obstacleColor{0.5f, 0.5f, 0.5f, 1.0f}; // Gray color for obstacles
+    const GameMap& map = controller_.getMap();
+    const Obstacle* walls = map.getObstacles();
+    for (std::size_t i = 0; i < map.getObstacleCount(); ++i) {
+        batch.addRectangle(walls[i].x, walls[i].y, walls[i].width, walls[i].height, 0.0f, obstacleColor);
+    }
+    if (firstBuild) {
+        mapMesh_ = renderer_.uploadStatic(batch);
+    } else {
+        renderer_.updateStatic(mapMesh_, batch);
+    }
+    
+    // Site markers as red circles
+    batch.clear();
+    const BatchColor markerColor{1.0f, 0.3f, 0.3f, 1.0f}; // Red color for the marker
+    for (const MapSite& site : map.getSites()) {
+        batch.addCircle(site.x, site.y, 0.01f, site.radius, 20, markerColor, markerColor);
+    }
+    if (firstBuild) {
+        siteMarkerMesh_ = renderer_.uploadStatic(batch);
+    } else {
+        renderer_.updateStatic(siteMarkerMesh_, batch);
+    }
+    
+    staticGeometryAspect_ = aspectRatio;
+}
 
 // Add this after the drawArrow method
 void GLVisualizer::drawText(const std::string& text, float x, float y) {
@@ -739,60 +866,30 @@ void GLVisualizer::drawLocationLabels() {
     // Set text color to white
     glColor3f(1.0f, 1.0f, 1.0f);
     
-    // Calculate scaling factor for wider screens
-    float aspectRatio = static_cast<float>(width_) / static_cast<float>(height_);
-    float scaleX = aspectRatio; // Use normal aspect ratio scaling
-    
     // Draw labels for all locations
-    drawText("DEFENDER SIDE SPAWN", -2.0f * scaleX, 3.5f);
-    drawText("A SITE", 3.0f * scaleX, 2.5f);
-    drawText("A ELBOW", 4.0f * scaleX, 1.0f);
-    drawText("A LINK", 1.5f * scaleX, 1.3f);
-    drawText("A MAIN", 3.5f * scaleX, 0.0f);
-    drawText("A LOBBY", 3.5f * scaleX, -2.0f);
-    drawText("MID COURTYARD", 0.0f, 0.3f);
-    drawText("MID TOP", -1.5f * scaleX, 1.8f);
-    drawText("MID TILES", 0.0f, -1.8f);
-    drawText("MID BOTTOM", -1.5f * scaleX, -2.3f);
-    drawText("B SITE", -3.0f * scaleX, 2.5f);
-    drawText("B BOBA", -3.5f * scaleX, 1.0f);
-    drawText("B MAIN", -3.5f * scaleX, -1.0f);
-    drawText("B MARKET", -1.5f * scaleX, -0.8f);
-    drawText("B LOBBY", -2.5f * scaleX, -2.8f);
-    drawText("ATTACKER SIDE SPAWN", 0.0f, -3.5f);
+    for (const MapLabel& label : controller_.getMap().getLabels()) {
+        drawText(label.text, label.x, label.y);
+    }
 } 
 
 // Add this after drawLocationLabels method
 void GLVisualizer::drawSiteMarkers() {
-    // Draw site markers (A and B) as red circles with labels
-    
-    // Calculate scaling factor for wider screens
-    float aspectRatio = static_cast<float>(width_) / static_cast<float>(height_);
-    float scaleX = aspectRatio; // Use normal aspect ratio scaling
-    
-    // A Site marker
-    glColor3f(1.0f, 0.3f, 0.3f); // Red color for the marker
-    drawCircle(3.5f * scaleX, 2.0f, 0.3f, 20); // Position for A site
+    // Draw site markers: the red circles are a static mesh
+    renderer_.drawStatic(siteMarkerMesh_);
     
-    // B Site marker
-    glColor3f(1.0f, 0.3f, 0.3f); // Red color for the marker
-    drawCircle(-3.0f * scaleX, 2.0f, 0.3f, 20); // Position for B site
-    
-    // Draw the A and B labels inside the markers
+    // Draw each site's name inside its marker
     glColor3f(1.0f, 1.0f, 1.0f); // White color for text
-    drawText("A", 3.45f * scaleX, 1.95f);
-    drawText("B", -3.05f * scaleX, 1.95f);
+    for (const MapSite& site : controller_.getMap().getSites()) {
+        drawText(site.name, site.x - 0.05f, site.y - 0.05f);
+    }
 } 
 
 // Add this after drawSiteMarkers method
-void GLVisualizer::drawGrid() {
+void GLVisualizer::drawGrid(GeometryBatch& batch) {
     // Draw a grid overlay to make the map look more tactical
     
-    // Set grid color to dark gray
-    glColor4f(0.2f, 0.2f, 0.2f, 0.3f); // Semi-transparent dark gray
-    
-    // Set line width
-    glLineWidth(1.0f);
+    // Dark gray (drawn without blending, so the alpha has no effect)
+    const BatchColor gridColor{0.2f, 0.2f, 0.2f, 0.3f};
     
     // Calculate grid size based on view dimensions
     float aspectRatio = static_cast<float>(width_) / static_cast<float>(height_);
@@ -802,35 +899,21 @@ void GLVisualizer::drawGrid() {
     // Grid cell size
     float gridSize = 0.5f;
     
-    // Z coordinate for 3D mode (slightly above ground)
+    // Z coordinate for 3D mode (on the ground)
     float z = 0.0f;
     
-    // Draw vertical grid lines
-    glBegin(GL_LINES);
+    // Vertical grid lines
     for (float x = -viewWidth/2; x <= viewWidth/2; x += gridSize) {
-        if (useFollowCamera_) {
-            glVertex3f(x, -viewHeight/2, z);
-            glVertex3f(x, viewHeight/2, z);
-        } else {
-            glVertex2f(x, -viewHeight/2);
-            glVertex2f(x, viewHeight/2);
-        }
+        batch.addLine(BatchVertex{x, -viewHeight/2, z, gridColor}, BatchVertex{x, viewHeight/2, z, gridColor});
     }
     
-    // Draw horizontal grid lines
+    // Horizontal grid lines
     for (float y = -viewHeight/2; y <= viewHeight/2; y += gridSize) {
-        if (useFollowCamera_) {
-            glVertex3f(-viewWidth/2, y, z);
-            glVertex3f(viewWidth/2, y, z);
-        } else {
-            glVertex2f(-viewWidth/2, y);
-            glVertex2f(viewWidth/2, y);
-        }
+        batch.addLine(BatchVertex{-viewWidth/2, y, z, gridColor}, BatchVertex{viewWidth/2, y, z, gridColor});
     }
-    glEnd();
 } 
 
-void GLVisualizer::drawTorch(float x, float y, float dirX, float dirY, float length) {
+void GLVisualizer::drawTorch(GeometryBatch& batch, float x, float y, float dirX, float dirY, float length) {
     // Create a torch light effect with improved physics-based bending around obstacles
     // and enhanced visual effects for smoother appearance
     
@@ -843,312 +926,137 @@ void GLVisualizer::drawTorch(float x, float y, float dirX, float dirY, float len
     // Calculate the base angle
     float baseAngle = std::atan2(dirY, dirX);
     
-    // Enable blending for the light effect
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
-    // Draw an outer glow around the particle
-    glBegin(GL_TRIANGLE_FAN);
-    glColor4f(1.0f, 0.6f, 0.0f, 0.7f); // Center color (orange)
-    glVertex2f(x, y);
-    
+    // Draw an outer glow around the particle, orange fading to transparent
     const float glowRadius = particleRadius_ * 1.5f;
     const int glowSegments = 32; // Increased for smoother glow
-    for (int i = 0; i <= glowSegments; ++i) {
-        float angle = 2.0f * M_PI * static_cast<float>(i) / glowSegments;
-        glColor4f(1.0f, 0.3f, 0.0f, 0.0f); // Outer color (transparent)
-        float vx = x + glowRadius * std::cos(angle);
-        float vy = y + glowRadius * std::sin(angle);
-        glVertex2f(vx, vy);
+    batch.addCircle(x, y, 0.0f, glowRadius, glowSegments,
+                    BatchColor{1.0f, 0.6f, 0.0f, 0.7f}, BatchColor{1.0f, 0.3f, 0.0f, 0.0f});
+    
+    // First pass: trace all ray paths (SIMD lanes, spread over the torch workers)
+    TorchRayConfig rayConfig;
+    rayConfig.rayCount = numRays + 1;
+    rayConfig.bendSteps = bendSteps;
+    rayConfig.coneAngle = coneAngle;
+    rayConfig.length = torchLength;
+    // Reuses last frame's paths while the torch holds still, and retraces
+    // only the rays a small turn moved
+    const TorchRayPaths* tracedPaths;
+    {
+        PHY_PROFILE_ZONE("drawTorch: trace rays");
+        tracedPaths = &torchCache_.trace(torchRays_, x, y, baseAngle, rayConfig, torchPool_.get());
     }
-    glEnd();
-    
-    // Store all ray paths for density calculation
-    std::vector<std::vector<std::pair<float, float>>> allRayPaths;
+    const TorchRayPaths& torchPaths = *tracedPaths;
+    const int rayCount = torchPaths.rayCount;
     
-    // First pass: Calculate all ray paths with improved physics
-    for (int i = 0; i <= numRays; ++i) {
-        float ratio = static_cast<float>(i) / numRays;
-        float angle = baseAngle - coneAngle/2.0f + coneAngle * ratio;
-        
-        // Initial ray direction
-        float rayDirX = std::cos(angle);
-        float rayDirY = std::sin(angle);
-        
-        // Physics parameters for this ray
-        float rayLength = torchLength * (0.85f + 0.3f * std::sin(ratio * M_PI)); // More consistent length
-        float stepSize = rayLength / bendSteps;
-        
-        // Start at particle position
-        float currentX = x;
-        float currentY = y;
-        
-        // Store the path of the ray for drawing
-        std::vector<std::pair<float, float>> rayPath;
-        rayPath.push_back({currentX, currentY});
-        
-        // Previous direction for smoothing
-        float prevDirX = rayDirX;
-        float prevDirY = rayDirY;
-        
-        // Simulate light bending using an improved physics model
-        for (int step = 0; step < bendSteps; ++step) {
-            // Calculate forces from nearby obstacles with improved physics
-            float forceX = 0.0f;
-            float forceY = 0.0f;
+    // Second pass: Draw solid connections between adjacent rays with improved smoothing
+    {
+        PHY_PROFILE_ZONE("drawTorch: light strips");
+        for (int i = 0; i < rayCount - 1; ++i) {
+            const float* path1 = torchPaths.ray(i);
+            const float* path2 = torchPaths.ray(i + 1);
+            const int length1 = torchPaths.pointCounts[i];
+            const int length2 = torchPaths.pointCounts[i + 1];
+            
+            // Skip if either path is too short
+            if (length1 < 2 || length2 < 2) continue;
             
-            // Distance-based influence factor (rays travel further before bending)
-            float distanceFactor = 1.0f - static_cast<float>(step) / bendSteps * 0.5f;
+            // Calculate the minimum length to use for the quad strips
+            int minLength = std::min(length1, length2);
             
-            // Check all obstacles for repulsive forces with improved physics
-            for (const auto& obstacle : obstacles_) {
-                // Calculate center and boundaries of obstacle
-                float obstacleLeft = obstacle.x - obstacle.width/2;
-                float obstacleRight = obstacle.x + obstacle.width/2;
-                float obstacleTop = obstacle.y + obstacle.height/2;
-                float obstacleBottom = obstacle.y - obstacle.height/2;
+            // Draw a quad strip between the two rays
+            torchScratch_.clear();
+            for (int j = 0; j < minLength; ++j) {
+                // Calculate progress along the ray (0 at source, 1 at end)
+                float t = static_cast<float>(j) / (minLength - 1);
                 
-                // Calculate distance to each edge of the obstacle
-                float distToLeft = currentX - obstacleLeft;
-                float distToRight = obstacleRight - currentX;
-                float distToTop = obstacleTop - currentY;
-                float distToBottom = currentY - obstacleBottom;
+                // Calculate position in the cone (0 at left edge, 1 at right edge)
+                float rayPosition = static_cast<float>(i) / (rayCount - 2);
                 
-                // Check if point is near the obstacle
-                bool nearObstacle = 
-                    currentX >= obstacleLeft - 1.0f && currentX <= obstacleRight + 1.0f &&
-                    currentY >= obstacleBottom - 1.0f && currentY <= obstacleTop + 1.0f;
+                // Calculate alpha based on position with improved falloff
+                // Higher in the center of the cone, lower at edges
+                float centerFactor = 1.0f - std::pow(std::abs(rayPosition - 0.5f) * 2.0f, 1.5f);
                 
-                if (!nearObstacle) continue;
+                // Improved distance falloff with smoother gradient
+                float distanceFactor = 1.0f - std::pow(t, 1.2f) * 0.8f;
                 
-                // Find the closest edge
-                float minDist = std::min({distToLeft, distToRight, distToTop, distToBottom});
+                // Combine factors for final alpha with improved smoothing
+                float alpha = std::max(0.0f, 0.85f * centerFactor * distanceFactor);
                 
-                // Apply smoother distance-based force
-                if (minDist > 0.01f && minDist < 2.0f) {
-                    // Improved inverse square law with smoother falloff
-                    float repulsiveForce = 0.08f / (minDist * minDist + 0.1f) * distanceFactor;
-                    
-                    // Calculate normal vector from obstacle
-                    float normalX = 0.0f;
-                    float normalY = 0.0f;
-                    
-                    // Determine which edge is closest and calculate normal
-                    if (minDist == distToLeft) {
-                        normalX = -1.0f;
-                    } else if (minDist == distToRight) {
-                        normalX = 1.0f;
-                    } else if (minDist == distToTop) {
-                        normalY = 1.0f;
-                    } else if (minDist == distToBottom) {
-                        normalY = -1.0f;
-                    }
-                    
-                    // Apply force in normal direction
-                    forceX += normalX * repulsiveForce;
-                    forceY += normalY * repulsiveForce;
-                    
-                    // Add corner handling for smoother bends
-                    // Check if we're near a corner
-                    const float cornerThreshold = 0.5f;
-                    bool nearTopLeft = (distToLeft < cornerThreshold && distToTop < cornerThreshold);
-                    bool nearTopRight = (distToRight < cornerThreshold && distToTop < cornerThreshold);
-                    bool nearBottomLeft = (distToLeft < cornerThreshold && distToBottom < cornerThreshold);
-                    bool nearBottomRight = (distToRight < cornerThreshold && distToBottom < cornerThreshold);
-                    
-                    if (nearTopLeft || nearTopRight || nearBottomLeft || nearBottomRight) {
-                        // Enhanced corner force
-                        float cornerForce = 0.15f / (minDist * minDist + 0.05f) * distanceFactor;
-                        
-                        // Apply appropriate corner normal
-                        if (nearTopLeft) {
-                            forceX -= cornerForce * 0.7071f; // -cos(45°)
-                            forceY += cornerForce * 0.7071f; // sin(45°)
-                        } else if (nearTopRight) {
-                            forceX += cornerForce * 0.7071f;
-                            forceY += cornerForce * 0.7071f;
-                        } else if (nearBottomLeft) {
-                            forceX -= cornerForce * 0.7071f;
-                            forceY -= cornerForce * 0.7071f;
-                        } else if (nearBottomRight) {
-                            forceX += cornerForce * 0.7071f;
-                            forceY -= cornerForce * 0.7071f;
-                        }
-                    }
-                }
-            }
-            
-            // Apply the forces to bend the ray direction with smoothing
-            float bendFactor = 0.25f; // Increased for more responsive bending
-            rayDirX += forceX * bendFactor;
-            rayDirY += forceY * bendFactor;
-            
-            // Apply smoothing between previous and current direction (prevents jittering)
-            float smoothFactor = 0.7f;
-            rayDirX = prevDirX * smoothFactor + rayDirX * (1.0f - smoothFactor);
-            rayDirY = prevDirY * smoothFactor + rayDirY * (1.0f - smoothFactor);
-            
-            // Store previous direction
-            prevDirX = rayDirX;
-            prevDirY = rayDirY;
-            
-            // Normalize the direction vector
-            float dirLength = std::sqrt(rayDirX * rayDirX + rayDirY * rayDirY);
-            if (dirLength > 0.001f) {
-                rayDirX /= dirLength;
-                rayDirY /= dirLength;
-            }
-            
-            // Move along the ray
-            float nextX = currentX + rayDirX * stepSize;
-            float nextY = currentY + rayDirY * stepSize;
-            
-            // Check if the ray hits an obstacle
-            bool hitObstacle = false;
-            for (const auto& obstacle : obstacles_) {
-                if (nextX >= obstacle.x - obstacle.width/2 && nextX <= obstacle.x + obstacle.width/2 &&
-                    nextY >= obstacle.y - obstacle.height/2 && nextY <= obstacle.y + obstacle.height/2) {
-                    hitObstacle = true;
-                    break;
-                }
-            }
-            
-            if (hitObstacle) {
-                // Stop the ray if it hits an obstacle
-                break;
+                // Improved color gradient from yellow/orange to red with distance
+                float r = 1.0f;
+                float g = 0.9f - 0.7f * std::pow(t, 1.2f);
+                float b = 0.25f * (1.0f - t) * centerFactor;
+                
+                // Add vertices for the quad strip
+                const BatchColor color{r, g, b, alpha};
+                torchScratch_.push_back(BatchVertex{path1[j * 2], path1[j * 2 + 1], 0.0f, color});
+                torchScratch_.push_back(BatchVertex{path2[j * 2], path2[j * 2 + 1], 0.0f, color});
             }
-            
-            // Update current position
-            currentX = nextX;
-            currentY = nextY;
-            rayPath.push_back({currentX, currentY});
+            batch.addQuadStrip(torchScratch_.data(), torchScratch_.size());
         }
-        
-        // Store this ray path
-        allRayPaths.push_back(rayPath);
-    }
-    
-    // Second pass: Draw solid connections between adjacent rays with improved smoothing
-    for (size_t i = 0; i < allRayPaths.size() - 1; ++i) {
-        const auto& path1 = allRayPaths[i];
-        const auto& path2 = allRayPaths[i + 1];
-        
-        // Skip if either path is too short
-        if (path1.size() < 2 || path2.size() < 2) continue;
-        
-        // Calculate the minimum length to use for the quad strips
-        size_t minLength = std::min(path1.size(), path2.size());
-        
-        // Draw a quad strip between the two rays
-        glBegin(GL_QUAD_STRIP);
-        
-        for (size_t j = 0; j < minLength; ++j) {
-            // Calculate progress along the ray (0 at source, 1 at end)
-            float t = static_cast<float>(j) / (minLength - 1);
-            
-            // Calculate position in the cone (0 at left edge, 1 at right edge)
-            float rayPosition = static_cast<float>(i) / (allRayPaths.size() - 2);
-            
-            // Calculate alpha based on position with improved falloff
-            // Higher in the center of the cone, lower at edges
-            float centerFactor = 1.0f - std::pow(std::abs(rayPosition - 0.5f) * 2.0f, 1.5f);
-            
-            // Improved distance falloff with smoother gradient
-            float distanceFactor = 1.0f - std::pow(t, 1.2f) * 0.8f;
-            
-            // Combine factors for final alpha with improved smoothing
-            float alpha = std::max(0.0f, 0.85f * centerFactor * distanceFactor);
-            
-            // Improved color gradient from yellow/orange to red with distance
-            float r = 1.0f;
-            float g = 0.9f - 0.7f * std::pow(t, 1.2f);
-            float b = 0.25f * (1.0f - t) * centerFactor;
-            
-            // Add vertices for the quad strip
-            glColor4f(r, g, b, alpha);
-            glVertex2f(path1[j].first, path1[j].second);
-            glVertex2f(path2[j].first, path2[j].second);
-        }
-        
-        glEnd();
     }
     
     // Third pass: Draw ray outlines (fewer, more subtle)
-    if (numRays > 10) {
-        // Only draw some of the rays for outline effect (more sparse for cleaner look)
-        for (size_t i = 0; i < allRayPaths.size(); i += 15) {
-            const auto& rayPath = allRayPaths[i];
-            
-            // Draw the ray as a thin line
-            if (rayPath.size() > 1) {
-                glLineWidth(0.8f); // Thinner lines for subtler effect
-                glBegin(GL_LINE_STRIP);
+    {
+        PHY_PROFILE_ZONE("drawTorch: outlines");
+        if (numRays > 10) {
+            // Only draw some of the rays for outline effect (more sparse for cleaner look)
+            for (int i = 0; i < rayCount; i += 15) {
+                const float* rayPath = torchPaths.ray(i);
+                const int pathLength = torchPaths.pointCounts[i];
                 
-                // Start with full brightness at the particle
-                glColor4f(1.0f, 0.9f, 0.4f, 0.2f); // More transparent for subtler effect
-                glVertex2f(rayPath[0].first, rayPath[0].second);
-                
-                // Draw the ray path with gradient
-                for (size_t j = 1; j < rayPath.size(); ++j) {
-                    float t = static_cast<float>(j) / rayPath.size();
-                    float alpha = 0.2f * (1.0f - t * t); // Very transparent
-                    glColor4f(1.0f, 0.8f - 0.6f * t, 0.0f, alpha);
-                    glVertex2f(rayPath[j].first, rayPath[j].second);
+                // Draw the ray as a thin line
+                if (pathLength > 1) {
+                    torchScratch_.clear();
+                    
+                    // Start with full brightness at the particle (more transparent for subtler effect)
+                    torchScratch_.push_back(BatchVertex{rayPath[0], rayPath[1], 0.0f, BatchColor{1.0f, 0.9f, 0.4f, 0.2f}});
+                    
+                    // Draw the ray path with gradient
+                    for (int j = 1; j < pathLength; ++j) {
+                        float t = static_cast<float>(j) / pathLength;
+                        float alpha = 0.2f * (1.0f - t * t); // Very transparent
+                        torchScratch_.push_back(BatchVertex{rayPath[j * 2], rayPath[j * 2 + 1], 0.0f,
+                                                            BatchColor{1.0f, 0.8f - 0.6f * t, 0.0f, alpha}});
+                    }
+                    
+                    // Thinner lines for subtler effect
+                    batch.addLineStrip(torchScratch_.data(), torchScratch_.size(), 0.8f);
                 }
-                
-                glEnd();
             }
         }
     }
     
     // Draw volumetric particles in the light cone for additional density
-    static std::mt19937 gen(static_cast<unsigned int>(time(nullptr)));
-    std::uniform_real_distribution<float> coneAngleDist(-coneAngle/2, coneAngle/2);
-    std::uniform_real_distribution<float> distDist(0.2f, 0.9f);
     std::uniform_real_distribution<float> sizeDist(0.02f, 0.07f); // Slightly smaller particles
-    std::uniform_real_distribution<float> alphaDist(0.1f, 0.4f); // Slightly more transparent
-    
-    // Add volumetric particles throughout the cone for additional density
-    const int numVolumetricParticles = 60; // More particles for density
-    for (int i = 0; i < numVolumetricParticles; ++i) {
-        // Random position within the cone
-        float particleAngle = baseAngle + coneAngleDist(gen);
-        float distance = distDist(gen) * torchLength;
-        float px = x + std::cos(particleAngle) * distance;
-        float py = y + std::sin(particleAngle) * distance;
-        
-        // Check if particle is inside an obstacle
-        bool insideObstacle = false;
-        for (const auto& obstacle : obstacles_) {
-            if (px >= obstacle.x - obstacle.width/2 && px <= obstacle.x + obstacle.width/2 &&
-                py >= obstacle.y - obstacle.height/2 && py <= obstacle.y + obstacle.height/2) {
-                insideObstacle = true;
-                break;
-            }
-        }
-        
-        // Skip if inside obstacle
-        if (insideObstacle) continue;
-        
-        // Random size and color
-        float size = sizeDist(gen) * 0.8f;
-        float distanceRatio = distance / torchLength;
-        float alpha = alphaDist(gen) * (1.0f - distanceRatio * 0.7f);
-        
-        // Draw volumetric particle
-        glBegin(GL_TRIANGLE_FAN);
-        glColor4f(1.0f, 0.7f, 0.2f, alpha);
-        glVertex2f(px, py);
-        
-        const int particleSegments = 6;
-        for (int j = 0; j <= particleSegments; ++j) {
-            float particleAngle = 2.0f * M_PI * j / particleSegments;
-            float vx = px + size * std::cos(particleAngle);
-            float vy = py + size * std::sin(particleAngle);
-            glColor4f(1.0f, 0.5f, 0.0f, 0.0f);
-            glVertex2f(vx, vy);
+    {
+        PHY_PROFILE_ZONE("drawTorch: volumetric specks");
+        std::uniform_real_distribution<float> coneAngleDist(-coneAngle/2, coneAngle/2);
+        std::uniform_real_distribution<float> distDist(0.2f, 0.9f);
+        std::uniform_real_distribution<float> alphaDist(0.1f, 0.4f); // Slightly more transparent
+    
+        // Add volumetric particles throughout the cone for additional density
+        const int numVolumetricParticles = 60; // More particles for density
+        for (int i = 0; i < numVolumetricParticles; ++i) {
+            // Random position within the cone
+            float particleAngle = baseAngle + coneAngleDist(effectRng_);
+            float distance = distDist(effectRng_) * torchLength;
+            float px = x + std::cos(particleAngle) * distance;
+            float py = y + std::sin(particleAngle) * distance;
+            
+            // Skip if inside an obstacle (a grid query, so large maps stay cheap)
+            if (checkObstacleCollision(px, py, 0.0f)) continue;
+            
+            // Random size and color
+            float size = sizeDist(effectRng_) * 0.8f;
+            float distanceRatio = distance / torchLength;
+            float alpha = alphaDist(effectRng_) * (1.0f - distanceRatio * 0.7f);
+            
+            // Draw volumetric particle
+            const int particleSegments = 6;
+            batch.addCircle(px, py, 0.0f, size, particleSegments,
+                            BatchColor{1.0f, 0.7f, 0.2f, alpha}, BatchColor{1.0f, 0.5f, 0.0f, 0.0f});
         }
-        glEnd();
     }
     
     // Draw flame particles at the center
@@ -1158,48 +1066,24 @@ void GLVisualizer::drawTorch(float x, float y, float dirX, float dirY, float len
     const int numParticles = 15; // More particles for denser effect
     for (int i = 0; i < numParticles; ++i) {
         // Random position near the center
-        float angle = angleDist(gen);
-        float radius = radiusDist(gen);
+        float angle = angleDist(effectRng_);
+        float radius = radiusDist(effectRng_);
         float px = x + radius * std::cos(angle);
         float py = y + radius * std::sin(angle);
         
         // Random size and color
-        float size = sizeDist(gen);
+        float size = sizeDist(effectRng_);
         
         // Draw flame particle
-        glBegin(GL_TRIANGLE_FAN);
-        glColor4f(1.0f, 0.9f, 0.3f, 0.8f);
-        glVertex2f(px, py);
-        
         const int particleSegments = 8;
-        for (int j = 0; j <= particleSegments; ++j) {
-            float particleAngle = 2.0f * M_PI * j / particleSegments;
-            float vx = px + size * std::cos(particleAngle);
-            float vy = py + size * std::sin(particleAngle);
-            glColor4f(1.0f, 0.5f, 0.0f, 0.0f);
-            glVertex2f(vx, vy);
-        }
-        glEnd();
+        batch.addCircle(px, py, 0.0f, size, particleSegments,
+                        BatchColor{1.0f, 0.9f, 0.3f, 0.8f}, BatchColor{1.0f, 0.5f, 0.0f, 0.0f});
     }
     
     // Add a bright center at the particle position
-    glBegin(GL_TRIANGLE_FAN);
-    glColor4f(1.0f, 1.0f, 0.7f, 0.95f);
-    glVertex2f(x, y);
-    
     const float centerRadius = particleRadius_ * 0.6f;
-    for (int i = 0; i <= 16; ++i) {
-        float angle = 2.0f * M_PI * static_cast<float>(i) / 16.0f;
-        float vx = x + centerRadius * std::cos(angle);
-        float vy = y + centerRadius * std::sin(angle);
-        glColor4f(1.0f, 0.8f, 0.2f, 0.0f);
-        glVertex2f(vx, vy);
-    }
-    glEnd();
-    
-    // Reset line width
-    glLineWidth(1.0f);
-    glDisable(GL_BLEND);
+    batch.addCircle(x, y, 0.0f, centerRadius, 16,
+                    BatchColor{1.0f, 1.0f, 0.7f, 0.95f}, BatchColor{1.0f, 0.8f, 0.2f, 0.0f});
 } 
 
 void GLVisualizer::toggleCameraMode() {
@@ -0,0 +1,227 @@
+#include "gravity_solver.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+GravitySolver::GravitySolver()
+    : mode_(Mode::Off), theta_(0.5), gravitationalConstant_(1.0), softening_(0.01) {
+}
+
+void GravitySolver::setOpeningAngle(double theta) {
+    if (theta < 0.0 || theta > 1.0) {
+        throw std::invalid_argument("Opening angle must be in [0, 1]");
+    }
+    theta_ = theta;
+}
+
+void GravitySolver::setSoftening(double softening) {
+    if (softening < 0.0) {
+        throw std::invalid_argument("Softening length must be non-negative");
+    }
+    softening_ = softening;
+}
+
+void GravitySolver::build(const Vector3D* positions, const double* masses, std::size_t count) {
+    nodes_.clear();
+    if (mode_ != Mode::BarnesHut || count == 0) return;
+
+    if (count > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) {
+        throw std::length_error("Too many particles for the octree");
+    }
+
+    // Bounding cube of all particles
+    Vector3D minCorner = positions[0];
+    Vector3D maxCorner = positions[0];
+    for (std::size_t i = 1; i < count; ++i) {
+        const Vector3D& p = positions[i];
+        minCorner.x = std::min(minCorner.x, p.x);
+        minCorner.y = std::min(minCorner.y, p.y);
+        minCorner.z = std::min(minCorner.z, p.z);
+        maxCorner.x = std::max(maxCorner.x, p.x);
+        maxCorner.y = std::max(maxCorner.y, p.y);
+        maxCorner.z = std::max(maxCorner.z, p.z);
+    }
+    Vector3D extent = maxCorner - minCorner;
+    double halfSize = 0.5 * std::max({extent.x, extent.y, extent.z});
+    halfSize = halfSize > 0.0 ? halfSize * (1.0 + 1e-9) : 1.0;
+
+    nextInLeaf_.resize(count);
+    nodes_.push_back(Node{(minCorner + maxCorner) * 0.5, halfSize, Vector3D(), 0.0, -1, -1});
+
+    for (std::size_t i = 0; i < count; ++i) {
+        insert(static_cast<std::int32_t>(i), positions);
+    }
+
+    computeMassDistribution(positions, masses);
+}
+
+void GravitySolver::insert(std::int32_t particle, const Vector3D* positions) {
+    const Vector3D& position = positions[particle];
+    std::int32_t node = 0;
+    int depth = 0;
+
+    for (;;) {
+        if (nodes_[node].firstChild >= 0) {
+            // Descend into the octant containing the particle
+            const Vector3D& center = nodes_[node].center;
+            int octant = (position.x >= center.x ? 1 : 0) |
+                         (position.y >= center.y ? 2 : 0) |
+                         (position.z >= center.z ? 4 : 0);
+            node = nodes_[node].firstChild + octant;
+            ++depth;
+            continue;
+        }
+
+        // Empty leaf: store the particle here
+        if (nodes_[node].firstParticle < 0) {
+            nodes_[node].firstParticle = particle;
+            nextInLeaf_[particle] = -1;
+            return;
+        }
+
+        // Too deep to separate (coincident particles): share the leaf
+        if (depth >= kMaxDepth) {
+            nextInLeaf_[particle] = nodes_[node].firstParticle;
+            nodes_[node].firstParticle = particle;
+            return;
+        }
+
+        // Occupied leaf: split it and push the resident particle down a level
+        std::int32_t resident = nodes_[node].firstParticle;
+        nodes_[node].firstParticle = -1;
+        subdivide(node);
+
+        const Vector3D& center = nodes_[node].center;
+        const Vector3D& residentPosition = positions[resident];
+        int octant = (residentPosition.x >= center.x ? 1 : 0) |
+                     (residentPosition.y >= center.y ? 2 : 0) |
+                     (residentPosition.z >= center.z ? 4 : 0);
+        nodes_[nodes_[node].firstChild + octant].firstParticle = resident;
+        nextInLeaf_[resident] = -1;
+    }
+}
+
+void GravitySolver::subdivide(std::int32_t node) {
+    // Copy before push_back, which may reallocate the pool
+    const Vector3D center = nodes_[node].center;
+    const double quarter = nodes_[node].halfSize * 0.5;
+
+    std::int32_t firstChild = static_cast<std::int32_t>(nodes_.size());
+    for (int octant = 0; octant < 8; ++octant) {
+        Vector3D offset((octant & 1) ? quarter : -quarter,
+                        (octant & 2) ? quarter : -quarter,
+                        (octant & 4) ? quarter : -quarter);
+        nodes_.push_back(Node{center + offset, quarter, Vector3D(), 0.0, -1, -1});
+    }
+    nodes_[node].firstChild = firstChild;
+}
+
+void GravitySolver::computeMassDistribution(const Vector3D* positions, const double* masses) {
+    // Children always come after their parent in the pool, so a reverse
+    // sweep visits every child before its parent
+    for (std::size_t i = nodes_.size(); i-- > 0;) {
+        Node& node = nodes_[i];
+        double mass = 0.0;
+        Vector3D weighted;
+
+        if (node.firstChild < 0) {
+            for (std::int32_t p = node.firstParticle; p >= 0; p = nextInLeaf_[p]) {
+                mass += masses[p];
+                weighted += positions[p] * masses[p];
+            }
+        } else {
+            for (int octant = 0; octant < 8; ++octant) {
+                const Node& child = nodes_[node.firstChild + octant];
+                mass += child.mass;
+                weighted += child.centerOfMass * child.mass;
+            }
+        }
+
+        node.mass = mass;
+        node.centerOfMass = mass > 0.0 ? weighted / mass : node.center;
+    }
+}
+
+void GravitySolver::accumulateForces(const Vector3D* positions, const double* masses, Vector3D* forces,
+                                     std::size_t count, std::size_t begin, std::size_t end) const {
+    if (mode_ == Mode::Off) return;
+
+    for (std::size_t i = begin; i < end; ++i) {
+        Vector3D field = (mode_ == Mode::BarnesHut)
+            ? treeField(i, positions, masses)
+            : directField(i, positions, masses, count);
+        forces[i] += field * (gravitationalConstant_ * masses[i]);
+    }
+}
+
+Vector3D GravitySolver::treeField(std::size_t particle, const Vector3D* positions, const double* masses) const {
+    Vector3D field;
+    if (nodes_.empty()) return field;
+
+    const Vector3D& position = positions[particle];
+    const double softening2 = softening_ * softening_;
+    const double theta2 = theta_ * theta_;
+
+    // Each visited node pushes at most eight children
+    std::int32_t stack[8 * (kMaxDepth + 1)];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes_[stack[--top]];
+        if (node.mass <= 0.0) continue;
+
+        if (node.firstChild < 0) {
+            // Leaf: sum its particles exactly, skipping the particle itself
+            for (std::int32_t p = node.firstParticle; p >= 0; p = nextInLeaf_[p]) {
+                if (static_cast<std::size_t>(p) == particle) continue;
+                Vector3D r = positions[p] - position;
+                double r2 = r.magnitudeSquared() + softening2;
+                if (r2 <= 0.0) continue;
+                field += r * (masses[p] / (r2 * std::sqrt(r2)));
+            }
+            continue;
+        }
+
+        Vector3D r = node.centerOfMass - position;
+        double distance2 = r.magnitudeSquared();
+        double size = 2.0 * node.halfSize;
+
+        // A cell holding the particle itself is always opened: its centre of
+        // mass can lie more than one cell size away (up to the cell's
+        // diagonal), and accepting it would pull the particle towards itself
+        const bool containsParticle = std::abs(position.x - node.center.x) <= node.halfSize &&
+                                      std::abs(position.y - node.center.y) <= node.halfSize &&
+                                      std::abs(position.z - node.center.z) <= node.halfSize;
+
+        if (!containsParticle && size * size < theta2 * distance2) {
+            // Far enough away: treat the whole cell as a point mass
+            double r2 = distance2 + softening2;
+            field += r * (node.mass / (r2 * std::sqrt(r2)));
+        } else {
+            for (int octant = 7; octant >= 0; --octant) {
+                stack[top++] = node.firstChild + octant;
+            }
+        }
+    }
+
+    return field;
+}
+
+Vector3D GravitySolver::directField(std::size_t particle, const Vector3D* positions, const double* masses,
+                                    std::size_t count) const {
+    Vector3D field;
+    const Vector3D& position = positions[particle];
+    const double softening2 = softening_ * softening_;
+
+    for (std::size_t j = 0; j < count; ++j) {
+        if (j == particle) continue;
+        Vector3D r = positions[j] - position;
+        double r2 = r.magnitudeSquared() + softening2;
+        if (r2 <= 0.0) continue;
+        field += r * (masses[j] / (r2 * std::sqrt(r2)));
+    }
+
+    return field;
+}
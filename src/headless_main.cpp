@@ -0,0 +1,333 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "game_map.hpp"
+#include "input_recording.hpp"
+#include "integrator.hpp"
+#include "player_controller.hpp"
+#include "profiler.hpp"
+#include "scene.hpp"
+#include "simulation.hpp"
+#include "snapshot.hpp"
+#include "trajectory.hpp"
+#include "vector_batch.hpp"
+
+namespace {
+    struct Options {
+        Scene scene = Scene::Cloud;
+        std::size_t particles = 10000;
+        long steps = 1000;
+        double dt = 1.0 / 240.0;
+        std::size_t threads = 1;
+        Integrator integrator = Integrator::SemiImplicitEuler;
+        unsigned int seed = 1;
+        std::string loadPath;    // Snapshot to restart from instead of a scene
+        std::string savePath;    // Snapshot written at the end (and at checkpoints)
+        long checkpointEvery = 0;
+        std::string replayPath;  // Input recording to play back instead of a scene
+        std::string mapPath;     // Map for the replay (default: the built-in layout)
+        std::string recordPath;  // Trajectory of every step
+        double recordQuantum = 0.0;
+        std::string profileTracePath;  // Chrome trace of the profiled step phases
+        double collideRadius = 0.0;    // Particle-particle collision radius (0 = off)
+        double restitution = 1.0;
+        VectorBatch::Backend simd = VectorBatch::bestBackend();
+    };
+
+    void printUsage(const char* program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --scene NAME        single, cloud, galaxy or cloth (default cloud)\n"
+                  << "  --particles N       Number of particles (default 10000)\n"
+                  << "  --steps N           Number of steps to run (default 1000)\n"
+                  << "  --dt SECONDS        Step length (default 1/240)\n"
+                  << "  --threads N         Simulation threads, 0 for all cores (default 1)\n"
+                  << "  --integrator NAME   euler, verlet, leapfrog or rk4 (default euler)\n"
+                  << "  --simd NAME         Vector kernels: scalar, sse2, avx2 or avx512 (default: best supported)\n"
+                  << "  --seed N            Seed for the scene layout (default 1)\n"
+                  << "  --load FILE         Restart from a snapshot instead of building a scene\n"
+                  << "  --save FILE         Write a snapshot when the run ends\n"
+                  << "  --replay FILE       Play back a session recorded with simulation --record-input\n"
+                  << "  --map FILE          Map the replayed session was played on (text or compiled)\n"
+                  << "  --checkpoint-every N  Also save to the --save file every N steps, in the background\n"
+                  << "  --record FILE       Record every step's positions to a trajectory file\n"
+                  << "  --record-quantum Q  Round recorded positions to multiples of Q (default exact)\n"
+                  << "  --collide RADIUS    Collide particles as spheres of this radius\n"
+                  << "  --restitution E     Bounciness of particle collisions, 0 to 1 (default 1)\n"
+                  << "  --profile-trace FILE  Time the step phases, print per-step statistics and write a Chrome trace\n";
+    }
+
+    /**
+     * Parse the command line
+     * @return false if the arguments are invalid or help was requested
+     */
+    bool parseOptions(int argc, char* argv[], Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                return false;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return false;
+            }
+            std::string value = argv[++i];
+
+            try {
+                if (arg == "--scene") {
+                    if (!parseScene(value, options.scene)) {
+                        std::cerr << "Unknown scene: " << value << std::endl;
+                        return false;
+                    }
+                } else if (arg == "--particles") {
+                    options.particles = std::stoul(value);
+                } else if (arg == "--steps") {
+                    options.steps = std::stol(value);
+                } else if (arg == "--dt") {
+                    options.dt = std::stod(value);
+                } else if (arg == "--threads") {
+                    options.threads = std::stoul(value);
+                } else if (arg == "--integrator") {
+                    if (!parseIntegrator(value, options.integrator)) {
+                        std::cerr << "Unknown integrator: " << value << std::endl;
+                        return false;
+                    }
+                } else if (arg == "--simd") {
+                    if (!VectorBatch::parseBackend(value, options.simd) || !VectorBatch::isSupported(options.simd)) {
+                        std::cerr << "Unknown or unsupported SIMD backend: " << value << std::endl;
+                        return false;
+                    }
+                } else if (arg == "--seed") {
+                    options.seed = static_cast<unsigned int>(std::stoul(value));
+                } else if (arg == "--load") {
+                    options.loadPath = value;
+                } else if (arg == "--save") {
+                    options.savePath = value;
+                } else if (arg == "--checkpoint-every") {
+                    options.checkpointEvery = std::stol(value);
+                } else if (arg == "--replay") {
+                    options.replayPath = value;
+                } else if (arg == "--map") {
+                    options.mapPath = value;
+                } else if (arg == "--record") {
+                    options.recordPath = value;
+                } else if (arg == "--record-quantum") {
+                    options.recordQuantum = std::stod(value);
+                } else if (arg == "--collide") {
+                    options.collideRadius = std::stod(value);
+                } else if (arg == "--restitution") {
+                    options.restitution = std::stod(value);
+                } else if (arg == "--profile-trace") {
+                    options.profileTracePath = value;
+                } else {
+                    std::cerr << "Unknown option: " << arg << std::endl;
+                    return false;
+                }
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+                return false;
+            }
+        }
+
+        if (options.steps <= 0 || !(options.dt > 0.0)) {
+            std::cerr << "Steps and dt must be positive" << std::endl;
+            return false;
+        }
+        if (options.checkpointEvery < 0 || (options.checkpointEvery > 0 && options.savePath.empty())) {
+            std::cerr << "--checkpoint-every needs a positive interval and --save" << std::endl;
+            return false;
+        }
+        if (options.recordQuantum < 0.0) {
+            std::cerr << "--record-quantum must not be negative" << std::endl;
+            return false;
+        }
+        if (!options.mapPath.empty() && options.replayPath.empty()) {
+            std::cerr << "--map is only used with --replay" << std::endl;
+            return false;
+        }
+        if (options.collideRadius < 0.0 || options.restitution < 0.0 || options.restitution > 1.0) {
+            std::cerr << "--collide must not be negative and --restitution must be in [0, 1]" << std::endl;
+            return false;
+        }
+        if (!options.profileTracePath.empty() && !kProfilerCompiledIn) {
+            std::cerr << "--profile-trace needs a build with PHY_ENABLE_PROFILER" << std::endl;
+            return false;
+        }
+        if (!options.replayPath.empty() && !options.loadPath.empty()) {
+            std::cerr << "--replay and --load cannot be combined" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        VectorBatch::setBackend(options.simd);
+        Simulation simulation;
+        simulation.setThreadCount(options.threads);
+        InputRecording replay;
+        std::unique_ptr<PlayerController> player;
+        if (!options.replayPath.empty()) {
+            // Rebuild the interactive session: the default particle, the map and the seeded spawn
+            replay = readInputRecording(options.replayPath);
+            simulation.setIntegrator(options.integrator);
+            simulation.initialize();
+            player.reset(new PlayerController(simulation, replay.mapAspectRatio, replay.seed));
+            // The visualizer spawns on the built-in map before a --map replaces
+            // it, so both spawns draw from the seeded generator here too
+            player->buildMap();
+            player->spawn();
+            if (!options.mapPath.empty()) {
+                auto loadStart = std::chrono::steady_clock::now();
+                auto map = std::make_shared<GameMap>(loadMap(options.mapPath));
+                double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+                std::cout << "Loaded map " << options.mapPath << ": " << map->getObstacleCount() << " walls in "
+                          << loadMs << " ms" << (map->isMapped() ? " (mapped)" : " (parsed)") << std::endl;
+                player->setMap(map);
+                player->spawn();
+            }
+
+            // Replaying keys on another map would run, but not reproduce the session
+            if (replay.mapFingerprint == 0) {
+                std::cerr << "Warning: " << options.replayPath << " does not record its map; "
+                          << "the replay only matches if it is the same one" << std::endl;
+            } else if (replay.mapFingerprint != player->getMap().fingerprint()) {
+                throw std::runtime_error("Recording " + options.replayPath + " was made on a different map than " +
+                                         (options.mapPath.empty() ? std::string("the built-in one; pass it with --map")
+                                                                  : options.mapPath));
+            }
+            options.steps = static_cast<long>(replay.keyMasks.size());
+            options.dt = replay.step;
+        } else if (options.loadPath.empty()) {
+            simulation.setIntegrator(options.integrator);
+            loadScene(simulation, options.scene, options.particles, options.seed);
+        } else {
+            // The snapshot restores the integrator it was saved with
+            simulation.loadSnapshot(options.loadPath);
+            options.integrator = simulation.getIntegrator();
+        }
+
+        if (options.collideRadius > 0.0) {
+            ParticleCollider& collider = simulation.getParticleCollider();
+            collider.setEnabled(true);
+            collider.setRadius(options.collideRadius);
+            collider.setRestitution(options.restitution);
+        }
+
+        std::size_t particleCount = simulation.getParticles().size();
+        std::string source = std::string("Scene ") + sceneName(options.scene);
+        if (player) {
+            source = "Replay " + options.replayPath + " (seed " + std::to_string(replay.seed) + ")";
+        } else if (!options.loadPath.empty()) {
+            source = "Snapshot " + options.loadPath;
+        }
+        std::cout << source
+                  << ": " << particleCount << " particles, "
+                  << options.steps << " steps of " << options.dt << " s, "
+                  << integratorName(options.integrator) << ", "
+                  << simulation.getThreadCount() << " thread(s), "
+                  << VectorBatch::backendName(VectorBatch::getBackend()) << " kernels" << std::endl;
+
+        using Clock = std::chrono::steady_clock;
+        SnapshotWriter checkpoints;
+        std::unique_ptr<TrajectoryWriter> trajectory;
+        if (!options.recordPath.empty()) {
+            TrajectoryOptions recordOptions;
+            recordOptions.quantum = options.recordQuantum;
+            trajectory.reset(new TrajectoryWriter(options.recordPath, particleCount, recordOptions));
+        }
+        // Each step is one profiler frame
+        Profiler& profiler = Profiler::instance();
+        profiler.setEnabled(!options.profileTracePath.empty());
+        std::uint64_t sweepOverlaps = 0;
+        std::uint64_t pairsTested = 0;
+        std::uint64_t contacts = 0;
+        Clock::time_point start = Clock::now();
+        for (long i = 0; i < options.steps; ++i) {
+            if (player) {
+                player->setKeyMask(replay.keyMasks[i]);
+                player->tick(options.dt);
+            } else {
+                simulation.step(options.dt);
+            }
+            if (options.collideRadius > 0.0) {
+                const ParticleCollisionStats& stats = simulation.getParticleCollider().getStats();
+                sweepOverlaps += stats.sweepOverlaps;
+                pairsTested += stats.pairsTested;
+                contacts += stats.contacts;
+            }
+            if (trajectory) {
+                trajectory->record(simulation.getParticles(), static_cast<std::uint64_t>(i + 1));
+            }
+            if (options.checkpointEvery > 0 && (i + 1) % options.checkpointEvery == 0) {
+                checkpoints.save(options.savePath, simulation.getParticles(), simulation.getSnapshotSettings());
+            }
+            PHY_PROFILE_FRAME();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        checkpoints.wait();
+        if (trajectory) {
+            trajectory->close();
+            std::cout << "Recorded " << trajectory->getFrameCount() << " frames to " << options.recordPath
+                      << " (" << trajectory->getEncodedBytes() / (1024.0 * 1024.0) << " MiB encoded)" << std::endl;
+        }
+        if (!options.savePath.empty()) {
+            simulation.saveSnapshot(options.savePath);
+            std::cout << "Saved snapshot to " << options.savePath << std::endl;
+        }
+
+        if (player) {
+            // Identical for every replay of the same recording
+            const Vector3D& position = simulation.getParticles().positions()[0];
+            std::cout << "Final player position: " << position.x << ", " << position.y
+                      << " (torch " << player->getRotationAngle() << " rad)" << std::endl;
+        }
+
+        if (options.collideRadius > 0.0) {
+            // Contacts per tested pair is the broad phase's hit rate
+            std::cout << "Particle collisions per step: " << static_cast<double>(sweepOverlaps) / options.steps
+                      << " x overlaps swept, " << static_cast<double>(pairsTested) / options.steps
+                      << " pairs tested, " << static_cast<double>(contacts) / options.steps << " contacts ("
+                      << (pairsTested ? 100.0 * contacts / pairsTested : 0.0) << "% of tested pairs touching)"
+                      << std::endl;
+        }
+
+        if (profiler.isEnabled()) {
+            std::vector<ProfileZoneStats> stats = profiler.getStats();
+            std::cout << std::left << std::setw(28) << "zone" << std::right << std::setw(10) << "min"
+                      << std::setw(10) << "avg" << std::setw(10) << "p99" << std::setw(8) << "calls"
+                      << "  (ms per step, last " << (stats.empty() ? 0 : stats[0].frames) << " steps)" << std::endl;
+            for (const ProfileZoneStats& zone : stats) {
+                std::cout << std::left << std::setw(28) << zone.name << std::right << std::fixed
+                          << std::setprecision(4) << std::setw(10) << zone.minMs << std::setw(10) << zone.avgMs
+                          << std::setw(10) << zone.p99Ms << std::setprecision(1) << std::setw(8)
+                          << zone.callsPerFrame << std::endl;
+            }
+            std::cout << std::defaultfloat << std::setprecision(6);
+            profiler.writeChromeTrace(options.profileTracePath);
+            std::cout << "Wrote profile trace to " << options.profileTracePath << std::endl;
+        }
+
+        double stepsPerSecond = options.steps / seconds;
+        std::cout << "Elapsed: " << seconds << " s" << std::endl;
+        std::cout << "Steps/sec: " << stepsPerSecond << std::endl;
+        std::cout << "Particle-updates/sec: " << stepsPerSecond * particleCount << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "input_recording.hpp"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include "binary_file.hpp"
+
+namespace {
+    const char kMagic[8] = {'P', 'H', 'Y', 'I', 'N', 'P', 'T', '\0'};
+    constexpr std::uint32_t kInputRecordingVersion = 2;
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t seed;
+        double step;
+        float mapAspectRatio;
+        std::uint32_t reserved;
+        std::uint64_t tickCount;
+        std::uint64_t mapFingerprint;  // Added in version 2
+    };
+    static_assert(sizeof(Header) == 48, "Input recording header layout changed");
+
+    // Version 1 headers end before mapFingerprint
+    constexpr std::size_t kVersion1HeaderSize = 40;
+}
+
+void writeInputRecording(const std::string& path, const InputRecording& recording) {
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kInputRecordingVersion;
+    header.seed = recording.seed;
+    header.step = recording.step;
+    header.mapAspectRatio = recording.mapAspectRatio;
+    header.tickCount = recording.keyMasks.size();
+    header.mapFingerprint = recording.mapFingerprint;
+
+    // Write beside the destination and rename over it, like the other formats
+    const std::string temporaryPath = path + ".tmp";
+    {
+        FilePtr file(std::fopen(temporaryPath.c_str(), "wb"));
+        if (!file) {
+            throw std::runtime_error("Failed to create input recording: " + temporaryPath);
+        }
+        writeBytes(file.get(), &header, sizeof(header), "input recording", path);
+        writeBytes(file.get(), recording.keyMasks.data(), recording.keyMasks.size(), "input recording", path);
+        if (std::fclose(file.release()) != 0) {
+            throw std::runtime_error("Failed to write input recording: " + path);
+        }
+    }
+    if (!replaceFile(temporaryPath, path)) {
+        throw std::runtime_error("Failed to move input recording into place: " + path);
+    }
+}
+
+InputRecording readInputRecording(const std::string& path) {
+    FilePtr file(std::fopen(path.c_str(), "rb"));
+    if (!file) {
+        throw std::runtime_error("Failed to open input recording: " + path);
+    }
+
+    Header header{};
+    if (std::fread(&header, kVersion1HeaderSize, 1, file.get()) != 1 ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not an input recording: " + path);
+    }
+    if (header.version != 1 && header.version != kInputRecordingVersion) {
+        throw std::runtime_error("Unsupported input recording version: " + path);
+    }
+    if (header.version >= 2 &&
+        std::fread(&header.mapFingerprint, sizeof(header.mapFingerprint), 1, file.get()) != 1) {
+        throw std::runtime_error("Input recording is truncated: " + path);
+    }
+    if (!(header.step > 0.0) || !(header.mapAspectRatio > 0.0f)) {
+        throw std::runtime_error("Input recording header is corrupt: " + path);
+    }
+
+    InputRecording recording;
+    recording.seed = header.seed;
+    recording.step = header.step;
+    recording.mapAspectRatio = header.mapAspectRatio;
+    recording.mapFingerprint = header.mapFingerprint;
+    recording.keyMasks.resize(static_cast<std::size_t>(header.tickCount));
+    if (std::fread(recording.keyMasks.data(), 1, recording.keyMasks.size(), file.get()) !=
+        recording.keyMasks.size()) {
+        throw std::runtime_error("Input recording is truncated: " + path);
+    }
+    return recording;
+}
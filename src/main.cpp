@@ -1,14 +1,48 @@
 #define GL_SILENCE_DEPRECATION // Silence OpenGL deprecation warnings on macOS
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <random>
+#include <string>
 #include <vector>
 #include "simulation.hpp"
+#include "game_map.hpp"
 #include "gl_visualizer.hpp"
+#include "profiler.hpp"
 
 int main(int argc, char* argv[]) {
-    (void)argc; // Unused parameter
-    (void)argv; // Unused parameter
+    // --render-bench measures frame time against particle count instead of playing;
+    // --record-input FILE logs the session's keys for phy_headless --replay;
+    // --profile-trace FILE writes the frame phase timings as a Chrome trace
+    bool renderBenchmark = false;
+    std::string inputRecordingPath;
+    std::string profileTracePath;
+    std::string mapPath;
+    std::uint32_t seed = std::random_device{}();
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--render-bench") == 0) {
+            renderBenchmark = true;
+        } else if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+            inputRecordingPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) {
+            profileTracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+            mapPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            try {
+                seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid seed: " << argv[i] << std::endl;
+                return 2;
+            }
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--render-bench] [--map FILE] [--record-input FILE] [--profile-trace FILE] [--seed N]" << std::endl;
+            return 2;
+        }
+    }
+    
     std::cout << "OpenGL Physics Simulation Starting..." << std::endl;
     
     try {
@@ -19,12 +53,34 @@ int main(int argc, char* argv[]) {
         simulation->initialize();
         
         // Create visualizer with a larger window size for better perspective view
-        GLVisualizer visualizer(*simulation, 1280, 960, "Phy");
+        GLVisualizer visualizer(*simulation, 1280, 960, "Phy", seed);
+        if (!mapPath.empty()) {
+            visualizer.setMap(std::make_shared<GameMap>(loadMap(mapPath)));
+        }
+        
+        if (renderBenchmark) {
+            visualizer.runRenderBenchmark({1000, 10000, 100000, 1000000}, 120);
+            return 0;
+        }
+        
+        // Step the simulation on its own thread so rendering never stalls it
+        visualizer.setThreadedSimulation(true);
+        if (!inputRecordingPath.empty()) {
+            visualizer.recordInput(inputRecordingPath);
+        }
+        if (!profileTracePath.empty()) {
+            if (!kProfilerCompiledIn) {
+                std::cerr << "--profile-trace needs a build with PHY_ENABLE_PROFILER" << std::endl;
+                return 2;
+            }
+            visualizer.exportProfileTrace(profileTracePath);
+        }
         
         std::cout << "Controls:" << std::endl;
         std::cout << "  - W, A, S, D: Move particle" << std::endl;
         std::cout << "  - K, L: Rotate torch left/right" << std::endl;
         std::cout << "  - C: Toggle between follow camera and top-down view" << std::endl;
+        std::cout << "  - P: Toggle the profiler overlay" << std::endl;
         std::cout << "  - ESC: Exit" << std::endl;
         std::cout << "Camera: Following particle from above (press C to toggle view)" << std::endl;
         
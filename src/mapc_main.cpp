@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "game_map.hpp"
+#include "obstacle_field.hpp"
+
+namespace {
+    void printUsage(const char* program) {
+        std::cerr << "Usage:\n"
+                  << "  " << program << " INPUT OUTPUT [--cell-size S]  Compile a map (text or compiled) to binary\n"
+                  << "  " << program << " --default ASPECT OUTPUT       Write the built-in layout as a text map\n"
+                  << "  " << program << " --info MAP                    Print a map's contents and load time\n"
+                  << "  " << program << " --field-report MAP [CELL...]  Compare baked torch fields with the exact forces\n";
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void printInfo(const std::string& path) {
+        auto start = std::chrono::steady_clock::now();
+        GameMap map = loadMap(path);
+        double loadMs = millisecondsSince(start);
+
+        const MapBounds& bounds = map.getBounds();
+        const ObstacleGrid& grid = map.getGrid();
+        std::cout << path << (map.isMapped() ? " (compiled)" : " (text)") << '\n'
+                  << "  Walls: " << map.getObstacleCount() << '\n'
+                  << "  Spawns: " << map.getSpawns().size() << ", sites: " << map.getSites().size()
+                  << ", labels: " << map.getLabels().size() << '\n'
+                  << "  Bounds: " << bounds.minX << ", " << bounds.minY << " to " << bounds.maxX << ", " << bounds.maxY << '\n'
+                  << "  Grid: " << grid.getColumns() << " x " << grid.getRows() << " cells of " << grid.getCellSize() << '\n'
+                  << "  Loaded in " << loadMs << " ms" << std::endl;
+    }
+
+    void printFieldReport(const std::string& path, std::vector<float> cellSizes) {
+        if (cellSizes.empty()) {
+            cellSizes = {0.1f, 0.05f, 0.025f, 0.0125f};
+        }
+        GameMap map = loadMap(path);
+        std::cout << path << ": torch field error against the exact forces (" << map.getObstacleCount() << " walls)\n"
+                  << "      cell      nodes   bake ms   max error   rms error   rms/peak   wall mismatches\n";
+        for (float cellSize : cellSizes) {
+            auto start = std::chrono::steady_clock::now();
+            ObstacleField field;
+            field.build(map.getObstacles(), map.getObstacleCount(), cellSize);
+            double bakeMs = millisecondsSince(start);
+            ObstacleFieldError error = field.measureError(map.getObstacles(), map.getObstacleCount());
+
+            char line[160];
+            std::snprintf(line, sizeof(line), "%10.5f %10lld %9.2f %11.5f %11.5f %9.2f%% %16.3f%%",
+                          cellSize, static_cast<long long>(field.getColumns()) * field.getRows(), bakeMs,
+                          error.maxForceError, error.rmsForceError,
+                          error.maxForce > 0.0 ? 100.0 * error.rmsForceError / error.maxForce : 0.0,
+                          error.samples ? 100.0 * error.insideMismatches / error.samples : 0.0);
+            std::cout << line << '\n';
+        }
+        std::cout.flush();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc == 3 && std::strcmp(argv[1], "--info") == 0) {
+            printInfo(argv[2]);
+            return 0;
+        }
+        if (argc >= 3 && std::strcmp(argv[1], "--field-report") == 0) {
+            std::vector<float> cellSizes;
+            for (int i = 3; i < argc; ++i) {
+                cellSizes.push_back(std::stof(argv[i]));
+            }
+            printFieldReport(argv[2], cellSizes);
+            return 0;
+        }
+        if (argc == 4 && std::strcmp(argv[1], "--default") == 0) {
+            writeMapText(argv[3], defaultMap(std::stof(argv[2])));
+            return 0;
+        }
+        if (argc == 3 || (argc == 5 && std::strcmp(argv[3], "--cell-size") == 0)) {
+            auto start = std::chrono::steady_clock::now();
+            GameMap map = loadMap(argv[1]);
+            if (argc == 5) {
+                map.buildGrid(std::stof(argv[4]));
+            }
+            writeCompiledMap(argv[2], map);
+            std::cout << "Compiled " << map.getObstacleCount() << " walls into " << argv[2] << " ("
+                      << map.getGrid().getColumns() << " x " << map.getGrid().getRows() << " grid) in "
+                      << millisecondsSince(start) << " ms" << std::endl;
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    printUsage(argv[0]);
+    return 2;
+}
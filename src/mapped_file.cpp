@@ -0,0 +1,48 @@
+#include "mapped_file.hpp"
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<void> mapFile(const std::string& path, std::size_t& size, bool writable) {
+#if defined(_WIN32)
+    (void)writable;  // The buffer is always writable
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    size = static_cast<std::size_t>(file.tellg());
+    auto* buffer = new std::uint64_t[(size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t) + 1];
+    std::shared_ptr<void> mapping(buffer, [](void* data) { delete[] static_cast<std::uint64_t*>(data); });
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size))) {
+        throw std::runtime_error("Failed to read " + path);
+    }
+    return mapping;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to read " + path);
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* data = ::mmap(nullptr, size, protection, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file open
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Failed to map " + path);
+    }
+    return std::shared_ptr<void>(data, [size](void* mapped) { ::munmap(mapped, size); });
+#endif
+}
@@ -0,0 +1,275 @@
+#include "obstacle_field.hpp"
+#include "obstacle_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    // Distance from an obstacle's bounds within which it pushes rays; also the distance clamp
+    constexpr float kReach = 1.0f;
+
+    // Node limit; keeps node offsets exact in float for the SIMD lookups (and the field under 64 MB)
+    constexpr std::size_t kMaxNodes = std::size_t(1) << 22;
+
+    // Repulsion of one obstacle, the terms of traceTorchRaysScalar() at distanceFactor 1
+    void addRepulsion(const Obstacle& obstacle, float x, float y, float& forceX, float& forceY) {
+        float obstacleLeft = obstacle.left();
+        float obstacleRight = obstacle.right();
+        float obstacleTop = obstacle.top();
+        float obstacleBottom = obstacle.bottom();
+
+        bool nearObstacle =
+            x >= obstacleLeft - 1.0f && x <= obstacleRight + 1.0f &&
+            y >= obstacleBottom - 1.0f && y <= obstacleTop + 1.0f;
+        if (!nearObstacle) return;
+
+        float distToLeft = x - obstacleLeft;
+        float distToRight = obstacleRight - x;
+        float distToTop = obstacleTop - y;
+        float distToBottom = y - obstacleBottom;
+        float minDist = std::min({distToLeft, distToRight, distToTop, distToBottom});
+        if (!(minDist > 0.01f && minDist < 2.0f)) return;
+
+        float repulsiveForce = 0.08f / (minDist * minDist + 0.1f);
+        if (minDist == distToLeft) {
+            forceX -= repulsiveForce;
+        } else if (minDist == distToRight) {
+            forceX += repulsiveForce;
+        } else if (minDist == distToTop) {
+            forceY += repulsiveForce;
+        } else if (minDist == distToBottom) {
+            forceY -= repulsiveForce;
+        }
+
+        const float cornerThreshold = 0.5f;
+        bool nearTopLeft = (distToLeft < cornerThreshold && distToTop < cornerThreshold);
+        bool nearTopRight = (distToRight < cornerThreshold && distToTop < cornerThreshold);
+        bool nearBottomLeft = (distToLeft < cornerThreshold && distToBottom < cornerThreshold);
+        bool nearBottomRight = (distToRight < cornerThreshold && distToBottom < cornerThreshold);
+        if (!(nearTopLeft || nearTopRight || nearBottomLeft || nearBottomRight)) return;
+
+        float cornerPush = 0.15f / (minDist * minDist + 0.05f) * 0.7071f;
+        forceX += (nearTopLeft || (!nearTopRight && nearBottomLeft)) ? -cornerPush : cornerPush;
+        forceY += (nearTopLeft || nearTopRight) ? cornerPush : -cornerPush;
+    }
+
+    /**
+     * Area the field covers: the obstacle bounds plus the reach of their
+     * push, or a single point at the origin for an empty map
+     */
+    void fieldBounds(const Obstacle* obstacles, std::size_t count, float& minX, float& maxX, float& minY, float& maxY) {
+        minX = maxX = minY = maxY = 0.0f;
+        if (count == 0) return;
+        minX = obstacles[0].left();
+        maxX = obstacles[0].right();
+        minY = obstacles[0].bottom();
+        maxY = obstacles[0].top();
+        for (std::size_t i = 1; i < count; ++i) {
+            minX = std::min(minX, obstacles[i].left());
+            maxX = std::max(maxX, obstacles[i].right());
+            minY = std::min(minY, obstacles[i].bottom());
+            maxY = std::max(maxY, obstacles[i].top());
+        }
+        minX -= kReach;
+        maxX += kReach;
+        minY -= kReach;
+        maxY += kReach;
+    }
+
+    // Nodes a field of the given extent and cell size needs
+    double nodeCount(double width, double height, double cellSize) {
+        return (std::ceil(width / cellSize) + 1.0) * (std::ceil(height / cellSize) + 1.0);
+    }
+
+    // Distance to a rectangle's boundary, negative inside (and zero on it)
+    float signedDistance(const Obstacle& obstacle, float x, float y) {
+        float dx = std::max(obstacle.left() - x, x - obstacle.right());
+        float dy = std::max(obstacle.bottom() - y, y - obstacle.top());
+        if (dx <= 0.0f && dy <= 0.0f) return std::max(dx, dy);
+        float outsideX = std::max(dx, 0.0f);
+        float outsideY = std::max(dy, 0.0f);
+        return std::sqrt(outsideX * outsideX + outsideY * outsideY);
+    }
+
+    /**
+     * Exact field values at a point, from the obstacles the grid finds nearby
+     *
+     * Candidates are summed in index order, like analyticForce(), so the
+     * result matches it bit for bit.
+     */
+    ObstacleField::Sample exactSample(const ObstacleGrid& grid, const Obstacle* obstacles, float x, float y,
+                                      std::vector<std::uint32_t>& candidates) {
+        candidates.clear();
+        grid.visitCandidates(x - kReach, y - kReach, x + kReach, y + kReach, [&](std::uint32_t index) {
+            candidates.push_back(index);
+            return false;
+        });
+        std::sort(candidates.begin(), candidates.end());
+
+        ObstacleField::Sample result{kReach, 0.0f, 0.0f};
+        for (std::uint32_t index : candidates) {
+            addRepulsion(obstacles[index], x, y, result.forceX, result.forceY);
+            result.distance = std::min(result.distance, signedDistance(obstacles[index], x, y));
+        }
+        return result;
+    }
+}
+
+ObstacleField::ObstacleField()
+    : originX_(0.0f), originY_(0.0f), cellSize_(1.0f), inverseCellSize_(1.0f), columns_(0), rows_(0) {
+}
+
+void ObstacleField::clear() {
+    nodes_.clear();
+    columns_ = rows_ = 0;
+}
+
+void ObstacleField::build(const Obstacle* obstacles, std::size_t count, float cellSize) {
+    if (!(cellSize > 0.0f) || !std::isfinite(cellSize)) {
+        throw std::invalid_argument("Obstacle field cell size must be positive");
+    }
+
+    // An empty map gets a single empty cell so lookups need no special case
+    float minX, maxX, minY, maxY;
+    fieldBounds(obstacles, count, minX, maxX, minY, maxY);
+
+    const double columns = std::ceil((static_cast<double>(maxX) - minX) / cellSize) + 1.0;
+    const double rows = std::ceil((static_cast<double>(maxY) - minY) / cellSize) + 1.0;
+    if (columns * rows > static_cast<double>(kMaxNodes)) {
+        throw std::length_error("Obstacle field cell size too small for the map");
+    }
+
+    originX_ = minX;
+    originY_ = minY;
+    cellSize_ = cellSize;
+    inverseCellSize_ = 1.0f / cellSize;
+    columns_ = std::max(2, static_cast<int>(columns));
+    rows_ = std::max(2, static_cast<int>(rows));
+    nodes_.assign(static_cast<std::size_t>(columns_) * rows_ * kNodeFloats, 0.0f);
+
+    ObstacleGrid grid;
+    grid.build(obstacles, count);
+    std::vector<std::uint32_t> candidates;
+    for (int row = 0; row < rows_; ++row) {
+        const float y = originY_ + row * cellSize_;
+        for (int column = 0; column < columns_; ++column) {
+            const float x = originX_ + column * cellSize_;
+            Sample node = exactSample(grid, obstacles, x, y, candidates);
+            float* out = nodes_.data() + (static_cast<std::size_t>(row) * columns_ + column) * kNodeFloats;
+            out[0] = node.distance;
+            out[1] = node.forceX;
+            out[2] = node.forceY;
+        }
+    }
+}
+
+float ObstacleField::fitCellSize(const Obstacle* obstacles, std::size_t count, float cellSize) {
+    if (!(cellSize > 0.0f) || !std::isfinite(cellSize)) {
+        throw std::invalid_argument("Obstacle field cell size must be positive");
+    }
+    float minX, maxX, minY, maxY;
+    fieldBounds(obstacles, count, minX, maxX, minY, maxY);
+    const double width = static_cast<double>(maxX) - minX;
+    const double height = static_cast<double>(maxY) - minY;
+    const double maxNodes = static_cast<double>(kMaxNodes);
+    if (nodeCount(width, height, cellSize) <= maxNodes) return cellSize;
+
+    // Each axis needs at most extent / cell + 2 nodes, so the positive root of
+    // (width + 2c)(height + 2c) = maxNodes c^2 always fits; float rounding may
+    // still need a nudge up
+    const double a = maxNodes - 4.0;
+    const double b = 2.0 * (width + height);
+    float fitted = static_cast<float>((b + std::sqrt(b * b + 4.0 * a * width * height)) / (2.0 * a));
+    while (nodeCount(width, height, fitted) > maxNodes) {
+        fitted = std::nextafter(fitted, std::numeric_limits<float>::infinity());
+    }
+    return std::max(fitted, cellSize);
+}
+
+ObstacleField::Sample ObstacleField::sample(float x, float y) const {
+    if (empty()) return Sample{kReach, 0.0f, 0.0f};
+
+    // Same arithmetic as the torch field kernels, clamps included
+    float gridX = (x - originX_) * inverseCellSize_;
+    float gridY = (y - originY_) * inverseCellSize_;
+    gridX = gridX > 0.0f ? gridX : 0.0f;
+    gridY = gridY > 0.0f ? gridY : 0.0f;
+    const float maxGridX = static_cast<float>(columns_ - 1);
+    const float maxGridY = static_cast<float>(rows_ - 1);
+    gridX = gridX < maxGridX ? gridX : maxGridX;
+    gridY = gridY < maxGridY ? gridY : maxGridY;
+
+    float cellX = static_cast<float>(static_cast<int>(gridX));
+    float cellY = static_cast<float>(static_cast<int>(gridY));
+    const float maxCellX = static_cast<float>(columns_ - 2);
+    const float maxCellY = static_cast<float>(rows_ - 2);
+    cellX = cellX < maxCellX ? cellX : maxCellX;
+    cellY = cellY < maxCellY ? cellY : maxCellY;
+    const float tx = gridX - cellX;
+    const float ty = gridY - cellY;
+
+    const float* n00 = nodes_.data() + (static_cast<std::size_t>(cellY) * columns_ + static_cast<std::size_t>(cellX)) * kNodeFloats;
+    const float* n10 = n00 + kNodeFloats;
+    const float* n01 = n00 + static_cast<std::size_t>(columns_) * kNodeFloats;
+    const float* n11 = n01 + kNodeFloats;
+
+    float values[3];
+    for (int channel = 0; channel < 3; ++channel) {
+        float bottom = n00[channel] + (n10[channel] - n00[channel]) * tx;
+        float top = n01[channel] + (n11[channel] - n01[channel]) * tx;
+        values[channel] = bottom + (top - bottom) * ty;
+    }
+    return Sample{values[0], values[1], values[2]};
+}
+
+ObstacleFieldError ObstacleField::measureError(const Obstacle* obstacles, std::size_t count, int samplesPerCell) const {
+    if (samplesPerCell < 1) {
+        throw std::invalid_argument("Need at least one sample per cell");
+    }
+    ObstacleFieldError error;
+    if (empty()) return error;
+
+    ObstacleGrid grid;
+    grid.build(obstacles, count);
+    std::vector<std::uint32_t> candidates;
+
+    // Offset by half a step so samples land between nodes as well as on cell edges
+    const float step = cellSize_ / samplesPerCell;
+    const int columns = (columns_ - 1) * samplesPerCell;
+    const int rows = (rows_ - 1) * samplesPerCell;
+    double sumSquared = 0.0;
+    for (int row = 0; row < rows; ++row) {
+        const float y = originY_ + (row + 0.5f) * step;
+        for (int column = 0; column < columns; ++column) {
+            const float x = originX_ + (column + 0.5f) * step;
+            Sample exact = exactSample(grid, obstacles, x, y, candidates);
+            Sample baked = sample(x, y);
+
+            double errorX = static_cast<double>(baked.forceX) - exact.forceX;
+            double errorY = static_cast<double>(baked.forceY) - exact.forceY;
+            double errorSquared = errorX * errorX + errorY * errorY;
+            sumSquared += errorSquared;
+            error.maxForceError = std::max(error.maxForceError, std::sqrt(errorSquared));
+            error.maxForce = std::max(error.maxForce, std::hypot(static_cast<double>(exact.forceX), exact.forceY));
+            if ((baked.distance <= 0.0f) != (exact.distance <= 0.0f)) {
+                ++error.insideMismatches;
+            }
+            ++error.samples;
+        }
+    }
+    if (error.samples > 0) {
+        error.rmsForceError = std::sqrt(sumSquared / error.samples);
+    }
+    return error;
+}
+
+void ObstacleField::analyticForce(const Obstacle* obstacles, std::size_t count, float x, float y,
+                                  float& forceX, float& forceY) {
+    forceX = 0.0f;
+    forceY = 0.0f;
+    for (std::size_t i = 0; i < count; ++i) {
+        addRepulsion(obstacles[i], x, y, forceX, forceY);
+    }
+}
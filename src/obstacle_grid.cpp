@@ -0,0 +1,162 @@
+#include "obstacle_grid.hpp"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    // Upper bound on grid resolution along each axis
+    constexpr int kMaxCellsPerAxis = 4096;
+}
+
+ObstacleGrid::ObstacleGrid()
+    : originX_(0.0f), originY_(0.0f), cellSize_(1.0f), inverseCellSize_(1.0f), columns_(0), rows_(0) {
+}
+
+void ObstacleGrid::build(const Obstacle* obstacles, std::size_t count, float cellSize) {
+    cellStarts_.clear();
+    cellItems_.clear();
+    obstacleCells_.clear();
+    adopted_ = AdoptedArrays();
+    columns_ = rows_ = 0;
+    if (count == 0) return;
+
+    if (count > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("Too many obstacles for the grid");
+    }
+    if (cellSize < 0.0f) {
+        throw std::invalid_argument("Grid cell size must be non-negative");
+    }
+
+    // Bounds of all obstacles
+    float minX = obstacles[0].left(), maxX = obstacles[0].right();
+    float minY = obstacles[0].bottom(), maxY = obstacles[0].top();
+    for (std::size_t i = 1; i < count; ++i) {
+        minX = std::min(minX, obstacles[i].left());
+        maxX = std::max(maxX, obstacles[i].right());
+        minY = std::min(minY, obstacles[i].bottom());
+        maxY = std::max(maxY, obstacles[i].top());
+    }
+    float extentX = std::max(maxX - minX, 1e-3f);
+    float extentY = std::max(maxY - minY, 1e-3f);
+
+    // By default aim for roughly one obstacle per cell
+    if (cellSize == 0.0f) {
+        cellSize = std::sqrt(extentX * extentY / static_cast<float>(count));
+    }
+    cellSize = std::max({cellSize, extentX / kMaxCellsPerAxis, extentY / kMaxCellsPerAxis});
+
+    originX_ = minX;
+    originY_ = minY;
+    cellSize_ = cellSize;
+    inverseCellSize_ = 1.0f / cellSize;
+    columns_ = std::max(1, std::min(kMaxCellsPerAxis, static_cast<int>(std::ceil(extentX / cellSize))));
+    rows_ = std::max(1, std::min(kMaxCellsPerAxis, static_cast<int>(std::ceil(extentY / cellSize))));
+
+    const std::size_t cellCount = static_cast<std::size_t>(columns_) * rows_;
+    cellStarts_.assign(cellCount + 1, 0);
+    obstacleCells_.resize(count);
+
+    // First pass: count the obstacles in each cell
+    for (std::size_t i = 0; i < count; ++i) {
+        int firstColumn = columnOf(obstacles[i].left());
+        int lastColumn = columnOf(obstacles[i].right());
+        int firstRow = rowOf(obstacles[i].bottom());
+        int lastRow = rowOf(obstacles[i].top());
+        obstacleCells_[i] = CellRange{firstColumn, firstRow};
+        for (int row = firstRow; row <= lastRow; ++row) {
+            for (int column = firstColumn; column <= lastColumn; ++column) {
+                cellStarts_[static_cast<std::size_t>(row) * columns_ + column + 1]++;
+            }
+        }
+    }
+
+    // Prefix sum turns the counts into slice offsets
+    for (std::size_t cell = 0; cell < cellCount; ++cell) {
+        cellStarts_[cell + 1] += cellStarts_[cell];
+    }
+
+    // Second pass: fill each cell's slice
+    cellItems_.resize(cellStarts_[cellCount]);
+    std::vector<std::uint32_t> cursor(cellStarts_.begin(), cellStarts_.end() - 1);
+    for (std::size_t i = 0; i < count; ++i) {
+        int lastColumn = columnOf(obstacles[i].right());
+        int lastRow = rowOf(obstacles[i].top());
+        for (int row = obstacleCells_[i].firstRow; row <= lastRow; ++row) {
+            for (int column = obstacleCells_[i].firstColumn; column <= lastColumn; ++column) {
+                std::size_t cell = static_cast<std::size_t>(row) * columns_ + column;
+                cellItems_[cursor[cell]++] = static_cast<std::uint32_t>(i);
+            }
+        }
+    }
+}
+
+void ObstacleGrid::adopt(std::shared_ptr<const void> owner, const Baked& baked) {
+    if (!owner) {
+        throw std::invalid_argument("Adopted grid needs an owner");
+    }
+    if (baked.obstacleCount == 0) {
+        build(nullptr, 0);
+        return;
+    }
+    if (baked.obstacleCount > std::numeric_limits<std::uint32_t>::max() ||
+        baked.columns < 1 || baked.rows < 1 || baked.columns > kMaxCellsPerAxis || baked.rows > kMaxCellsPerAxis ||
+        !(baked.cellSize > 0.0f) || !std::isfinite(baked.originX) || !std::isfinite(baked.originY) ||
+        !baked.cellStarts || !baked.obstacleCells) {
+        throw std::invalid_argument("Grid layout is invalid");
+    }
+
+    // Slices must be in order, and every index must stay inside its array
+    const std::size_t cellCount = static_cast<std::size_t>(baked.columns) * baked.rows;
+    if (baked.cellStarts[0] != 0) {
+        throw std::invalid_argument("Grid cell offsets are invalid");
+    }
+    for (std::size_t cell = 0; cell < cellCount; ++cell) {
+        if (baked.cellStarts[cell + 1] < baked.cellStarts[cell]) {
+            throw std::invalid_argument("Grid cell offsets are invalid");
+        }
+    }
+    const std::size_t itemCount = baked.cellStarts[cellCount];
+    if (itemCount > 0 && !baked.cellItems) {
+        throw std::invalid_argument("Grid cell items are missing");
+    }
+    for (std::size_t k = 0; k < itemCount; ++k) {
+        if (baked.cellItems[k] >= baked.obstacleCount) {
+            throw std::invalid_argument("Grid cell item is out of range");
+        }
+    }
+    for (std::size_t i = 0; i < baked.obstacleCount; ++i) {
+        const CellRange& range = baked.obstacleCells[i];
+        if (range.firstColumn < 0 || range.firstColumn >= baked.columns ||
+            range.firstRow < 0 || range.firstRow >= baked.rows) {
+            throw std::invalid_argument("Grid obstacle cell is out of range");
+        }
+    }
+
+    build(nullptr, 0);
+    originX_ = baked.originX;
+    originY_ = baked.originY;
+    cellSize_ = baked.cellSize;
+    inverseCellSize_ = 1.0f / baked.cellSize;
+    columns_ = baked.columns;
+    rows_ = baked.rows;
+    adopted_.owner = std::move(owner);
+    adopted_.cellStarts = baked.cellStarts;
+    adopted_.cellItems = baked.cellItems;
+    adopted_.obstacleCells = baked.obstacleCells;
+    adopted_.obstacleCount = baked.obstacleCount;
+}
+
+ObstacleGrid::Baked ObstacleGrid::getBaked() const {
+    Baked baked{};
+    baked.originX = originX_;
+    baked.originY = originY_;
+    baked.cellSize = cellSize_;
+    baked.columns = columns_;
+    baked.rows = rows_;
+    baked.cellStarts = cellStarts();
+    baked.cellItems = cellItems();
+    baked.obstacleCells = obstacleCells();
+    baked.obstacleCount = isAdopted() ? adopted_.obstacleCount : obstacleCells_.size();
+    return baked;
+}
@@ -1,28 +1,27 @@
 #include "particle.hpp"
 
 Particle::Particle(double mass, const Vector3D& position, const Vector3D& velocity, const std::string& name)
-    : mass_(mass), position_(position), velocity_(velocity), force_(), name_(name) {
-    if (mass <= 0) {
-        throw std::invalid_argument("Particle mass must be positive");
-    }
+    : owned_(std::make_unique<ParticleStore>()), store_(owned_.get()), index_(0) {
+    // ParticleStore::add validates the mass
+    index_ = owned_->add(mass, position, velocity, name);
 }
 
 void Particle::applyForce(const Vector3D& force) {
-    force_ += force;
+    store_->forces()[index_] += force;
 }
 
 void Particle::updatePosition(double dt) {
     // Simple Euler integration: position += velocity * dt
-    position_ += velocity_ * dt;
+    store_->positions()[index_] += store_->velocities()[index_] * dt;
 }
 
 void Particle::updateVelocity(double dt) {
     // F = ma, so a = F/m
     // v += a * dt
-    Vector3D acceleration = force_ / mass_;
-    velocity_ += acceleration * dt;
+    Vector3D acceleration = store_->forces()[index_] * store_->inverseMasses()[index_];
+    store_->velocities()[index_] += acceleration * dt;
 }
 
 void Particle::resetForces() {
-    force_ = Vector3D(0, 0, 0);
-} 
\ No newline at end of file
+    store_->forces()[index_] = Vector3D(0, 0, 0);
+}
@@ -0,0 +1,186 @@
+#include "particle_collision.hpp"
+#include "vector_batch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+    // Insertion-sort moves allowed per particle before a full sort is cheaper
+    constexpr std::size_t kMaxMovesPerParticle = 16;
+}
+
+ParticleCollider::ParticleCollider()
+    : enabled_(false), radius_(0.05), restitution_(1.0) {}
+
+void ParticleCollider::setRadius(double radius) {
+    if (!(radius > 0.0)) {
+        throw std::invalid_argument("Particle radius must be positive");
+    }
+    radius_ = radius;
+}
+
+void ParticleCollider::setRadii(std::vector<double> radii) {
+    for (double radius : radii) {
+        if (!(radius > 0.0)) {
+            throw std::invalid_argument("Particle radii must be positive");
+        }
+    }
+    if (radii.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("Too many particle radii");
+    }
+    radii_ = std::move(radii);
+}
+
+void ParticleCollider::setRestitution(double restitution) {
+    if (!(restitution >= 0.0 && restitution <= 1.0)) {
+        throw std::invalid_argument("Restitution must be in [0, 1]");
+    }
+    restitution_ = restitution;
+}
+
+void ParticleCollider::sortOrder(const Vector3D* positions, std::size_t count) {
+    order_.resize(count);
+    std::iota(order_.begin(), order_.end(), 0u);
+    starts_.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        starts_[i] = positions[i].x - radiusOf(static_cast<std::uint32_t>(i));
+    }
+    // Ties broken by index so the order does not depend on the previous one
+    std::sort(order_.begin(), order_.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return starts_[a] < starts_[b] || (starts_[a] == starts_[b] && a < b);
+    });
+    for (std::size_t k = 0; k < count; ++k) {
+        std::uint32_t index = order_[k];
+        starts_[k] = positions[index].x - radiusOf(index);
+    }
+    stats_.fullSort = true;
+}
+
+void ParticleCollider::updateOrder(const Vector3D* positions, std::size_t count) {
+    if (order_.size() != count) {
+        sortOrder(positions, count);
+        return;
+    }
+
+    // Refresh the keys in the previous order, then repair it by insertion
+    for (std::size_t k = 0; k < count; ++k) {
+        std::uint32_t index = order_[k];
+        starts_[k] = positions[index].x - radiusOf(index);
+    }
+    const std::size_t maxMoves = count * kMaxMovesPerParticle;
+    std::size_t moves = 0;
+    for (std::size_t k = 1; k < count; ++k) {
+        double start = starts_[k];
+        if (starts_[k - 1] <= start) continue;
+        std::uint32_t index = order_[k];
+        std::size_t m = k;
+        while (m > 0 && starts_[m - 1] > start) {
+            starts_[m] = starts_[m - 1];
+            order_[m] = order_[m - 1];
+            --m;
+        }
+        starts_[m] = start;
+        order_[m] = index;
+        moves += k - m;
+        if (moves > maxMoves) {
+            // Scrambled (e.g. teleported particles): the full sort is cheaper
+            sortOrder(positions, count);
+            break;
+        }
+    }
+    stats_.sortMoves = moves;
+}
+
+void ParticleCollider::resolve(Vector3D* positions, Vector3D* velocities, const double* inverseMasses,
+                               std::size_t count) {
+    if (!radii_.empty() && radii_.size() != count) {
+        throw std::invalid_argument("Particle radii do not match the particle count");
+    }
+    if (count > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("Too many particles for collision");
+    }
+    stats_ = ParticleCollisionStats();
+    updateOrder(positions, count);
+
+    // Copy y, z and radius into sweep order so the inner loop reads memory in sequence
+    sortedY_.resize(count);
+    sortedZ_.resize(count);
+    sortedRadii_.resize(count);
+    for (std::size_t k = 0; k < count; ++k) {
+        std::uint32_t index = order_[k];
+        sortedY_[k] = positions[index].y;
+        sortedZ_[k] = positions[index].z;
+        sortedRadii_[k] = radiusOf(index);
+    }
+
+    // Sweep: each particle against the later ones whose x extent starts before its own ends,
+    // keeping the pairs whose boxes also overlap in y and z
+    pairFirst_.clear();
+    pairSecond_.clear();
+    const double* starts = starts_.data();
+    const double* ys = sortedY_.data();
+    const double* zs = sortedZ_.data();
+    const double* radii = sortedRadii_.data();
+    std::size_t overlaps = 0;
+    for (std::size_t k = 0; k < count; ++k) {
+        const double radius = radii[k];
+        const double end = starts[k] + 2.0 * radius;
+        const double y = ys[k];
+        const double z = zs[k];
+        std::size_t m = k + 1;
+        for (; m < count && starts[m] <= end; ++m) {
+            double reach = radius + radii[m];
+            if (std::abs(ys[m] - y) <= reach && std::abs(zs[m] - z) <= reach) {
+                pairFirst_.push_back(order_[k]);
+                pairSecond_.push_back(order_[m]);
+            }
+        }
+        overlaps += m - k - 1;
+    }
+    stats_.sweepOverlaps = overlaps;
+    const std::size_t pairCount = pairFirst_.size();
+    stats_.pairsTested = pairCount;
+
+    // Narrow phase over the whole batch, before any particle moves
+    pairDistancesSquared_.resize(pairCount);
+    VectorBatch::pairDistancesSquared(pairDistancesSquared_.data(), positions, pairFirst_.data(),
+                                      pairSecond_.data(), pairCount);
+    contacts_.clear();
+    for (std::size_t k = 0; k < pairCount; ++k) {
+        double reach = radiusOf(pairFirst_[k]) + radiusOf(pairSecond_[k]);
+        if (pairDistancesSquared_[k] < reach * reach) {
+            contacts_.emplace_back(pairFirst_[k], pairSecond_[k]);
+        }
+    }
+    stats_.contacts = contacts_.size();
+
+    // Resolve in sweep order; earlier pushes can separate later pairs
+    for (const auto& pair : contacts_) {
+        const std::uint32_t a = pair.first;
+        const std::uint32_t b = pair.second;
+        Vector3D delta = positions[b] - positions[a];
+        double reach = radiusOf(a) + radiusOf(b);
+        double distanceSquared = delta.dot(delta);
+        if (distanceSquared >= reach * reach) continue;
+
+        // Coincident centres have no direction; separate them along x
+        double distance = std::sqrt(distanceSquared);
+        Vector3D normal = distance > 0.0 ? delta / distance : Vector3D(1.0, 0.0, 0.0);
+        double weightA = inverseMasses[a];
+        double weightB = inverseMasses[b];
+        double weight = weightA + weightB;
+
+        double penetration = (reach - distance) / weight;
+        positions[a] -= normal * (penetration * weightA);
+        positions[b] += normal * (penetration * weightB);
+
+        double approach = (velocities[b] - velocities[a]).dot(normal);
+        if (approach < 0.0) {
+            double impulse = -(1.0 + restitution_) * approach / weight;
+            velocities[a] -= normal * (impulse * weightA);
+            velocities[b] += normal * (impulse * weightB);
+        }
+    }
+}
@@ -0,0 +1,225 @@
+#include "particle_renderer.hpp"
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace {
+    // Attribute slots, bound before linking
+    constexpr GLuint kCornerAttribute = 0;
+    constexpr GLuint kCenterAttribute = 1;
+    constexpr GLuint kColorAttribute = 2;
+
+    // Particles packed per task when a pool is given
+    constexpr std::size_t kPackChunk = 16384;
+
+    const char* kVertexShader = R"(
+#version 120
+attribute vec2 corner;
+attribute vec4 center;
+attribute vec4 color;
+varying vec4 fragmentColor;
+void main() {
+    fragmentColor = color;
+    vec3 position = center.xyz + vec3(corner * center.w, 0.0);
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 1.0);
+}
+)";
+
+    const char* kFragmentShader = R"(
+#version 120
+varying vec4 fragmentColor;
+void main() {
+    gl_FragColor = fragmentColor;
+}
+)";
+
+    const void* offsetPointer(std::size_t offset) {
+        return reinterpret_cast<const void*>(offset);
+    }
+}
+
+ParticleRenderer::ParticleRenderer()
+    : program_(0),
+      discBuffer_(0),
+      instanceBuffer_(0),
+      discVertexCount_(0),
+      instanceCapacity_(0),
+      drawCalls_(0),
+      streamedBytes_(0) {
+}
+
+ParticleRenderer::~ParticleRenderer() {
+    release();
+}
+
+GLuint ParticleRenderer::compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cerr << "Particle shader failed to compile: " << log << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool ParticleRenderer::initialize(int segments) {
+    release();
+
+    // glVertexAttribDivisor is core from 3.3; older contexts use the batched fallback
+    if (!GLEW_VERSION_3_3 || segments < 3) {
+        return false;
+    }
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, kVertexShader);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, kFragmentShader);
+    if (!vertexShader || !fragmentShader) {
+        if (vertexShader) glDeleteShader(vertexShader);
+        if (fragmentShader) glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    program_ = glCreateProgram();
+    glAttachShader(program_, vertexShader);
+    glAttachShader(program_, fragmentShader);
+    glBindAttribLocation(program_, kCornerAttribute, "corner");
+    glBindAttribLocation(program_, kCenterAttribute, "center");
+    glBindAttribLocation(program_, kColorAttribute, "color");
+    glLinkProgram(program_);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program_, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        char log[1024];
+        glGetProgramInfoLog(program_, sizeof(log), nullptr, log);
+        std::cerr << "Particle shader failed to link: " << log << std::endl;
+        glDeleteProgram(program_);
+        program_ = 0;
+        return false;
+    }
+
+    // Unit disc as a triangle list, computed once for every particle and frame
+    std::vector<float> disc;
+    disc.reserve(static_cast<std::size_t>(segments) * 6);
+    float previousX = 1.0f;
+    float previousY = 0.0f;
+    for (int i = 1; i <= segments; ++i) {
+        float angle = 2.0f * M_PI * static_cast<float>(i) / static_cast<float>(segments);
+        float x = std::cos(angle);
+        float y = std::sin(angle);
+        disc.insert(disc.end(), {0.0f, 0.0f, previousX, previousY, x, y});
+        previousX = x;
+        previousY = y;
+    }
+    discVertexCount_ = static_cast<GLsizei>(disc.size() / 2);
+
+    glGenBuffers(1, &discBuffer_);
+    glBindBuffer(GL_ARRAY_BUFFER, discBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(disc.size() * sizeof(float)), disc.data(), GL_STATIC_DRAW);
+    glGenBuffers(1, &instanceBuffer_);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceCapacity_ = 0;
+    return true;
+}
+
+void ParticleRenderer::release() {
+    if (program_) {
+        glDeleteProgram(program_);
+        program_ = 0;
+    }
+    if (discBuffer_) {
+        glDeleteBuffers(1, &discBuffer_);
+        discBuffer_ = 0;
+    }
+    if (instanceBuffer_) {
+        glDeleteBuffers(1, &instanceBuffer_);
+        instanceBuffer_ = 0;
+    }
+    instanceCapacity_ = 0;
+}
+
+void ParticleRenderer::uploadInstances(const Vector3D* positions, std::size_t count, float radius,
+                                       const BatchColor& color, ThreadPool* pool) {
+    const std::size_t bytes = count * sizeof(ParticleInstance);
+
+    // Orphan last frame's storage so the GPU can keep reading it while we write
+    if (count > instanceCapacity_) {
+        instanceCapacity_ = count + count / 2;
+    }
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instanceCapacity_ * sizeof(ParticleInstance)),
+                 nullptr, GL_STREAM_DRAW);
+
+    auto pack = [&](ParticleInstance* out) {
+        if (pool && count > kPackChunk) {
+            pool->parallelFor(count, [&](std::size_t begin, std::size_t end) {
+                packParticleInstances(positions + begin, end - begin, radius, color, out + begin);
+            }, kPackChunk);
+        } else {
+            packParticleInstances(positions, count, radius, color, out);
+        }
+    };
+
+    // Pack straight into buffer memory; a failed unmap means the contents were lost
+    void* target = glMapBufferRange(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (target) {
+        pack(static_cast<ParticleInstance*>(target));
+        if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE) {
+            streamedBytes_ += bytes;
+            return;
+        }
+    }
+
+    staging_.resize(count);
+    pack(staging_.data());
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes), staging_.data());
+    streamedBytes_ += bytes;
+}
+
+void ParticleRenderer::draw(const Vector3D* positions, std::size_t count, float radius,
+                            const BatchColor& color, ThreadPool* pool) {
+    if (!program_ || count == 0) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+    uploadInstances(positions, count, radius, color, pool);
+
+    constexpr GLsizei stride = sizeof(ParticleInstance);
+    glVertexAttribPointer(kCenterAttribute, 4, GL_FLOAT, GL_FALSE, stride,
+                          offsetPointer(offsetof(ParticleInstance, x)));
+    glVertexAttribPointer(kColorAttribute, 4, GL_FLOAT, GL_FALSE, stride,
+                          offsetPointer(offsetof(ParticleInstance, color)));
+    glVertexAttribDivisor(kCenterAttribute, 1);
+    glVertexAttribDivisor(kColorAttribute, 1);
+    glEnableVertexAttribArray(kCenterAttribute);
+    glEnableVertexAttribArray(kColorAttribute);
+
+    glBindBuffer(GL_ARRAY_BUFFER, discBuffer_);
+    glVertexAttribPointer(kCornerAttribute, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(kCornerAttribute);
+
+    glUseProgram(program_);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, discVertexCount_, static_cast<GLsizei>(count));
+    ++drawCalls_;
+    glUseProgram(0);
+
+    // Leave the attribute state as the fixed-function paths expect it
+    glDisableVertexAttribArray(kCornerAttribute);
+    glDisableVertexAttribArray(kCenterAttribute);
+    glDisableVertexAttribArray(kColorAttribute);
+    glVertexAttribDivisor(kCenterAttribute, 0);
+    glVertexAttribDivisor(kColorAttribute, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ParticleRenderer::beginFrame() {
+    drawCalls_ = 0;
+    streamedBytes_ = 0;
+}
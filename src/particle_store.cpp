@@ -0,0 +1,93 @@
+#include "particle_store.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+std::size_t ParticleStore::add(double mass, const Vector3D& position, const Vector3D& velocity, const std::string& name) {
+    if (mass <= 0) {
+        throw std::invalid_argument("Particle mass must be positive");
+    }
+    copyAdoptedArrays();
+
+    positions_.push_back(position);
+    velocities_.push_back(velocity);
+    forces_.emplace_back();
+    masses_.push_back(mass);
+    inverseMasses_.push_back(1.0 / mass);
+    if (!names_.empty() || !name.empty()) {
+        names_.resize(forces_.size() - 1);
+        names_.push_back(name);
+    }
+
+    return forces_.size() - 1;
+}
+
+void ParticleStore::clear() {
+    adopted_ = AdoptedArrays();
+    positions_.clear();
+    velocities_.clear();
+    forces_.clear();
+    masses_.clear();
+    inverseMasses_.clear();
+    names_.clear();
+}
+
+void ParticleStore::reserve(std::size_t count) {
+    copyAdoptedArrays();
+    positions_.reserve(count);
+    velocities_.reserve(count);
+    forces_.reserve(count);
+    masses_.reserve(count);
+    inverseMasses_.reserve(count);
+}
+
+void ParticleStore::adopt(std::shared_ptr<void> owner, std::size_t count, Vector3D* positions,
+                          Vector3D* velocities, double* masses, double* inverseMasses) {
+    if (!owner) {
+        throw std::invalid_argument("Adopted particle arrays need an owner");
+    }
+    clear();
+    adopted_ = AdoptedArrays{std::move(owner), positions, velocities, masses, inverseMasses};
+    forces_.resize(count);
+}
+
+void ParticleStore::copyAdoptedArrays() {
+    if (!isAdopted()) return;
+
+    const std::size_t count = forces_.size();
+    positions_.assign(adopted_.positions, adopted_.positions + count);
+    velocities_.assign(adopted_.velocities, adopted_.velocities + count);
+    masses_.assign(adopted_.masses, adopted_.masses + count);
+    inverseMasses_.assign(adopted_.inverseMasses, adopted_.inverseMasses + count);
+    adopted_ = AdoptedArrays();
+}
+
+void ParticleStore::resetForces() {
+    std::fill(forces_.begin(), forces_.end(), Vector3D());
+}
+
+void ParticleStore::setMass(std::size_t index, double mass) {
+    if (mass <= 0) {
+        throw std::invalid_argument("Particle mass must be positive");
+    }
+    markModified();
+    if (isAdopted()) {
+        adopted_.masses[index] = mass;
+        adopted_.inverseMasses[index] = 1.0 / mass;
+        return;
+    }
+    masses_[index] = mass;
+    inverseMasses_[index] = 1.0 / mass;
+}
+
+const std::string& ParticleStore::name(std::size_t index) const {
+    static const std::string unnamed;
+    return names_.empty() ? unnamed : names_[index];
+}
+
+void ParticleStore::setName(std::size_t index, const std::string& name) {
+    if (names_.empty()) {
+        if (name.empty()) return;
+        names_.resize(size());
+    }
+    names_[index] = name;
+}
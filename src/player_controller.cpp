@@ -0,0 +1,159 @@
+#include "player_controller.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+PlayerController::PlayerController(Simulation& simulation, float mapAspectRatio, std::uint32_t seed)
+    : simulation_(simulation),
+      mapAspectRatio_(mapAspectRatio),
+      seed_(seed),
+      rng_(seed),
+      keyMask_(0),
+      rotationAngle_(0.0f),
+      rotationSpeed_(6.0f),  // Rotation speed in radians per second (0.1 rad per frame at 60 fps)
+      moveSpeed_(9.0f),      // Movement speed in units per second (0.15 per frame at 60 fps)
+      recordingEnabled_(false) {
+}
+
+void PlayerController::buildMap() {
+    setMap(std::make_shared<GameMap>(defaultMap(mapAspectRatio_)));
+}
+
+void PlayerController::setMap(std::shared_ptr<const GameMap> map) {
+    if (!map) {
+        throw std::invalid_argument("Player needs a map");
+    }
+    
+    // The simulation sweeps the particle against the map's walls every step
+    const GameMap& walls = *map;
+    simulation_.adoptObstacles(map, walls.getObstacles(), walls.getObstacleCount(), walls.getGrid().getBaked());
+    simulation_.setCollisionRadius(kParticleRadius);
+    map_ = std::move(map);
+}
+
+void PlayerController::spawn() {
+    Particle* centralParticle = simulation_.getCentralParticle();
+    if (!centralParticle) return;
+    
+    // Pick one of the map's spawn points with the seeded generator
+    const std::vector<MapSpawn>& spawns = map_->getSpawns();
+    if (spawns.empty()) return;
+    std::uniform_int_distribution<int> spawnDist(0, static_cast<int>(spawns.size()) - 1);
+    const MapSpawn& selectedSpawn = spawns[spawnDist(rng_)];
+    
+    // Place the particle at the selected spawn point
+    centralParticle->setPosition(Vector3D(selectedSpawn.x, selectedSpawn.y, 0));
+    centralParticle->setVelocity(Vector3D(0, 0, 0));
+    
+    std::cout << "Particle spawned at " << selectedSpawn.name << " position." << std::endl;
+}
+
+void PlayerController::setKeyState(InputKey key, bool pressed) {
+    if (key == InputKey::Count) return;
+    if (pressed) {
+        keyMask_ |= inputKeyBit(key);
+    } else {
+        keyMask_ &= static_cast<std::uint8_t>(~inputKeyBit(key));
+    }
+}
+
+void PlayerController::startRecording(double step) {
+    recording_.seed = seed_;
+    recording_.step = step;
+    recording_.mapAspectRatio = mapAspectRatio_;
+    recording_.mapFingerprint = map_ ? map_->fingerprint() : 0;
+    recording_.keyMasks.clear();
+    recordingEnabled_ = true;
+}
+
+void PlayerController::tick(double dt) {
+    PHY_PROFILE_ZONE("PlayerController::tick");
+    // The keys this tick sees are all a replay needs
+    if (recordingEnabled_) {
+        recording_.keyMasks.push_back(keyMask_);
+    }
+    
+    // Update direction based on keyboard input
+    updateDirection(dt);
+    
+    // Handle keyboard input
+    handleKeyboardInput(dt);
+    
+    // Get the central particle
+    Particle* centralParticle = simulation_.getCentralParticle();
+    if (!centralParticle) return;
+    
+    // Update the simulation (this also resolves obstacle collisions)
+    simulation_.step(dt);
+    
+    // If no keys are pressed, ensure the particle doesn't move at all
+    if (!isHeld(InputKey::W) && !isHeld(InputKey::A) && !isHeld(InputKey::S) && !isHeld(InputKey::D)) {
+        // Reset velocity to zero but keep the current position
+        centralParticle->setVelocity(Vector3D(0, 0, 0));
+    }
+}
+
+void PlayerController::updateDirection(double dt) {
+    PHY_PROFILE_ZONE("updateDirection");
+    // Get the central particle
+    Particle* centralParticle = simulation_.getCentralParticle();
+    if (!centralParticle) return;
+    
+    // Update rotation angle based on key states
+    if (isHeld(InputKey::K)) {
+        // Rotate counter-clockwise (left)
+        rotationAngle_ += rotationSpeed_ * static_cast<float>(dt);
+    }
+    if (isHeld(InputKey::L)) {
+        // Rotate clockwise (right)
+        rotationAngle_ -= rotationSpeed_ * static_cast<float>(dt);
+    }
+    
+    // Keep angle in [0, 2π) range
+    while (rotationAngle_ >= 2.0f * M_PI) {
+        rotationAngle_ -= 2.0f * M_PI;
+    }
+    while (rotationAngle_ < 0.0f) {
+        rotationAngle_ += 2.0f * M_PI;
+    }
+}
+
+void PlayerController::handleKeyboardInput(double dt) {
+    PHY_PROFILE_ZONE("handleKeyboardInput");
+    Particle* centralParticle = simulation_.getCentralParticle();
+    if (!centralParticle) return;
+    
+    Vector3D position = centralParticle->getPosition();
+    Vector3D velocity(0, 0, 0);
+    
+    // Apply movement based on key states - always use full speed
+    if (isHeld(InputKey::W)) velocity.y += moveSpeed_;
+    if (isHeld(InputKey::S)) velocity.y -= moveSpeed_;
+    if (isHeld(InputKey::A)) velocity.x -= moveSpeed_;
+    if (isHeld(InputKey::D)) velocity.x += moveSpeed_;
+    
+    // If no movement, explicitly set velocity to zero and return early
+    if (velocity.x == 0 && velocity.y == 0) {
+        centralParticle->setVelocity(Vector3D(0, 0, 0));
+        return;
+    }
+    
+    // Obstacles are handled by the simulation's swept collision, which
+    // stops the particle at the contact and slides it along the wall
+    Vector3D newPosition = position + velocity * dt;
+    
+    // Keep the particle inside the map's bounds
+    const MapBounds& bounds = map_->getBounds();
+    newPosition.x = std::max(static_cast<double>(bounds.minX + kParticleRadius), 
+                  std::min(static_cast<double>(bounds.maxX - kParticleRadius), newPosition.x));
+    newPosition.y = std::max(static_cast<double>(bounds.minY + kParticleRadius), 
+                  std::min(static_cast<double>(bounds.maxY - kParticleRadius), newPosition.y));
+    
+    // Set the velocity that carries the particle to the clamped target
+    // during this step's simulation update
+    centralParticle->setVelocity((newPosition - position) / dt);
+}
@@ -0,0 +1,222 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+
+struct Profiler::ThreadBuffer {
+    std::thread::id id;
+    std::uint32_t index;
+    std::mutex mutex;                  // Taken by the owning thread per event; contended only while reading
+    std::vector<ProfileEvent> events;  // Ring of eventCapacity events
+    std::size_t next = 0;
+    std::size_t count = 0;
+};
+
+namespace {
+    std::atomic<std::uint64_t> nextSerial{1};
+
+    std::uint64_t steadyNs() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void writeJsonString(std::ostream& out, const char* text) {
+        out << '"';
+        for (const char* c = text; *c; ++c) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\' << *c;
+            } else if (static_cast<unsigned char>(*c) < 0x20) {
+                out << ' ';
+            } else {
+                out << *c;
+            }
+        }
+        out << '"';
+    }
+}
+
+Profiler::Profiler(std::size_t eventCapacity)
+    : serial_(nextSerial.fetch_add(1)), eventCapacity_(eventCapacity), epochNs_(steadyNs()), enabled_(false),
+      historyMs_(kMaxZones * kHistoryFrames, 0.0f), historyCalls_(kMaxZones * kHistoryFrames, 0),
+      frames_(0) {
+    if (eventCapacity == 0) {
+        throw std::invalid_argument("Profiler event capacity must be positive");
+    }
+    zoneNames_.reserve(kMaxZones);
+    for (std::size_t i = 0; i < kMaxZones; ++i) {
+        frameNs_[i].store(0, std::memory_order_relaxed);
+        frameCalls_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+Profiler::~Profiler() = default;
+
+std::uint32_t Profiler::registerZone(const char* name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t i = 0; i < zoneNames_.size(); ++i) {
+        if (zoneNames_[i] == name || std::string(zoneNames_[i]) == name) {
+            return static_cast<std::uint32_t>(i);
+        }
+    }
+    if (zoneNames_.size() == kMaxZones) {
+        throw std::length_error("Too many profiler zones");
+    }
+    zoneNames_.push_back(name);
+    return static_cast<std::uint32_t>(zoneNames_.size() - 1);
+}
+
+std::uint64_t Profiler::now() const {
+    return steadyNs() - epochNs_;
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer() {
+    // Most recently used buffer of this thread, valid while the serial matches
+    thread_local std::uint64_t cachedSerial = 0;
+    thread_local ThreadBuffer* cachedBuffer = nullptr;
+    if (cachedSerial == serial_) {
+        return *cachedBuffer;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::thread::id id = std::this_thread::get_id();
+    ThreadBuffer* buffer = nullptr;
+    for (auto& candidate : threads_) {
+        if (candidate->id == id) {
+            buffer = candidate.get();
+        }
+    }
+    if (!buffer) {
+        threads_.push_back(std::make_unique<ThreadBuffer>());
+        buffer = threads_.back().get();
+        buffer->id = id;
+        buffer->index = static_cast<std::uint32_t>(threads_.size() - 1);
+        buffer->events.resize(eventCapacity_);
+    }
+    cachedSerial = serial_;
+    cachedBuffer = buffer;
+    return *buffer;
+}
+
+void Profiler::record(std::uint32_t zone, std::uint64_t startNs, std::uint64_t endNs) {
+    frameNs_[zone].fetch_add(endNs - startNs, std::memory_order_relaxed);
+    frameCalls_[zone].fetch_add(1, std::memory_order_relaxed);
+
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events[buffer.next] = ProfileEvent{zone, buffer.index, startNs, endNs};
+    buffer.next = (buffer.next + 1) % eventCapacity_;
+    buffer.count = std::min(buffer.count + 1, eventCapacity_);
+}
+
+void Profiler::endFrame() {
+    if (!isEnabled()) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::size_t slot = static_cast<std::size_t>(frames_ % kHistoryFrames);
+    for (std::size_t zone = 0; zone < zoneNames_.size(); ++zone) {
+        std::uint64_t ns = frameNs_[zone].exchange(0, std::memory_order_relaxed);
+        historyMs_[zone * kHistoryFrames + slot] = static_cast<float>(ns * 1e-6);
+        historyCalls_[zone * kHistoryFrames + slot] = frameCalls_[zone].exchange(0, std::memory_order_relaxed);
+    }
+    ++frames_;
+}
+
+std::vector<ProfileZoneStats> Profiler::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::size_t frames = static_cast<std::size_t>(std::min<std::uint64_t>(frames_, kHistoryFrames));
+    std::vector<ProfileZoneStats> stats;
+    std::vector<float> sorted;
+    for (std::size_t zone = 0; zone < zoneNames_.size(); ++zone) {
+        ProfileZoneStats zoneStats{zoneNames_[zone], 0.0, 0.0, 0.0, 0.0, frames};
+        if (frames > 0) {
+            // Zones registered after the history started read as zero in the older frames
+            const float* history = &historyMs_[zone * kHistoryFrames];
+            sorted.assign(history, history + frames);
+            double total = 0.0;
+            std::uint64_t calls = 0;
+            for (std::size_t i = 0; i < frames; ++i) {
+                total += sorted[i];
+                calls += historyCalls_[zone * kHistoryFrames + i];
+            }
+            std::size_t p99 = static_cast<std::size_t>(std::ceil(0.99 * frames)) - 1;
+            std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+            zoneStats.p99Ms = sorted[p99];
+            zoneStats.minMs = *std::min_element(sorted.begin(), sorted.begin() + p99 + 1);
+            zoneStats.avgMs = total / frames;
+            zoneStats.callsPerFrame = static_cast<double>(calls) / frames;
+        }
+        stats.push_back(zoneStats);
+    }
+    return stats;
+}
+
+std::uint64_t Profiler::getFrameCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frames_;
+}
+
+std::vector<ProfileEvent> Profiler::getEvents() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ProfileEvent> events;
+    for (const auto& buffer : threads_) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        std::size_t first = (buffer->next + eventCapacity_ - buffer->count) % eventCapacity_;
+        for (std::size_t i = 0; i < buffer->count; ++i) {
+            events.push_back(buffer->events[(first + i) % eventCapacity_]);
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+        return a.startNs < b.startNs;
+    });
+    return events;
+}
+
+void Profiler::writeChromeTrace(const std::string& path) const {
+    std::vector<ProfileEvent> events = getEvents();
+    std::vector<const char*> names;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        names = zoneNames_;
+    }
+
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to create trace: " + path);
+    }
+    // Complete ("X") events with microsecond timestamps
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    file << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        const ProfileEvent& event = events[i];
+        file << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(file, names[event.zone]);
+        file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+             << ",\"ts\":" << event.startNs * 1e-3
+             << ",\"dur\":" << (event.endNs - event.startNs) * 1e-3 << '}';
+    }
+    file << "\n]}\n";
+
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write trace: " + path);
+    }
+}
+
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& buffer : threads_) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->next = 0;
+        buffer->count = 0;
+    }
+    for (std::size_t i = 0; i < kMaxZones; ++i) {
+        frameNs_[i].store(0, std::memory_order_relaxed);
+        frameCalls_[i].store(0, std::memory_order_relaxed);
+    }
+    std::fill(historyMs_.begin(), historyMs_.end(), 0.0f);
+    std::fill(historyCalls_.begin(), historyCalls_.end(), 0);
+    frames_ = 0;
+}
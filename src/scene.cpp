@@ -0,0 +1,92 @@
+#include "scene.hpp"
+#include <cmath>
+#include <random>
+
+namespace {
+    void loadCloud(Simulation& simulation, std::size_t particleCount, std::mt19937& rng) {
+        std::uniform_real_distribution<double> position(-5.0, 5.0);
+        std::uniform_real_distribution<double> velocity(-1.0, 1.0);
+        for (std::size_t i = 0; i < particleCount; ++i) {
+            simulation.addParticle(1.0, Vector3D(position(rng), position(rng), position(rng)),
+                                   Vector3D(velocity(rng), velocity(rng), velocity(rng)));
+        }
+        simulation.setGravity(9.81);
+        simulation.setDamping(0.1);
+    }
+
+    void loadGalaxy(Simulation& simulation, std::size_t particleCount, std::mt19937& rng) {
+        const double coreMass = 1000.0;
+        const double G = 1.0;
+        simulation.addParticle(coreMass, Vector3D(0, 0, 0), Vector3D(0, 0, 0), "Core");
+
+        // Thin disc of light bodies on roughly circular orbits around the core
+        std::uniform_real_distribution<double> radius(1.0, 10.0);
+        std::uniform_real_distribution<double> angle(0.0, 2.0 * M_PI);
+        std::uniform_real_distribution<double> height(-0.1, 0.1);
+        for (std::size_t i = 1; i < particleCount; ++i) {
+            double r = radius(rng);
+            double theta = angle(rng);
+            double speed = std::sqrt(G * coreMass / r);
+            simulation.addParticle(0.01, Vector3D(r * std::cos(theta), r * std::sin(theta), height(rng)),
+                                   Vector3D(-speed * std::sin(theta), speed * std::cos(theta), 0.0));
+        }
+
+        GravitySolver& gravity = simulation.getGravitySolver();
+        gravity.setMode(GravitySolver::Mode::BarnesHut);
+        gravity.setGravitationalConstant(G);
+        gravity.setOpeningAngle(0.5);
+        gravity.setSoftening(0.05);
+    }
+
+    void loadCloth(Simulation& simulation, std::size_t particleCount, std::mt19937& rng) {
+        std::size_t side = static_cast<std::size_t>(std::sqrt(static_cast<double>(particleCount)));
+        if (side < 2) side = 2;
+        const double spacing = 0.1;
+
+        // Slightly jittered so the cloth does not fall perfectly flat
+        std::uniform_real_distribution<double> jitter(-0.001, 0.001);
+        for (std::size_t row = 0; row < side; ++row) {
+            for (std::size_t column = 0; column < side; ++column) {
+                simulation.addParticle(0.1, Vector3D(column * spacing, -(row * spacing), jitter(rng)),
+                                       Vector3D(0, 0, 0));
+            }
+        }
+
+        // Structural springs to the right and below each particle
+        SpringForce& springs = simulation.addForceGenerator<SpringForce>();
+        for (std::size_t row = 0; row < side; ++row) {
+            for (std::size_t column = 0; column < side; ++column) {
+                std::size_t index = row * side + column;
+                if (column + 1 < side) springs.addSpring(index, index + 1, spacing, 500.0, 0.5);
+                if (row + 1 < side) springs.addSpring(index, index + side, spacing, 500.0, 0.5);
+            }
+        }
+        simulation.setGravity(9.81);
+        simulation.setDamping(0.05);
+    }
+}
+
+void loadScene(Simulation& simulation, Scene scene, std::size_t particleCount, unsigned int seed) {
+    simulation.clearParticles();
+    simulation.clearForceGenerators();
+    simulation.clearObstacles();
+    simulation.setGravity(0.0);
+    simulation.setDamping(0.0);
+    simulation.getGravitySolver().setMode(GravitySolver::Mode::Off);
+
+    std::mt19937 rng(seed);
+    switch (scene) {
+        case Scene::Single:
+            simulation.initialize();
+            break;
+        case Scene::Cloud:
+            loadCloud(simulation, particleCount, rng);
+            break;
+        case Scene::Galaxy:
+            loadGalaxy(simulation, particleCount, rng);
+            break;
+        case Scene::Cloth:
+            loadCloth(simulation, particleCount, rng);
+            break;
+    }
+}
@@ -1,11 +1,23 @@
 #include "simulation.hpp"
+#include "profiler.hpp"
+#include "vector_batch.hpp"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <random>
 #include <cmath> // Added for M_PI and std::sqrt
+#include <thread>
 
-Simulation::Simulation() 
-    : gravity_(0.0), damping_(0.0) {  // Set damping to 0 to prevent any slowdown effect
+Simulation::Simulation()
+    : gravity_(0.0), damping_(0.0),  // Set damping to 0 to prevent any slowdown effect
+      gravityForce_(Vector3D(0.0, -gravity_, 0.0)),
+      dragForce_(damping_),
+      centralParticle_(particles_, 0),
+      integrator_(Integrator::SemiImplicitEuler),
+      forcesValid_(false),
+      forcesVersion_(0),
+      collisionRadius_(0.0),
+      threadCount_(1) {
 }
 
 Simulation::~Simulation() {
@@ -15,68 +27,464 @@ Simulation::~Simulation() {
 void Simulation::initialize() {
     // Clear existing particles
     particles_.clear();
-    
+
     // Create a single central particle with no initial velocity
     Vector3D position(0, 0, 0);
     Vector3D velocity(0.0, 0.0, 0); // No initial velocity
     double mass = 10.0;
-    
-    particles_.push_back(std::make_unique<Particle>(mass, position, velocity, "CentralParticle"));
-    
+
+    particles_.add(mass, position, velocity, "CentralParticle");
+    forcesValid_ = false;
+
     std::cout << "Initialized simulation with " << particles_.size() << " particle." << std::endl;
 }
 
+std::size_t Simulation::addParticle(double mass, const Vector3D& position, const Vector3D& velocity,
+                                    const std::string& name) {
+    forcesValid_ = false;
+    return particles_.add(mass, position, velocity, name);
+}
+
+void Simulation::saveSnapshot(const std::string& path) const {
+    writeSnapshot(path, particles_, getSnapshotSettings());
+}
+
+void Simulation::loadSnapshot(const std::string& path) {
+    SnapshotFile snapshot(path);
+    SnapshotSettings settings = snapshot.getSettings();
+    for (const SnapshotForce& force : settings.forces) {
+        for (const SpringForce::Spring& spring : force.springs) {
+            if (spring.a >= snapshot.getParticleCount() || spring.b >= snapshot.getParticleCount()) {
+                throw std::runtime_error("Snapshot spring joins a missing particle: " + path);
+            }
+        }
+    }
+    snapshot.adoptInto(particles_);
+
+    setGravity(settings.gravity);
+    setDamping(settings.damping);
+    setCollisionRadius(settings.collisionRadius);
+    setIntegrator(settings.integrator);
+
+    gravitySolver_.setMode(settings.gravityMode);
+    gravitySolver_.setGravitationalConstant(settings.gravitationalConstant);
+    gravitySolver_.setOpeningAngle(settings.openingAngle);
+    gravitySolver_.setSoftening(settings.gravitySoftening);
+
+    particleCollider_.setEnabled(settings.particleCollisions);
+    particleCollider_.setRadius(settings.particleRadius);
+    particleCollider_.setRadii(std::move(settings.particleRadii));
+    particleCollider_.setRestitution(settings.restitution);
+
+    clearForceGenerators();
+    for (const SnapshotForce& force : settings.forces) {
+        switch (force.kind) {
+            case SnapshotForce::Kind::UniformGravity:
+                addForceGenerator<UniformGravity>(force.vector);
+                break;
+            case SnapshotForce::Kind::LinearDrag:
+                addForceGenerator<LinearDrag>(force.strength);
+                break;
+            case SnapshotForce::Kind::PointAttractor:
+                addForceGenerator<PointAttractor>(force.vector, force.strength, force.softening);
+                break;
+            case SnapshotForce::Kind::Springs: {
+                SpringForce& springs = addForceGenerator<SpringForce>();
+                for (const SpringForce::Spring& spring : force.springs) {
+                    springs.addSpring(spring.a, spring.b, spring.restLength, spring.stiffness, spring.damping);
+                }
+                break;
+            }
+        }
+    }
+    forcesValid_ = false;
+}
+
+SnapshotSettings Simulation::getSnapshotSettings() const {
+    SnapshotSettings settings;
+    settings.gravity = gravity_;
+    settings.damping = damping_;
+    settings.collisionRadius = collisionRadius_;
+    settings.integrator = integrator_;
+
+    settings.gravityMode = gravitySolver_.getMode();
+    settings.gravitationalConstant = gravitySolver_.getGravitationalConstant();
+    settings.openingAngle = gravitySolver_.getOpeningAngle();
+    settings.gravitySoftening = gravitySolver_.getSoftening();
+
+    settings.particleCollisions = particleCollider_.isEnabled();
+    settings.particleRadius = particleCollider_.getRadius();
+    settings.particleRadii = particleCollider_.getRadii();
+    settings.restitution = particleCollider_.getRestitution();
+
+    // Only the built-in generators have a stored form; a restart without
+    // the others would silently diverge, so refuse to save instead
+    for (const auto& generator : forceGenerators_) {
+        SnapshotForce force;
+        if (auto* gravity = dynamic_cast<const UniformGravity*>(generator.get())) {
+            force.kind = SnapshotForce::Kind::UniformGravity;
+            force.vector = gravity->getAcceleration();
+        } else if (auto* drag = dynamic_cast<const LinearDrag*>(generator.get())) {
+            force.kind = SnapshotForce::Kind::LinearDrag;
+            force.strength = drag->getCoefficient();
+        } else if (auto* attractor = dynamic_cast<const PointAttractor*>(generator.get())) {
+            force.kind = SnapshotForce::Kind::PointAttractor;
+            force.vector = attractor->getCenter();
+            force.strength = attractor->getStrength();
+            force.softening = attractor->getSoftening();
+        } else if (auto* springs = dynamic_cast<const SpringForce*>(generator.get())) {
+            force.kind = SnapshotForce::Kind::Springs;
+            force.springs = springs->getSprings();
+        } else {
+            throw std::invalid_argument("Only built-in force generators can be saved in a snapshot");
+        }
+        settings.forces.push_back(std::move(force));
+    }
+    return settings;
+}
+
+void Simulation::clearParticles() {
+    particles_.clear();
+    forcesValid_ = false;
+}
+
+void Simulation::setGravity(double gravity) {
+    gravity_ = gravity;
+    gravityForce_.setAcceleration(Vector3D(0.0, -gravity_, 0.0));
+    forcesValid_ = false;
+}
+
+void Simulation::setDamping(double damping) {
+    if (damping < 0.0) {
+        throw std::invalid_argument("Damping must be non-negative");
+    }
+    damping_ = damping;
+    dragForce_.setCoefficient(damping_);
+    forcesValid_ = false;
+}
+
+void Simulation::setIntegrator(Integrator integrator) {
+    integrator_ = integrator;
+    forcesValid_ = false;
+}
+
+void Simulation::setObstacles(std::vector<Obstacle> obstacles) {
+    obstacleCollider_.setObstacles(std::move(obstacles));
+}
+
+void Simulation::adoptObstacles(std::shared_ptr<const void> owner, const Obstacle* obstacles, std::size_t count,
+                                const ObstacleGrid::Baked& grid) {
+    obstacleCollider_.adoptObstacles(std::move(owner), obstacles, count, grid);
+}
+
+void Simulation::clearObstacles() {
+    obstacleCollider_.clear();
+}
+
+void Simulation::setCollisionRadius(double radius) {
+    if (radius < 0.0) {
+        throw std::invalid_argument("Collision radius must be non-negative");
+    }
+    collisionRadius_ = radius;
+}
+
+void Simulation::setThreadCount(std::size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threadCount == threadCount_) return;
+
+    threadCount_ = threadCount;
+    threadPool_.reset();
+    if (threadCount_ > 1) {
+        threadPool_ = std::make_unique<ThreadPool>(threadCount_);
+    }
+}
+
 void Simulation::step(double dt) {
     if (dt <= 0) {
         throw std::invalid_argument("Time step must be positive");
     }
-    
-    // Apply forces
-    applyForces();
-    
-    // Update velocities based on forces
-    updateVelocities(dt);
-    
-    // Update positions based on velocities
-    updatePositions(dt);
+    PHY_PROFILE_ZONE("Simulation::step");
+
+    // Remember where each particle started so its motion can be swept
+    const bool collide = !obstacleCollider_.empty();
+    if (collide) {
+        PHY_PROFILE_ZONE("step: save start positions");
+        stepStartPositions_.resize(particles_.size());
+        const Vector3D* positions = particles_.positions();
+        Vector3D* startPositions = stepStartPositions_.data();
+        forEachParticleChunk([=](std::size_t begin, std::size_t end) {
+            std::copy(positions + begin, positions + end, startPositions + begin);
+        });
+    }
+
+    {
+        PHY_PROFILE_ZONE("step: integrate");
+        switch (integrator_) {
+            case Integrator::SemiImplicitEuler:
+                integrateSemiImplicitEuler(dt);
+                break;
+            case Integrator::VelocityVerlet:
+                integrateVelocityVerlet(dt);
+                break;
+            case Integrator::Leapfrog:
+                integrateLeapfrog(dt);
+                break;
+            case Integrator::RK4:
+                integrateRK4(dt);
+                break;
+        }
+    }
+
+    if (particleCollider_.isEnabled()) {
+        PHY_PROFILE_ZONE("step: particle collisions");
+        particleCollider_.resolve(particles_.positions(), particles_.velocities(), particles_.inverseMasses(),
+                                  particles_.size());
+        if (particleCollider_.getStats().contacts > 0) {
+            // Positions and velocities changed since the last force evaluation
+            forcesValid_ = false;
+        }
+    }
+
+    if (collide) {
+        PHY_PROFILE_ZONE("step: obstacle collisions");
+        resolveObstacleCollisions();
+    }
 }
 
 void Simulation::applyForces() {
-    // Reset all forces
-    for (auto& particle : particles_) {
-        particle->resetForces();
+    PHY_PROFILE_ZONE("step: forces");
+    const std::size_t generatorCount = forceGenerators_.size();
+    Vector3D* forces = particles_.forces();
+    std::size_t next = 0;
+    bool firstPass = true;
+
+    // Consecutive per-particle generators are fused into one chunked pass;
+    // pair generators run serially in between, keeping registration order
+    while (firstPass || next < generatorCount) {
+        std::size_t runEnd = next;
+        while (runEnd < generatorCount && forceGenerators_[runEnd]->isPerParticle()) {
+            ++runEnd;
+        }
+
+        forEachParticleChunk([&](std::size_t begin, std::size_t end) {
+            if (firstPass) {
+                // Reset all forces, then apply the built-in fields
+                std::fill(forces + begin, forces + end, Vector3D());
+                if (gravity_ != 0.0) gravityForce_.apply(particles_, begin, end);
+                if (damping_ != 0.0) dragForce_.apply(particles_, begin, end);
+            }
+            for (std::size_t g = next; g < runEnd; ++g) {
+                forceGenerators_[g]->apply(particles_, begin, end);
+            }
+        });
+        firstPass = false;
+        next = runEnd;
+
+        while (next < generatorCount && !forceGenerators_[next]->isPerParticle()) {
+            forceGenerators_[next]->apply(particles_, 0, particles_.size());
+            ++next;
+        }
+    }
+
+    // Pairwise gravity: the octree is built serially, then each particle
+    // walks it independently
+    if (gravitySolver_.getMode() != GravitySolver::Mode::Off) {
+        const std::size_t count = particles_.size();
+        const Vector3D* positions = particles_.positions();
+        const double* masses = particles_.masses();
+        gravitySolver_.build(positions, masses, count);
+        forEachParticleChunk([&](std::size_t begin, std::size_t end) {
+            gravitySolver_.accumulateForces(positions, masses, forces, count, begin, end);
+        }, 64);
     }
-    
-    // No forces applied - particle movement is controlled directly through velocity
 }
 
-void Simulation::updateVelocities(double dt) {
-    for (auto& particle : particles_) {
-        particle->updateVelocity(dt);
+void Simulation::integrateSemiImplicitEuler(double dt) {
+    applyForces();
+
+    Vector3D* positions = particles_.positions();
+    Vector3D* velocities = particles_.velocities();
+    const Vector3D* forces = particles_.forces();
+    const double* inverseMasses = particles_.inverseMasses();
+
+    // v += (F / m) * dt, then x += v * dt
+    forEachParticleChunk([=](std::size_t begin, std::size_t end) {
+        VectorBatch::kickDrift(positions + begin, velocities + begin, forces + begin, inverseMasses + begin,
+                               dt, dt, end - begin);
+    });
+
+    // Forces were evaluated before the drift, so they are stale now
+    forcesValid_ = false;
+}
+
+void Simulation::integrateVelocityVerlet(double dt) {
+    // Forces from the end of the previous step are reused when still valid
+    // and no particle was edited through a handle since
+    if (!forcesValid_ || forcesVersion_ != particles_.getVersion()) {
+        applyForces();
     }
+
+    Vector3D* positions = particles_.positions();
+    Vector3D* velocities = particles_.velocities();
+    const Vector3D* forces = particles_.forces();
+    const double* inverseMasses = particles_.inverseMasses();
+    const double halfDt = 0.5 * dt;
+
+    // Half kick and full drift
+    forEachParticleChunk([=](std::size_t begin, std::size_t end) {
+        VectorBatch::kickDrift(positions + begin, velocities + begin, forces + begin, inverseMasses + begin,
+                               halfDt, dt, end - begin);
+    });
+
+    applyForces();
+
+    // Second half kick with the forces at the new positions
+    forEachParticleChunk([=](std::size_t begin, std::size_t end) {
+        VectorBatch::scaledAdd(velocities + begin, forces + begin, inverseMasses + begin, halfDt, end - begin);
+    });
+
+    // Velocity-dependent forces (drag) now lag by half a kick; this is the
+    // usual velocity Verlet approximation
+    forcesValid_ = true;
+    forcesVersion_ = particles_.getVersion();
 }
 
-void Simulation::updatePositions(double dt) {
-    for (auto& particle : particles_) {
-        particle->updatePosition(dt);
+void Simulation::integrateLeapfrog(double dt) {
+    Vector3D* positions = particles_.positions();
+    Vector3D* velocities = particles_.velocities();
+    const Vector3D* forces = particles_.forces();
+    const double* inverseMasses = particles_.inverseMasses();
+    const double halfDt = 0.5 * dt;
+
+    // Half drift
+    forEachParticleChunk([=](std::size_t begin, std::size_t end) {
+        VectorBatch::axpy(positions + begin, velocities + begin, halfDt, end - begin);
+    });
+
+    applyForces();
+
+    // Full kick and second half drift
+    forEachParticleChunk([=](std::size_t begin, std::size_t end) {
+        VectorBatch::kickDrift(positions + begin, velocities + begin, forces + begin, inverseMasses + begin,
+                               dt, halfDt, end - begin);
+    });
+
+    forcesValid_ = false;
+}
+
+void Simulation::integrateRK4(double dt) {
+    const std::size_t count = particles_.size();
+    stagePositions_.resize(count);
+    stageVelocities_.resize(count);
+    positionSums_.resize(count);
+    velocitySums_.resize(count);
+
+    Vector3D* positions = particles_.positions();
+    Vector3D* velocities = particles_.velocities();
+    const Vector3D* forces = particles_.forces();
+    const double* inverseMasses = particles_.inverseMasses();
+    Vector3D* startPositions = stagePositions_.data();
+    Vector3D* startVelocities = stageVelocities_.data();
+    Vector3D* positionSums = positionSums_.data();
+    Vector3D* velocitySums = velocitySums_.data();
+
+    // Stage weights and the offsets at which the next stage is evaluated
+    const double weights[4] = {1.0, 2.0, 2.0, 1.0};
+    const double offsets[3] = {0.5 * dt, 0.5 * dt, dt};
+    const double finalScale = dt / 6.0;
+
+    for (int stage = 0; stage < 4; ++stage) {
+        // Derivatives at the current stage state: dx = v, dv = F / m
+        applyForces();
+
+        const double weight = weights[stage];
+        const bool first = (stage == 0);
+        const bool last = (stage == 3);
+        const double offset = last ? 0.0 : offsets[stage];
+
+        forEachParticleChunk([=](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                Vector3D dx = velocities[i];
+                Vector3D dv = forces[i] * inverseMasses[i];
+
+                if (first) {
+                    startPositions[i] = positions[i];
+                    startVelocities[i] = velocities[i];
+                    positionSums[i] = dx;
+                    velocitySums[i] = dv;
+                } else {
+                    positionSums[i] += dx * weight;
+                    velocitySums[i] += dv * weight;
+                }
+
+                if (last) {
+                    positions[i] = startPositions[i] + positionSums[i] * finalScale;
+                    velocities[i] = startVelocities[i] + velocitySums[i] * finalScale;
+                } else {
+                    positions[i] = startPositions[i] + dx * offset;
+                    velocities[i] = startVelocities[i] + dv * offset;
+                }
+            }
+        });
     }
+
+    forcesValid_ = false;
+}
+
+void Simulation::resolveObstacleCollisions() {
+    Vector3D* positions = particles_.positions();
+    Vector3D* velocities = particles_.velocities();
+    const Vector3D* startPositions = stepStartPositions_.data();
+    const ObstacleCollider& collider = obstacleCollider_;
+    const double radius = collisionRadius_;
+
+    forEachParticleChunk([&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const Vector3D& start = startPositions[i];
+            SlideResult result = collider.slide(start.x, start.y, positions[i].x - start.x,
+                                                positions[i].y - start.y, radius);
+            if (result.contactCount == 0) continue;
+
+            positions[i].x = result.x;
+            positions[i].y = result.y;
+
+            // Drop the velocity into each surface that was touched
+            Vector3D& velocity = velocities[i];
+            for (int c = 0; c < result.contactCount; ++c) {
+                double into = velocity.x * result.normalX[c] + velocity.y * result.normalY[c];
+                if (into < 0.0) {
+                    velocity.x -= result.normalX[c] * into;
+                    velocity.y -= result.normalY[c] * into;
+                }
+            }
+        }
+    }, 256);
+
+    // Positions may have moved since the last force evaluation
+    forcesValid_ = false;
 }
 
 void Simulation::printState() const {
-    std::cout << "=== Simulation State ===" << std::endl;
-    for (const auto& particle : particles_) {
-        std::cout << particle->getName() << ": "
-                  << "Position: " << particle->getPosition() 
-                  << ", Velocity: " << particle->getVelocity()
-                  << ", Mass: " << particle->getMass() << std::endl;
+    // One flush at the end; std::endl per particle made this I/O-bound
+    std::cout << "=== Simulation State ===\n";
+    const Vector3D* positions = particles_.positions();
+    const Vector3D* velocities = particles_.velocities();
+    const double* masses = particles_.masses();
+    for (std::size_t i = 0; i < particles_.size(); ++i) {
+        std::cout << particles_.name(i) << ": "
+                  << "Position: " << positions[i]
+                  << ", Velocity: " << velocities[i]
+                  << ", Mass: " << masses[i] << '\n';
     }
     std::cout << "======================" << std::endl;
-} 
+}
 
 // Method to get the central particle
 Particle* Simulation::getCentralParticle() {
     if (!particles_.empty()) {
-        return particles_[0].get();
+        return &centralParticle_;
     }
     return nullptr;
-} 
\ No newline at end of file
+}
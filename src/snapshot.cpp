@@ -0,0 +1,379 @@
+#include "snapshot.hpp"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include "binary_file.hpp"
+#include "mapped_file.hpp"
+
+namespace {
+    const char kMagic[8] = {'P', 'H', 'Y', 'S', 'N', 'A', 'P', '\0'};
+
+    // Bytes of one force table entry before its springs, and of one spring
+    constexpr std::size_t kForceEntryBytes = 2 * sizeof(std::uint32_t) + sizeof(std::uint64_t) + 5 * sizeof(double);
+    constexpr std::size_t kSpringBytes = 2 * sizeof(std::uint32_t) + 3 * sizeof(double);
+
+    template <typename T>
+    void appendValue(std::vector<char>& table, const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        table.insert(table.end(), bytes, bytes + sizeof(value));
+    }
+
+    template <typename T>
+    T readValue(const char*& cursor) {
+        T value;
+        std::memcpy(&value, cursor, sizeof(value));
+        cursor += sizeof(value);
+        return value;
+    }
+
+    /**
+     * Write a snapshot from raw arrays (shared by the synchronous and background paths)
+     */
+    void writeArrays(const std::string& path, std::size_t count, const Vector3D* positions,
+                     const Vector3D* velocities, const double* masses, const double* inverseMasses,
+                     const std::vector<std::pair<std::size_t, std::string>>& names,
+                     const SnapshotSettings& settings) {
+        if (!hostIsLittleEndian()) {
+            throw std::runtime_error("Snapshots are little-endian and this host is not");
+        }
+
+        // Name and force tables first, so their sizes are known for the header
+        std::vector<char> nameTable;
+        for (const auto& entry : names) {
+            appendValue(nameTable, static_cast<std::uint64_t>(entry.first));
+            appendValue(nameTable, static_cast<std::uint32_t>(entry.second.size()));
+            nameTable.insert(nameTable.end(), entry.second.begin(), entry.second.end());
+        }
+        std::vector<char> forceTable;
+        for (const SnapshotForce& force : settings.forces) {
+            appendValue(forceTable, static_cast<std::uint32_t>(force.kind));
+            appendValue(forceTable, std::uint32_t(0));
+            appendValue(forceTable, static_cast<std::uint64_t>(force.springs.size()));
+            appendValue(forceTable, force.vector.x);
+            appendValue(forceTable, force.vector.y);
+            appendValue(forceTable, force.vector.z);
+            appendValue(forceTable, force.strength);
+            appendValue(forceTable, force.softening);
+            for (const SpringForce::Spring& spring : force.springs) {
+                appendValue(forceTable, spring.a);
+                appendValue(forceTable, spring.b);
+                appendValue(forceTable, spring.restLength);
+                appendValue(forceTable, spring.stiffness);
+                appendValue(forceTable, spring.damping);
+            }
+        }
+        const std::vector<double>& radii = settings.particleRadii;
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kSnapshotVersion;
+        header.headerSize = sizeof(SnapshotHeader);
+        header.particleCount = count;
+        header.positionsOffset = alignUp(sizeof(SnapshotHeader));
+        header.velocitiesOffset = alignUp(header.positionsOffset + count * sizeof(Vector3D));
+        header.massesOffset = alignUp(header.velocitiesOffset + count * sizeof(Vector3D));
+        header.inverseMassesOffset = alignUp(header.massesOffset + count * sizeof(double));
+        std::uint64_t end = header.inverseMassesOffset + count * sizeof(double);
+        header.radiiOffset = radii.empty() ? 0 : alignUp(end);
+        header.radiiCount = radii.size();
+        if (!radii.empty()) end = header.radiiOffset + radii.size() * sizeof(double);
+        header.namesOffset = nameTable.empty() ? 0 : alignUp(end);
+        header.namesSize = nameTable.size();
+        if (!nameTable.empty()) end = header.namesOffset + nameTable.size();
+        header.forcesOffset = forceTable.empty() ? 0 : alignUp(end);
+        header.forcesSize = forceTable.size();
+        header.gravity = settings.gravity;
+        header.damping = settings.damping;
+        header.collisionRadius = settings.collisionRadius;
+        header.integrator = static_cast<std::uint32_t>(settings.integrator);
+        header.gravityMode = static_cast<std::uint32_t>(settings.gravityMode);
+        header.gravitationalConstant = settings.gravitationalConstant;
+        header.openingAngle = settings.openingAngle;
+        header.gravitySoftening = settings.gravitySoftening;
+        header.particleCollisions = settings.particleCollisions ? 1 : 0;
+        header.particleRadius = settings.particleRadius;
+        header.restitution = settings.restitution;
+
+        // Write beside the destination and rename over it, so a crash never
+        // leaves a torn snapshot and readers see either the old file or the new one
+        const std::string temporaryPath = path + ".tmp";
+        {
+            FilePtr file(std::fopen(temporaryPath.c_str(), "wb"));
+            if (!file) {
+                throw std::runtime_error("Failed to create snapshot: " + temporaryPath);
+            }
+            std::uint64_t position = 0;
+            writeBytes(file.get(), &header, sizeof(header), "snapshot", path);
+            position += sizeof(header);
+            padTo(file.get(), position, header.positionsOffset, "snapshot", path);
+            writeBytes(file.get(), positions, count * sizeof(Vector3D), "snapshot", path);
+            position += count * sizeof(Vector3D);
+            padTo(file.get(), position, header.velocitiesOffset, "snapshot", path);
+            writeBytes(file.get(), velocities, count * sizeof(Vector3D), "snapshot", path);
+            position += count * sizeof(Vector3D);
+            padTo(file.get(), position, header.massesOffset, "snapshot", path);
+            writeBytes(file.get(), masses, count * sizeof(double), "snapshot", path);
+            position += count * sizeof(double);
+            padTo(file.get(), position, header.inverseMassesOffset, "snapshot", path);
+            writeBytes(file.get(), inverseMasses, count * sizeof(double), "snapshot", path);
+            position += count * sizeof(double);
+            if (!radii.empty()) {
+                padTo(file.get(), position, header.radiiOffset, "snapshot", path);
+                writeBytes(file.get(), radii.data(), radii.size() * sizeof(double), "snapshot", path);
+                position += radii.size() * sizeof(double);
+            }
+            if (!nameTable.empty()) {
+                padTo(file.get(), position, header.namesOffset, "snapshot", path);
+                writeBytes(file.get(), nameTable.data(), nameTable.size(), "snapshot", path);
+                position += nameTable.size();
+            }
+            if (!forceTable.empty()) {
+                padTo(file.get(), position, header.forcesOffset, "snapshot", path);
+                writeBytes(file.get(), forceTable.data(), forceTable.size(), "snapshot", path);
+            }
+            if (std::fflush(file.get()) != 0) {
+                throw std::runtime_error("Failed to write snapshot: " + path);
+            }
+        }
+        if (!replaceFile(temporaryPath, path)) {
+            throw std::runtime_error("Failed to move snapshot into place: " + path);
+        }
+    }
+
+    void collectNames(const ParticleStore& particles, std::vector<std::pair<std::size_t, std::string>>& names) {
+        names.clear();
+        for (std::size_t i = 0; i < particles.size(); ++i) {
+            if (!particles.name(i).empty()) {
+                names.emplace_back(i, particles.name(i));
+            }
+        }
+    }
+
+    bool arrayFits(std::uint64_t offset, std::uint64_t bytes, std::size_t fileSize) {
+        return offset % alignof(double) == 0 && offset <= fileSize && bytes <= fileSize - offset;
+    }
+}
+
+void writeSnapshot(const std::string& path, const ParticleStore& particles, const SnapshotSettings& settings) {
+    std::vector<std::pair<std::size_t, std::string>> names;
+    collectNames(particles, names);
+    writeArrays(path, particles.size(), particles.positions(), particles.velocities(),
+                particles.masses(), particles.inverseMasses(), names, settings);
+}
+
+SnapshotFile::SnapshotFile(const std::string& path)
+    : size_(0), header_(nullptr) {
+    if (!hostIsLittleEndian()) {
+        throw std::runtime_error("Snapshots are little-endian and this host is not");
+    }
+
+    mapping_ = mapFile(path, size_, true);
+    if (size_ < sizeof(SnapshotHeader)) {
+        throw std::runtime_error("Snapshot is truncated: " + path);
+    }
+    header_ = static_cast<const SnapshotHeader*>(mapping_.get());
+    if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a snapshot file: " + path);
+    }
+    if (header_->version != kSnapshotVersion || header_->headerSize != sizeof(SnapshotHeader)) {
+        throw std::runtime_error("Unsupported snapshot version: " + path);
+    }
+
+    // Bounds-check every array so adopted pointers never run past the mapping
+    const std::uint64_t count = header_->particleCount;
+    if (count > size_ / sizeof(double) ||
+        !arrayFits(header_->positionsOffset, count * sizeof(Vector3D), size_) ||
+        !arrayFits(header_->velocitiesOffset, count * sizeof(Vector3D), size_) ||
+        !arrayFits(header_->massesOffset, count * sizeof(double), size_) ||
+        !arrayFits(header_->inverseMassesOffset, count * sizeof(double), size_) ||
+        (header_->namesOffset && !arrayFits(header_->namesOffset, header_->namesSize, size_)) ||
+        header_->radiiCount > size_ / sizeof(double) ||
+        (header_->radiiOffset && !arrayFits(header_->radiiOffset, header_->radiiCount * sizeof(double), size_)) ||
+        (!header_->radiiOffset && header_->radiiCount) ||
+        (header_->forcesOffset && !arrayFits(header_->forcesOffset, header_->forcesSize, size_))) {
+        throw std::runtime_error("Snapshot is truncated or corrupt: " + path);
+    }
+    if (header_->integrator > static_cast<std::uint32_t>(Integrator::RK4)) {
+        throw std::runtime_error("Snapshot has an unknown integrator: " + path);
+    }
+    if (header_->gravityMode > static_cast<std::uint32_t>(GravitySolver::Mode::BarnesHut)) {
+        throw std::runtime_error("Snapshot has an unknown gravity mode: " + path);
+    }
+
+    // The same ranges the Simulation setters accept, so a load cannot fail halfway
+    if (!(header_->damping >= 0.0) || !(header_->collisionRadius >= 0.0) ||
+        !(header_->openingAngle >= 0.0 && header_->openingAngle <= 1.0) || !(header_->gravitySoftening >= 0.0) ||
+        !(header_->particleRadius > 0.0) || !(header_->restitution >= 0.0 && header_->restitution <= 1.0)) {
+        throw std::runtime_error("Snapshot settings are out of range: " + path);
+    }
+    const double* radii = array<const double>(header_->radiiOffset);
+    for (std::uint64_t i = 0; i < header_->radiiCount; ++i) {
+        if (!(radii[i] > 0.0)) {
+            throw std::runtime_error("Snapshot settings are out of range: " + path);
+        }
+    }
+}
+
+SnapshotSettings SnapshotFile::getSettings() const {
+    SnapshotSettings settings;
+    settings.gravity = header_->gravity;
+    settings.damping = header_->damping;
+    settings.collisionRadius = header_->collisionRadius;
+    settings.integrator = static_cast<Integrator>(header_->integrator);
+
+    settings.gravityMode = static_cast<GravitySolver::Mode>(header_->gravityMode);
+    settings.gravitationalConstant = header_->gravitationalConstant;
+    settings.openingAngle = header_->openingAngle;
+    settings.gravitySoftening = header_->gravitySoftening;
+
+    settings.particleCollisions = header_->particleCollisions != 0;
+    settings.particleRadius = header_->particleRadius;
+    settings.restitution = header_->restitution;
+    if (header_->radiiCount) {
+        const double* radii = array<const double>(header_->radiiOffset);
+        settings.particleRadii.assign(radii, radii + header_->radiiCount);
+    }
+
+    if (!header_->forcesOffset) return settings;
+    const char* cursor = array<const char>(header_->forcesOffset);
+    const char* end = cursor + header_->forcesSize;
+    while (cursor != end) {
+        if (static_cast<std::size_t>(end - cursor) < kForceEntryBytes) {
+            throw std::runtime_error("Snapshot force table is corrupt");
+        }
+        SnapshotForce force;
+        std::uint32_t kind = readValue<std::uint32_t>(cursor);
+        readValue<std::uint32_t>(cursor);
+        std::uint64_t springCount = readValue<std::uint64_t>(cursor);
+        force.vector.x = readValue<double>(cursor);
+        force.vector.y = readValue<double>(cursor);
+        force.vector.z = readValue<double>(cursor);
+        force.strength = readValue<double>(cursor);
+        force.softening = readValue<double>(cursor);
+        if (kind < static_cast<std::uint32_t>(SnapshotForce::Kind::UniformGravity) ||
+            kind > static_cast<std::uint32_t>(SnapshotForce::Kind::Springs) ||
+            springCount > static_cast<std::size_t>(end - cursor) / kSpringBytes) {
+            throw std::runtime_error("Snapshot force table is corrupt");
+        }
+        force.kind = static_cast<SnapshotForce::Kind>(kind);
+
+        force.springs.resize(static_cast<std::size_t>(springCount));
+        for (SpringForce::Spring& spring : force.springs) {
+            spring.a = readValue<std::uint32_t>(cursor);
+            spring.b = readValue<std::uint32_t>(cursor);
+            spring.restLength = readValue<double>(cursor);
+            spring.stiffness = readValue<double>(cursor);
+            spring.damping = readValue<double>(cursor);
+            if (spring.a == spring.b) {
+                throw std::runtime_error("Snapshot force table is corrupt");
+            }
+        }
+        settings.forces.push_back(std::move(force));
+    }
+    return settings;
+}
+
+void SnapshotFile::adoptInto(ParticleStore& store) const {
+    store.adopt(mapping_, getParticleCount(),
+                array<Vector3D>(header_->positionsOffset), array<Vector3D>(header_->velocitiesOffset),
+                array<double>(header_->massesOffset), array<double>(header_->inverseMassesOffset));
+    for (const auto& entry : readNames()) {
+        store.setName(entry.first, entry.second);
+    }
+}
+
+std::vector<std::pair<std::size_t, std::string>> SnapshotFile::readNames() const {
+    std::vector<std::pair<std::size_t, std::string>> names;
+    if (!header_->namesOffset) return names;
+
+    const char* cursor = array<const char>(header_->namesOffset);
+    const char* end = cursor + header_->namesSize;
+    while (cursor != end) {
+        std::uint64_t index;
+        std::uint32_t length;
+        if (static_cast<std::size_t>(end - cursor) < sizeof(index) + sizeof(length)) {
+            throw std::runtime_error("Snapshot name table is corrupt");
+        }
+        std::memcpy(&index, cursor, sizeof(index));
+        std::memcpy(&length, cursor + sizeof(index), sizeof(length));
+        cursor += sizeof(index) + sizeof(length);
+        if (static_cast<std::size_t>(end - cursor) < length || index >= header_->particleCount) {
+            throw std::runtime_error("Snapshot name table is corrupt");
+        }
+        names.emplace_back(static_cast<std::size_t>(index), std::string(cursor, length));
+        cursor += length;
+    }
+    return names;
+}
+
+SnapshotWriter::SnapshotWriter()
+    : pending_(false),
+      stopping_(false) {
+    thread_ = std::thread(&SnapshotWriter::threadLoop, this);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+}
+
+void SnapshotWriter::save(const std::string& path, const ParticleStore& particles, const SnapshotSettings& settings) {
+    // The staging buffers belong to the writer thread until the previous save is done
+    wait();
+
+    const std::size_t count = particles.size();
+    positions_.assign(particles.positions(), particles.positions() + count);
+    velocities_.assign(particles.velocities(), particles.velocities() + count);
+    masses_.assign(particles.masses(), particles.masses() + count);
+    inverseMasses_.assign(particles.inverseMasses(), particles.inverseMasses() + count);
+    collectNames(particles, names_);
+    settings_ = settings;
+    path_ = path;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = true;
+    }
+    condition_.notify_all();
+}
+
+void SnapshotWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return !pending_; });
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool SnapshotWriter::isBusy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void SnapshotWriter::threadLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        condition_.wait(lock, [this] { return pending_ || stopping_; });
+        if (!pending_) return;  // Stopping with nothing left to write
+
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            writeArrays(path_, masses_.size(), positions_.data(), velocities_.data(),
+                        masses_.data(), inverseMasses_.data(), names_, settings_);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        error_ = error;
+        pending_ = false;
+        condition_.notify_all();
+    }
+}
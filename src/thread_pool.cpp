@@ -0,0 +1,86 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+    std::size_t workerCount = threadCount > 1 ? threadCount - 1 : 0;
+    workers_.reserve(workerCount);
+    for (std::size_t i = 0; i < workerCount; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(std::size_t count, std::size_t minChunk, ChunkFunction function, void* context) {
+    if (count == 0) return;
+
+    // Aim for a few chunks per thread so uneven chunks balance out,
+    // but never hand out chunks smaller than minChunk
+    std::size_t threads = threadCount();
+    std::size_t chunkSize = (count + threads * 4 - 1) / (threads * 4);
+    chunkSize = std::max(chunkSize, std::max<std::size_t>(minChunk, 1));
+
+    // Small jobs run inline instead of waking the workers
+    if (workers_.empty() || chunkSize >= count) {
+        function(context, 0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        function_ = function;
+        context_ = context;
+        count_ = count;
+        chunkSize_ = chunkSize;
+        nextChunk_.store(0, std::memory_order_relaxed);
+        activeWorkers_ = workers_.size();
+        ++generation_;
+    }
+    wakeCondition_.notify_all();
+
+    // The calling thread works on the job too
+    processChunks();
+
+    // Barrier: wait until every worker has left the job
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneCondition_.wait(lock, [this] { return activeWorkers_ == 0; });
+}
+
+void ThreadPool::processChunks() {
+    for (;;) {
+        std::size_t begin = nextChunk_.fetch_add(chunkSize_, std::memory_order_relaxed);
+        if (begin >= count_) break;
+        std::size_t end = std::min(begin + chunkSize_, count_);
+        function_(context_, begin, end);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    std::size_t seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeCondition_.wait(lock, [&] { return stopping_ || generation_ != seenGeneration; });
+            if (stopping_) return;
+            seenGeneration = generation_;
+        }
+
+        processChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--activeWorkers_ == 0) {
+                doneCondition_.notify_one();
+            }
+        }
+    }
+}
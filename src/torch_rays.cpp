@@ -0,0 +1,560 @@
+#include "torch_rays.hpp"
+#include "cpu_features.hpp"
+#include "torch_ray_kernel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#include "torch_ray_simd.hpp"
+#define PHY_TORCH_RAYS_SSE 1
+#endif
+
+void traceTorchRaysScalar(const TorchKernelArgs& args, int begin, int end) {
+    for (int ray = begin; ray < end; ++ray) {
+        float rayDirX = args.dirX[ray];
+        float rayDirY = args.dirY[ray];
+        float stepSize = args.stepSize[ray];
+        float currentX = args.originX;
+        float currentY = args.originY;
+
+        float* path = args.vertices + static_cast<std::size_t>(ray) * args.stride * 2;
+        int pointCount = 0;
+        path[pointCount * 2] = currentX;
+        path[pointCount * 2 + 1] = currentY;
+        ++pointCount;
+
+        // Previous direction for smoothing
+        float prevDirX = rayDirX;
+        float prevDirY = rayDirY;
+
+        for (int step = 0; step < args.bendSteps; ++step) {
+            float forceX = 0.0f;
+            float forceY = 0.0f;
+
+            // Distance-based influence factor (rays travel further before bending)
+            float distanceFactor = 1.0f - static_cast<float>(step) / args.bendSteps * 0.5f;
+
+            // Repulsion from the edges of nearby obstacles
+            for (std::size_t o = 0; o < args.obstacleCount; ++o) {
+                float obstacleLeft = args.left[o];
+                float obstacleRight = args.right[o];
+                float obstacleTop = args.top[o];
+                float obstacleBottom = args.bottom[o];
+
+                bool nearObstacle =
+                    currentX >= obstacleLeft - 1.0f && currentX <= obstacleRight + 1.0f &&
+                    currentY >= obstacleBottom - 1.0f && currentY <= obstacleTop + 1.0f;
+                if (!nearObstacle) continue;
+
+                float distToLeft = currentX - obstacleLeft;
+                float distToRight = obstacleRight - currentX;
+                float distToTop = obstacleTop - currentY;
+                float distToBottom = currentY - obstacleBottom;
+                float minDist = std::min({distToLeft, distToRight, distToTop, distToBottom});
+
+                if (minDist > 0.01f && minDist < 2.0f) {
+                    float repulsiveForce = 0.08f / (minDist * minDist + 0.1f) * distanceFactor;
+
+                    // Normal of the closest edge
+                    float normalX = 0.0f;
+                    float normalY = 0.0f;
+                    if (minDist == distToLeft) {
+                        normalX = -1.0f;
+                    } else if (minDist == distToRight) {
+                        normalX = 1.0f;
+                    } else if (minDist == distToTop) {
+                        normalY = 1.0f;
+                    } else if (minDist == distToBottom) {
+                        normalY = -1.0f;
+                    }
+
+                    forceX += normalX * repulsiveForce;
+                    forceY += normalY * repulsiveForce;
+
+                    // Extra push near corners for smoother bends
+                    const float cornerThreshold = 0.5f;
+                    bool nearTopLeft = (distToLeft < cornerThreshold && distToTop < cornerThreshold);
+                    bool nearTopRight = (distToRight < cornerThreshold && distToTop < cornerThreshold);
+                    bool nearBottomLeft = (distToLeft < cornerThreshold && distToBottom < cornerThreshold);
+                    bool nearBottomRight = (distToRight < cornerThreshold && distToBottom < cornerThreshold);
+
+                    if (nearTopLeft || nearTopRight || nearBottomLeft || nearBottomRight) {
+                        float cornerForce = 0.15f / (minDist * minDist + 0.05f) * distanceFactor;
+
+                        if (nearTopLeft) {
+                            forceX -= cornerForce * 0.7071f;
+                            forceY += cornerForce * 0.7071f;
+                        } else if (nearTopRight) {
+                            forceX += cornerForce * 0.7071f;
+                            forceY += cornerForce * 0.7071f;
+                        } else if (nearBottomLeft) {
+                            forceX -= cornerForce * 0.7071f;
+                            forceY -= cornerForce * 0.7071f;
+                        } else if (nearBottomRight) {
+                            forceX += cornerForce * 0.7071f;
+                            forceY -= cornerForce * 0.7071f;
+                        }
+                    }
+                }
+            }
+
+            // Bend the direction, smoothed against the previous one
+            float bendFactor = 0.25f;
+            rayDirX += forceX * bendFactor;
+            rayDirY += forceY * bendFactor;
+
+            float smoothFactor = 0.7f;
+            rayDirX = prevDirX * smoothFactor + rayDirX * (1.0f - smoothFactor);
+            rayDirY = prevDirY * smoothFactor + rayDirY * (1.0f - smoothFactor);
+            prevDirX = rayDirX;
+            prevDirY = rayDirY;
+
+            float dirLength = std::sqrt(rayDirX * rayDirX + rayDirY * rayDirY);
+            if (dirLength > 0.001f) {
+                rayDirX /= dirLength;
+                rayDirY /= dirLength;
+            }
+
+            float nextX = currentX + rayDirX * stepSize;
+            float nextY = currentY + rayDirY * stepSize;
+
+            // Stop the ray before it enters an obstacle
+            bool hitObstacle = false;
+            for (std::size_t o = 0; o < args.obstacleCount; ++o) {
+                if (nextX >= args.left[o] && nextX <= args.right[o] &&
+                    nextY >= args.bottom[o] && nextY <= args.top[o]) {
+                    hitObstacle = true;
+                    break;
+                }
+            }
+            if (hitObstacle) break;
+
+            currentX = nextX;
+            currentY = nextY;
+            path[pointCount * 2] = currentX;
+            path[pointCount * 2 + 1] = currentY;
+            ++pointCount;
+        }
+
+        args.pointCounts[ray] = pointCount;
+    }
+}
+
+namespace {
+    /**
+     * Bilinear lookup in the kernel's baked field
+     *
+     * The clamps are written as the SIMD min/max instructions evaluate
+     * them, so every backend reads the same values.
+     */
+    void sampleTorchField(const TorchKernelArgs& args, float x, float y,
+                          float& distance, float& forceX, float& forceY) {
+        float gridX = (x - args.fieldOriginX) * args.fieldInverseCellSize;
+        float gridY = (y - args.fieldOriginY) * args.fieldInverseCellSize;
+        gridX = gridX > 0.0f ? gridX : 0.0f;
+        gridY = gridY > 0.0f ? gridY : 0.0f;
+        const float maxGridX = static_cast<float>(args.fieldColumns - 1);
+        const float maxGridY = static_cast<float>(args.fieldRows - 1);
+        gridX = gridX < maxGridX ? gridX : maxGridX;
+        gridY = gridY < maxGridY ? gridY : maxGridY;
+
+        float cellX = static_cast<float>(static_cast<int>(gridX));
+        float cellY = static_cast<float>(static_cast<int>(gridY));
+        const float maxCellX = static_cast<float>(args.fieldColumns - 2);
+        const float maxCellY = static_cast<float>(args.fieldRows - 2);
+        cellX = cellX < maxCellX ? cellX : maxCellX;
+        cellY = cellY < maxCellY ? cellY : maxCellY;
+        const float tx = gridX - cellX;
+        const float ty = gridY - cellY;
+
+        const float* n00 = args.fieldNodes +
+            (static_cast<std::size_t>(cellY) * args.fieldColumns + static_cast<std::size_t>(cellX)) * 4;
+        const float* n10 = n00 + 4;
+        const float* n01 = n00 + static_cast<std::size_t>(args.fieldColumns) * 4;
+        const float* n11 = n01 + 4;
+
+        float values[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            float bottom = n00[channel] + (n10[channel] - n00[channel]) * tx;
+            float top = n01[channel] + (n11[channel] - n01[channel]) * tx;
+            values[channel] = bottom + (top - bottom) * ty;
+        }
+        distance = values[0];
+        forceX = values[1];
+        forceY = values[2];
+    }
+}
+
+void traceTorchRaysFieldScalar(const TorchKernelArgs& args, int begin, int end) {
+    for (int ray = begin; ray < end; ++ray) {
+        float rayDirX = args.dirX[ray];
+        float rayDirY = args.dirY[ray];
+        float stepSize = args.stepSize[ray];
+        float currentX = args.originX;
+        float currentY = args.originY;
+
+        float* path = args.vertices + static_cast<std::size_t>(ray) * args.stride * 2;
+        int pointCount = 0;
+        path[pointCount * 2] = currentX;
+        path[pointCount * 2 + 1] = currentY;
+        ++pointCount;
+
+        float prevDirX = rayDirX;
+        float prevDirY = rayDirY;
+
+        // Repulsion at the current point; each step's lookup at the next
+        // point provides the one for the step after it
+        float distance, fieldForceX, fieldForceY;
+        sampleTorchField(args, currentX, currentY, distance, fieldForceX, fieldForceY);
+
+        for (int step = 0; step < args.bendSteps; ++step) {
+            float distanceFactor = 1.0f - static_cast<float>(step) / args.bendSteps * 0.5f;
+            float forceX = fieldForceX * distanceFactor;
+            float forceY = fieldForceY * distanceFactor;
+
+            float bendFactor = 0.25f;
+            rayDirX += forceX * bendFactor;
+            rayDirY += forceY * bendFactor;
+
+            float smoothFactor = 0.7f;
+            rayDirX = prevDirX * smoothFactor + rayDirX * (1.0f - smoothFactor);
+            rayDirY = prevDirY * smoothFactor + rayDirY * (1.0f - smoothFactor);
+            prevDirX = rayDirX;
+            prevDirY = rayDirY;
+
+            float dirLength = std::sqrt(rayDirX * rayDirX + rayDirY * rayDirY);
+            if (dirLength > 0.001f) {
+                rayDirX /= dirLength;
+                rayDirY /= dirLength;
+            }
+
+            float nextX = currentX + rayDirX * stepSize;
+            float nextY = currentY + rayDirY * stepSize;
+
+            // A distance of zero or less is on or inside a wall
+            sampleTorchField(args, nextX, nextY, distance, fieldForceX, fieldForceY);
+            if (distance <= 0.0f) break;
+
+            currentX = nextX;
+            currentY = nextY;
+            path[pointCount * 2] = currentX;
+            path[pointCount * 2 + 1] = currentY;
+            ++pointCount;
+        }
+
+        args.pointCounts[ray] = pointCount;
+    }
+}
+
+#ifdef PHY_TORCH_RAYS_SSE
+
+namespace {
+    struct SseLanes {
+        using Vec = __m128;
+        static constexpr int kWidth = 4;
+
+        static Vec set1(float value) { return _mm_set1_ps(value); }
+        static Vec load(const float* source) { return _mm_loadu_ps(source); }
+        static void store(float* destination, Vec value) { _mm_store_ps(destination, value); }
+        static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+        static Vec sqrt(Vec a) { return _mm_sqrt_ps(a); }
+        static Vec min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+        static Vec truncate(Vec a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a)); }
+        static Vec gather(const float* base, Vec index) {
+            alignas(16) std::int32_t offsets[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets), _mm_cvttps_epi32(index));
+            return _mm_setr_ps(base[offsets[0]], base[offsets[1]], base[offsets[2]], base[offsets[3]]);
+        }
+        static Vec cmplt(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+        static Vec cmple(Vec a, Vec b) { return _mm_cmple_ps(a, b); }
+        static Vec cmpgt(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+        static Vec cmpge(Vec a, Vec b) { return _mm_cmpge_ps(a, b); }
+        static Vec cmpeq(Vec a, Vec b) { return _mm_cmpeq_ps(a, b); }
+        static Vec bitAnd(Vec a, Vec b) { return _mm_and_ps(a, b); }
+        static Vec bitOr(Vec a, Vec b) { return _mm_or_ps(a, b); }
+        static Vec bitAndNot(Vec a, Vec b) { return _mm_andnot_ps(a, b); }
+        static Vec select(Vec mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        static int movemask(Vec mask) { return _mm_movemask_ps(mask); }
+        static bool any(Vec mask) { return _mm_movemask_ps(mask) != 0; }
+    };
+}
+
+void traceTorchRaysSse(const TorchKernelArgs& args, int begin, int end) {
+    marchTorchRays<SseLanes>(args, begin, end);
+}
+
+void traceTorchRaysFieldSse(const TorchKernelArgs& args, int begin, int end) {
+    marchTorchRaysField<SseLanes>(args, begin, end);
+}
+
+bool torchRaysSseCompiled() {
+    return true;
+}
+
+#else
+
+void traceTorchRaysSse(const TorchKernelArgs& args, int begin, int end) {
+    traceTorchRaysScalar(args, begin, end);
+}
+
+void traceTorchRaysFieldSse(const TorchKernelArgs& args, int begin, int end) {
+    traceTorchRaysFieldScalar(args, begin, end);
+}
+
+bool torchRaysSseCompiled() {
+    return false;
+}
+
+#endif
+
+namespace {
+    // Ray steps times obstacles above which tracing is spread over a pool
+    constexpr std::size_t kParallelWork = std::size_t(1) << 17;
+}
+
+TorchRayTracer::TorchRayTracer() : backend_(Backend::Scalar), obstacleVersion_(0), fieldCellSize_(0.0f) {
+    if (isSupported(Backend::AVX2)) {
+        backend_ = Backend::AVX2;
+    } else if (isSupported(Backend::SSE)) {
+        backend_ = Backend::SSE;
+    }
+}
+
+bool TorchRayTracer::isSupported(Backend backend) {
+    switch (backend) {
+        case Backend::Scalar:
+            return true;
+        case Backend::SSE:
+            return torchRaysSseCompiled();
+        case Backend::AVX2:
+            return torchRaysAvx2Compiled() && cpuFeatures().avx2;
+    }
+    return false;
+}
+
+const char* TorchRayTracer::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Scalar: return "scalar";
+        case Backend::SSE: return "sse";
+        case Backend::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+void TorchRayTracer::setBackend(Backend backend) {
+    if (!isSupported(backend)) {
+        throw std::invalid_argument(std::string("Torch ray backend not supported: ") + backendName(backend));
+    }
+    backend_ = backend;
+}
+
+void TorchRayTracer::setObstacles(const Obstacle* obstacles, std::size_t count) {
+    ++obstacleVersion_;
+    obstacles_.assign(obstacles, obstacles + count);
+    grid_.build(obstacles_.data(), obstacles_.size());
+    if (fieldCellSize_ > 0.0f) {
+        field_.build(obstacles_.data(), obstacles_.size(),
+                     ObstacleField::fitCellSize(obstacles_.data(), obstacles_.size(), fieldCellSize_));
+    }
+
+    // Worst case: every obstacle is in reach of the torch
+    candidates_.reserve(count);
+    left_.reserve(count);
+    right_.reserve(count);
+    bottom_.reserve(count);
+    top_.reserve(count);
+}
+
+void TorchRayTracer::setFieldCellSize(float cellSize) {
+    if (!(cellSize >= 0.0f) || !std::isfinite(cellSize)) {
+        throw std::invalid_argument("Torch field cell size must not be negative");
+    }
+    if (cellSize > 0.0f) {
+        field_.build(obstacles_.data(), obstacles_.size(),
+                     ObstacleField::fitCellSize(obstacles_.data(), obstacles_.size(), cellSize));
+    } else {
+        field_.clear();
+    }
+    fieldCellSize_ = cellSize;
+    ++obstacleVersion_;
+}
+
+void TorchRayTracer::trace(float x, float y, float baseAngle, const TorchRayConfig& config,
+                           TorchRayPaths& paths, ThreadPool* pool) {
+    checkConfig(config);
+
+    // Rays spread evenly across the cone, edges included
+    const int rayCount = config.rayCount;
+    const int numRays = rayCount - 1;
+    angles_.resize(rayCount);
+    for (int i = 0; i < rayCount; ++i) {
+        float ratio = static_cast<float>(i) / numRays;
+        angles_[i] = baseAngle - config.coneAngle/2.0f + config.coneAngle * ratio;
+    }
+    traceFan(x, y, angles_.data(), config, paths, pool);
+}
+
+void TorchRayTracer::checkConfig(const TorchRayConfig& config) {
+    if (config.rayCount < 2 || config.bendSteps < 1) {
+        throw std::invalid_argument("Torch needs at least two rays and one bend step");
+    }
+}
+
+void TorchRayTracer::traceFan(float x, float y, const float* angles, const TorchRayConfig& config,
+                              TorchRayPaths& paths, ThreadPool* pool) {
+    const int count = config.rayCount;
+    const int bendSteps = config.bendSteps;
+    const int numRays = count - 1;
+    paths.resize(count, bendSteps);
+
+    // Initial direction and step length of each ray, padded for full-width SIMD loads
+    const std::size_t padded = (count + kTorchMaxLanes - 1) / kTorchMaxLanes * kTorchMaxLanes;
+    dirX_.resize(padded);
+    dirY_.resize(padded);
+    stepSize_.resize(padded);
+    float maxRayLength = 0.0f;
+    for (int k = 0; k < count; ++k) {
+        float ratio = static_cast<float>(k) / numRays;
+        dirX_[k] = std::cos(angles[k]);
+        dirY_[k] = std::sin(angles[k]);
+
+        float rayLength = config.length * (0.85f + 0.3f * std::sin(ratio * M_PI));
+        stepSize_[k] = rayLength / bendSteps;
+        maxRayLength = std::max(maxRayLength, stepSize_[k] * bendSteps);
+    }
+    std::fill(dirX_.begin() + count, dirX_.end(), dirX_[count - 1]);
+    std::fill(dirY_.begin() + count, dirY_.end(), dirY_[count - 1]);
+    std::fill(stepSize_.begin() + count, stepSize_.end(), stepSize_[count - 1]);
+
+    // Rays never leave a disc of maxRayLength around the torch, and only
+    // obstacles within 1 unit of a ray point push it. Candidates are kept
+    // in index order so forces are summed in the same order as before culling.
+    // A baked field already holds every obstacle's push.
+    const bool useField = !field_.empty();
+    candidates_.clear();
+    if (!useField) {
+        const float reach = maxRayLength * 1.01f + 1.0f + 0.01f;
+        grid_.visitCandidates(x - reach, y - reach, x + reach, y + reach, [&](std::uint32_t index) {
+            candidates_.push_back(index);
+            return false;
+        });
+        std::sort(candidates_.begin(), candidates_.end());
+    }
+
+    left_.resize(candidates_.size());
+    right_.resize(candidates_.size());
+    bottom_.resize(candidates_.size());
+    top_.resize(candidates_.size());
+    for (std::size_t k = 0; k < candidates_.size(); ++k) {
+        const Obstacle& obstacle = obstacles_[candidates_[k]];
+        left_[k] = obstacle.x - obstacle.width/2;
+        right_[k] = obstacle.x + obstacle.width/2;
+        bottom_[k] = obstacle.y - obstacle.height/2;
+        top_[k] = obstacle.y + obstacle.height/2;
+    }
+
+    TorchKernelArgs args;
+    args.left = left_.data();
+    args.right = right_.data();
+    args.bottom = bottom_.data();
+    args.top = top_.data();
+    args.obstacleCount = candidates_.size();
+    args.dirX = dirX_.data();
+    args.dirY = dirY_.data();
+    args.stepSize = stepSize_.data();
+    args.originX = x;
+    args.originY = y;
+    args.bendSteps = bendSteps;
+    args.fieldNodes = field_.nodes();
+    args.fieldOriginX = field_.getOriginX();
+    args.fieldOriginY = field_.getOriginY();
+    args.fieldInverseCellSize = field_.getInverseCellSize();
+    args.fieldColumns = field_.getColumns();
+    args.fieldRows = field_.getRows();
+    args.vertices = paths.vertices.data();
+    args.pointCounts = paths.pointCounts.data();
+    args.stride = paths.stride;
+
+    void (*kernel)(const TorchKernelArgs&, int, int) = useField ? traceTorchRaysFieldScalar : traceTorchRaysScalar;
+    if (backend_ == Backend::SSE) kernel = useField ? traceTorchRaysFieldSse : traceTorchRaysSse;
+    if (backend_ == Backend::AVX2) kernel = useField ? traceTorchRaysFieldAvx2 : traceTorchRaysAvx2;
+
+    // Waking the workers costs tens of microseconds, more than a small
+    // fan takes to trace, so only large fields are split across threads
+    const std::size_t work = static_cast<std::size_t>(count) * bendSteps * std::max<std::size_t>(1, candidates_.size());
+    if (pool && pool->threadCount() > 1 && work >= kParallelWork) {
+        // Hand out whole SIMD blocks of rays; rays are independent
+        const std::size_t blockCount = padded / kTorchMaxLanes;
+        pool->parallelFor(blockCount, [&](std::size_t first, std::size_t last) {
+            kernel(args, static_cast<int>(first * kTorchMaxLanes),
+                   std::min(count, static_cast<int>(last * kTorchMaxLanes)));
+        }, 1);
+    } else {
+        kernel(args, 0, count);
+    }
+}
+
+namespace {
+    bool sameFanShape(const TorchRayConfig& a, const TorchRayConfig& b) {
+        return a.rayCount == b.rayCount && a.bendSteps == b.bendSteps &&
+               a.coneAngle == b.coneAngle && a.length == b.length;
+    }
+}
+
+TorchRayCache::TorchRayCache(float positionQuantum, float angleQuantum)
+    : positionQuantum_(0.0f), angleQuantum_(0.0f), valid_(false), tracer_(nullptr),
+      obstacleVersion_(0), originX_(0.0f), originY_(0.0f), baseAngle_(0.0f) {
+    setQuantization(positionQuantum, angleQuantum);
+}
+
+void TorchRayCache::setQuantization(float positionQuantum, float angleQuantum) {
+    if (!(positionQuantum >= 0.0f) || !(angleQuantum >= 0.0f)) {
+        throw std::invalid_argument("Torch cache quanta must not be negative");
+    }
+    positionQuantum_ = positionQuantum;
+    angleQuantum_ = angleQuantum;
+    valid_ = false;
+}
+
+float TorchRayCache::snap(float value, float quantum) const {
+    if (quantum == 0.0f) return value;
+    return static_cast<float>(std::round(static_cast<double>(value) / quantum) * quantum);
+}
+
+const TorchRayPaths& TorchRayCache::trace(TorchRayTracer& tracer, float x, float y, float baseAngle,
+                                          const TorchRayConfig& config, ThreadPool* pool) {
+    // Snap the pose as a whole; the fan is traced from the snapped values,
+    // so a hit returns exactly what tracing them again would
+    const float originX = snap(x, positionQuantum_);
+    const float originY = snap(y, positionQuantum_);
+    const float angle = snap(baseAngle, angleQuantum_);
+
+    const std::size_t rayCount = config.rayCount > 0 ? static_cast<std::size_t>(config.rayCount) : 0;
+    if (valid_ && tracer_ == &tracer && obstacleVersion_ == tracer.getObstacleVersion() &&
+        originX == originX_ && originY == originY_ && angle == baseAngle_ && sameFanShape(config, config_)) {
+        ++stats_.hits;
+        stats_.raysReused += rayCount;
+        return paths_;
+    }
+
+    // Left invalid if tracing throws
+    valid_ = false;
+    tracer.trace(originX, originY, angle, config, paths_, pool);
+    ++stats_.misses;
+    stats_.raysTraced += rayCount;
+    valid_ = true;
+    tracer_ = &tracer;
+    obstacleVersion_ = tracer.getObstacleVersion();
+    originX_ = originX;
+    originY_ = originY;
+    baseAngle_ = angle;
+    config_ = config;
+    return paths_;
+}
@@ -0,0 +1,67 @@
+#include "torch_ray_kernel.hpp"
+
+// Built with -mavx2 -ffp-contract=off (see CMakeLists.txt); only called
+// after a runtime CPU check
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include "torch_ray_simd.hpp"
+
+namespace {
+    struct Avx2Lanes {
+        using Vec = __m256;
+        static constexpr int kWidth = 8;
+
+        static Vec set1(float value) { return _mm256_set1_ps(value); }
+        static Vec load(const float* source) { return _mm256_loadu_ps(source); }
+        static void store(float* destination, Vec value) { _mm256_store_ps(destination, value); }
+        static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+        static Vec sqrt(Vec a) { return _mm256_sqrt_ps(a); }
+        static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+        static Vec truncate(Vec a) { return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+        static Vec gather(const float* base, Vec index) { return _mm256_i32gather_ps(base, _mm256_cvttps_epi32(index), 4); }
+        static Vec cmplt(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Vec cmple(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static Vec cmpgt(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static Vec cmpge(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static Vec cmpeq(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static Vec bitAnd(Vec a, Vec b) { return _mm256_and_ps(a, b); }
+        static Vec bitOr(Vec a, Vec b) { return _mm256_or_ps(a, b); }
+        static Vec bitAndNot(Vec a, Vec b) { return _mm256_andnot_ps(a, b); }
+        static Vec select(Vec mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+        static int movemask(Vec mask) { return _mm256_movemask_ps(mask); }
+        static bool any(Vec mask) { return _mm256_movemask_ps(mask) != 0; }
+    };
+}
+
+void traceTorchRaysAvx2(const TorchKernelArgs& args, int begin, int end) {
+    marchTorchRays<Avx2Lanes>(args, begin, end);
+}
+
+void traceTorchRaysFieldAvx2(const TorchKernelArgs& args, int begin, int end) {
+    marchTorchRaysField<Avx2Lanes>(args, begin, end);
+}
+
+bool torchRaysAvx2Compiled() {
+    return true;
+}
+
+#else
+
+void traceTorchRaysAvx2(const TorchKernelArgs& args, int begin, int end) {
+    traceTorchRaysScalar(args, begin, end);
+}
+
+void traceTorchRaysFieldAvx2(const TorchKernelArgs& args, int begin, int end) {
+    traceTorchRaysFieldScalar(args, begin, end);
+}
+
+bool torchRaysAvx2Compiled() {
+    return false;
+}
+
+#endif
@@ -0,0 +1,486 @@
+#include "trajectory.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "binary_file.hpp"
+
+namespace {
+    const char kFileMagic[8] = {'P', 'H', 'Y', 'T', 'R', 'A', 'J', '\0'};
+    const char kIndexMagic[8] = {'P', 'H', 'Y', 'T', 'I', 'D', 'X', '\0'};
+    constexpr std::uint32_t kChunkMagic = 0x4B4E4843;  // "CHNK"
+    constexpr std::uint32_t kTrajectoryVersion = 1;
+
+    // On-disk structures (little-endian, written as they are in memory)
+    struct FileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::uint64_t particleCount;
+        double quantum;
+        std::uint32_t framesPerChunk;
+        std::uint32_t reserved0;
+        std::uint64_t reserved[3];
+    };
+    static_assert(sizeof(FileHeader) == 64, "Trajectory header layout changed");
+
+    struct ChunkHeader {
+        std::uint32_t magic;
+        std::uint32_t frameCount;
+        std::uint64_t firstFrame;
+        std::uint64_t payloadBytes;
+    };
+    static_assert(sizeof(ChunkHeader) == 24, "Trajectory chunk header layout changed");
+
+    struct IndexEntry {
+        std::uint64_t offset;
+        std::uint64_t firstFrame;
+        std::uint32_t frameCount;
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(IndexEntry) == 24, "Trajectory index layout changed");
+
+    struct Footer {
+        std::uint64_t indexOffset;
+        std::uint64_t chunkCount;
+        std::uint64_t frameCount;
+        char magic[8];
+    };
+    static_assert(sizeof(Footer) == 32, "Trajectory footer layout changed");
+
+    bool seekTo(std::FILE* file, std::uint64_t offset) {
+#if defined(_WIN32)
+        return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    std::uint64_t fileSize(std::FILE* file) {
+#if defined(_WIN32)
+        _fseeki64(file, 0, SEEK_END);
+        return static_cast<std::uint64_t>(_ftelli64(file));
+#else
+        fseeko(file, 0, SEEK_END);
+        return static_cast<std::uint64_t>(ftello(file));
+#endif
+    }
+
+    bool readBytes(std::FILE* file, void* data, std::size_t bytes) {
+        return std::fread(data, 1, bytes, file) == bytes;
+    }
+
+    constexpr std::size_t kMaxVarintBytes = 10;
+
+    // Writes to a buffer with room for kMaxVarintBytes; returns the end
+    std::uint8_t* putVarint(std::uint8_t* out, std::uint64_t value) {
+        while (value >= 0x80) {
+            *out++ = static_cast<std::uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<std::uint8_t>(value);
+        return out;
+    }
+
+    std::uint64_t getVarint(const std::vector<std::uint8_t>& in, std::size_t& cursor) {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (cursor >= in.size()) {
+                throw std::runtime_error("Trajectory chunk is truncated");
+            }
+            std::uint8_t byte = in[cursor++];
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        throw std::runtime_error("Trajectory chunk is corrupt");
+    }
+
+    // Signed deltas map to small unsigned values: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+    std::uint64_t zigzag(std::int64_t value) {
+        return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+    }
+
+    std::int64_t unzigzag(std::uint64_t value) {
+        return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+    }
+
+    std::int64_t doubleBits(double value) {
+        std::int64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double bitsDouble(std::int64_t bits) {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& path, std::size_t particleCount,
+                                   const TrajectoryOptions& options)
+    : file_(nullptr),
+      path_(path),
+      particleCount_(particleCount),
+      options_(options),
+      framesRecorded_(0),
+      previousStep_(0),
+      chunkBytes_(0),
+      chunkFrames_(0),
+      chunkFirstFrame_(0),
+      framesWritten_(0),
+      filePosition_(0),
+      encodedBytes_(0),
+      stopping_(false),
+      closed_(false) {
+    if (!hostIsLittleEndian()) {
+        throw std::runtime_error("Trajectories are little-endian and this host is not");
+    }
+    if (options.quantum < 0.0 || !std::isfinite(options.quantum)) {
+        throw std::invalid_argument("Trajectory quantum must be zero or positive");
+    }
+    if (options.framesPerChunk == 0 || options.queueDepth == 0) {
+        throw std::invalid_argument("Trajectory chunk size and queue depth must be positive");
+    }
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        throw std::runtime_error("Failed to create trajectory: " + path);
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+    header.version = kTrajectoryVersion;
+    header.headerSize = sizeof(FileHeader);
+    header.particleCount = particleCount;
+    header.quantum = options.quantum;
+    header.framesPerChunk = options.framesPerChunk;
+    try {
+        writeBytes(file_, &header, sizeof(header), "trajectory", path_);
+    } catch (...) {
+        std::fclose(file_);
+        throw;
+    }
+    filePosition_ = sizeof(header);
+
+    // All buffers are allocated up front; recording never allocates
+    frames_.resize(options.queueDepth);
+    for (std::size_t i = 0; i < frames_.size(); ++i) {
+        frames_[i].positions.resize(particleCount);
+        freeFrames_.push_back(i);
+    }
+    previous_.resize(particleCount * 3);
+
+    thread_ = std::thread(&TrajectoryWriter::threadLoop, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    try {
+        close();
+    } catch (...) {
+        // Destructors must not throw; close() reports errors to callers who ask
+    }
+}
+
+void TrajectoryWriter::throwIfFailed() {
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void TrajectoryWriter::record(const Vector3D* positions, std::uint64_t step) {
+    std::size_t slot;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_) {
+            throw std::logic_error("Trajectory is closed");
+        }
+        condition_.wait(lock, [this] { return !freeFrames_.empty() || error_; });
+        throwIfFailed();
+        slot = freeFrames_.front();
+        freeFrames_.pop_front();
+    }
+
+    Frame& frame = frames_[slot];
+    std::memcpy(frame.positions.data(), positions, particleCount_ * sizeof(Vector3D));
+    frame.step = step;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queuedFrames_.push_back(slot);
+    }
+    condition_.notify_all();
+    ++framesRecorded_;
+}
+
+void TrajectoryWriter::record(const ParticleStore& particles, std::uint64_t step) {
+    if (particles.size() != particleCount_) {
+        throw std::invalid_argument("Particle count differs from the trajectory's");
+    }
+    record(particles.positions(), step);
+}
+
+void TrajectoryWriter::threadLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        condition_.wait(lock, [this] { return !queuedFrames_.empty() || stopping_; });
+        if (queuedFrames_.empty()) return;  // Stopping with nothing left to write
+
+        std::size_t slot = queuedFrames_.front();
+        queuedFrames_.pop_front();
+        bool failed = error_ != nullptr;
+        lock.unlock();
+
+        // After an error frames are dropped, but buffers keep cycling so record() never hangs
+        std::exception_ptr error;
+        if (!failed) {
+            try {
+                encodeFrame(frames_[slot]);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        lock.lock();
+        if (error) error_ = error;
+        freeFrames_.push_back(slot);
+        condition_.notify_all();
+    }
+}
+
+void TrajectoryWriter::encodeFrame(const Frame& frame) {
+    if (chunkFrames_ == 0) {
+        // Keyframe: deltas against zero, so the chunk decodes on its own
+        std::fill(previous_.begin(), previous_.end(), 0);
+        previousStep_ = 0;
+        chunkFirstFrame_ = framesWritten_;
+    }
+
+    // Size the buffer for the worst case up front, then trim to what was written
+    const std::size_t valueCount = particleCount_ * 3;
+    const std::size_t needed = chunkBytes_ + (valueCount + 1) * kMaxVarintBytes;
+    if (chunk_.size() < needed) {
+        chunk_.resize(std::max(needed, chunk_.size() * 2));
+    }
+    std::uint8_t* start = chunk_.data() + chunkBytes_;
+    std::uint8_t* out = start;
+
+    out = putVarint(out, zigzag(static_cast<std::int64_t>(frame.step - previousStep_)));
+    previousStep_ = frame.step;
+
+    const double* values = &frame.positions.data()->x;
+    std::int64_t* previous = previous_.data();
+    if (options_.quantum > 0.0) {
+        const double scale = 1.0 / options_.quantum;
+        for (std::size_t i = 0; i < valueCount; ++i) {
+            double scaled = values[i] * scale;
+            if (!(std::fabs(scaled) < 4.0e18)) {
+                throw std::range_error("Position is too large (or not finite) for the trajectory quantum");
+            }
+            std::int64_t quantized = std::llrint(scaled);
+            out = putVarint(out, zigzag(quantized - previous[i]));
+            previous[i] = quantized;
+        }
+    } else {
+        for (std::size_t i = 0; i < valueCount; ++i) {
+            std::int64_t bits = doubleBits(values[i]);
+            out = putVarint(out, static_cast<std::uint64_t>(bits ^ previous[i]));
+            previous[i] = bits;
+        }
+    }
+    chunkBytes_ += static_cast<std::size_t>(out - start);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        encodedBytes_ += static_cast<std::uint64_t>(out - start);
+    }
+    ++chunkFrames_;
+    ++framesWritten_;
+    if (chunkFrames_ == options_.framesPerChunk) {
+        flushChunk();
+    }
+}
+
+void TrajectoryWriter::flushChunk() {
+    if (chunkFrames_ == 0) return;
+
+    ChunkHeader header{kChunkMagic, chunkFrames_, chunkFirstFrame_, chunkBytes_};
+    writeBytes(file_, &header, sizeof(header), "trajectory", path_);
+    writeBytes(file_, chunk_.data(), chunkBytes_, "trajectory", path_);
+    index_.push_back(ChunkEntry{filePosition_, chunkFirstFrame_, chunkFrames_, 0});
+    filePosition_ += sizeof(header) + chunkBytes_;
+    chunkBytes_ = 0;
+    chunkFrames_ = 0;
+}
+
+void TrajectoryWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) return;
+        closed_ = true;
+        stopping_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+
+    try {
+        throwIfFailed();
+        flushChunk();
+
+        // Chunk index and footer, so readers can seek without scanning
+        Footer footer{filePosition_, index_.size(), framesWritten_, {}};
+        std::memcpy(footer.magic, kIndexMagic, sizeof(kIndexMagic));
+        for (const ChunkEntry& entry : index_) {
+            IndexEntry out{entry.offset, entry.firstFrame, entry.frameCount, 0};
+            writeBytes(file_, &out, sizeof(out), "trajectory", path_);
+        }
+        writeBytes(file_, &footer, sizeof(footer), "trajectory", path_);
+    } catch (...) {
+        std::fclose(file_);
+        file_ = nullptr;
+        throw;
+    }
+    if (std::fclose(file_) != 0) {
+        file_ = nullptr;
+        throw std::runtime_error("Failed to write trajectory: " + path_);
+    }
+    file_ = nullptr;
+}
+
+std::uint64_t TrajectoryWriter::getEncodedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return encodedBytes_;
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& path)
+    : file_(nullptr),
+      path_(path),
+      particleCount_(0),
+      quantum_(0.0),
+      frameCount_(0),
+      loadedChunk_(0),
+      nextFrame_(0),
+      cursor_(0),
+      lastStep_(0) {
+    if (!hostIsLittleEndian()) {
+        throw std::runtime_error("Trajectories are little-endian and this host is not");
+    }
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_) {
+        throw std::runtime_error("Failed to open trajectory: " + path);
+    }
+
+    try {
+        FileHeader header;
+        if (!readBytes(file_, &header, sizeof(header)) ||
+            std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0) {
+            throw std::runtime_error("Not a trajectory file: " + path);
+        }
+        if (header.version != kTrajectoryVersion || header.headerSize != sizeof(FileHeader)) {
+            throw std::runtime_error("Unsupported trajectory version: " + path);
+        }
+        particleCount_ = static_cast<std::size_t>(header.particleCount);
+        quantum_ = header.quantum;
+        previous_.resize(particleCount_ * 3);
+
+        // Use the index when the writer was closed; otherwise walk the chunk headers
+        const std::uint64_t size = fileSize(file_);
+        Footer footer;
+        bool indexed = size >= sizeof(FileHeader) + sizeof(Footer) &&
+                       seekTo(file_, size - sizeof(Footer)) && readBytes(file_, &footer, sizeof(footer)) &&
+                       std::memcmp(footer.magic, kIndexMagic, sizeof(kIndexMagic)) == 0 &&
+                       footer.indexOffset + footer.chunkCount * sizeof(IndexEntry) + sizeof(Footer) == size;
+        if (indexed) {
+            seekTo(file_, footer.indexOffset);
+            for (std::uint64_t i = 0; i < footer.chunkCount; ++i) {
+                IndexEntry entry;
+                if (!readBytes(file_, &entry, sizeof(entry))) {
+                    throw std::runtime_error("Trajectory index is truncated: " + path);
+                }
+                chunks_.push_back(Chunk{entry.offset, entry.firstFrame, entry.frameCount});
+            }
+            frameCount_ = footer.frameCount;
+        } else {
+            std::uint64_t offset = sizeof(FileHeader);
+            ChunkHeader chunk;
+            while (seekTo(file_, offset) && readBytes(file_, &chunk, sizeof(chunk)) &&
+                   chunk.magic == kChunkMagic && offset + sizeof(chunk) + chunk.payloadBytes <= size) {
+                chunks_.push_back(Chunk{offset, chunk.firstFrame, chunk.frameCount});
+                frameCount_ = chunk.firstFrame + chunk.frameCount;
+                offset += sizeof(chunk) + chunk.payloadBytes;
+            }
+        }
+    } catch (...) {
+        std::fclose(file_);
+        throw;
+    }
+    loadedChunk_ = chunks_.size();  // Nothing loaded yet
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    if (file_) std::fclose(file_);
+}
+
+void TrajectoryReader::loadChunk(std::size_t chunk) {
+    ChunkHeader header;
+    if (!seekTo(file_, chunks_[chunk].offset) || !readBytes(file_, &header, sizeof(header)) ||
+        header.magic != kChunkMagic) {
+        throw std::runtime_error("Trajectory chunk is corrupt: " + path_);
+    }
+    payload_.resize(static_cast<std::size_t>(header.payloadBytes));
+    if (!readBytes(file_, payload_.data(), payload_.size())) {
+        throw std::runtime_error("Trajectory chunk is truncated: " + path_);
+    }
+    loadedChunk_ = chunk;
+    nextFrame_ = chunks_[chunk].firstFrame;
+    cursor_ = 0;
+    std::fill(previous_.begin(), previous_.end(), 0);
+    lastStep_ = 0;
+}
+
+std::uint64_t TrajectoryReader::decodeNextFrame() {
+    lastStep_ += static_cast<std::uint64_t>(unzigzag(getVarint(payload_, cursor_)));
+    if (quantum_ > 0.0) {
+        for (std::int64_t& value : previous_) {
+            value += unzigzag(getVarint(payload_, cursor_));
+        }
+    } else {
+        for (std::int64_t& value : previous_) {
+            value ^= static_cast<std::int64_t>(getVarint(payload_, cursor_));
+        }
+    }
+    ++nextFrame_;
+    return lastStep_;
+}
+
+std::uint64_t TrajectoryReader::readFrame(std::uint64_t frame, std::vector<Vector3D>& positions) {
+    if (frame >= frameCount_) {
+        throw std::out_of_range("Trajectory frame out of range");
+    }
+
+    // Find the chunk holding the frame (chunks are in frame order)
+    std::size_t low = 0;
+    std::size_t high = chunks_.size();
+    while (high - low > 1) {
+        std::size_t middle = (low + high) / 2;
+        if (chunks_[middle].firstFrame <= frame) low = middle; else high = middle;
+    }
+
+    // Restart from the keyframe unless we can decode forward from where we are
+    if (loadedChunk_ != low || nextFrame_ > frame) {
+        loadChunk(low);
+    }
+    std::uint64_t step = lastStep_;
+    while (nextFrame_ <= frame) {
+        step = decodeNextFrame();
+    }
+
+    positions.resize(particleCount_);
+    double* values = &positions.data()->x;
+    for (std::size_t i = 0; i < previous_.size(); ++i) {
+        values[i] = quantum_ > 0.0 ? static_cast<double>(previous_[i]) * quantum_ : bitsDouble(previous_[i]);
+    }
+    return step;
+}
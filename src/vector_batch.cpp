@@ -0,0 +1,218 @@
+#include "vector_batch.hpp"
+#include "cpu_features.hpp"
+#include "vector_batch_kernel.hpp"
+#include "vector_batch_simd.hpp"
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHY_VECTOR_BATCH_SSE2 1
+#endif
+
+namespace {
+    // One vector per "register": the portable reference
+    struct ScalarLanes {
+        using Vec = double;
+        static constexpr int kWidth = 1;
+
+        static Vec set1(double value) { return value; }
+        static Vec load(const double* source) { return *source; }
+        static void store(double* destination, Vec value) { *destination = value; }
+        static Vec add(Vec a, Vec b) { return a + b; }
+        static Vec sub(Vec a, Vec b) { return a - b; }
+        static Vec mul(Vec a, Vec b) { return a * b; }
+        static Vec div(Vec a, Vec b) { return a / b; }
+        static Vec sqrt(Vec a) { return std::sqrt(a); }
+        // Same operand rules as the SSE/AVX min and max instructions
+        static Vec min(Vec a, Vec b) { return a < b ? a : b; }
+        static Vec max(Vec a, Vec b) { return a > b ? a : b; }
+        static Vec positiveOr0(Vec test, Vec a) { return test > 0.0 ? a : 0.0; }
+        static void spread(Vec s, Vec* out) { out[0] = out[1] = out[2] = s; }
+        static void loadComponents(const double* p, Vec& x, Vec& y, Vec& z) {
+            x = p[0];
+            y = p[1];
+            z = p[2];
+        }
+        static void gatherComponents(const double* p, const std::uint32_t* indices, Vec& x, Vec& y, Vec& z) {
+            loadComponents(p + std::size_t(3) * indices[0], x, y, z);
+        }
+    };
+
+#ifdef PHY_VECTOR_BATCH_SSE2
+    struct Sse2Lanes {
+        using Vec = __m128d;
+        static constexpr int kWidth = 2;
+
+        static Vec set1(double value) { return _mm_set1_pd(value); }
+        static Vec load(const double* source) { return _mm_loadu_pd(source); }
+        static void store(double* destination, Vec value) { _mm_storeu_pd(destination, value); }
+        static Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+        static Vec sqrt(Vec a) { return _mm_sqrt_pd(a); }
+        static Vec min(Vec a, Vec b) { return _mm_min_pd(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm_max_pd(a, b); }
+        static Vec positiveOr0(Vec test, Vec a) { return _mm_and_pd(_mm_cmpgt_pd(test, _mm_setzero_pd()), a); }
+        // (s0 s0) (s0 s1) (s1 s1)
+        static void spread(Vec s, Vec* out) {
+            out[0] = _mm_unpacklo_pd(s, s);
+            out[1] = s;
+            out[2] = _mm_unpackhi_pd(s, s);
+        }
+        // (x0 y0) (z0 x1) (y1 z1) -> (x0 x1) (y0 y1) (z0 z1)
+        static void loadComponents(const double* p, Vec& x, Vec& y, Vec& z) {
+            Vec a = _mm_loadu_pd(p);
+            Vec b = _mm_loadu_pd(p + 2);
+            Vec c = _mm_loadu_pd(p + 4);
+            x = _mm_shuffle_pd(a, b, 2);
+            y = _mm_shuffle_pd(a, c, 1);
+            z = _mm_shuffle_pd(b, c, 2);
+        }
+        static void gatherComponents(const double* p, const std::uint32_t* indices, Vec& x, Vec& y, Vec& z) {
+            const double* a = p + std::size_t(3) * indices[0];
+            const double* b = p + std::size_t(3) * indices[1];
+            x = _mm_setr_pd(a[0], b[0]);
+            y = _mm_setr_pd(a[1], b[1]);
+            z = _mm_setr_pd(a[2], b[2]);
+        }
+    };
+#endif
+
+    const VectorBatchKernels* kernelsFor(VectorBatch::Backend backend) {
+        switch (backend) {
+            case VectorBatch::Backend::Scalar: return vectorBatchKernelsScalar();
+            case VectorBatch::Backend::SSE2: return vectorBatchKernelsSse2();
+            case VectorBatch::Backend::AVX2: return vectorBatchKernelsAvx2();
+            case VectorBatch::Backend::AVX512: return vectorBatchKernelsAvx512();
+        }
+        return nullptr;
+    }
+
+    /**
+     * The backend in use, chosen on first use from the CPU's features
+     */
+    struct ActiveBackend {
+        std::atomic<VectorBatch::Backend> backend;
+        std::atomic<const VectorBatchKernels*> kernels;
+
+        ActiveBackend()
+            : backend(VectorBatch::bestBackend()), kernels(kernelsFor(backend.load())) {}
+    };
+
+    ActiveBackend& activeBackend() {
+        static ActiveBackend active;
+        return active;
+    }
+
+    const VectorBatchKernels& kernels() {
+        return *activeBackend().kernels.load(std::memory_order_relaxed);
+    }
+
+    // Vector3D is standard layout, so a vector's address is that of its x
+    double* components(Vector3D* v) { return reinterpret_cast<double*>(v); }
+    const double* components(const Vector3D* v) { return reinterpret_cast<const double*>(v); }
+}
+
+const VectorBatchKernels* vectorBatchKernelsScalar() {
+    static const VectorBatchKernels kernels = VectorBatchSimd<ScalarLanes>::table();
+    return &kernels;
+}
+
+#ifdef PHY_VECTOR_BATCH_SSE2
+const VectorBatchKernels* vectorBatchKernelsSse2() {
+    static const VectorBatchKernels kernels = VectorBatchSimd<Sse2Lanes>::table();
+    return &kernels;
+}
+#else
+const VectorBatchKernels* vectorBatchKernelsSse2() {
+    return nullptr;
+}
+#endif
+
+void VectorBatch::setBackend(Backend backend) {
+    if (!isSupported(backend)) {
+        throw std::invalid_argument(std::string("Vector batch backend not supported: ") + backendName(backend));
+    }
+    ActiveBackend& active = activeBackend();
+    active.kernels.store(kernelsFor(backend), std::memory_order_relaxed);
+    active.backend.store(backend, std::memory_order_relaxed);
+}
+
+VectorBatch::Backend VectorBatch::getBackend() {
+    return activeBackend().backend.load(std::memory_order_relaxed);
+}
+
+VectorBatch::Backend VectorBatch::bestBackend() {
+    for (Backend backend : {Backend::AVX512, Backend::AVX2, Backend::SSE2}) {
+        if (isSupported(backend)) return backend;
+    }
+    return Backend::Scalar;
+}
+
+bool VectorBatch::isSupported(Backend backend) {
+    if (kernelsFor(backend) == nullptr) return false;
+    switch (backend) {
+        case Backend::Scalar: return true;
+        case Backend::SSE2: return cpuFeatures().sse2;
+        case Backend::AVX2: return cpuFeatures().avx2;
+        case Backend::AVX512: return cpuFeatures().avx512f;
+    }
+    return false;
+}
+
+const char* VectorBatch::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Scalar: return "scalar";
+        case Backend::SSE2: return "sse2";
+        case Backend::AVX2: return "avx2";
+        case Backend::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+bool VectorBatch::parseBackend(const std::string& name, Backend& backend) {
+    for (Backend candidate : {Backend::Scalar, Backend::SSE2, Backend::AVX2, Backend::AVX512}) {
+        if (name == backendName(candidate)) {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void VectorBatch::axpy(Vector3D* y, const Vector3D* x, double a, std::size_t count) {
+    kernels().axpy(components(y), components(x), a, count);
+}
+
+void VectorBatch::scaledAdd(Vector3D* y, const Vector3D* x, const double* scales, double a, std::size_t count) {
+    kernels().scaledAdd(components(y), components(x), scales, a, count);
+}
+
+void VectorBatch::kickDrift(Vector3D* x, Vector3D* v, const Vector3D* f, const double* scales, double kick,
+                            double drift, std::size_t count) {
+    kernels().kickDrift(components(x), components(v), components(f), scales, kick, drift, count);
+}
+
+void VectorBatch::lengths(double* out, const Vector3D* v, std::size_t count) {
+    kernels().lengths(out, components(v), count);
+}
+
+void VectorBatch::normalize(Vector3D* v, std::size_t count) {
+    kernels().normalize(components(v), count);
+}
+
+void VectorBatch::clampToBox(Vector3D* v, const Vector3D& low, const Vector3D& high, std::size_t count) {
+    kernels().clampToBox(components(v), components(&low), components(&high), count);
+}
+
+void VectorBatch::distances(double* out, const Vector3D* a, const Vector3D* b, std::size_t count) {
+    kernels().distances(out, components(a), components(b), count);
+}
+
+void VectorBatch::pairDistancesSquared(double* out, const Vector3D* points, const std::uint32_t* first,
+                                       const std::uint32_t* second, std::size_t count) {
+    kernels().pairDistancesSquared(out, components(points), first, second, count);
+}
@@ -0,0 +1,74 @@
+#include "vector_batch_kernel.hpp"
+
+// Built with -mavx2 -ffp-contract=off (see CMakeLists.txt); only called
+// after a runtime CPU check
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include "vector_batch_simd.hpp"
+
+namespace {
+    struct Avx2Lanes {
+        using Vec = __m256d;
+        static constexpr int kWidth = 4;
+
+        static Vec set1(double value) { return _mm256_set1_pd(value); }
+        static Vec load(const double* source) { return _mm256_loadu_pd(source); }
+        static void store(double* destination, Vec value) { _mm256_storeu_pd(destination, value); }
+        static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+        static Vec sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+        static Vec min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+        static Vec positiveOr0(Vec test, Vec a) {
+            return _mm256_and_pd(_mm256_cmp_pd(test, _mm256_setzero_pd(), _CMP_GT_OQ), a);
+        }
+        // (s0 s0 s0 s1) (s1 s1 s2 s2) (s2 s3 s3 s3)
+        static void spread(Vec s, Vec* out) {
+            out[0] = _mm256_permute4x64_pd(s, 0x40);
+            out[1] = _mm256_permute4x64_pd(s, 0xA5);
+            out[2] = _mm256_permute4x64_pd(s, 0xFE);
+        }
+        // (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3) -> (x0 x1 x2 x3) (y0 y1 y2 y3) (z0 z1 z2 z3)
+        static void loadComponents(const double* p, Vec& x, Vec& y, Vec& z) {
+            Vec a = _mm256_loadu_pd(p);
+            Vec b = _mm256_loadu_pd(p + 4);
+            Vec c = _mm256_loadu_pd(p + 8);
+            Vec xy = _mm256_blend_pd(a, b, 0xC);             // x0 y0 x2 y2
+            Vec zx = _mm256_permute2f128_pd(a, c, 0x21);     // z0 x1 z2 x3
+            Vec yz = _mm256_blend_pd(b, c, 0xC);             // y1 z1 y3 z3
+            x = _mm256_blend_pd(xy, zx, 0xA);
+            y = _mm256_shuffle_pd(xy, yz, 0x5);
+            z = _mm256_blend_pd(zx, yz, 0xA);
+        }
+        // Four scattered vectors; two 128-bit loads each beat a hardware gather
+        static void gatherComponents(const double* p, const std::uint32_t* indices, Vec& x, Vec& y, Vec& z) {
+            const double* v0 = p + std::size_t(3) * indices[0];
+            const double* v1 = p + std::size_t(3) * indices[1];
+            const double* v2 = p + std::size_t(3) * indices[2];
+            const double* v3 = p + std::size_t(3) * indices[3];
+            Vec xy02 = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(v0)), _mm_loadu_pd(v2), 1);
+            Vec xy13 = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(v1)), _mm_loadu_pd(v3), 1);
+            x = _mm256_unpacklo_pd(xy02, xy13);
+            y = _mm256_unpackhi_pd(xy02, xy13);
+            __m128d z01 = _mm_unpacklo_pd(_mm_load_sd(v0 + 2), _mm_load_sd(v1 + 2));
+            __m128d z23 = _mm_unpacklo_pd(_mm_load_sd(v2 + 2), _mm_load_sd(v3 + 2));
+            z = _mm256_insertf128_pd(_mm256_castpd128_pd256(z01), z23, 1);
+        }
+    };
+}
+
+const VectorBatchKernels* vectorBatchKernelsAvx2() {
+    static const VectorBatchKernels kernels = VectorBatchSimd<Avx2Lanes>::table();
+    return &kernels;
+}
+
+#else
+
+const VectorBatchKernels* vectorBatchKernelsAvx2() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "vector_batch_kernel.hpp"
+
+// Built with -mavx512f -ffp-contract=off (see CMakeLists.txt); only called
+// after a runtime CPU check
+
+#if defined(__AVX512F__)
+// GCC 12's AVX-512 intrinsics start from _mm512_undefined_*() and trip
+// -Wmaybe-uninitialized once inlined; the values are fully overwritten
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#include "vector_batch_simd.hpp"
+
+namespace {
+    // Lane sources of spread(): lane i of the scalars covers components 3i..3i+2
+    alignas(64) const long long kSpreadIndices[3][8] = {
+        {0, 0, 0, 1, 1, 1, 2, 2},
+        {2, 3, 3, 3, 4, 4, 4, 5},
+        {5, 5, 6, 6, 6, 7, 7, 7},
+    };
+    // Deinterleave: each component first from (a, b), then its last lanes from c
+    alignas(64) const long long kComponentsFromAB[3][8] = {
+        {0, 3, 6, 9, 12, 15, 0, 0},
+        {1, 4, 7, 10, 13, 0, 0, 0},
+        {2, 5, 8, 11, 14, 0, 0, 0},
+    };
+    alignas(64) const long long kComponentsFromC[3][8] = {
+        {0, 1, 2, 3, 4, 5, 10, 13},
+        {0, 1, 2, 3, 4, 8, 11, 14},
+        {0, 1, 2, 3, 4, 9, 12, 15},
+    };
+
+    struct Avx512Lanes {
+        using Vec = __m512d;
+        static constexpr int kWidth = 8;
+
+        static Vec set1(double value) { return _mm512_set1_pd(value); }
+        static Vec load(const double* source) { return _mm512_loadu_pd(source); }
+        static void store(double* destination, Vec value) { _mm512_storeu_pd(destination, value); }
+        static Vec add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+        static Vec div(Vec a, Vec b) { return _mm512_div_pd(a, b); }
+        static Vec sqrt(Vec a) { return _mm512_sqrt_pd(a); }
+        static Vec min(Vec a, Vec b) { return _mm512_min_pd(a, b); }
+        static Vec max(Vec a, Vec b) { return _mm512_max_pd(a, b); }
+        static Vec positiveOr0(Vec test, Vec a) {
+            return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(test, _mm512_setzero_pd(), _CMP_GT_OQ), a);
+        }
+        static void spread(Vec s, Vec* out) {
+            for (int r = 0; r < 3; ++r) {
+                out[r] = _mm512_permutexvar_pd(_mm512_load_si512(kSpreadIndices[r]), s);
+            }
+        }
+        static void loadComponents(const double* p, Vec& x, Vec& y, Vec& z) {
+            Vec a = _mm512_loadu_pd(p);
+            Vec b = _mm512_loadu_pd(p + 8);
+            Vec c = _mm512_loadu_pd(p + 16);
+            Vec* components[3] = {&x, &y, &z};
+            for (int r = 0; r < 3; ++r) {
+                Vec ab = _mm512_permutex2var_pd(a, _mm512_load_si512(kComponentsFromAB[r]), b);
+                *components[r] = _mm512_permutex2var_pd(ab, _mm512_load_si512(kComponentsFromC[r]), c);
+            }
+        }
+        // Eight scattered vectors; two 128-bit loads each beat a hardware gather
+        static void gatherComponents(const double* p, const std::uint32_t* indices, Vec& x, Vec& y, Vec& z) {
+            __m256d halves[2][3];
+            for (int h = 0; h < 2; ++h) {
+                const double* v0 = p + std::size_t(3) * indices[4 * h];
+                const double* v1 = p + std::size_t(3) * indices[4 * h + 1];
+                const double* v2 = p + std::size_t(3) * indices[4 * h + 2];
+                const double* v3 = p + std::size_t(3) * indices[4 * h + 3];
+                __m256d xy02 = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(v0)), _mm_loadu_pd(v2), 1);
+                __m256d xy13 = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(v1)), _mm_loadu_pd(v3), 1);
+                halves[h][0] = _mm256_unpacklo_pd(xy02, xy13);
+                halves[h][1] = _mm256_unpackhi_pd(xy02, xy13);
+                __m128d z01 = _mm_unpacklo_pd(_mm_load_sd(v0 + 2), _mm_load_sd(v1 + 2));
+                __m128d z23 = _mm_unpacklo_pd(_mm_load_sd(v2 + 2), _mm_load_sd(v3 + 2));
+                halves[h][2] = _mm256_insertf128_pd(_mm256_castpd128_pd256(z01), z23, 1);
+            }
+            x = _mm512_insertf64x4(_mm512_castpd256_pd512(halves[0][0]), halves[1][0], 1);
+            y = _mm512_insertf64x4(_mm512_castpd256_pd512(halves[0][1]), halves[1][1], 1);
+            z = _mm512_insertf64x4(_mm512_castpd256_pd512(halves[0][2]), halves[1][2], 1);
+        }
+    };
+}
+
+const VectorBatchKernels* vectorBatchKernelsAvx512() {
+    static const VectorBatchKernels kernels = VectorBatchSimd<Avx512Lanes>::table();
+    return &kernels;
+}
+
+#else
+
+const VectorBatchKernels* vectorBatchKernelsAvx512() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "obstacle.hpp"
+#include "thread_pool.hpp"
+#include "torch_rays.hpp"
+#include "torch_test_obstacles.hpp"
+#include <atomic>
+#include <vector>
+#include <cstdlib>
+#include <new>
+
+// Replacing global operator new affects every test in the binary, so the
+// allocation checks live in their own executable
+
+// Count heap allocations so tests can check that hot paths do not allocate
+namespace {
+    std::atomic<std::size_t> allocationCount{0};
+}
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+// GCC pairs the replaced operators with each other, but still flags the free()
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+// Test that torch ray tracing reuses its buffers across frames
+TEST(TorchRayTest, SteadyStateFramesDoNotAllocate) {
+    std::vector<Obstacle> obstacles = makeTorchObstacles(5, 60, 4.0f);
+    TorchRayConfig config;
+    config.length = 3.0f;
+    config.rayCount = 301;
+    ThreadPool pool(4);
+
+    TorchRayTracer tracer;
+    tracer.setObstacles(obstacles.data(), obstacles.size());
+    TorchRayPaths paths;
+
+    // The first frame sizes the path buffers
+    tracer.trace(0.0f, 0.0f, 0.0f, config, paths, &pool);
+
+    std::size_t before = allocationCount.load();
+    for (int frame = 0; frame < 50; ++frame) {
+        float x = 0.05f * frame - 1.0f;
+        tracer.trace(x, 0.0f, 0.13f * frame, config, paths, (frame % 2) ? &pool : nullptr);
+    }
+    EXPECT_EQ(allocationCount.load(), before);
+
+    // A smaller fan fits in the same storage
+    config.rayCount = 81;
+    tracer.trace(0.0f, 0.0f, 0.0f, config, paths);
+    EXPECT_EQ(allocationCount.load(), before);
+}
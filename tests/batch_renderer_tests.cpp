@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include "batch_renderer.hpp"
+#include "geometry_batch.hpp"
+#include <GLFW/glfw3.h>
+#include <stdexcept>
+
+// BatchRenderer against a real GL context. The context comes from a hidden
+// GLFW window; without a display (or with a GL older than 1.5) the tests
+// are skipped rather than failed.
+namespace {
+    class BatchRendererTest : public ::testing::Test {
+    protected:
+        static constexpr int kSize = 32;
+
+        void SetUp() override {
+            if (!glfwInit()) GTEST_SKIP() << "No display for a GL context";
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            window_ = glfwCreateWindow(kSize, kSize, "batch_renderer_tests", nullptr, nullptr);
+            if (!window_) GTEST_SKIP() << "Could not create a GL context";
+            glfwMakeContextCurrent(window_);
+            if (glewInit() != GLEW_OK || !GLEW_VERSION_1_5) GTEST_SKIP() << "GL 1.5 not available";
+
+            glViewport(0, 0, kSize, kSize);
+            glDisable(GL_DEPTH_TEST);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        void TearDown() override {
+            if (window_) glfwDestroyWindow(window_);
+            glfwTerminate();
+        }
+
+        // Colour of the pixel at the centre of the back buffer
+        BatchColor centerPixel() {
+            float pixel[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            glFinish();
+            glReadBuffer(GL_BACK);
+            glReadPixels(kSize / 2, kSize / 2, 1, 1, GL_RGBA, GL_FLOAT, pixel);
+            return BatchColor{pixel[0], pixel[1], pixel[2], pixel[3]};
+        }
+
+        // A quad covering the whole viewport under the identity matrices
+        static GeometryBatch fullScreen(const BatchColor& color) {
+            GeometryBatch batch;
+            batch.addRectangle(0.0f, 0.0f, 2.0f, 2.0f, 0.0f, color);
+            return batch;
+        }
+
+        GLFWwindow* window_ = nullptr;
+    };
+}
+
+TEST_F(BatchRendererTest, OneDrawCallPerCommand) {
+    BatchRenderer renderer;
+    renderer.initialize();
+    ASSERT_TRUE(renderer.isInitialized());
+
+    // Triangles, thin lines and thick lines: three runs
+    GeometryBatch batch = fullScreen(BatchColor{1.0f, 0.0f, 0.0f, 1.0f});
+    BatchVertex a{-0.5f, 0.0f, 0.0f, {0.0f, 1.0f, 0.0f, 1.0f}};
+    BatchVertex b{0.5f, 0.0f, 0.0f, {0.0f, 1.0f, 0.0f, 1.0f}};
+    batch.addLine(a, b);
+    batch.addLine(a, b);
+    batch.addLine(a, b, 3.0f);
+    ASSERT_EQ(batch.getCommands().size(), 3u);
+
+    renderer.beginFrame();
+    renderer.drawDynamic(batch);
+    EXPECT_EQ(renderer.getDrawCallCount(), 3u);
+    EXPECT_EQ(renderer.getStreamedBytes(), batch.getVertices().size() * sizeof(BatchVertex));
+
+    // Static meshes count their runs too but stream nothing
+    std::size_t mesh = renderer.uploadStatic(batch);
+    renderer.beginFrame();
+    renderer.drawStatic(mesh);
+    EXPECT_EQ(renderer.getDrawCallCount(), 3u);
+    EXPECT_EQ(renderer.getStreamedBytes(), 0u);
+
+    // Empty batches issue nothing
+    renderer.beginFrame();
+    renderer.drawDynamic(GeometryBatch());
+    EXPECT_EQ(renderer.getDrawCallCount(), 0u);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(BatchRendererTest, RingGrowsAndWrapsWithoutLosingGeometry) {
+    BatchRenderer renderer;
+    // Room for one quad; the circle below does not fit
+    renderer.initialize(6 * sizeof(BatchVertex));
+
+    GeometryBatch circle;
+    circle.addCircle(0.0f, 0.0f, 0.0f, 2.0f, 32, BatchColor{0.0f, 0.0f, 1.0f, 1.0f}, BatchColor{0.0f, 0.0f, 1.0f, 1.0f});
+    ASSERT_GT(circle.getVertices().size() * sizeof(BatchVertex), 6 * sizeof(BatchVertex));
+
+    renderer.beginFrame();
+    renderer.drawDynamic(circle);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+    BatchColor grown = centerPixel();
+    EXPECT_FLOAT_EQ(grown.b, 1.0f);
+    EXPECT_FLOAT_EQ(grown.r, 0.0f);
+
+    // Enough full-screen quads to wrap the grown ring a few times; the
+    // last one drawn must be the one on screen
+    const BatchColor colors[] = {
+        {1.0f, 0.0f, 0.0f, 1.0f},
+        {0.0f, 1.0f, 0.0f, 1.0f},
+        {1.0f, 1.0f, 0.0f, 1.0f},
+    };
+    for (int frame = 0; frame < 100; ++frame) {
+        renderer.beginFrame();
+        const BatchColor& color = colors[frame % 3];
+        renderer.drawDynamic(fullScreen(color));
+        EXPECT_EQ(renderer.getDrawCallCount(), 1u);
+
+        BatchColor pixel = centerPixel();
+        EXPECT_FLOAT_EQ(pixel.r, color.r) << "frame " << frame;
+        EXPECT_FLOAT_EQ(pixel.g, color.g) << "frame " << frame;
+        EXPECT_FLOAT_EQ(pixel.b, color.b) << "frame " << frame;
+    }
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
+
+TEST_F(BatchRendererTest, UpdatedStaticMeshDrawsNewGeometry) {
+    BatchRenderer renderer;
+    renderer.initialize();
+
+    std::size_t mesh = renderer.uploadStatic(fullScreen(BatchColor{1.0f, 0.0f, 0.0f, 1.0f}));
+    renderer.drawStatic(mesh);
+    EXPECT_FLOAT_EQ(centerPixel().r, 1.0f);
+
+    renderer.updateStatic(mesh, fullScreen(BatchColor{0.0f, 1.0f, 0.0f, 1.0f}));
+    renderer.drawStatic(mesh);
+    BatchColor pixel = centerPixel();
+    EXPECT_FLOAT_EQ(pixel.r, 0.0f);
+    EXPECT_FLOAT_EQ(pixel.g, 1.0f);
+
+    EXPECT_THROW(renderer.drawStatic(mesh + 1), std::out_of_range);
+    EXPECT_EQ(glGetError(), static_cast<GLenum>(GL_NO_ERROR));
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "obstacle.hpp"
+#include "obstacle_grid.hpp"
+
+// Microbenchmark: circle-vs-obstacle queries with a linear scan and with
+// the uniform grid, at increasing map sizes. Obstacle density is kept
+// constant, so the grid's per-query cost should stay flat while the scan
+// grows linearly.
+
+namespace {
+
+struct Query {
+    float x, y;
+};
+
+// Same test GLVisualizer::checkObstacleCollision used before the grid
+bool linearCollision(const std::vector<Obstacle>& obstacles, float x, float y, float radius) {
+    for (const auto& obstacle : obstacles) {
+        if (obstacle.intersectsCircle(x, y, radius)) return true;
+    }
+    return false;
+}
+
+bool gridCollision(const ObstacleGrid& grid, const std::vector<Obstacle>& obstacles, float x, float y, float radius) {
+    return grid.visitCandidates(x - radius, y - radius, x + radius, y + radius, [&](std::uint32_t index) {
+        return obstacles[index].intersectsCircle(x, y, radius);
+    });
+}
+
+template <typename Fn>
+double nanosecondsPerQuery(const std::vector<Query>& queries, int repeats, Fn&& fn, int& hits) {
+    auto start = std::chrono::steady_clock::now();
+    hits = 0;
+    for (int r = 0; r < repeats; ++r) {
+        for (const Query& query : queries) {
+            hits += fn(query.x, query.y) ? 1 : 0;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double total = std::chrono::duration<double, std::nano>(end - start).count();
+    return total / (static_cast<double>(queries.size()) * repeats);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int queryCount = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const float radius = 0.15f; // Player radius in GLVisualizer
+
+    std::printf("%10s %14s %14s %10s\n", "obstacles", "linear ns/q", "grid ns/q", "speedup");
+    for (std::size_t count : {std::size_t(20), std::size_t(1000), std::size_t(100000)}) {
+        // About as dense as the built-in map: ~19 walls over a 13 x 10 area
+        float halfExtent = 0.5f * std::sqrt(static_cast<float>(count) * 130.0f / 19.0f);
+        std::mt19937 gen(1234);
+        std::uniform_real_distribution<float> position(-halfExtent, halfExtent);
+        std::uniform_real_distribution<float> length(0.5f, 4.0f);
+        std::bernoulli_distribution horizontal(0.5);
+
+        std::vector<Obstacle> obstacles;
+        obstacles.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            float wallLength = length(gen);
+            bool isHorizontal = horizontal(gen);
+            obstacles.emplace_back(position(gen), position(gen),
+                                   isHorizontal ? wallLength : 0.2f, isHorizontal ? 0.2f : wallLength);
+        }
+
+        ObstacleGrid grid;
+        grid.build(obstacles.data(), obstacles.size());
+
+        std::vector<Query> queries(queryCount);
+        for (Query& query : queries) {
+            query.x = position(gen);
+            query.y = position(gen);
+        }
+
+        // Keep total work roughly constant across sizes
+        int linearRepeats = std::max<int>(1, static_cast<int>(2000 / count));
+        int linearHits = 0, gridHits = 0;
+        double linearNs = nanosecondsPerQuery(queries, linearRepeats, [&](float x, float y) {
+            return linearCollision(obstacles, x, y, radius);
+        }, linearHits);
+        double gridNs = nanosecondsPerQuery(queries, linearRepeats, [&](float x, float y) {
+            return gridCollision(grid, obstacles, x, y, radius);
+        }, gridHits);
+
+        if (linearHits != gridHits) {
+            std::fprintf(stderr, "Mismatch at %zu obstacles: linear %d hits, grid %d hits\n",
+                         count, linearHits, gridHits);
+            return 1;
+        }
+
+        std::printf("%10zu %14.1f %14.1f %9.1fx\n", count, linearNs, gridNs, linearNs / gridNs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,396 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "integrator.hpp"
+#include "particle.hpp"
+#include "particle_collision.hpp"
+#include "particle_store.hpp"
+#include "scene.hpp"
+#include "simulation.hpp"
+#include "torch_rays.hpp"
+#include "vector3d.hpp"
+#include "vector_batch.hpp"
+
+// Throughput benchmarks for the vector type, the particle handle and
+// Simulation::step. Items are particles (or vectors) processed; bytes are
+// the particle data a step sweeps through, so bytes/sec can be compared
+// with memory bandwidth.
+//
+// Save a run with --benchmark_out=run.json --benchmark_out_format=json and
+// compare two runs with tools/compare_bench.py.
+
+namespace {
+
+std::vector<Vector3D> randomVectors(std::size_t count, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> value(-10.0, 10.0);
+    std::vector<Vector3D> vectors(count);
+    for (Vector3D& v : vectors) {
+        v = Vector3D(value(rng), value(rng), value(rng));
+    }
+    return vectors;
+}
+
+void setVectorCounters(benchmark::State& state, std::size_t count, std::size_t bytesPerItem) {
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * count * bytesPerItem));
+}
+
+// x += v * dt, the core of every integrator
+void BM_Vector3DScaledAdd(benchmark::State& state) {
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::vector<Vector3D> positions = randomVectors(count, 1);
+    const std::vector<Vector3D> velocities = randomVectors(count, 2);
+    const double dt = 1e-3;
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            positions[i] += velocities[i] * dt;
+        }
+        benchmark::DoNotOptimize(positions.data());
+        benchmark::ClobberMemory();
+    }
+    setVectorCounters(state, count, 3 * sizeof(Vector3D));
+}
+BENCHMARK(BM_Vector3DScaledAdd)->RangeMultiplier(10)->Range(1000, 1000000);
+
+void BM_Vector3DNormalize(benchmark::State& state) {
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    const std::vector<Vector3D> input = randomVectors(count, 3);
+    std::vector<Vector3D> output(count);
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            output[i] = input[i].normalize();
+        }
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setVectorCounters(state, count, 2 * sizeof(Vector3D));
+}
+BENCHMARK(BM_Vector3DNormalize)->RangeMultiplier(10)->Range(1000, 1000000);
+
+void BM_Vector3DDistance(benchmark::State& state) {
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    const std::vector<Vector3D> a = randomVectors(count, 4);
+    const std::vector<Vector3D> b = randomVectors(count, 5);
+
+    for (auto _ : state) {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += Vector3D::distance(a[i], b[i]);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    setVectorCounters(state, count, 2 * sizeof(Vector3D));
+}
+BENCHMARK(BM_Vector3DDistance)->RangeMultiplier(10)->Range(1000, 1000000);
+
+void BM_Vector3DCrossDot(benchmark::State& state) {
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    const std::vector<Vector3D> a = randomVectors(count, 6);
+    const std::vector<Vector3D> b = randomVectors(count, 7);
+
+    for (auto _ : state) {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += a[i].cross(b[i]).dot(a[i]);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    setVectorCounters(state, count, 2 * sizeof(Vector3D));
+}
+BENCHMARK(BM_Vector3DCrossDot)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// Layout comparison: the same kernels over packed and padded vectors, float and double
+template <typename V>
+std::vector<V> randomVectorsAs(std::size_t count, unsigned int seed) {
+    const std::vector<Vector3D> source = randomVectors(count, seed);
+    return std::vector<V>(source.begin(), source.end());
+}
+
+// The semi-implicit Euler sweep of Simulation::step: v += f / m * dt, x += v * dt
+template <typename V>
+void BM_VectorLayoutStep(benchmark::State& state) {
+    using T = typename V::value_type;
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::vector<V> positions = randomVectorsAs<V>(count, 1);
+    std::vector<V> velocities = randomVectorsAs<V>(count, 2);
+    const std::vector<V> forces = randomVectorsAs<V>(count, 3);
+    const std::vector<T> inverseMasses(count, T(0.5));
+    const T dt = T(1e-3);
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            velocities[i].addScaled(forces[i], inverseMasses[i] * dt);
+            positions[i].addScaled(velocities[i], dt);
+        }
+        benchmark::DoNotOptimize(positions.data());
+        benchmark::ClobberMemory();
+    }
+    setVectorCounters(state, count, 3 * sizeof(V) + sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_VectorLayoutStep, Vector3D)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK_TEMPLATE(BM_VectorLayoutStep, Vector3PaddedD)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK_TEMPLATE(BM_VectorLayoutStep, Vector3F)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK_TEMPLATE(BM_VectorLayoutStep, Vector3PaddedF)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// Torch-style ray march: advance, then bend the direction toward a pull and renormalize
+template <typename V>
+void BM_VectorLayoutTorch(benchmark::State& state) {
+    using T = typename V::value_type;
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    const std::vector<V> directions = randomVectorsAs<V>(count, 4);
+    const std::vector<V> pulls = randomVectorsAs<V>(count, 5);
+    std::vector<V> ends(count);
+    const int steps = 16;
+    const T stepSize = T(0.05);
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            V point;
+            V direction = directions[i].normalize();
+            for (int step = 0; step < steps; ++step) {
+                point.addScaled(direction, stepSize);
+                direction = (direction * T(0.7) + (pulls[i] - point) * T(0.3)).normalize();
+            }
+            ends[i] = point;
+        }
+        benchmark::DoNotOptimize(ends.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count * steps));
+}
+BENCHMARK_TEMPLATE(BM_VectorLayoutTorch, Vector3D)->Arg(10000);
+BENCHMARK_TEMPLATE(BM_VectorLayoutTorch, Vector3PaddedD)->Arg(10000);
+BENCHMARK_TEMPLATE(BM_VectorLayoutTorch, Vector3F)->Arg(10000);
+BENCHMARK_TEMPLATE(BM_VectorLayoutTorch, Vector3PaddedF)->Arg(10000);
+
+// Batch kernels, by backend. Args: kernel, backend, vector count
+const VectorBatch::Backend kBatchBackends[] = {VectorBatch::Backend::Scalar, VectorBatch::Backend::SSE2,
+                                               VectorBatch::Backend::AVX2, VectorBatch::Backend::AVX512};
+const char* const kBatchKernels[] = {"scaledAdd", "axpy", "normalize", "distances", "pairs", "kickDrift",
+                                     "scaledAdd+axpy"};
+
+void BM_VectorBatch(benchmark::State& state) {
+    const int kernel = static_cast<int>(state.range(0));
+    const VectorBatch::Backend backend = kBatchBackends[state.range(1)];
+    const std::size_t count = static_cast<std::size_t>(state.range(2));
+    std::vector<Vector3D> a = randomVectors(count, 1);
+    const std::vector<Vector3D> b = randomVectors(count, 2);
+    std::vector<Vector3D> c = randomVectors(count, 4);
+    const std::vector<double> scales(count, 0.5);
+    std::vector<double> out(count);
+    std::vector<std::uint32_t> first(count), second(count);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<std::uint32_t> index(0, static_cast<std::uint32_t>(count - 1));
+    for (std::size_t k = 0; k < count; ++k) {
+        first[k] = index(rng);
+        second[k] = index(rng);
+    }
+
+    const VectorBatch::Backend original = VectorBatch::getBackend();
+    VectorBatch::setBackend(backend);
+    for (auto _ : state) {
+        switch (kernel) {
+            case 0: VectorBatch::scaledAdd(a.data(), b.data(), scales.data(), 1e-3, count); break;
+            case 1: VectorBatch::axpy(a.data(), b.data(), 1e-3, count); break;
+            case 2: VectorBatch::normalize(a.data(), count); break;
+            case 3: VectorBatch::distances(out.data(), a.data(), b.data(), count); break;
+            case 4: VectorBatch::pairDistancesSquared(out.data(), b.data(), first.data(), second.data(), count); break;
+            case 5: VectorBatch::kickDrift(a.data(), c.data(), b.data(), scales.data(), 1e-3, 1e-3, count); break;
+            case 6:  // The same update unfused, for comparison with kickDrift
+                VectorBatch::scaledAdd(c.data(), b.data(), scales.data(), 1e-3, count);
+                VectorBatch::axpy(a.data(), c.data(), 1e-3, count);
+                break;
+        }
+        benchmark::DoNotOptimize(a.data());
+        benchmark::DoNotOptimize(c.data());
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    VectorBatch::setBackend(original);
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count));
+    state.SetLabel(std::string(kBatchKernels[kernel]) + "/" + VectorBatch::backendName(backend));
+}
+
+void vectorBatchArgs(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"kernel", "backend", "vectors"});
+    for (std::int64_t kernel = 0; kernel < 7; ++kernel) {
+        for (std::int64_t backend = 0; backend < 4; ++backend) {
+            if (!VectorBatch::isSupported(kBatchBackends[backend])) continue;
+            for (std::int64_t count : {1000, 100000}) {
+                benchmark->Args({kernel, backend, count});
+            }
+        }
+    }
+}
+BENCHMARK(BM_VectorBatch)->Apply(vectorBatchArgs);
+
+// Torch fan traced against the obstacles or a baked field.
+// Args: obstacles scattered around the torch, field cell size in 1/1000 units (0 for exact)
+void BM_TorchRays(benchmark::State& state) {
+    const int count = static_cast<int>(state.range(0));
+    const float cellSize = state.range(1) / 1000.0f;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+    std::uniform_real_distribution<float> size(0.1f, 0.6f);
+    std::vector<Obstacle> obstacles;
+    while (static_cast<int>(obstacles.size()) < count) {
+        Obstacle obstacle(position(rng), position(rng), size(rng), size(rng));
+        if (!obstacle.intersectsCircle(0.0f, 0.0f, 0.3f)) obstacles.push_back(obstacle);
+    }
+
+    TorchRayTracer tracer;
+    tracer.setFieldCellSize(cellSize);
+    tracer.setObstacles(obstacles.data(), obstacles.size());
+    TorchRayConfig config;
+    config.length = 3.0f;
+    TorchRayPaths paths;
+    float angle = 0.0f;
+    for (auto _ : state) {
+        tracer.trace(0.0f, 0.0f, angle, config, paths);
+        angle += 0.01f;
+        benchmark::DoNotOptimize(paths.vertices.data());
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * config.rayCount));
+}
+BENCHMARK(BM_TorchRays)->ArgNames({"obstacles", "cell"})->ArgsProduct({{20, 200, 2000}, {0, 25}})
+    ->Unit(benchmark::kMicrosecond);
+
+// One Euler update per particle through the Particle handle API
+void BM_ParticleHandleUpdate(benchmark::State& state) {
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    const std::vector<Vector3D> positions = randomVectors(count, 8);
+    ParticleStore store;
+    store.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        store.add(1.0, positions[i], Vector3D(0, 0, 0));
+    }
+    const Vector3D force(0.0, -9.81, 0.0);
+    const double dt = 1e-3;
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            Particle particle(store, i);
+            particle.applyForce(force);
+            particle.updateVelocity(dt);
+            particle.updatePosition(dt);
+            particle.resetForces();
+        }
+        benchmark::DoNotOptimize(store.positions());
+        benchmark::ClobberMemory();
+    }
+    setVectorCounters(state, count, 3 * sizeof(Vector3D) + sizeof(double));
+}
+BENCHMARK(BM_ParticleHandleUpdate)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// Force sets, each built by a scene
+const Scene kForceScenes[] = {Scene::Cloud, Scene::Cloth, Scene::Galaxy};
+const char* const kForceNames[] = {"uniform", "springs", "nbody"};
+const Integrator kIntegrators[] = {Integrator::SemiImplicitEuler, Integrator::VelocityVerlet,
+                                   Integrator::Leapfrog, Integrator::RK4};
+
+// Args: particle count, integrator, force set, thread count
+void BM_SimulationStep(benchmark::State& state) {
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    const Integrator integrator = kIntegrators[state.range(1)];
+    const int forceSet = static_cast<int>(state.range(2));
+    const std::size_t threads = static_cast<std::size_t>(state.range(3));
+
+    Simulation simulation;
+    simulation.setThreadCount(threads);
+    simulation.setIntegrator(integrator);
+    loadScene(simulation, kForceScenes[forceSet], count, 1);
+    const std::size_t particles = simulation.getParticles().size();
+
+    // First step outside the timing: fills Verlet's force cache and sizes scratch arrays
+    simulation.step(1e-3);
+    for (auto _ : state) {
+        simulation.step(1e-3);
+    }
+
+    // Positions, velocities and forces plus both mass arrays
+    const std::size_t bytesPerParticle = 3 * sizeof(Vector3D) + 2 * sizeof(double);
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * particles));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * particles * bytesPerParticle));
+    state.SetLabel(std::string(integratorName(integrator)) + "/" + kForceNames[forceSet]);
+}
+
+void simulationStepArgs(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"particles", "integrator", "forces", "threads"});
+    for (std::int64_t count : {1000, 10000, 100000}) {
+        for (std::int64_t integrator = 0; integrator < 4; ++integrator) {
+            for (std::int64_t forceSet = 0; forceSet < 3; ++forceSet) {
+                // Pairwise gravity is O(N log N) with a large constant; keep it short
+                if (forceSet == 2 && count > 10000) continue;
+                for (std::int64_t threads : {1, 4}) {
+                    benchmark->Args({count, integrator, forceSet, threads});
+                }
+            }
+        }
+    }
+}
+BENCHMARK(BM_SimulationStep)->Apply(simulationStepArgs)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Args: particle count. A flat gas of discs covering about 30% of a square box
+void BM_ParticleCollisions(benchmark::State& state) {
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    const double radius = 0.05;
+    const double side = std::sqrt(count * M_PI * radius * radius / 0.3);
+    const double dt = 1e-3;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> position(radius, side - radius);
+    std::uniform_real_distribution<double> velocity(-1.0, 1.0);
+    std::vector<Vector3D> positions(count);
+    std::vector<Vector3D> velocities(count);
+    std::vector<double> inverseMasses(count, 1.0);
+    for (std::size_t i = 0; i < count; ++i) {
+        positions[i] = Vector3D(position(rng), position(rng), 0.0);
+        velocities[i] = Vector3D(velocity(rng), velocity(rng), 0.0);
+    }
+    ParticleCollider collider;
+    collider.setEnabled(true);
+    collider.setRadius(radius);
+
+    // Drift and bounce off the box walls, then collide; only the collision is timed
+    auto advance = [&]() {
+        for (std::size_t i = 0; i < count; ++i) {
+            positions[i] += velocities[i] * dt;
+            if (positions[i].x < 0.0 || positions[i].x > side) velocities[i].x = -velocities[i].x;
+            if (positions[i].y < 0.0 || positions[i].y > side) velocities[i].y = -velocities[i].y;
+        }
+    };
+
+    // The first calls sort from scratch and separate the initial overlaps
+    for (int i = 0; i < 10; ++i) {
+        advance();
+        collider.resolve(positions.data(), velocities.data(), inverseMasses.data(), count);
+    }
+    double overlaps = 0.0;
+    double pairs = 0.0;
+    double contacts = 0.0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        advance();
+        state.ResumeTiming();
+        collider.resolve(positions.data(), velocities.data(), inverseMasses.data(), count);
+        overlaps += collider.getStats().sweepOverlaps;
+        pairs += collider.getStats().pairsTested;
+        contacts += collider.getStats().contacts;
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count));
+    state.counters["overlaps"] = benchmark::Counter(overlaps, benchmark::Counter::kAvgIterations);
+    state.counters["pairs"] = benchmark::Counter(pairs, benchmark::Counter::kAvgIterations);
+    state.counters["contacts"] = benchmark::Counter(contacts, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ParticleCollisions)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -1,7 +1,38 @@
 #include <gtest/gtest.h>
 #include "vector3d.hpp"
 #include "particle.hpp"
+#include "player_controller.hpp"
+#include "profiler.hpp"
+#include "scene.hpp"
 #include "simulation.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
+#include "fixed_timestep.hpp"
+#include "force_generators.hpp"
+#include "game_map.hpp"
+#include "geometry_batch.hpp"
+#include "gravity_solver.hpp"
+#include "collision.hpp"
+#include "integrator.hpp"
+#include "obstacle.hpp"
+#include "obstacle_field.hpp"
+#include "obstacle_grid.hpp"
+#include "thread_pool.hpp"
+#include "torch_rays.hpp"
+#include "trajectory.hpp"
+#include "vector_batch.hpp"
+#include "torch_test_obstacles.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <cstring>
 
 // Test Vector3D class
 TEST(Vector3DTest, Construction) {
@@ -59,6 +90,195 @@ TEST(Vector3DTest, Magnitude) {
     EXPECT_DOUBLE_EQ(v2.magnitude(), std::sqrt(3.0));
 }
 
+// The padded SIMD layout must compute exactly what the packed one does
+template <typename T>
+void expectPaddedMatchesPacked() {
+    using Packed = Vector3<T>;
+    using Padded = Vector3<T, true>;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<T> value(T(-5), T(5));
+    std::vector<Padded> padded(33);
+    for (int i = 0; i < 200; ++i) {
+        Packed a(value(rng), value(rng), value(rng));
+        Packed b(value(rng), value(rng), value(rng));
+        T s = value(rng);
+        Padded pa(a);
+        Padded pb(b);
+
+        Packed expected = ((a + b) * s - a.cross(b) / s).normalize();
+        expected.addScaled(b, s);
+        expected -= a;
+        Padded actual = ((pa + pb) * s - pa.cross(pb) / s).normalize();
+        actual.addScaled(pb, s);
+        actual -= pa;
+        ASSERT_EQ(expected.x, actual.x);
+        ASSERT_EQ(expected.y, actual.y);
+        ASSERT_EQ(expected.z, actual.z);
+        ASSERT_EQ(actual.w, T(0));
+        ASSERT_EQ(a.dot(b), pa.dot(pb));
+        ASSERT_EQ(Packed::distance(a, b), Padded::distance(pa, pb));
+    }
+    for (const Padded& v : padded) {
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&v) % (4 * sizeof(T)), 0u);
+    }
+}
+
+TEST(Vector3DTest, PaddedLayoutMatchesPacked) {
+    static_assert(std::is_same<Vector3D, Vector3<double>>::value, "Vector3D is the packed double vector");
+    expectPaddedMatchesPacked<float>();
+    expectPaddedMatchesPacked<double>();
+
+    Vector3F narrowed(Vector3D(1.5, -2.0, 0.25));
+    EXPECT_EQ(narrowed.x, 1.5f);
+    EXPECT_EQ(narrowed.y, -2.0f);
+    EXPECT_EQ(narrowed.z, 0.25f);
+}
+
+// Every batch backend must match the per-vector Vector3D expressions exactly
+namespace {
+    void expectSameVectors(const std::vector<Vector3D>& expected, const std::vector<Vector3D>& actual,
+                           const char* what) {
+        ASSERT_EQ(expected.size(), actual.size()) << what;
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            // memcmp so that NaN components compare equal to NaN
+            ASSERT_EQ(std::memcmp(&expected[i], &actual[i], sizeof(Vector3D)), 0)
+                << what << " vector " << i << ": " << expected[i] << " vs " << actual[i];
+        }
+    }
+}
+
+TEST(VectorBatchTest, BackendsMatchVector3D) {
+    const VectorBatch::Backend original = VectorBatch::getBackend();
+    EXPECT_TRUE(VectorBatch::isSupported(VectorBatch::Backend::Scalar));
+    EXPECT_EQ(original, VectorBatch::bestBackend());
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> value(-10.0, 10.0);
+    const Vector3D low(-4.0, -5.0, -6.0);
+    const Vector3D high(4.0, 5.0, 6.0);
+
+    for (auto backend : {VectorBatch::Backend::Scalar, VectorBatch::Backend::SSE2,
+                         VectorBatch::Backend::AVX2, VectorBatch::Backend::AVX512}) {
+        if (!VectorBatch::isSupported(backend)) continue;
+        VectorBatch::setBackend(backend);
+        SCOPED_TRACE(VectorBatch::backendName(backend));
+
+        // Sizes around every block width exercise the padded tails
+        for (std::size_t count : {0u, 1u, 2u, 3u, 5u, 8u, 13u, 17u, 64u, 101u}) {
+            std::vector<Vector3D> a(count), b(count);
+            std::vector<double> scales(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                a[i] = Vector3D(value(rng), value(rng), value(rng));
+                b[i] = Vector3D(value(rng), value(rng), value(rng));
+                scales[i] = value(rng);
+            }
+            if (count > 2) {
+                a[1] = Vector3D();  // Zero length
+                a[2].y = std::nan("");
+            }
+
+            std::vector<Vector3D> expected = a, actual = a;
+            for (std::size_t i = 0; i < count; ++i) expected[i] += b[i] * 0.25;
+            VectorBatch::axpy(actual.data(), b.data(), 0.25, count);
+            expectSameVectors(expected, actual, "axpy");
+
+            expected = a;
+            actual = a;
+            for (std::size_t i = 0; i < count; ++i) expected[i] += b[i] * scales[i] * 0.01;
+            VectorBatch::scaledAdd(actual.data(), b.data(), scales.data(), 0.01, count);
+            expectSameVectors(expected, actual, "scaledAdd");
+
+            // Kick b with the forces a, then drift c with it
+            std::vector<Vector3D> expectedVelocities = b, velocities = b;
+            std::vector<Vector3D> c(count);
+            for (std::size_t i = 0; i < count; ++i) c[i] = a[(i + 1) % count] * 0.5;
+            expected = c;
+            actual = c;
+            for (std::size_t i = 0; i < count; ++i) {
+                expectedVelocities[i] += a[i] * scales[i] * 0.01;
+                expected[i] += expectedVelocities[i] * 0.02;
+            }
+            VectorBatch::kickDrift(actual.data(), velocities.data(), a.data(), scales.data(), 0.01, 0.02, count);
+            expectSameVectors(expectedVelocities, velocities, "kickDrift velocities");
+            expectSameVectors(expected, actual, "kickDrift positions");
+
+            expected = a;
+            actual = a;
+            for (std::size_t i = 0; i < count; ++i) expected[i] = expected[i].normalize();
+            VectorBatch::normalize(actual.data(), count);
+            expectSameVectors(expected, actual, "normalize");
+
+            expected = a;
+            actual = a;
+            for (Vector3D& v : expected) {
+                v.x = std::isnan(v.x) ? v.x : std::clamp(v.x, low.x, high.x);
+                v.y = std::isnan(v.y) ? v.y : std::clamp(v.y, low.y, high.y);
+                v.z = std::isnan(v.z) ? v.z : std::clamp(v.z, low.z, high.z);
+            }
+            VectorBatch::clampToBox(actual.data(), low, high, count);
+            expectSameVectors(expected, actual, "clampToBox");
+
+            std::vector<double> out(count);
+            VectorBatch::lengths(out.data(), a.data(), count);
+            for (std::size_t i = 0; i < count; ++i) {
+                double length = a[i].magnitude();
+                ASSERT_EQ(std::memcmp(&out[i], &length, sizeof(double)), 0) << "lengths " << i;
+            }
+
+            VectorBatch::distances(out.data(), a.data(), b.data(), count);
+            for (std::size_t i = 0; i < count; ++i) {
+                double distance = Vector3D::distance(a[i], b[i]);
+                ASSERT_EQ(std::memcmp(&out[i], &distance, sizeof(double)), 0) << "distances " << i;
+            }
+
+            std::vector<std::uint32_t> first(count), second(count);
+            std::uniform_int_distribution<std::uint32_t> index(0, count ? static_cast<std::uint32_t>(count - 1) : 0);
+            for (std::size_t k = 0; k < count; ++k) {
+                first[k] = index(rng);
+                second[k] = index(rng);
+            }
+            VectorBatch::pairDistancesSquared(out.data(), b.data(), first.data(), second.data(), count);
+            for (std::size_t k = 0; k < count; ++k) {
+                ASSERT_EQ(out[k], Vector3D::distanceSquared(b[first[k]], b[second[k]])) << "pairs " << k;
+            }
+        }
+    }
+
+    VectorBatch::setBackend(original);
+}
+
+TEST(VectorBatchTest, SimulationIsBackendIndependent) {
+    const VectorBatch::Backend original = VectorBatch::getBackend();
+    auto run = [](VectorBatch::Backend backend, Integrator integrator) {
+        VectorBatch::setBackend(backend);
+        Simulation simulation;
+        simulation.setIntegrator(integrator);
+        simulation.setGravity(9.81);
+        loadScene(simulation, Scene::Cloud, 203, 3);
+        for (int i = 0; i < 20; ++i) simulation.step(0.01);
+        const ParticleStore& particles = simulation.getParticles();
+        return std::vector<Vector3D>(particles.positions(), particles.positions() + particles.size());
+    };
+
+    for (Integrator integrator : {Integrator::SemiImplicitEuler, Integrator::VelocityVerlet, Integrator::Leapfrog}) {
+        std::vector<Vector3D> reference = run(VectorBatch::Backend::Scalar, integrator);
+        for (auto backend : {VectorBatch::Backend::SSE2, VectorBatch::Backend::AVX2, VectorBatch::Backend::AVX512}) {
+            if (!VectorBatch::isSupported(backend)) continue;
+            expectSameVectors(reference, run(backend, integrator), VectorBatch::backendName(backend));
+        }
+    }
+    VectorBatch::setBackend(original);
+}
+
+TEST(VectorBatchTest, ParseNames) {
+    VectorBatch::Backend backend;
+    EXPECT_TRUE(VectorBatch::parseBackend("avx2", backend));
+    EXPECT_EQ(backend, VectorBatch::Backend::AVX2);
+    EXPECT_TRUE(VectorBatch::parseBackend("scalar", backend));
+    EXPECT_EQ(backend, VectorBatch::Backend::Scalar);
+    EXPECT_FALSE(VectorBatch::parseBackend("neon", backend));
+}
+
 // Test Particle class
 TEST(ParticleTest, Construction) {
     Vector3D pos(1.0, 2.0, 3.0);
@@ -109,8 +329,1858 @@ TEST(ParticleTest, ForceApplication) {
     EXPECT_DOUBLE_EQ(p.getPosition().z, 0.0);
 }
 
+// Test ParticleStore class
+TEST(ParticleStoreTest, AddKeepsArraysInSync) {
+    ParticleStore store;
+    store.add(2.0, Vector3D(1.0, 0.0, 0.0), Vector3D(0.0, 1.0, 0.0), "First");
+    store.add(4.0, Vector3D(2.0, 0.0, 0.0), Vector3D(0.0, 2.0, 0.0));
+    
+    ASSERT_EQ(store.size(), 2u);
+    EXPECT_DOUBLE_EQ(store.positions()[1].x, 2.0);
+    EXPECT_DOUBLE_EQ(store.velocities()[1].y, 2.0);
+    EXPECT_DOUBLE_EQ(store.masses()[0], 2.0);
+    EXPECT_DOUBLE_EQ(store.inverseMasses()[1], 0.25);
+    EXPECT_EQ(store.name(0), "First");
+    EXPECT_EQ(store.name(1), "");
+    
+    EXPECT_THROW(store.add(0.0, Vector3D(), Vector3D()), std::invalid_argument);
+    EXPECT_EQ(store.size(), 2u);
+}
+
+TEST(ParticleStoreTest, HandleViewsStore) {
+    ParticleStore store;
+    std::size_t index = store.add(5.0, Vector3D(), Vector3D());
+    
+    Particle handle(store, index);
+    handle.setVelocity(Vector3D(1.0, 0.0, 0.0));
+    handle.updatePosition(0.5);
+    
+    EXPECT_DOUBLE_EQ(store.positions()[index].x, 0.5);
+    EXPECT_DOUBLE_EQ(handle.getMass(), 5.0);
+}
+
+// Test Simulation class
+TEST(SimulationTest, StepIntegratesAllParticles) {
+    Simulation sim;
+    sim.addParticle(1.0, Vector3D(0.0, 0.0, 0.0), Vector3D(1.0, 0.0, 0.0), "A");
+    sim.addParticle(2.0, Vector3D(1.0, 1.0, 0.0), Vector3D(0.0, -2.0, 0.0), "B");
+    
+    sim.step(0.5);
+    
+    const ParticleStore& particles = sim.getParticles();
+    EXPECT_DOUBLE_EQ(particles.positions()[0].x, 0.5);
+    EXPECT_DOUBLE_EQ(particles.positions()[1].y, 0.0);
+    
+    Particle* central = sim.getCentralParticle();
+    ASSERT_NE(central, nullptr);
+    EXPECT_EQ(central->getName(), "A");
+    
+    sim.clearParticles();
+    EXPECT_EQ(sim.getCentralParticle(), nullptr);
+    EXPECT_THROW(sim.step(0.0), std::invalid_argument);
+}
+
+// Test ThreadPool class
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.threadCount(), 4u);
+    
+    std::vector<int> visits(10000, 0);
+    for (int round = 0; round < 3; ++round) {
+        pool.parallelFor(visits.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                visits[i]++;
+            }
+        }, 16);
+    }
+    
+    for (int count : visits) {
+        EXPECT_EQ(count, 3);
+    }
+}
+
+TEST(SimulationTest, ParallelStepMatchesSerial) {
+    auto populate = [](Simulation& sim) {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> dist(-10.0, 10.0);
+        for (int i = 0; i < 5000; ++i) {
+            sim.addParticle(1.0 + (i % 7), Vector3D(dist(gen), dist(gen), dist(gen)),
+                            Vector3D(dist(gen), dist(gen), dist(gen)));
+        }
+    };
+    
+    Simulation serial;
+    populate(serial);
+    for (int i = 0; i < 10; ++i) serial.step(0.01);
+    
+    for (std::size_t threads : {2u, 3u, 8u}) {
+        Simulation parallel;
+        parallel.setThreadCount(threads);
+        EXPECT_EQ(parallel.getThreadCount(), threads);
+        populate(parallel);
+        for (int i = 0; i < 10; ++i) parallel.step(0.01);
+        
+        const ParticleStore& a = serial.getParticles();
+        const ParticleStore& b = parallel.getParticles();
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            ASSERT_EQ(a.positions()[i].x, b.positions()[i].x);
+            ASSERT_EQ(a.positions()[i].y, b.positions()[i].y);
+            ASSERT_EQ(a.positions()[i].z, b.positions()[i].z);
+            ASSERT_EQ(a.velocities()[i].x, b.velocities()[i].x);
+        }
+    }
+}
+
+// Test GravitySolver class
+TEST(GravitySolverTest, BarnesHutMatchesDirectSum) {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-50.0, 50.0);
+    std::uniform_real_distribution<double> massDist(0.5, 2.0);
+    
+    const std::size_t count = 2000;
+    std::vector<Vector3D> positions;
+    std::vector<double> masses;
+    for (std::size_t i = 0; i < count; ++i) {
+        positions.emplace_back(dist(gen), dist(gen), dist(gen));
+        masses.push_back(massDist(gen));
+    }
+    
+    GravitySolver direct;
+    direct.setMode(GravitySolver::Mode::DirectSum);
+    std::vector<Vector3D> exact(count);
+    direct.build(positions.data(), masses.data(), count);
+    direct.accumulateForces(positions.data(), masses.data(), exact.data(), count, 0, count);
+    
+    GravitySolver tree;
+    tree.setMode(GravitySolver::Mode::BarnesHut);
+    tree.setOpeningAngle(0.5);
+    std::vector<Vector3D> approx(count);
+    tree.build(positions.data(), masses.data(), count);
+    tree.accumulateForces(positions.data(), masses.data(), approx.data(), count, 0, count);
+    EXPECT_GT(tree.getNodeCount(), count);
+    
+    double errorSum = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        errorSum += (approx[i] - exact[i]).magnitude() / exact[i].magnitude();
+    }
+    EXPECT_LT(errorSum / count, 0.01);
+    
+    // Opening every node reproduces the direct sum up to rounding
+    tree.setOpeningAngle(0.0);
+    std::vector<Vector3D> opened(count);
+    tree.build(positions.data(), masses.data(), count);
+    tree.accumulateForces(positions.data(), masses.data(), opened.data(), count, 0, count);
+    for (std::size_t i = 0; i < count; ++i) {
+        EXPECT_NEAR((opened[i] - exact[i]).magnitude() / exact[i].magnitude(), 0.0, 1e-9);
+    }
+}
+
+TEST(GravitySolverTest, WideOpeningAngleExcludesSelfInteraction) {
+    // With theta = 1 the root cell passes the opening test for particle 0:
+    // the heavy particle pulls the centre of mass 1.3 cell sizes away
+    std::vector<Vector3D> positions = {Vector3D(0.0, 0.0, 0.0), Vector3D(1.0, 1.0, 1.0)};
+    std::vector<double> masses = {1.0, 3.0};
+    
+    GravitySolver direct;
+    direct.setMode(GravitySolver::Mode::DirectSum);
+    direct.setSoftening(0.0);
+    std::vector<Vector3D> exact(2);
+    direct.accumulateForces(positions.data(), masses.data(), exact.data(), 2, 0, 2);
+    
+    GravitySolver tree;
+    tree.setMode(GravitySolver::Mode::BarnesHut);
+    tree.setSoftening(0.0);
+    tree.setOpeningAngle(1.0);
+    std::vector<Vector3D> approx(2);
+    tree.build(positions.data(), masses.data(), 2);
+    tree.accumulateForces(positions.data(), masses.data(), approx.data(), 2, 0, 2);
+    for (std::size_t i = 0; i < 2; ++i) {
+        EXPECT_NEAR((approx[i] - exact[i]).magnitude() / exact[i].magnitude(), 0.0, 1e-12) << i;
+    }
+    
+    // A random cloud at theta = 1 stays close to the direct sum
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(-10.0, 10.0);
+    positions.clear();
+    masses.clear();
+    for (int i = 0; i < 500; ++i) {
+        positions.emplace_back(dist(gen), dist(gen), dist(gen));
+        masses.push_back(1.0 + (i % 4));
+    }
+    const std::size_t count = positions.size();
+    exact.assign(count, Vector3D());
+    approx.assign(count, Vector3D());
+    direct.accumulateForces(positions.data(), masses.data(), exact.data(), count, 0, count);
+    tree.build(positions.data(), masses.data(), count);
+    tree.accumulateForces(positions.data(), masses.data(), approx.data(), count, 0, count);
+    double errorSum = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        errorSum += (approx[i] - exact[i]).magnitude() / exact[i].magnitude();
+    }
+    EXPECT_LT(errorSum / count, 0.1);
+}
+
+TEST(GravitySolverTest, CoincidentParticlesStayFinite) {
+    std::vector<Vector3D> positions(4, Vector3D(1.0, 1.0, 1.0));
+    positions.emplace_back(2.0, 1.0, 1.0);
+    std::vector<double> masses(positions.size(), 1.0);
+    std::vector<Vector3D> forces(positions.size());
+    
+    GravitySolver tree;
+    tree.setMode(GravitySolver::Mode::BarnesHut);
+    tree.setSoftening(0.0);
+    tree.build(positions.data(), masses.data(), positions.size());
+    tree.accumulateForces(positions.data(), masses.data(), forces.data(), positions.size(), 0, positions.size());
+    
+    for (const auto& force : forces) {
+        EXPECT_TRUE(std::isfinite(force.x));
+    }
+    EXPECT_NEAR(forces[4].x, -4.0, 1e-12);
+}
+
+TEST(SimulationTest, GravityAttractsAndIsThreadIndependent) {
+    auto run = [](std::size_t threads) {
+        Simulation sim;
+        sim.setThreadCount(threads);
+        sim.getGravitySolver().setMode(GravitySolver::Mode::BarnesHut);
+        std::mt19937 gen(3);
+        std::uniform_real_distribution<double> dist(-5.0, 5.0);
+        for (int i = 0; i < 3000; ++i) {
+            sim.addParticle(1.0, Vector3D(dist(gen), dist(gen), dist(gen)), Vector3D());
+        }
+        for (int i = 0; i < 3; ++i) sim.step(0.001);
+        std::vector<Vector3D> result(sim.getParticles().positions(),
+                                     sim.getParticles().positions() + sim.getParticles().size());
+        return result;
+    };
+    
+    std::vector<Vector3D> serial = run(1);
+    std::vector<Vector3D> parallel = run(4);
+    for (std::size_t i = 0; i < serial.size(); ++i) {
+        ASSERT_EQ(serial[i].x, parallel[i].x);
+        ASSERT_EQ(serial[i].y, parallel[i].y);
+        ASSERT_EQ(serial[i].z, parallel[i].z);
+    }
+}
+
+// Test force generators
+TEST(ForceGeneratorTest, BuiltInGravityAndDrag) {
+    Simulation sim;
+    sim.addParticle(2.0, Vector3D(), Vector3D(1.0, 0.0, 0.0));
+    sim.setGravity(9.81);
+    sim.setDamping(0.5);
+    
+    sim.step(0.1);
+    
+    // F = (0, -m g, 0) - k v = (-0.5, -19.62, 0), a = F / 2
+    const Vector3D& velocity = sim.getParticles().velocities()[0];
+    EXPECT_NEAR(velocity.x, 1.0 - 0.025, 1e-12);
+    EXPECT_NEAR(velocity.y, -0.981, 1e-12);
+    EXPECT_THROW(sim.setDamping(-1.0), std::invalid_argument);
+}
+
+TEST(ForceGeneratorTest, SpringAndAttractor) {
+    ParticleStore store;
+    store.add(1.0, Vector3D(0.0, 0.0, 0.0), Vector3D());
+    store.add(1.0, Vector3D(3.0, 0.0, 0.0), Vector3D());
+    
+    SpringForce springs;
+    springs.addSpring(0, 1, 1.0, 2.0);
+    springs.apply(store, 0, store.size());
+    
+    // Stretched by 2 with k = 2: equal and opposite pull of 4
+    EXPECT_DOUBLE_EQ(store.forces()[0].x, 4.0);
+    EXPECT_DOUBLE_EQ(store.forces()[1].x, -4.0);
+    EXPECT_FALSE(springs.isPerParticle());
+    EXPECT_THROW(springs.addSpring(1, 1, 1.0, 1.0), std::invalid_argument);
+    
+    store.resetForces();
+    PointAttractor attractor(Vector3D(0.0, 2.0, 0.0), 8.0, 0.0);
+    attractor.apply(store, 0, 1);
+    EXPECT_DOUBLE_EQ(store.forces()[0].y, 2.0);
+    EXPECT_DOUBLE_EQ(store.forces()[1].y, 0.0);
+}
+
+TEST(ForceGeneratorTest, RegisteredGeneratorsAreThreadIndependent) {
+    auto run = [](std::size_t threads) {
+        Simulation sim;
+        sim.setThreadCount(threads);
+        sim.setDamping(0.1);
+        std::mt19937 gen(11);
+        std::uniform_real_distribution<double> dist(-5.0, 5.0);
+        for (int i = 0; i < 4000; ++i) {
+            sim.addParticle(1.0, Vector3D(dist(gen), dist(gen), dist(gen)), Vector3D(dist(gen), 0.0, 0.0));
+        }
+        auto& springs = sim.addForceGenerator<SpringForce>();
+        for (std::size_t i = 0; i + 1 < 4000; i += 2) {
+            springs.addSpring(i, i + 1, 1.0, 5.0, 0.1);
+        }
+        sim.addForceGenerator<PointAttractor>(Vector3D(), 3.0);
+        for (int i = 0; i < 5; ++i) sim.step(0.01);
+        return std::vector<Vector3D>(sim.getParticles().positions(),
+                                     sim.getParticles().positions() + sim.getParticles().size());
+    };
+    
+    std::vector<Vector3D> serial = run(1);
+    std::vector<Vector3D> parallel = run(3);
+    for (std::size_t i = 0; i < serial.size(); ++i) {
+        ASSERT_EQ(serial[i].x, parallel[i].x);
+        ASSERT_EQ(serial[i].y, parallel[i].y);
+    }
+}
+
+// Test integrators
+TEST(IntegratorTest, SecondOrderSchemesAreExactForConstantAcceleration) {
+    for (Integrator integrator : {Integrator::VelocityVerlet, Integrator::Leapfrog, Integrator::RK4}) {
+        Simulation sim;
+        sim.setIntegrator(integrator);
+        sim.setGravity(10.0);
+        sim.addParticle(1.0, Vector3D(), Vector3D(1.0, 5.0, 0.0));
+        
+        for (int i = 0; i < 100; ++i) sim.step(0.01);
+        
+        // y = v0 t - g t^2 / 2 at t = 1
+        const Vector3D& position = sim.getParticles().positions()[0];
+        EXPECT_NEAR(position.x, 1.0, 1e-9) << integratorName(integrator);
+        EXPECT_NEAR(position.y, 0.0, 1e-9) << integratorName(integrator);
+        EXPECT_NEAR(sim.getParticles().velocities()[0].y, -5.0, 1e-9) << integratorName(integrator);
+    }
+}
+
+TEST(IntegratorTest, SymplecticSchemesConserveOscillatorEnergy) {
+    // Two unit masses joined by a spring of stiffness 50, integrated with a
+    // large timestep over many periods
+    auto finalEnergy = [](Integrator integrator) {
+        Simulation sim;
+        sim.setIntegrator(integrator);
+        sim.addParticle(1.0, Vector3D(-1.0, 0.0, 0.0), Vector3D());
+        sim.addParticle(1.0, Vector3D(1.0, 0.0, 0.0), Vector3D());
+        sim.addForceGenerator<SpringForce>().addSpring(0, 1, 1.0, 50.0);
+        for (int i = 0; i < 5000; ++i) sim.step(0.05);
+        
+        const ParticleStore& p = sim.getParticles();
+        double stretch = Vector3D::distance(p.positions()[0], p.positions()[1]) - 1.0;
+        double kinetic = 0.5 * (p.velocities()[0].magnitudeSquared() + p.velocities()[1].magnitudeSquared());
+        return kinetic + 0.5 * 50.0 * stretch * stretch;
+    };
+    
+    const double initialEnergy = 0.5 * 50.0 * 1.0;
+    EXPECT_NEAR(finalEnergy(Integrator::VelocityVerlet), initialEnergy, 0.1 * initialEnergy);
+    EXPECT_NEAR(finalEnergy(Integrator::Leapfrog), initialEnergy, 0.1 * initialEnergy);
+    EXPECT_NEAR(finalEnergy(Integrator::RK4), initialEnergy, 0.1 * initialEnergy);
+}
+
+TEST(IntegratorTest, HandleWritesInvalidateCachedForces) {
+    // Velocity Verlet reuses last step's forces; moving a particle through
+    // a handle must make the next step recompute them
+    auto run = [](bool invalidateExplicitly) {
+        Simulation sim;
+        sim.setIntegrator(Integrator::VelocityVerlet);
+        sim.addParticle(1.0, Vector3D(-1.0, 0.0, 0.0), Vector3D());
+        sim.addParticle(1.0, Vector3D(1.0, 0.0, 0.0), Vector3D());
+        sim.addForceGenerator<SpringForce>().addSpring(0, 1, 1.0, 50.0);
+        sim.step(0.01);
+        
+        sim.getParticle(1).setPosition(Vector3D(3.0, 0.5, 0.0));
+        sim.getParticle(0).setVelocity(Vector3D(0.0, 1.0, 0.0));
+        if (invalidateExplicitly) sim.invalidateForces();
+        sim.step(0.01);
+        return std::vector<Vector3D>{sim.getParticles().velocities()[0], sim.getParticles().velocities()[1]};
+    };
+    
+    std::vector<Vector3D> implicit = run(false);
+    std::vector<Vector3D> expected = run(true);
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(implicit[i].x, expected[i].x) << i;
+        EXPECT_EQ(implicit[i].y, expected[i].y) << i;
+    }
+}
+
+TEST(IntegratorTest, ParseNames) {
+    Integrator integrator = Integrator::SemiImplicitEuler;
+    EXPECT_TRUE(parseIntegrator("rk4", integrator));
+    EXPECT_EQ(integrator, Integrator::RK4);
+    EXPECT_TRUE(parseIntegrator("verlet", integrator));
+    EXPECT_EQ(integrator, Integrator::VelocityVerlet);
+    EXPECT_FALSE(parseIntegrator("midpoint", integrator));
+}
+
+// Test FixedTimestep class
+TEST(FixedTimestepTest, AccumulatesPartialFrames) {
+    FixedTimestep timestep(0.25, 4);
+    
+    EXPECT_EQ(timestep.advance(0.1), 0);
+    EXPECT_NEAR(timestep.getAlpha(), 0.4, 1e-12);
+    EXPECT_EQ(timestep.advance(0.2), 1);
+    EXPECT_NEAR(timestep.getAlpha(), 0.2, 1e-12);
+    EXPECT_EQ(timestep.advance(0.5), 2);
+    EXPECT_NEAR(timestep.getAlpha(), 0.2, 1e-12);
+}
+
+TEST(FixedTimestepTest, ClampsSubstepsOnSlowFrames) {
+    FixedTimestep timestep(0.01, 5);
+    
+    // A 1 second hitch runs only five steps and drops the backlog
+    EXPECT_EQ(timestep.advance(1.0), 5);
+    EXPECT_LT(timestep.getAlpha(), 1.0);
+    EXPECT_NEAR(timestep.getDroppedSeconds(), 0.95, 0.01);
+    
+    // The next normal frame is not penalised
+    EXPECT_LE(timestep.advance(0.016), 2);
+    EXPECT_THROW(FixedTimestep(0.0, 1), std::invalid_argument);
+    EXPECT_THROW(FixedTimestep(0.01, 0), std::invalid_argument);
+}
+
+// Test lock-free handoff primitives
+TEST(SpscQueueTest, PreservesOrderAcrossThreads) {
+    SpscQueue<int, 64> queue;
+    const int count = 100000;
+    
+    std::thread producer([&] {
+        for (int i = 0; i < count; ++i) {
+            while (!queue.push(i)) std::this_thread::yield();
+        }
+    });
+    
+    int expected = 0;
+    while (expected < count) {
+        int value;
+        if (queue.pop(value)) {
+            ASSERT_EQ(value, expected);
+            ++expected;
+        }
+    }
+    producer.join();
+    
+    int leftover;
+    EXPECT_FALSE(queue.pop(leftover));
+}
+
+TEST(TripleBufferTest, ReaderSeesLatestCompleteState) {
+    TripleBuffer<std::vector<int>> buffer;
+    EXPECT_FALSE(buffer.update());
+    
+    buffer.writeBuffer().assign(3, 1);
+    buffer.publish();
+    buffer.writeBuffer().assign(3, 2);
+    buffer.publish();
+    
+    // Only the newest publication is visible
+    EXPECT_TRUE(buffer.update());
+    EXPECT_EQ(buffer.readBuffer(), std::vector<int>(3, 2));
+    EXPECT_FALSE(buffer.update());
+    
+    // Concurrent writer: every read is a consistent, non-decreasing state
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (int i = 3; i < 20000; ++i) {
+            buffer.writeBuffer().assign(16, i);
+            buffer.publish();
+        }
+        done = true;
+    });
+    int last = 2;
+    bool consistent = true;
+    while (!done) {
+        buffer.update();
+        const std::vector<int>& state = buffer.readBuffer();
+        for (int value : state) consistent = consistent && value == state[0];
+        consistent = consistent && state[0] >= last;
+        last = state[0];
+    }
+    writer.join();
+    buffer.update();
+    EXPECT_TRUE(consistent);
+    EXPECT_EQ(buffer.readBuffer(), std::vector<int>(16, 19999));
+}
+
+// Test ObstacleGrid class
+TEST(ObstacleGridTest, MatchesLinearScan) {
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> size(0.1f, 4.0f);
+    std::vector<Obstacle> obstacles;
+    for (int i = 0; i < 500; ++i) {
+        obstacles.emplace_back(position(gen), position(gen), size(gen), size(gen));
+    }
+    
+    ObstacleGrid grid;
+    grid.build(obstacles.data(), obstacles.size());
+    EXPECT_GT(grid.getColumns() * grid.getRows(), 1);
+    
+    std::uniform_real_distribution<float> query(-25.0f, 25.0f);
+    for (int i = 0; i < 2000; ++i) {
+        float x = query(gen), y = query(gen), radius = 0.15f + (i % 5) * 0.5f;
+        
+        bool linear = false;
+        for (const auto& obstacle : obstacles) {
+            linear = linear || obstacle.intersectsCircle(x, y, radius);
+        }
+        
+        // Each obstacle is reported at most once per query
+        std::vector<int> seen(obstacles.size(), 0);
+        bool indexed = false;
+        grid.visitCandidates(x - radius, y - radius, x + radius, y + radius, [&](std::uint32_t index) {
+            seen[index]++;
+            indexed = indexed || obstacles[index].intersectsCircle(x, y, radius);
+            return false;
+        });
+        
+        ASSERT_EQ(linear, indexed);
+        for (int count : seen) ASSERT_LE(count, 1);
+    }
+}
+
+TEST(ObstacleGridTest, EmptyGridHasNoCandidates) {
+    ObstacleGrid grid;
+    grid.build(nullptr, 0);
+    EXPECT_TRUE(grid.empty());
+    EXPECT_FALSE(grid.visitCandidates(-1.0f, -1.0f, 1.0f, 1.0f, [](std::uint32_t) { return true; }));
+}
+
+// Test swept-circle collision
+TEST(CollisionTest, SweepHitsFaceAtExactTime) {
+    Obstacle wall(0.0f, 0.0f, 2.0f, 2.0f);
+    SweepHit hit;
+    
+    // Contact when the centre reaches x = -1.5, an eighth of the way along
+    ASSERT_TRUE(sweepCircle(wall, -2.0, 0.0, 4.0, 0.0, 0.5, hit));
+    EXPECT_NEAR(hit.time, 0.125, 1e-12);
+    EXPECT_DOUBLE_EQ(hit.normalX, -1.0);
+    EXPECT_DOUBLE_EQ(hit.normalY, 0.0);
+    
+    // A displacement that stops short does not hit
+    EXPECT_FALSE(sweepCircle(wall, -2.0, 0.0, 0.4, 0.0, 0.5, hit));
+}
+
+TEST(CollisionTest, SweepHitsRoundedCorner) {
+    Obstacle wall(0.0f, 0.0f, 2.0f, 2.0f);
+    SweepHit hit;
+    
+    // Diagonal approach towards the (1, 1) corner
+    ASSERT_TRUE(sweepCircle(wall, 3.0, 3.0, -2.0, -2.0, 0.5, hit));
+    double x = 3.0 - 2.0 * hit.time;
+    double y = 3.0 - 2.0 * hit.time;
+    EXPECT_NEAR(std::hypot(x - 1.0, y - 1.0), 0.5, 1e-12);
+    EXPECT_NEAR(hit.normalX, std::sqrt(0.5), 1e-12);
+    EXPECT_NEAR(hit.normalY, std::sqrt(0.5), 1e-12);
+    
+    // Passing through the square corner of the grown box but outside the
+    // rounded one is a miss
+    EXPECT_FALSE(sweepCircle(wall, 2.4, 0.5, -1.5, 1.5, 0.5, hit));
+    EXPECT_TRUE(sweepCircle(wall, 2.1, 0.5, -1.5, 1.5, 0.5, hit));
+}
+
+TEST(CollisionTest, OverlappingCircleCanOnlyMoveOut) {
+    Obstacle wall(0.0f, 0.0f, 2.0f, 2.0f);
+    SweepHit hit;
+    
+    ASSERT_TRUE(sweepCircle(wall, -1.2, 0.0, 1.0, 0.0, 0.5, hit));
+    EXPECT_DOUBLE_EQ(hit.time, 0.0);
+    EXPECT_DOUBLE_EQ(hit.normalX, -1.0);
+    EXPECT_FALSE(sweepCircle(wall, -1.2, 0.0, -1.0, 0.0, 0.5, hit));
+}
+
+TEST(CollisionTest, CircleStartingInContactCannotMoveIn) {
+    Obstacle wall(0.0f, 0.0f, 2.0f, 2.0f);
+    SweepHit hit;
+    
+    // Touching the left face exactly: moving in is blocked at once
+    ASSERT_TRUE(sweepCircle(wall, -1.25, 0.0, 1.0, 0.0, 0.25, hit));
+    EXPECT_DOUBLE_EQ(hit.time, 0.0);
+    EXPECT_DOUBLE_EQ(hit.normalX, -1.0);
+    EXPECT_DOUBLE_EQ(hit.normalY, 0.0);
+    EXPECT_FALSE(sweepCircle(wall, -1.25, 0.0, -1.0, 0.0, 0.25, hit));
+    
+    // The collider keeps the circle outside and slides the rest of the motion
+    ObstacleCollider collider;
+    collider.setObstacles({wall});
+    SlideResult result = collider.slide(-1.25, 0.0, 1.0, 0.0, 0.25);
+    EXPECT_EQ(result.contactCount, 1);
+    EXPECT_LE(result.x, -1.25);
+    EXPECT_FALSE(collider.overlaps(result.x, result.y, 0.25));
+    result = collider.slide(-1.25, 0.0, 1.0, 0.5, 0.25);
+    EXPECT_LE(result.x, -1.25);
+    EXPECT_NEAR(result.y, 0.5, 1e-9);
+    EXPECT_FALSE(collider.overlaps(result.x, result.y, 0.25));
+}
+
+TEST(CollisionTest, SlideAlongWall) {
+    ObstacleCollider collider;
+    collider.setObstacles({Obstacle(0.0f, 0.0f, 10.0f, 1.0f)});
+    
+    // Moving diagonally down onto the top of the wall keeps the x motion
+    SlideResult result = collider.slide(0.0, 2.0, 3.0, -3.0, 0.5);
+    ASSERT_EQ(result.contactCount, 1);
+    EXPECT_NEAR(result.x, 3.0, 1e-9);
+    EXPECT_NEAR(result.y, 1.0, 1e-5);
+    EXPECT_GE(result.y, 1.0);
+    EXPECT_DOUBLE_EQ(result.normalY[0], 1.0);
+    EXPECT_FALSE(collider.overlaps(result.x, result.y, 0.5));
+}
+
+TEST(CollisionTest, FastParticlesDoNotTunnelThroughThinWalls) {
+    for (std::size_t threads : {1u, 4u}) {
+        Simulation sim;
+        sim.setThreadCount(threads);
+        sim.setObstacles({Obstacle(0.0f, 0.0f, 100.0f, 0.05f)});
+        sim.setCollisionRadius(0.1);
+        
+        for (int i = 0; i < 2000; ++i) {
+            double x = -40.0 + 0.04 * i;
+            sim.addParticle(1.0, Vector3D(x, 1.0, 0.0), Vector3D(5.0, -300.0, 0.0));
+        }
+        
+        // Each step moves a particle far further than the wall is thick
+        for (int step = 0; step < 5; ++step) {
+            sim.step(0.01);
+        }
+        
+        const Vector3D* positions = sim.getParticles().positions();
+        const Vector3D* velocities = sim.getParticles().velocities();
+        for (std::size_t i = 0; i < sim.getParticles().size(); ++i) {
+            ASSERT_GT(positions[i].y, 0.025 + 0.1 - 1e-9);
+            EXPECT_DOUBLE_EQ(velocities[i].y, 0.0);
+            EXPECT_DOUBLE_EQ(velocities[i].x, 5.0);
+        }
+    }
+}
+
+// Test torch ray marching
+TEST(TorchRayTest, BackendsMatchScalar) {
+    std::vector<Obstacle> obstacles = makeTorchObstacles(11, 60, 4.0f);
+    TorchRayConfig config;
+    config.length = 3.0f;
+    config.rayCount = 301; // Enough work to use the pool
+    ThreadPool pool(4);
+    
+    TorchRayTracer reference;
+    reference.setBackend(TorchRayTracer::Backend::Scalar);
+    reference.setObstacles(obstacles.data(), obstacles.size());
+    
+    for (auto backend : {TorchRayTracer::Backend::SSE, TorchRayTracer::Backend::AVX2}) {
+        if (!TorchRayTracer::isSupported(backend)) continue;
+        TorchRayTracer tracer;
+        tracer.setBackend(backend);
+        tracer.setObstacles(obstacles.data(), obstacles.size());
+        
+        for (int i = 0; i < 16; ++i) {
+            float angle = 0.4f * i;
+            TorchRayPaths expected, actual;
+            reference.trace(0.0f, 0.0f, angle, config, expected);
+            tracer.trace(0.0f, 0.0f, angle, config, actual, (i % 2) ? &pool : nullptr);
+            
+            ASSERT_EQ(expected.pointCounts, actual.pointCounts) << TorchRayTracer::backendName(backend);
+            for (int ray = 0; ray < expected.rayCount; ++ray) {
+                for (int k = 0; k < expected.pointCounts[ray] * 2; ++k) {
+                    ASSERT_NEAR(expected.ray(ray)[k], actual.ray(ray)[k], 1e-5f)
+                        << TorchRayTracer::backendName(backend) << " ray " << ray;
+                }
+            }
+        }
+    }
+}
+
+TEST(TorchRayTest, DistantObstaclesDoNotAffectPaths) {
+    std::vector<Obstacle> nearby = makeTorchObstacles(3, 40, 4.0f);
+    std::vector<Obstacle> withDistant = nearby;
+    for (int i = 0; i < 1000; ++i) {
+        withDistant.emplace_back(50.0f + (i % 40), 50.0f + (i / 40), 0.5f, 0.5f);
+    }
+    
+    TorchRayConfig config;
+    config.length = 3.0f;
+    TorchRayTracer a, b;
+    a.setObstacles(nearby.data(), nearby.size());
+    b.setObstacles(withDistant.data(), withDistant.size());
+    
+    TorchRayPaths pathsA, pathsB;
+    a.trace(0.0f, 0.0f, 1.0f, config, pathsA);
+    b.trace(0.0f, 0.0f, 1.0f, config, pathsB);
+    EXPECT_EQ(pathsA.pointCounts, pathsB.pointCounts);
+    EXPECT_EQ(pathsA.vertices, pathsB.vertices);
+}
+
+TEST(TorchRayTest, RaysStopOutsideObstacles) {
+    std::vector<Obstacle> obstacles = makeTorchObstacles(7, 80, 3.0f);
+    TorchRayConfig config;
+    config.length = 3.0f;
+    TorchRayTracer tracer;
+    tracer.setObstacles(obstacles.data(), obstacles.size());
+    
+    TorchRayPaths paths;
+    tracer.trace(0.0f, 0.0f, 2.0f, config, paths);
+    ASSERT_EQ(paths.rayCount, config.rayCount);
+    
+    int stoppedEarly = 0;
+    for (int ray = 0; ray < paths.rayCount; ++ray) {
+        const float* path = paths.ray(ray);
+        EXPECT_EQ(path[0], 0.0f);
+        EXPECT_EQ(path[1], 0.0f);
+        if (paths.pointCounts[ray] < paths.stride) ++stoppedEarly;
+        for (int k = 1; k < paths.pointCounts[ray]; ++k) {
+            for (const auto& obstacle : obstacles) {
+                ASSERT_FALSE(obstacle.contains(path[k * 2], path[k * 2 + 1]));
+            }
+        }
+    }
+    EXPECT_GT(stoppedEarly, 0);
+    
+    EXPECT_THROW(tracer.trace(0.0f, 0.0f, 0.0f, TorchRayConfig{1, 30, 1.0f, 1.0f}, paths), std::invalid_argument);
+}
+
+TEST(TorchRayCacheTest, ReusesStillPoseAndRetracesOnTurn) {
+    std::vector<Obstacle> obstacles = makeTorchObstacles(9, 60, 3.0f);
+    TorchRayConfig config;
+    config.length = 3.0f;
+    TorchRayTracer tracer;
+    tracer.setObstacles(obstacles.data(), obstacles.size());
+    const std::uint64_t rayCount = static_cast<std::uint64_t>(config.rayCount);
+    
+    TorchRayCache cache(1e-3f, 1e-3f);
+    std::vector<float> firstVertices = cache.trace(tracer, 0.1f, 0.2f, 1.0f, config).vertices;
+    EXPECT_EQ(cache.getStats().misses, 1u);
+    EXPECT_EQ(cache.getStats().raysTraced, rayCount);
+    
+    // Pose jitter below the quanta is a hit and every ray is reused
+    const TorchRayPaths& still = cache.trace(tracer, 0.1002f, 0.2f, 1.0002f, config);
+    EXPECT_EQ(cache.getStats().hits, 1u);
+    EXPECT_EQ(cache.getStats().raysReused, rayCount);
+    EXPECT_EQ(still.vertices, firstVertices);
+    
+    // One controller tick of turning (6 rad/s at 240 Hz) traces the whole
+    // fan, from the snapped pose, exactly as the tracer does
+    const float tick = 6.0f / 240.0f;
+    const TorchRayPaths& turned = cache.trace(tracer, 0.1f, 0.2f, 1.0f + tick, config);
+    EXPECT_EQ(cache.getStats().misses, 2u);
+    EXPECT_EQ(cache.getStats().raysReused, rayCount);
+    TorchRayPaths expected;
+    const float snapped = static_cast<float>(std::round(static_cast<double>(1.0f + tick) / 1e-3f) * 1e-3f);
+    tracer.trace(0.1f, 0.2f, snapped, config, expected);
+    ASSERT_EQ(turned.pointCounts, expected.pointCounts);
+    for (int ray = 0; ray < config.rayCount; ++ray) {
+        for (int k = 0; k < expected.pointCounts[ray] * 2; ++k) {
+            ASSERT_EQ(turned.ray(ray)[k], expected.ray(ray)[k]) << "ray " << ray;
+        }
+    }
+    
+    // Moving the torch or replacing the obstacles traces the whole fan
+    cache.trace(tracer, 0.3f, 0.2f, 1.0f + tick, config);
+    tracer.setObstacles(obstacles.data(), obstacles.size() / 2);
+    cache.trace(tracer, 0.3f, 0.2f, 1.0f + tick, config);
+    EXPECT_EQ(cache.getStats().misses, 4u);
+    EXPECT_EQ(cache.getStats().raysTraced, 4 * rayCount);
+    EXPECT_EQ(cache.getStats().lookups(), 5u);
+    EXPECT_DOUBLE_EQ(cache.getStats().hitRate(), 0.2);
+}
+
+TEST(TorchRayCacheTest, UnsnappedCacheMatchesTracer) {
+    std::vector<Obstacle> obstacles = makeTorchObstacles(4, 60, 3.0f);
+    TorchRayConfig config;
+    config.length = 3.0f;
+    TorchRayTracer tracer;
+    tracer.setObstacles(obstacles.data(), obstacles.size());
+    
+    TorchRayCache cache(0.0f, 0.0f);
+    TorchRayPaths expected;
+    for (int frame = 0; frame < 6; ++frame) {
+        float angle = 0.3f * (frame / 2);  // Every pose twice
+        const TorchRayPaths& actual = cache.trace(tracer, 0.25f, -0.5f, angle, config);
+        tracer.trace(0.25f, -0.5f, angle, config, expected);
+        ASSERT_EQ(actual.pointCounts, expected.pointCounts);
+        ASSERT_EQ(actual.vertices, expected.vertices);
+    }
+    EXPECT_EQ(cache.getStats().hits, 3u);
+    EXPECT_THROW(cache.setQuantization(-1.0f, 0.0f), std::invalid_argument);
+}
+
+TEST(ObstacleFieldTest, MatchesAnalyticForcesAtNodesAndConverges) {
+    std::vector<Obstacle> obstacles = makeTorchObstacles(12, 40, 3.0f);
+    ObstacleField field;
+    field.build(obstacles.data(), obstacles.size(), 0.1f);
+    ASSERT_FALSE(field.empty());
+    
+    // Nodes hold the exact values (lookups there are off by rounding only)
+    for (int row = 0; row < field.getRows(); row += 7) {
+        for (int column = 0; column < field.getColumns(); column += 7) {
+            float x = field.getOriginX() + column * field.getCellSize();
+            float y = field.getOriginY() + row * field.getCellSize();
+            float forceX, forceY;
+            ObstacleField::analyticForce(obstacles.data(), obstacles.size(), x, y, forceX, forceY);
+            ObstacleField::Sample sample = field.sample(x, y);
+            ASSERT_NEAR(sample.forceX, forceX, 1e-4f);
+            ASSERT_NEAR(sample.forceY, forceY, 1e-4f);
+            bool inside = std::any_of(obstacles.begin(), obstacles.end(),
+                                      [&](const Obstacle& o) { return o.contains(x, y); });
+            ASSERT_EQ(sample.distance <= 0.0f, inside);
+        }
+    }
+    
+    // Finer fields approximate the forces between nodes better
+    ObstacleFieldError coarse = field.measureError(obstacles.data(), obstacles.size());
+    ObstacleField fine;
+    fine.build(obstacles.data(), obstacles.size(), 0.025f);
+    ObstacleFieldError fineError = fine.measureError(obstacles.data(), obstacles.size());
+    EXPECT_GT(coarse.samples, 0u);
+    EXPECT_GT(coarse.maxForce, 0.0);
+    EXPECT_LT(fineError.rmsForceError, coarse.rmsForceError);
+    double coarseMismatches = static_cast<double>(coarse.insideMismatches) / coarse.samples;
+    double fineMismatches = static_cast<double>(fineError.insideMismatches) / fineError.samples;
+    EXPECT_LT(fineMismatches, coarseMismatches);
+    EXPECT_LT(fineMismatches, 0.01);
+    
+    // Far outside the map there is no push and no wall
+    ObstacleField::Sample far = field.sample(1000.0f, -1000.0f);
+    EXPECT_EQ(far.forceX, 0.0f);
+    EXPECT_EQ(far.forceY, 0.0f);
+    EXPECT_GT(far.distance, 0.0f);
+    
+    EXPECT_THROW(field.build(obstacles.data(), obstacles.size(), 0.0f), std::invalid_argument);
+    EXPECT_THROW(field.build(obstacles.data(), obstacles.size(), 1e-4f), std::length_error);
+}
+
+TEST(ObstacleFieldTest, LargeMapFieldCoarsensToFit) {
+    // 120 x 120 units: a 0.025 field would need about 23M nodes
+    std::vector<Obstacle> obstacles = makeTorchObstacles(21, 20000, 60.0f);
+    EXPECT_THROW(ObstacleField().build(obstacles.data(), obstacles.size(), 0.025f), std::length_error);
+    
+    TorchRayTracer tracer;
+    tracer.setFieldCellSize(0.025f);
+    ASSERT_NO_THROW(tracer.setObstacles(obstacles.data(), obstacles.size()));
+    const ObstacleField& field = tracer.getField();
+    ASSERT_FALSE(field.empty());
+    EXPECT_GT(field.getCellSize(), 0.025f);
+    EXPECT_LT(field.getCellSize(), 0.07f);
+    EXPECT_LE(static_cast<std::size_t>(field.getColumns()) * field.getRows(), std::size_t(1) << 22);
+    EXPECT_EQ(tracer.getFieldCellSize(), 0.025f);
+    
+    // The fitted size is the finest that fits, and small maps keep the request
+    EXPECT_THROW(ObstacleField().build(obstacles.data(), obstacles.size(), field.getCellSize() * 0.99f),
+                 std::length_error);
+    std::vector<Obstacle> small = makeTorchObstacles(12, 40, 3.0f);
+    EXPECT_EQ(ObstacleField::fitCellSize(small.data(), small.size(), 0.025f), 0.025f);
+    
+    // The torch traces on the coarse field
+    TorchRayConfig config;
+    config.length = 3.0f;
+    TorchRayPaths paths;
+    tracer.trace(0.0f, 0.0f, 0.0f, config, paths);
+    for (int ray = 0; ray < config.rayCount; ++ray) {
+        EXPECT_GE(paths.pointCounts[ray], 1);
+    }
+}
+
+TEST(TorchRayTest, FieldTracingMatchesAcrossBackendsAndApproximatesExact) {
+    std::vector<Obstacle> obstacles = makeTorchObstacles(11, 60, 4.0f);
+    TorchRayConfig config;
+    config.length = 3.0f;
+    config.rayCount = 301;
+    ThreadPool pool(4);
+    
+    TorchRayTracer exact;
+    exact.setObstacles(obstacles.data(), obstacles.size());
+    TorchRayTracer reference;
+    reference.setBackend(TorchRayTracer::Backend::Scalar);
+    reference.setObstacles(obstacles.data(), obstacles.size());
+    std::uint64_t version = reference.getObstacleVersion();
+    reference.setFieldCellSize(0.01f);
+    EXPECT_NE(reference.getObstacleVersion(), version);
+    EXPECT_FALSE(reference.getField().empty());
+    
+    for (auto backend : {TorchRayTracer::Backend::SSE, TorchRayTracer::Backend::AVX2}) {
+        if (!TorchRayTracer::isSupported(backend)) continue;
+        TorchRayTracer tracer;
+        tracer.setBackend(backend);
+        tracer.setFieldCellSize(0.01f);  // Baked once the obstacles arrive
+        tracer.setObstacles(obstacles.data(), obstacles.size());
+        for (int i = 0; i < 8; ++i) {
+            TorchRayPaths expected, actual;
+            reference.trace(0.0f, 0.0f, 0.8f * i, config, expected);
+            tracer.trace(0.0f, 0.0f, 0.8f * i, config, actual, (i % 2) ? &pool : nullptr);
+            ASSERT_EQ(expected.pointCounts, actual.pointCounts) << TorchRayTracer::backendName(backend);
+            ASSERT_EQ(expected.vertices, actual.vertices) << TorchRayTracer::backendName(backend);
+        }
+    }
+    
+    // Baked rays follow the exact ones closely and still stop at the walls
+    int sameLength = 0;
+    float maxDeviation = 0.0f;
+    for (int i = 0; i < 8; ++i) {
+        TorchRayPaths expected, actual;
+        exact.trace(0.0f, 0.0f, 0.8f * i, config, expected);
+        reference.trace(0.0f, 0.0f, 0.8f * i, config, actual);
+        for (int ray = 0; ray < config.rayCount; ++ray) {
+            int common = std::min(expected.pointCounts[ray], actual.pointCounts[ray]);
+            if (expected.pointCounts[ray] == actual.pointCounts[ray]) ++sameLength;
+            for (int k = 0; k < common * 2; ++k) {
+                maxDeviation = std::max(maxDeviation, std::abs(expected.ray(ray)[k] - actual.ray(ray)[k]));
+            }
+        }
+    }
+    EXPECT_GT(sameLength, 8 * config.rayCount * 95 / 100);
+    EXPECT_LT(maxDeviation, 0.05f);
+    
+    reference.setFieldCellSize(0.0f);
+    EXPECT_TRUE(reference.getField().empty());
+    TorchRayPaths expected, actual;
+    exact.trace(0.0f, 0.0f, 0.5f, config, expected);
+    reference.trace(0.0f, 0.0f, 0.5f, config, actual);
+    EXPECT_EQ(expected.vertices, actual.vertices);
+    EXPECT_THROW(reference.setFieldCellSize(-1.0f), std::invalid_argument);
+}
+
+// Geometry batch tests
+TEST(GeometryBatchTest, CircleTessellatesToTriangleFan) {
+    GeometryBatch batch;
+    const BatchColor center{1.0f, 1.0f, 1.0f, 1.0f};
+    const BatchColor rim{0.0f, 0.0f, 0.0f, 0.0f};
+    batch.addCircle(1.0f, 2.0f, 0.5f, 0.25f, 8, center, rim);
+
+    const std::vector<BatchVertex>& vertices = batch.getVertices();
+    ASSERT_EQ(vertices.size(), 8u * 3);
+    ASSERT_EQ(batch.getCommands().size(), 1u);
+    EXPECT_EQ(batch.getCommands()[0].primitive, BatchPrimitive::Triangles);
+    EXPECT_EQ(batch.getCommands()[0].count, 8u * 3);
+
+    for (std::size_t i = 0; i < vertices.size(); i += 3) {
+        // Every triangle shares the centre and has two rim points
+        EXPECT_FLOAT_EQ(vertices[i].x, 1.0f);
+        EXPECT_FLOAT_EQ(vertices[i].y, 2.0f);
+        EXPECT_FLOAT_EQ(vertices[i].color.a, 1.0f);
+        for (int k = 1; k <= 2; ++k) {
+            const BatchVertex& v = vertices[i + k];
+            EXPECT_NEAR(std::hypot(v.x - 1.0f, v.y - 2.0f), 0.25f, 1e-6f);
+            EXPECT_FLOAT_EQ(v.z, 0.5f);
+            EXPECT_FLOAT_EQ(v.color.a, 0.0f);
+        }
+        // Consecutive triangles are joined like a fan
+        if (i + 3 < vertices.size()) {
+            EXPECT_FLOAT_EQ(vertices[i + 2].x, vertices[i + 4].x);
+            EXPECT_FLOAT_EQ(vertices[i + 2].y, vertices[i + 4].y);
+        }
+    }
+
+    batch.addCircle(0.0f, 0.0f, 0.0f, 1.0f, 2, center, rim);
+    EXPECT_EQ(vertices.size(), 8u * 3);  // Degenerate circles add nothing
+}
+
+TEST(GeometryBatchTest, QuadStripAndLineStripTessellation) {
+    GeometryBatch batch;
+    const BatchColor white{1.0f, 1.0f, 1.0f, 1.0f};
+    std::vector<BatchVertex> strip;
+    for (int row = 0; row < 4; ++row) {
+        strip.push_back(BatchVertex{0.0f, static_cast<float>(row), 0.0f, white});
+        strip.push_back(BatchVertex{1.0f, static_cast<float>(row), 0.0f, white});
+    }
+
+    batch.addQuadStrip(strip.data(), strip.size());
+    EXPECT_EQ(batch.getVertices().size(), 3u * 6);  // 3 quads of 2 triangles
+
+    batch.clear();
+    batch.addLineStrip(strip.data(), 5, 2.0f);
+    ASSERT_EQ(batch.getVertices().size(), 4u * 2);
+    ASSERT_EQ(batch.getCommands().size(), 1u);
+    EXPECT_EQ(batch.getCommands()[0].primitive, BatchPrimitive::Lines);
+    EXPECT_FLOAT_EQ(batch.getCommands()[0].lineWidth, 2.0f);
+    // Segment ends are shared with the next segment's start
+    EXPECT_FLOAT_EQ(batch.getVertices()[1].y, batch.getVertices()[2].y);
+}
+
+TEST(GeometryBatchTest, RunsMergeUntilPrimitiveOrWidthChanges) {
+    GeometryBatch batch;
+    const BatchColor color{0.5f, 0.5f, 0.5f, 1.0f};
+    const BatchVertex a{0.0f, 0.0f, 0.0f, color};
+    const BatchVertex b{1.0f, 0.0f, 0.0f, color};
+
+    batch.addRectangle(0.0f, 0.0f, 1.0f, 1.0f, 0.0f, color);
+    batch.addCircle(0.0f, 0.0f, 0.0f, 1.0f, 4, color, color);
+    batch.addLine(a, b);
+    batch.addLine(a, b);
+    batch.addLine(a, b, 3.0f);
+    batch.addRectangle(0.0f, 0.0f, 1.0f, 1.0f, 0.0f, color);
+
+    const std::vector<BatchCommand>& commands = batch.getCommands();
+    ASSERT_EQ(commands.size(), 4u);
+    EXPECT_EQ(commands[0].primitive, BatchPrimitive::Triangles);
+    EXPECT_EQ(commands[0].count, 6u + 12u);
+    EXPECT_EQ(commands[1].primitive, BatchPrimitive::Lines);
+    EXPECT_EQ(commands[1].count, 4u);
+    EXPECT_FLOAT_EQ(commands[2].lineWidth, 3.0f);
+    EXPECT_EQ(commands[3].first, 18u + 6u);
+
+    // Commands tile the vertex buffer in submission order
+    std::uint32_t next = 0;
+    for (const BatchCommand& command : commands) {
+        EXPECT_EQ(command.first, next);
+        next += command.count;
+    }
+    EXPECT_EQ(next, batch.getVertices().size());
+
+    // Clearing keeps the storage for the next frame
+    const std::size_t capacity = batch.getVertices().capacity();
+    batch.clear();
+    EXPECT_TRUE(batch.empty());
+    EXPECT_TRUE(batch.getCommands().empty());
+    EXPECT_EQ(batch.getVertices().capacity(), capacity);
+}
+
+TEST(GeometryBatchTest, PackParticleInstances) {
+    std::vector<Vector3D> positions = {Vector3D(1.5, -2.0, 0.25), Vector3D(-3.0, 4.0, 0.0)};
+    const BatchColor color{0.3f, 0.7f, 1.0f, 1.0f};
+    std::vector<ParticleInstance> instances(positions.size());
+    packParticleInstances(positions.data(), positions.size(), 0.06f, color, instances.data());
+
+    static_assert(sizeof(ParticleInstance) == 32, "Instance layout must match the GPU attributes");
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        EXPECT_FLOAT_EQ(instances[i].x, static_cast<float>(positions[i].x));
+        EXPECT_FLOAT_EQ(instances[i].y, static_cast<float>(positions[i].y));
+        EXPECT_FLOAT_EQ(instances[i].z, static_cast<float>(positions[i].z));
+        EXPECT_FLOAT_EQ(instances[i].radius, 0.06f);
+        EXPECT_FLOAT_EQ(instances[i].color.g, 0.7f);
+    }
+}
+
+// Scene tests
+TEST(SceneTest, ParseSceneNames) {
+    Scene scene = Scene::Single;
+    EXPECT_TRUE(parseScene("galaxy", scene));
+    EXPECT_EQ(scene, Scene::Galaxy);
+    EXPECT_TRUE(parseScene(sceneName(Scene::Cloth), scene));
+    EXPECT_EQ(scene, Scene::Cloth);
+    EXPECT_FALSE(parseScene("nebula", scene));
+}
+
+TEST(SceneTest, ScenesAreReproducibleAndReplacePreviousState) {
+    Simulation a;
+    Simulation b;
+    loadScene(a, Scene::Cloud, 500, 7);
+    a.addForceGenerator<LinearDrag>(1.0);
+    loadScene(a, Scene::Cloud, 500, 7);  // Reloading discards the extra generator
+    loadScene(b, Scene::Cloud, 500, 7);
+    ASSERT_EQ(a.getParticles().size(), 500u);
+
+    for (int i = 0; i < 10; ++i) {
+        a.step(0.01);
+        b.step(0.01);
+    }
+    for (std::size_t i = 0; i < a.getParticles().size(); ++i) {
+        EXPECT_EQ(a.getParticles().positions()[i].x, b.getParticles().positions()[i].x);
+        EXPECT_EQ(a.getParticles().positions()[i].y, b.getParticles().positions()[i].y);
+    }
+
+    loadScene(a, Scene::Cloth, 110, 7);
+    EXPECT_EQ(a.getParticles().size(), 100u);  // Rounded down to a 10x10 grid
+    loadScene(a, Scene::Single, 1000);
+    EXPECT_EQ(a.getParticles().size(), 1u);
+    EXPECT_EQ(a.getGravity(), 0.0);
+}
+
+// Snapshot tests
+namespace {
+std::string snapshotPath(const char* name) {
+    return testing::TempDir() + name;
+}
+
+void expectSameState(const ParticleStore& a, const ParticleStore& b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        EXPECT_EQ(a.positions()[i].x, b.positions()[i].x);
+        EXPECT_EQ(a.positions()[i].y, b.positions()[i].y);
+        EXPECT_EQ(a.positions()[i].z, b.positions()[i].z);
+        EXPECT_EQ(a.velocities()[i].x, b.velocities()[i].x);
+        EXPECT_EQ(a.velocities()[i].z, b.velocities()[i].z);
+        EXPECT_EQ(a.masses()[i], b.masses()[i]);
+        EXPECT_EQ(a.name(i), b.name(i));
+    }
+}
+}
+
+TEST(SnapshotTest, RoundTripRestoresStateAndSettings) {
+    Simulation original;
+    loadScene(original, Scene::Cloud, 300, 3);
+    original.setIntegrator(Integrator::Leapfrog);
+    original.addParticle(2.0, Vector3D(1, 2, 3), Vector3D(-1, 0, 0), "Probe");
+    original.step(0.01);
+
+    const std::string path = snapshotPath("round_trip.snap");
+    original.saveSnapshot(path);
+
+    Simulation restored;
+    restored.loadSnapshot(path);
+    EXPECT_TRUE(restored.getParticles().isAdopted());
+    expectSameState(original.getParticles(), restored.getParticles());
+    EXPECT_EQ(restored.getParticles().name(300), "Probe");
+    EXPECT_EQ(restored.getIntegrator(), Integrator::Leapfrog);
+    EXPECT_EQ(restored.getGravity(), original.getGravity());
+    EXPECT_EQ(restored.getDamping(), original.getDamping());
+
+    // The restarted run continues exactly like the original
+    for (int i = 0; i < 5; ++i) {
+        original.step(0.01);
+        restored.step(0.01);
+    }
+    expectSameState(original.getParticles(), restored.getParticles());
+
+    // Stepping writes to the private mapping, never to the file
+    Simulation reloaded;
+    reloaded.loadSnapshot(path);
+    EXPECT_NE(reloaded.getParticles().positions()[0].y, restored.getParticles().positions()[0].y);
+    std::remove(path.c_str());
+}
+
+namespace {
+// Steps a scene, restarts a fresh simulation from a snapshot of it, and
+// checks that both runs stay identical
+void expectRestartMatchesContinuousRun(Scene scene, std::size_t particleCount, Integrator integrator,
+                                       const char* fileName) {
+    Simulation continuous;
+    continuous.setIntegrator(integrator);
+    loadScene(continuous, scene, particleCount, 7);
+    for (int i = 0; i < 10; ++i) {
+        continuous.step(0.002);
+    }
+
+    const std::string path = snapshotPath(fileName);
+    continuous.saveSnapshot(path);
+    Simulation restarted;
+    restarted.loadSnapshot(path);
+    std::remove(path.c_str());
+
+    for (int i = 0; i < 20; ++i) {
+        continuous.step(0.002);
+        restarted.step(0.002);
+    }
+    expectSameState(continuous.getParticles(), restarted.getParticles());
+}
+
+class PushAwayFromOrigin : public ForceGenerator {
+public:
+    void apply(ParticleStore& particles, std::size_t begin, std::size_t end) const override {
+        for (std::size_t i = begin; i < end; ++i) {
+            particles.forces()[i] += particles.positions()[i];
+        }
+    }
+};
+}
+
+TEST(SnapshotTest, GalaxyRestartMatchesContinuousRun) {
+    expectRestartMatchesContinuousRun(Scene::Galaxy, 400, Integrator::VelocityVerlet, "galaxy_restart.snap");
+
+    // The solver configuration comes back with the particles
+    Simulation original;
+    loadScene(original, Scene::Galaxy, 50, 7);
+    original.getGravitySolver().setOpeningAngle(0.7);
+    const std::string path = snapshotPath("galaxy_settings.snap");
+    original.saveSnapshot(path);
+    Simulation restored;
+    restored.loadSnapshot(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(restored.getGravitySolver().getMode(), GravitySolver::Mode::BarnesHut);
+    EXPECT_EQ(restored.getGravitySolver().getOpeningAngle(), 0.7);
+    EXPECT_EQ(restored.getGravitySolver().getSoftening(), original.getGravitySolver().getSoftening());
+    EXPECT_EQ(restored.getGravitySolver().getGravitationalConstant(),
+              original.getGravitySolver().getGravitationalConstant());
+}
+
+TEST(SnapshotTest, ClothRestartMatchesContinuousRun) {
+    expectRestartMatchesContinuousRun(Scene::Cloth, 400, Integrator::SemiImplicitEuler, "cloth_restart.snap");
+
+    // Springs and other built-in generators are restored in order, replacing
+    // whatever the loading simulation had registered
+    Simulation original;
+    loadScene(original, Scene::Cloth, 100, 7);
+    original.addForceGenerator<PointAttractor>(Vector3D(0.5, -0.5, 1.0), 2.0, 0.2);
+    const std::string path = snapshotPath("cloth_settings.snap");
+    original.saveSnapshot(path);
+
+    Simulation restored;
+    restored.addForceGenerator<LinearDrag>(3.0);
+    restored.loadSnapshot(path);
+    std::remove(path.c_str());
+    for (int i = 0; i < 5; ++i) {
+        original.step(0.002);
+        restored.step(0.002);
+    }
+    expectSameState(original.getParticles(), restored.getParticles());
+}
+
+TEST(SnapshotTest, CollisionRestartMatchesContinuousRun) {
+    Simulation continuous;
+    loadScene(continuous, Scene::Cloud, 300, 8);
+    ParticleCollider& collider = continuous.getParticleCollider();
+    collider.setEnabled(true);
+    collider.setRestitution(0.4);
+    std::vector<double> radii(300);
+    for (std::size_t i = 0; i < radii.size(); ++i) {
+        radii[i] = 0.1 + 0.001 * i;
+    }
+    collider.setRadii(radii);
+    continuous.step(0.01);
+
+    const std::string path = snapshotPath("collision_restart.snap");
+    continuous.saveSnapshot(path);
+    Simulation restarted;
+    restarted.loadSnapshot(path);
+    std::remove(path.c_str());
+    EXPECT_TRUE(restarted.getParticleCollider().isEnabled());
+    EXPECT_EQ(restarted.getParticleCollider().getRestitution(), 0.4);
+    EXPECT_EQ(restarted.getParticleCollider().getRadii(), radii);
+
+    for (int i = 0; i < 10; ++i) {
+        continuous.step(0.01);
+        restarted.step(0.01);
+    }
+    expectSameState(continuous.getParticles(), restarted.getParticles());
+}
+
+TEST(SnapshotTest, RefusesForceGeneratorsWithoutStoredForm) {
+    Simulation simulation;
+    loadScene(simulation, Scene::Cloud, 10, 2);
+    simulation.addForceGenerator<PushAwayFromOrigin>();
+    const std::string path = snapshotPath("custom_force.snap");
+    EXPECT_THROW(simulation.saveSnapshot(path), std::invalid_argument);
+    EXPECT_THROW(simulation.getSnapshotSettings(), std::invalid_argument);
+}
+
+TEST(SnapshotTest, AddingToAdoptedStoreCopiesArrays) {
+    Simulation original;
+    loadScene(original, Scene::Cloud, 50, 4);
+    const std::string path = snapshotPath("adopted.snap");
+    original.saveSnapshot(path);
+
+    Simulation restored;
+    restored.loadSnapshot(path);
+    std::remove(path.c_str());  // The mapping stays valid after the file is unlinked
+
+    restored.addParticle(1.0, Vector3D(9, 9, 9), Vector3D(0, 0, 0), "Late");
+    EXPECT_FALSE(restored.getParticles().isAdopted());
+    ASSERT_EQ(restored.getParticles().size(), 51u);
+    EXPECT_EQ(restored.getParticles().positions()[10].x, original.getParticles().positions()[10].x);
+    EXPECT_EQ(restored.getParticles().inverseMasses()[10], original.getParticles().inverseMasses()[10]);
+    EXPECT_EQ(restored.getParticles().name(50), "Late");
+    EXPECT_EQ(restored.getParticles().name(0), "");
+}
+
+TEST(SnapshotTest, BackgroundSaveCapturesStateAtCallTime) {
+    Simulation simulation;
+    loadScene(simulation, Scene::Cloud, 2000, 5);
+    simulation.step(0.01);
+
+    Simulation expected;
+    loadScene(expected, Scene::Cloud, 2000, 5);
+    expected.step(0.01);
+
+    const std::string path = snapshotPath("background.snap");
+    SnapshotWriter writer;
+    writer.save(path, simulation.getParticles(), simulation.getSnapshotSettings());
+    for (int i = 0; i < 10; ++i) {
+        simulation.step(0.01);  // Keeps running while the file is written
+    }
+    writer.wait();
+    EXPECT_FALSE(writer.isBusy());
+
+    Simulation restored;
+    restored.loadSnapshot(path);
+    expectSameState(expected.getParticles(), restored.getParticles());
+    std::remove(path.c_str());
+
+    // Write errors surface from wait()
+    writer.save(testing::TempDir() + "missing_dir/x.snap", simulation.getParticles(),
+                simulation.getSnapshotSettings());
+    EXPECT_THROW(writer.wait(), std::runtime_error);
+}
+
+TEST(SnapshotTest, RejectsCorruptFiles) {
+    Simulation simulation;
+    loadScene(simulation, Scene::Cloud, 100, 6);
+    const std::string path = snapshotPath("corrupt.snap");
+    simulation.saveSnapshot(path);
+
+    // Cut the file short: the arrays no longer fit
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    std::vector<char> bytes(4096);
+    std::size_t size = std::fread(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+    file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, size, file);
+    std::fclose(file);
+    EXPECT_THROW(simulation.loadSnapshot(path), std::runtime_error);
+
+    // Wrong magic
+    bytes[0] = 'X';
+    file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, sizeof(SnapshotHeader), file);
+    std::fclose(file);
+    EXPECT_THROW(simulation.loadSnapshot(path), std::runtime_error);
+    EXPECT_THROW(simulation.loadSnapshot(snapshotPath("does_not_exist.snap")), std::runtime_error);
+
+    // A failed load leaves the simulation as it was
+    EXPECT_EQ(simulation.getParticles().size(), 100u);
+    std::remove(path.c_str());
+}
+
+// Trajectory tests
+namespace {
+// Records a falling cloud, keeping a copy of every frame for comparison
+std::vector<std::vector<Vector3D>> recordCloud(const std::string& path, std::size_t particles, int frames,
+                                                const TrajectoryOptions& options) {
+    Simulation simulation;
+    loadScene(simulation, Scene::Cloud, particles, 9);
+    std::vector<std::vector<Vector3D>> expected;
+    TrajectoryWriter writer(path, particles, options);
+    for (int i = 0; i < frames; ++i) {
+        simulation.step(0.01);
+        const Vector3D* positions = simulation.getParticles().positions();
+        expected.emplace_back(positions, positions + particles);
+        writer.record(simulation.getParticles(), 100 + i);
+    }
+    writer.close();
+    EXPECT_EQ(writer.getFrameCount(), static_cast<std::uint64_t>(frames));
+    return expected;
+}
+}
+
+TEST(TrajectoryTest, ExactModeRoundTripsBitForBit) {
+    const std::string path = snapshotPath("exact.traj");
+    TrajectoryOptions options;
+    options.framesPerChunk = 8;
+    std::vector<std::vector<Vector3D>> expected = recordCloud(path, 200, 30, options);
+
+    TrajectoryReader reader(path);
+    EXPECT_EQ(reader.getParticleCount(), 200u);
+    ASSERT_EQ(reader.getFrameCount(), 30u);
+    std::vector<Vector3D> positions;
+    for (std::uint64_t frame = 0; frame < 30; ++frame) {
+        EXPECT_EQ(reader.readFrame(frame, positions), 100 + frame);
+        for (std::size_t i = 0; i < 200; ++i) {
+            ASSERT_EQ(positions[i].x, expected[frame][i].x);
+            ASSERT_EQ(positions[i].y, expected[frame][i].y);
+            ASSERT_EQ(positions[i].z, expected[frame][i].z);
+        }
+    }
+
+    // Seeking backwards and into the middle of a chunk
+    for (std::uint64_t frame : {29u, 3u, 17u, 16u, 0u, 23u}) {
+        EXPECT_EQ(reader.readFrame(frame, positions), 100 + frame);
+        EXPECT_EQ(positions[57].y, expected[frame][57].y);
+    }
+    EXPECT_THROW(reader.readFrame(30, positions), std::out_of_range);
+    std::remove(path.c_str());
+}
+
+TEST(TrajectoryTest, QuantizedModeStaysWithinHalfAQuantum) {
+    const std::string path = snapshotPath("quantized.traj");
+    TrajectoryOptions options;
+    options.quantum = 1e-4;
+    std::vector<std::vector<Vector3D>> expected = recordCloud(path, 500, 20, options);
+
+    TrajectoryReader reader(path);
+    EXPECT_EQ(reader.getQuantum(), 1e-4);
+    std::vector<Vector3D> positions;
+    for (std::uint64_t frame : {19u, 0u, 7u}) {
+        reader.readFrame(frame, positions);
+        for (std::size_t i = 0; i < 500; ++i) {
+            EXPECT_NEAR(positions[i].x, expected[frame][i].x, 0.5e-4 + 1e-12);
+            EXPECT_NEAR(positions[i].y, expected[frame][i].y, 0.5e-4 + 1e-12);
+        }
+    }
+
+    // Deltas between steps are a few quanta: far smaller than raw doubles
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fclose(file);
+    EXPECT_LT(size, static_cast<long>(20 * 500 * sizeof(Vector3D) / 3));
+    std::remove(path.c_str());
+
+    // Values the quantum cannot represent are reported on close
+    TrajectoryWriter writer(path, 1, options);
+    Vector3D huge(1e300, 0, 0);
+    writer.record(&huge, 0);
+    EXPECT_THROW(writer.close(), std::range_error);
+    std::remove(path.c_str());
+}
+
+TEST(TrajectoryTest, UnclosedFileIsReadableUpToLastChunk) {
+    const std::string path = snapshotPath("unclosed.traj");
+    TrajectoryOptions options;
+    options.framesPerChunk = 4;
+    std::vector<std::vector<Vector3D>> expected = recordCloud(path, 50, 10, options);
+
+    // Drop the index and footer, and cut the last chunk short
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    std::vector<char> bytes(1 << 20);
+    std::size_t size = std::fread(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+    std::size_t indexBytes = 3 * 24 + 32;  // Three chunk entries and the footer
+    file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, size - indexBytes - 10, file);
+    std::fclose(file);
+
+    TrajectoryReader reader(path);
+    ASSERT_EQ(reader.getFrameCount(), 8u);  // Two complete chunks survive
+    std::vector<Vector3D> positions;
+    EXPECT_EQ(reader.readFrame(6, positions), 106u);
+    EXPECT_EQ(positions[10].x, expected[6][10].x);
+    std::remove(path.c_str());
+
+    EXPECT_THROW(TrajectoryReader(snapshotPath("does_not_exist.traj")), std::runtime_error);
+    EXPECT_THROW(TrajectoryWriter(path, 10, TrajectoryOptions{-1.0}), std::invalid_argument);
+}
+
+// Input record-and-replay tests
+namespace {
+// Plays a scripted session and returns the player's final position
+Vector3D playSession(std::uint32_t seed, const std::vector<std::uint8_t>& keyMasks, InputRecording* recording) {
+    Simulation simulation;
+    simulation.initialize();
+    PlayerController player(simulation, 4.0f / 3.0f, seed);
+    player.buildMap();
+    player.spawn();
+    if (recording) player.startRecording(1.0 / 240.0);
+    for (std::uint8_t mask : keyMasks) {
+        player.setKeyMask(mask);
+        player.tick(1.0 / 240.0);
+    }
+    if (recording) *recording = player.getRecording();
+    return simulation.getParticles().positions()[0];
+}
+}
+
+TEST(InputReplayTest, RecordedSessionReplaysExactly) {
+    // Walk into walls, turn the torch, then stand still
+    std::vector<std::uint8_t> script;
+    for (int i = 0; i < 300; ++i) script.push_back(inputKeyBit(InputKey::W) | inputKeyBit(InputKey::D));
+    for (int i = 0; i < 200; ++i) script.push_back(inputKeyBit(InputKey::A) | inputKeyBit(InputKey::K));
+    for (int i = 0; i < 50; ++i) script.push_back(0);
+
+    InputRecording recording;
+    Vector3D original = playSession(42, script, &recording);
+    EXPECT_EQ(recording.seed, 42u);
+    EXPECT_EQ(recording.keyMasks, script);
+
+    const std::string path = snapshotPath("session.input");
+    writeInputRecording(path, recording);
+    InputRecording loaded = readInputRecording(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(loaded.step, 1.0 / 240.0);
+    EXPECT_EQ(loaded.mapAspectRatio, 4.0f / 3.0f);
+    EXPECT_EQ(loaded.mapFingerprint, defaultMap(4.0f / 3.0f).fingerprint());
+
+    Vector3D replayed = playSession(loaded.seed, loaded.keyMasks, nullptr);
+    EXPECT_EQ(replayed.x, original.x);
+    EXPECT_EQ(replayed.y, original.y);
+
+    EXPECT_THROW(readInputRecording(snapshotPath("missing.input")), std::runtime_error);
+}
+
+TEST(InputReplayTest, RecordingIdentifiesItsMap) {
+    // Any change to the walls, spawns or markers changes the fingerprint
+    const GameMap original = defaultMap(4.0f / 3.0f);
+    GameMap moved = defaultMap(4.0f / 3.0f);
+    moved.addObstacle(Obstacle(100.0f, 100.0f, 1.0f, 1.0f));
+    GameMap renamed = defaultMap(4.0f / 3.0f);
+    renamed.addLabel(MapLabel{0.0f, 0.0f, "MID"});
+    EXPECT_NE(moved.fingerprint(), original.fingerprint());
+    EXPECT_NE(renamed.fingerprint(), original.fingerprint());
+    EXPECT_NE(defaultMap(16.0f / 9.0f).fingerprint(), original.fingerprint());
+
+    // Version 1 recordings carry no fingerprint and read back as unknown
+    InputRecording recording;
+    recording.seed = 9;
+    recording.mapFingerprint = moved.fingerprint();
+    recording.keyMasks = {1, 2, 3};
+    const std::string path = snapshotPath("fingerprint.input");
+    writeInputRecording(path, recording);
+    EXPECT_EQ(readInputRecording(path).mapFingerprint, moved.fingerprint());
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    std::vector<char> bytes(64);
+    bytes.resize(std::fread(bytes.data(), 1, bytes.size(), file));
+    std::fclose(file);
+    ASSERT_EQ(bytes.size(), 48u + 3u);
+    const std::uint32_t version1 = 1;
+    std::memcpy(bytes.data() + 8, &version1, sizeof(version1));
+    bytes.erase(bytes.begin() + 40, bytes.begin() + 48);
+    file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+    InputRecording legacy = readInputRecording(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(legacy.mapFingerprint, 0u);
+    EXPECT_EQ(legacy.seed, 9u);
+    EXPECT_EQ(legacy.keyMasks, recording.keyMasks);
+}
+
+TEST(InputReplayTest, SpawnAndMovementFollowSeedAndKeys) {
+    // Both spawn points are reachable, and a seed always picks the same one
+    bool sawDefender = false;
+    bool sawAttacker = false;
+    for (std::uint32_t seed = 0; seed < 16; ++seed) {
+        Vector3D spawn = playSession(seed, {}, nullptr);
+        EXPECT_EQ(spawn.y, playSession(seed, {}, nullptr).y);
+        (spawn.y > 0 ? sawDefender : sawAttacker) = true;
+    }
+    EXPECT_TRUE(sawDefender);
+    EXPECT_TRUE(sawAttacker);
+
+    // Holding S for 0.1 s moves the player down at the move speed (9 units/s)
+    Vector3D start = playSession(3, {}, nullptr);
+    Vector3D moved = playSession(3, std::vector<std::uint8_t>(24, inputKeyBit(InputKey::S)), nullptr);
+    EXPECT_NEAR(start.y - moved.y, 0.9, 1e-9);
+    EXPECT_EQ(moved.x, start.x);
+}
+
+// Map format tests
+namespace {
+void expectSameWalls(const GameMap& a, const GameMap& b) {
+    ASSERT_EQ(a.getObstacleCount(), b.getObstacleCount());
+    for (std::size_t i = 0; i < a.getObstacleCount(); ++i) {
+        EXPECT_EQ(a.getObstacles()[i].x, b.getObstacles()[i].x);
+        EXPECT_EQ(a.getObstacles()[i].y, b.getObstacles()[i].y);
+        EXPECT_EQ(a.getObstacles()[i].width, b.getObstacles()[i].width);
+        EXPECT_EQ(a.getObstacles()[i].height, b.getObstacles()[i].height);
+    }
+}
+}
+
+TEST(GameMapTest, TextAndCompiledFormsMatchTheBuiltInLayout) {
+    const GameMap original = defaultMap(4.0f / 3.0f);
+    EXPECT_EQ(original.getObstacleCount(), 19u);
+    ASSERT_EQ(original.getSpawns().size(), 2u);
+    EXPECT_EQ(original.getLabels().size(), 16u);
+
+    const std::string textPath = snapshotPath("default.map");
+    const std::string compiledPath = snapshotPath("default.pmap");
+    writeMapText(textPath, original);
+    GameMap text = loadMap(textPath);
+    EXPECT_FALSE(text.isMapped());
+    expectSameWalls(original, text);
+    EXPECT_EQ(text.getLabels()[0].text, "DEFENDER SIDE SPAWN");
+    EXPECT_EQ(text.getSites()[1].name, "B");
+    EXPECT_EQ(text.getBounds().maxX, original.getBounds().maxX);
+
+    writeCompiledMap(compiledPath, text);
+    GameMap compiled = loadMap(compiledPath);
+    EXPECT_TRUE(compiled.isMapped());
+    expectSameWalls(original, compiled);
+    EXPECT_EQ(compiled.getSpawns()[1].name, "Attacker");
+    EXPECT_EQ(compiled.getSites()[0].radius, 0.3f);
+    EXPECT_EQ(compiled.getLabels().size(), 16u);
+    EXPECT_TRUE(compiled.getGrid().isAdopted());
+    EXPECT_EQ(compiled.getGrid().getColumns(), text.getGrid().getColumns());
+
+    // All three forms identify as the same map
+    EXPECT_EQ(text.fingerprint(), original.fingerprint());
+    EXPECT_EQ(compiled.fingerprint(), original.fingerprint());
+    std::remove(textPath.c_str());
+    std::remove(compiledPath.c_str());
+}
+
+TEST(GameMapTest, MappedWallsCollideLikeCopiedOnes) {
+    // A few thousand random walls, compiled and mapped
+    GameMap generated;
+    generated.setBounds(MapBounds{-100.0f, -100.0f, 100.0f, 100.0f});
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> position(-95.0f, 95.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+    for (int i = 0; i < 5000; ++i) {
+        generated.addObstacle(Obstacle(position(rng), position(rng), size(rng), size(rng)));
+    }
+    generated.buildGrid();
+    const std::string path = snapshotPath("generated.pmap");
+    writeCompiledMap(path, generated);
+    auto mapped = std::make_shared<GameMap>(loadCompiledMap(path));
+    std::remove(path.c_str());  // The mapping stays valid after the file is unlinked
+
+    ObstacleCollider copied;
+    copied.setObstacles(std::vector<Obstacle>(generated.getObstacles(),
+                                              generated.getObstacles() + generated.getObstacleCount()));
+    ObstacleCollider adopted;
+    adopted.adoptObstacles(mapped, mapped->getObstacles(), mapped->getObstacleCount(), mapped->getGrid().getBaked());
+    EXPECT_EQ(adopted.getObstacleCount(), 5000u);
+
+    std::uniform_real_distribution<double> start(-90.0, 90.0);
+    std::uniform_real_distribution<double> move(-5.0, 5.0);
+    for (int i = 0; i < 500; ++i) {
+        double x = start(rng), y = start(rng), dx = move(rng), dy = move(rng);
+        EXPECT_EQ(copied.overlaps(x, y, 0.2), adopted.overlaps(x, y, 0.2));
+        SlideResult a = copied.slide(x, y, dx, dy, 0.2);
+        SlideResult b = adopted.slide(x, y, dx, dy, 0.2);
+        EXPECT_EQ(a.x, b.x);
+        EXPECT_EQ(a.y, b.y);
+        EXPECT_EQ(a.contactCount, b.contactCount);
+    }
+
+    // Growing a mapped map copies its walls first
+    GameMap grown = *mapped;
+    grown.addObstacle(Obstacle(0, 0, 1, 1));
+    EXPECT_FALSE(grown.isMapped());
+    EXPECT_EQ(grown.getObstacleCount(), 5001u);
+}
+
+TEST(GameMapTest, RejectsMalformedMaps) {
+    const std::string path = snapshotPath("bad.map");
+    auto writeText = [&](const char* text) {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        std::fputs(text, file);
+        std::fclose(file);
+    };
+
+    writeText("# comment\nwall 0 0 1 1\nwall 1 2 -1 1\n");
+    try {
+        readMapText(path);
+        FAIL() << "Negative wall size accepted";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find(":3:"), std::string::npos);
+    }
+    writeText("door 0 0\n");
+    EXPECT_THROW(readMapText(path), std::runtime_error);
+    writeText("bounds 1 1 0 0\n");
+    EXPECT_THROW(readMapText(path), std::runtime_error);
+
+    // A compiled map whose grid points past its walls
+    writeCompiledMap(path, defaultMap(1.0f));
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    std::vector<char> bytes(1 << 16);
+    std::size_t size = std::fread(bytes.data(), 1, bytes.size(), file);
+    std::uint64_t cellItemsOffset;
+    std::memcpy(&cellItemsOffset, bytes.data() + 96, sizeof(cellItemsOffset));  // Header's cellItemsOffset
+    std::uint32_t badIndex = 1000;
+    std::memcpy(bytes.data() + cellItemsOffset, &badIndex, sizeof(badIndex));
+    std::rewind(file);
+    std::fwrite(bytes.data(), 1, size, file);
+    std::fclose(file);
+    EXPECT_THROW(loadCompiledMap(path), std::runtime_error);
+
+    // Compiled walls with a negative size or a NaN position
+    writeCompiledMap(path, defaultMap(1.0f));
+    file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    size = std::fread(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+    std::uint64_t wallsOffset;
+    std::memcpy(&wallsOffset, bytes.data() + 24, sizeof(wallsOffset));  // Header's wallsOffset
+    struct BadWall { std::size_t field; float value; };  // Field: 0 x, 1 y, 2 width, 3 height
+    const BadWall badWalls[] = {{2, -1.0f}, {0, std::numeric_limits<float>::quiet_NaN()}};
+    for (const BadWall& bad : badWalls) {
+        std::vector<char> corrupt(bytes.begin(), bytes.begin() + size);
+        std::memcpy(corrupt.data() + wallsOffset + bad.field * sizeof(float), &bad.value, sizeof(float));
+        file = std::fopen(path.c_str(), "wb");
+        std::fwrite(corrupt.data(), 1, corrupt.size(), file);
+        std::fclose(file);
+        EXPECT_THROW(loadCompiledMap(path), std::runtime_error);
+    }
+
+    // Truncated
+    file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, 100, file);
+    std::fclose(file);
+    EXPECT_THROW(loadCompiledMap(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+// Profiler tests
+TEST(ProfilerTest, FrameStatisticsCoverTheRecentHistory) {
+    Profiler profiler(16);
+    const std::uint32_t physics = profiler.registerZone("physics");
+    const std::uint32_t render = profiler.registerZone("render");
+    EXPECT_EQ(profiler.registerZone("physics"), physics);
+
+    // Disabled: nothing is recorded and frames are not counted
+    { ProfileZone zone(profiler, physics); }
+    profiler.endFrame();
+    EXPECT_EQ(profiler.getFrameCount(), 0u);
+    EXPECT_TRUE(profiler.getEvents().empty());
+
+    // 100 frames: physics takes i ms in frame i (twice i/2 ms), render 1 ms
+    profiler.setEnabled(true);
+    for (std::uint64_t i = 1; i <= 100; ++i) {
+        const std::uint64_t ms = 1000000;
+        profiler.record(physics, 0, i * ms / 2);
+        profiler.record(physics, 0, i * ms / 2);
+        profiler.record(render, 0, ms);
+        profiler.endFrame();
+    }
+    std::vector<ProfileZoneStats> stats = profiler.getStats();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats[0].name, "physics");
+    EXPECT_EQ(stats[0].frames, 100u);
+    EXPECT_NEAR(stats[0].minMs, 1.0, 1e-6);
+    EXPECT_NEAR(stats[0].avgMs, 50.5, 1e-4);
+    EXPECT_NEAR(stats[0].p99Ms, 99.0, 1e-6);
+    EXPECT_DOUBLE_EQ(stats[0].callsPerFrame, 2.0);
+    EXPECT_NEAR(stats[1].p99Ms, 1.0, 1e-6);
+
+    // The history is a ring: after kHistoryFrames more frames the slow ones are gone
+    for (std::size_t i = 0; i < Profiler::kHistoryFrames; ++i) {
+        profiler.record(physics, 0, 2000000);
+        profiler.endFrame();
+    }
+    stats = profiler.getStats();
+    EXPECT_EQ(stats[0].frames, Profiler::kHistoryFrames);
+    EXPECT_NEAR(stats[0].p99Ms, 2.0, 1e-6);
+    EXPECT_NEAR(stats[1].avgMs, 0.0, 1e-9);
+
+    // The event ring keeps only the latest 16 events of the thread
+    EXPECT_EQ(profiler.getEvents().size(), 16u);
+    profiler.reset();
+    EXPECT_EQ(profiler.getFrameCount(), 0u);
+    EXPECT_TRUE(profiler.getEvents().empty());
+}
+
+TEST(ProfilerTest, ExportsNestedZonesFromEveryThread) {
+    Profiler profiler;
+    profiler.setEnabled(true);
+    const std::uint32_t outer = profiler.registerZone("outer \"step\"");
+    const std::uint32_t inner = profiler.registerZone("inner");
+    auto work = [&]() {
+        ProfileZone outerZone(profiler, outer);
+        for (int i = 0; i < 3; ++i) {
+            ProfileZone innerZone(profiler, inner);
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    };
+    work();
+    std::thread other(work);
+    other.join();
+
+    std::vector<ProfileEvent> events = profiler.getEvents();
+    ASSERT_EQ(events.size(), 8u);
+    for (std::size_t i = 1; i < events.size(); ++i) {
+        EXPECT_LE(events[i - 1].startNs, events[i].startNs);
+    }
+    // Each outer zone encloses the inner zones of its thread
+    for (const ProfileEvent& event : events) {
+        if (event.zone != inner) continue;
+        bool enclosed = false;
+        for (const ProfileEvent& parent : events) {
+            enclosed |= parent.zone == outer && parent.thread == event.thread &&
+                        parent.startNs <= event.startNs && event.endNs <= parent.endNs;
+        }
+        EXPECT_TRUE(enclosed);
+        EXPECT_GE(event.endNs - event.startNs, 50000u);
+    }
+
+    const std::string path = snapshotPath("profile.json");
+    profiler.writeChromeTrace(path);
+    std::ifstream file(path);
+    std::string trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(trace.find("\"name\":\"outer \\\"step\\\"\",\"ph\":\"X\",\"pid\":1,\"tid\":1"), std::string::npos);
+    EXPECT_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+    std::size_t count = 0;
+    for (std::size_t at = trace.find("\"ph\":\"X\""); at != std::string::npos; at = trace.find("\"ph\":\"X\"", at + 1)) {
+        ++count;
+    }
+    EXPECT_EQ(count, 8u);
+    std::remove(path.c_str());
+}
+
+// Particle collision tests
+TEST(ParticleCollisionTest, HeadOnCollisionsConserveMomentum) {
+    Simulation simulation;
+    simulation.addParticle(1.0, Vector3D(-0.5, 0, 0), Vector3D(1, 0, 0));
+    simulation.addParticle(1.0, Vector3D(0.5, 0, 0), Vector3D(-1, 0, 0));
+    simulation.addParticle(3.0, Vector3D(10, 0, 0), Vector3D(0, 0, 0));  // Far away, never touched
+    ParticleCollider& collider = simulation.getParticleCollider();
+    collider.setEnabled(true);
+    collider.setRadius(0.1);
+
+    // Elastic: equal masses swap velocities
+    int steps = 0;
+    while (simulation.getParticles().velocities()[0].x > 0.0 && steps < 1000) {
+        simulation.step(0.01);
+        ++steps;
+    }
+    const ParticleStore& particles = simulation.getParticles();
+    EXPECT_EQ(collider.getStats().contacts, 1u);
+    EXPECT_EQ(collider.getStats().pairsTested, 1u);
+    EXPECT_NEAR(particles.velocities()[0].x, -1.0, 1e-12);
+    EXPECT_NEAR(particles.velocities()[1].x, 1.0, 1e-12);
+    EXPECT_GE(particles.positions()[1].x - particles.positions()[0].x, 0.2 - 1e-12);
+
+    // Perfectly inelastic, unequal masses: they move on together with the momentum kept
+    simulation.clearParticles();
+    simulation.addParticle(1.0, Vector3D(0, 0, 0), Vector3D(2, 0, 0));
+    simulation.addParticle(3.0, Vector3D(0.15, 0.05, 0), Vector3D(0, 0, 0));
+    collider.setRestitution(0.0);
+    simulation.step(0.001);
+    EXPECT_EQ(collider.getStats().contacts, 1u);
+    EXPECT_TRUE(collider.getStats().fullSort);
+    Vector3D momentum = particles.velocities()[0] * 1.0 + particles.velocities()[1] * 3.0;
+    EXPECT_NEAR(momentum.x, 2.0, 1e-12);
+    EXPECT_NEAR(momentum.y, 0.0, 1e-12);
+    Vector3D normal = (particles.positions()[1] - particles.positions()[0]).normalize();
+    EXPECT_NEAR((particles.velocities()[1] - particles.velocities()[0]).dot(normal), 0.0, 1e-12);
+
+    EXPECT_THROW(collider.setRestitution(1.5), std::invalid_argument);
+    EXPECT_THROW(collider.setRadius(0.0), std::invalid_argument);
+    collider.setRadii({0.1});
+    EXPECT_THROW(simulation.step(0.001), std::invalid_argument);
+}
+
+TEST(ParticleCollisionTest, SweepFindsEveryTouchingPair) {
+    const std::size_t count = 2000;
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<double> position(0.0, 10.0);
+    std::uniform_real_distribution<double> velocity(-1.0, 1.0);
+    std::uniform_real_distribution<double> size(0.02, 0.12);
+    std::vector<Vector3D> positions(count), velocities(count);
+    std::vector<double> inverseMasses(count, 1.0), radii(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        positions[i] = Vector3D(position(rng), position(rng), 0.0);
+        velocities[i] = Vector3D(velocity(rng), velocity(rng), 0.0);
+        radii[i] = size(rng);
+    }
+    ParticleCollider collider;
+    collider.setRadii(radii);
+
+    auto touchingPairs = [&]() {
+        std::size_t touching = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            for (std::size_t j = i + 1; j < count; ++j) {
+                Vector3D delta = positions[j] - positions[i];
+                double reach = radii[i] + radii[j];
+                touching += delta.dot(delta) < reach * reach;
+            }
+        }
+        return touching;
+    };
+
+    std::size_t totalTouching = 0;
+    for (int step = 0; step < 20; ++step) {
+        std::size_t expected = touchingPairs();
+        totalTouching += expected;
+        collider.resolve(positions.data(), velocities.data(), inverseMasses.data(), count);
+        const ParticleCollisionStats& stats = collider.getStats();
+        EXPECT_EQ(stats.contacts, expected);
+        EXPECT_GE(stats.sweepOverlaps, stats.pairsTested);
+        EXPECT_GE(stats.pairsTested, stats.contacts);
+        EXPECT_LT(stats.pairsTested, count);  // Against about 2 million pairs in all
+        // After the first call only a repair of the previous order is needed
+        EXPECT_EQ(stats.fullSort, step == 0);
+        for (std::size_t i = 0; i < count; ++i) {
+            positions[i] += velocities[i] * 0.01;
+        }
+    }
+    EXPECT_GT(totalTouching, 0u);
+
+    // Scrambled positions fall back to a full sort and are still exact
+    std::shuffle(positions.begin(), positions.end(), rng);
+    std::size_t expected = touchingPairs();
+    collider.resolve(positions.data(), velocities.data(), inverseMasses.data(), count);
+    EXPECT_TRUE(collider.getStats().fullSort);
+    EXPECT_EQ(collider.getStats().contacts, expected);
+}
+
 // Main function to run all tests
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-} 
\ No newline at end of file
+} 
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <random>
+#include <vector>
+#include "obstacle.hpp"
+
+/**
+ * Random thin walls around the origin for torch ray tests
+ *
+ * Alternates horizontal and vertical walls 0.2 thick and 0.3 to 2.5 long,
+ * leaving the torch origin clear. Shared by the test executables.
+ * @param seed Random seed
+ * @param count Walls to try (those touching the origin are skipped)
+ * @param extent Wall centres fall within [-extent, extent] on each axis
+ */
+inline std::vector<Obstacle> makeTorchObstacles(unsigned int seed, int count, float extent) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> length(0.3f, 2.5f);
+    std::vector<Obstacle> obstacles;
+    for (int i = 0; i < count; ++i) {
+        float wall = length(gen);
+        bool horizontal = (i % 2) == 0;
+        Obstacle obstacle(position(gen), position(gen), horizontal ? wall : 0.2f, horizontal ? 0.2f : wall);
+        // Keep the torch origin free
+        if (obstacle.intersectsCircle(0.0f, 0.0f, 0.3f)) continue;
+        obstacles.push_back(obstacle);
+    }
+    return obstacles;
+}
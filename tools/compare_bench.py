@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""Compare two physics_bench JSON runs and fail on slowdowns.
+
+Produce the inputs with:
+    physics_bench --benchmark_out=run.json --benchmark_out_format=json
+
+Benchmarks are matched by name. A benchmark is a regression when its real
+time per iteration grew by more than --max-slowdown (a fraction, 0.10 =
+10%) over the baseline. Exits with status 1 if any benchmark regressed,
+so it can gate a release.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load_times(path):
+    with open(path) as f:
+        data = json.load(f)
+    times = {}
+    for entry in data.get("benchmarks", []):
+        # With repetitions, compare the medians and skip the other aggregates
+        if entry.get("run_type") == "aggregate" and entry.get("aggregate_name") != "median":
+            continue
+        name = entry.get("run_name", entry["name"])
+        times[name] = entry["real_time"] * unit_scale(entry.get("time_unit", "ns"))
+    return times
+
+
+def unit_scale(unit):
+    return {"ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1.0}[unit]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline", help="JSON output of the reference run")
+    parser.add_argument("current", help="JSON output of the run to check")
+    parser.add_argument("--max-slowdown", type=float, default=0.10,
+                        help="largest allowed relative increase in time (default 0.10)")
+    parser.add_argument("--filter", default="", help="only compare benchmarks whose name contains this text")
+    args = parser.parse_args()
+
+    baseline = load_times(args.baseline)
+    current = load_times(args.current)
+
+    regressions = 0
+    compared = 0
+    print(f"{'benchmark':<60} {'baseline':>12} {'current':>12} {'change':>8}")
+    for name in sorted(baseline):
+        if args.filter not in name or name not in current:
+            continue
+        compared += 1
+        change = current[name] / baseline[name] - 1.0
+        flag = ""
+        if change > args.max_slowdown:
+            regressions += 1
+            flag = "  REGRESSION"
+        print(f"{name:<60} {baseline[name] * 1e6:>10.2f}us {current[name] * 1e6:>10.2f}us {change:>+7.1%}{flag}")
+
+    missing = [name for name in baseline if args.filter in name and name not in current]
+    for name in missing:
+        print(f"{name:<60} missing from {args.current}")
+
+    print(f"\n{compared} compared, {regressions} slower than {args.max_slowdown:.0%}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())